@@ -66,8 +66,8 @@ int32_t OH_TrafficFilter_ClearRedirectRule(OH_TrafficFilter_Redirector* redirect
     return RedirectorAdapterManager::GetInstance().ClearRedirectRule(redirector);
 }
 
-int32_t OH_TrafficFilter_QueryProcess(const OH_TrafficFilter_ConnectionInfo* connectionInfo,
-    OH_TrafficFilter_ProcessInfo* processInfo)
+static int32_t CheckQueryProcessParams(const OH_TrafficFilter_ConnectionInfo* connectionInfo,
+    const OH_TrafficFilter_ProcessInfo* processInfo)
 {
     if (connectionInfo == nullptr || processInfo == nullptr) {
         NETMGR_EXT_LOG_E("QueryProcess: connectionInfo or processInfo is null");
@@ -108,8 +108,41 @@ int32_t OH_TrafficFilter_QueryProcess(const OH_TrafficFilter_ConnectionInfo* con
         NETMGR_EXT_LOG_E("QueryProcess: invalid protocol=%{public}u", connectionInfo->protocol);
         return OH_TRAFFICFILTER_ERROR_INVALID_PARAM;
     }
+    return OH_TRAFFICFILTER_OK;
+}
+
+int32_t OH_TrafficFilter_QueryProcess(const OH_TrafficFilter_ConnectionInfo* connectionInfo,
+    OH_TrafficFilter_ProcessInfo* processInfo)
+{
+    int32_t ret = CheckQueryProcessParams(connectionInfo, processInfo);
+    if (ret != OH_TRAFFICFILTER_OK) {
+        return ret;
+    }
     return RedirectorAdapterManager::GetInstance().QueryProcess(connectionInfo, processInfo);
 }
+
+int32_t OH_TrafficFilter_QueryProcesses(const OH_TrafficFilter_ConnectionInfo* const* connectionInfos,
+    OH_TrafficFilter_ProcessInfo* const* processInfos, int32_t* results, uint32_t count)
+{
+    if (connectionInfos == nullptr || processInfos == nullptr || results == nullptr) {
+        NETMGR_EXT_LOG_E("QueryProcesses: connectionInfos, processInfos or results is null");
+        return OH_TRAFFICFILTER_ERROR_INVALID_PARAM;
+    }
+    if (count == 0 || count > OH_TRAFFICFILTER_MAX_QUERY_PROCESS_COUNT) {
+        NETMGR_EXT_LOG_E("QueryProcesses: invalid count=%{public}u, max=%{public}u",
+            count, OH_TRAFFICFILTER_MAX_QUERY_PROCESS_COUNT);
+        return OH_TRAFFICFILTER_ERROR_INVALID_PARAM;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        int32_t ret = CheckQueryProcessParams(connectionInfos[i], processInfos[i]);
+        if (ret != OH_TRAFFICFILTER_OK) {
+            NETMGR_EXT_LOG_E("QueryProcesses: invalid entry %{public}u", i);
+            return ret;
+        }
+    }
+    return RedirectorAdapterManager::GetInstance().QueryProcesses(connectionInfos, processInfos, results, count);
+}
+
 int32_t OH_TrafficFilter_AddPacketRule(OH_TrafficFilter_PacketController* controller,
     const OH_TrafficFilter_FilterRule* rule)
 {
@@ -121,6 +154,21 @@ int32_t OH_TrafficFilter_ClearPacketRule(OH_TrafficFilter_PacketController* cont
     return PacketControllerAdapterManager::GetInstance().ClearPacketRule(controller);
 }
 
+int32_t OH_TrafficFilter_GetPacketControllerStats(OH_TrafficFilter_PacketController* controller,
+    OH_TrafficFilter_PacketControllerStats* stats)
+{
+    if (controller == nullptr || stats == nullptr) {
+        NETMGR_EXT_LOG_E("GetPacketControllerStats: controller or stats is NULL");
+        return OH_TRAFFICFILTER_ERROR_INVALID_PARAM;
+    }
+    if (stats->size < PACKET_CONTROLLER_STATS_MIN_SIZE) {
+        NETMGR_EXT_LOG_E("GetPacketControllerStats: invalid stats size=%{public}u, min=%{public}u",
+            stats->size, PACKET_CONTROLLER_STATS_MIN_SIZE);
+        return OH_TRAFFICFILTER_ERROR_INVALID_PARAM;
+    }
+    return PacketControllerAdapterManager::GetInstance().GetPacketControllerStats(controller, stats);
+}
+
 int32_t OH_TrafficFilter_CreatePacketController(
     uint32_t group_id,
     uint32_t priority,
@@ -13,10 +13,13 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <cctype>
+#include <cerrno>
 #include <cstddef>
 #include <cstring>
+#include <memory>
 #include <string>
 #include "net_trafficfilter_adapter.h"
 #include "netfirewall_client.h"
@@ -24,6 +27,8 @@
 #include "netmgr_ext_log_wrapper.h"
 
 #include <poll.h>
+#include <sched.h>
+#include <unistd.h>
 #include <sys/socket.h>
 #include <linux/netlink.h>
 
@@ -60,7 +65,22 @@ static constexpr uint8_t UDP_HEADER_LEN = 8;
 static constexpr uint8_t TCP_DATA_OFFSET_MASK = 0xF0;
 static constexpr uint8_t TCP_DATA_OFFSET_SHIFT = 4;
 static constexpr uint8_t TCP_DATA_OFFSET_UNIT = 4;
-static constexpr uint16_t MAX_PACKET_HEADER_SIZE = 256;
+static constexpr uint16_t MAX_PACKET_HEADER_SIZE = NFQ_PACKET_HEADER_MAX;
+static constexpr size_t NFQ_RECV_SLOT_SIZE = 65536;
+static constexpr uint32_t NFQ_VERDICT_ACCEPT = 1;
+static constexpr int32_t NFQ_DIRECT_VERDICT_RETRY_MS = 1000;
+
+static constexpr uint8_t NFQ_HOOK_LOCAL_IN = 1;
+static constexpr uint8_t NFQ_HOOK_FORWARD = 2;
+static constexpr uint8_t NFQ_HOOK_LOCAL_OUT = 3;
+static constexpr uint8_t TCP_FLAGS_OFFSET = 13;
+static constexpr uint8_t TCP_WIRE_FLAG_FIN = 0x01;
+static constexpr uint8_t TCP_WIRE_FLAG_SYN = 0x02;
+static constexpr uint8_t TCP_WIRE_FLAG_RST = 0x04;
+static constexpr uint8_t TCP_WIRE_FLAG_PSH = 0x08;
+static constexpr uint8_t TCP_WIRE_FLAG_ACK = 0x10;
+static constexpr uint8_t TCP_WIRE_FLAG_URG = 0x20;
+static constexpr uint16_t HWADDR_ETHER_LEN = 6;
 
 static inline uint16_t NfqNlType(uint8_t subsys, uint8_t msg)
 {
@@ -998,6 +1018,46 @@ int32_t RedirectorAdapterManager::QueryProcess(const OH_TrafficFilter_Connection
     return OH_TRAFFICFILTER_OK;
 }
 
+int32_t RedirectorAdapterManager::QueryProcesses(const OH_TrafficFilter_ConnectionInfo* const* connectionInfos,
+    OH_TrafficFilter_ProcessInfo* const* processInfos, int32_t* results, uint32_t count)
+{
+    if (connectionInfos == nullptr || processInfos == nullptr || results == nullptr ||
+        count == 0 || count > OH_TRAFFICFILTER_MAX_QUERY_PROCESS_COUNT) {
+        NETMGR_EXT_LOG_E("QueryProcesses: invalid params, count=%{public}u", count);
+        return OH_TRAFFICFILTER_ERROR_INVALID_PARAM;
+    }
+    std::vector<TrafficFilterConnectionTuple> connections(count);
+    for (uint32_t i = 0; i < count; i++) {
+        const OH_TrafficFilter_ConnectionInfo* connectionInfo = connectionInfos[i];
+        if (connectionInfo == nullptr || processInfos[i] == nullptr) {
+            NETMGR_EXT_LOG_E("QueryProcesses: entry %{public}u is null", i);
+            return OH_TRAFFICFILTER_ERROR_INVALID_PARAM;
+        }
+        if (!ConvertTrafficFilterIpToString(connectionInfo->srcIp, connections[i].srcIp_) ||
+            !ConvertTrafficFilterIpToString(connectionInfo->dstIp, connections[i].dstIp_)) {
+            NETMGR_EXT_LOG_E("QueryProcesses: convert ip of entry %{public}u failed", i);
+            return OH_TRAFFICFILTER_ERROR_INVALID_PARAM;
+        }
+        connections[i].srcPort_ = connectionInfo->srcPort;
+        connections[i].dstPort_ = connectionInfo->dstPort;
+        connections[i].protocol_ = connectionInfo->protocol;
+    }
+
+    std::vector<TrafficFilterProcessOwner> owners;
+    int32_t ret = NetFirewallClient::GetInstance().QueryProcesses(connections, owners);
+    if (ret != OH_TRAFFICFILTER_OK) {
+        NETMGR_EXT_LOG_E("QueryProcesses: QueryProcesses failed, ret=%{public}d", ret);
+        return ret;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        results[i] = owners[i].result_;
+        if (owners[i].result_ == OH_TRAFFICFILTER_OK) {
+            FillProcessInfoBySize(processInfos[i], owners[i].pid_, owners[i].uid_);
+        }
+    }
+    return OH_TRAFFICFILTER_OK;
+}
+
 int32_t RedirectorAdapterManager::AddRedirector(
     const std::string& redirectorId, OH_TrafficFilter_Redirector** redirector)
 {
@@ -1072,6 +1132,18 @@ static void ConvertCConfigToIPCCfg(
     ipcConfig.packetCopyLen_ = cConfig->packetCopyLen;
     ipcConfig.nfqueueMaxlen_ = cConfig->nfqueueMaxlen;
     ipcConfig.nfqueueFlags_ = cConfig->nfqueueFlags;
+    if (IsFieldInSize(cConfig->size, offsetof(OH_TrafficFilter_Config, queueCount), sizeof(cConfig->queueCount)) &&
+        cConfig->queueCount > 1) {
+        ipcConfig.queueCount_ = cConfig->queueCount;
+    }
+    if (IsFieldInSize(cConfig->size, offsetof(OH_TrafficFilter_Config, enableFlowCache),
+        sizeof(cConfig->enableFlowCache))) {
+        ipcConfig.flowCache_ = cConfig->enableFlowCache;
+    }
+    if (IsFieldInSize(cConfig->size, offsetof(OH_TrafficFilter_Config, enableUserSpaceMatch),
+        sizeof(cConfig->enableUserSpaceMatch))) {
+        ipcConfig.userSpaceMatch_ = cConfig->enableUserSpaceMatch;
+    }
 }
 
 PacketControllerAdapterManager& PacketControllerAdapterManager::GetInstance()
@@ -1115,6 +1187,20 @@ int32_t PacketControllerAdapterManager::CheckConfig(const OH_TrafficFilter_Confi
     if (config->nfqueueMaxlen > NFQUEUE_MAXLEN) {
         return OH_TRAFFICFILTER_ERROR_INVALID_PARAM;
     }
+    if (IsFieldInSize(config->size, offsetof(OH_TrafficFilter_Config, recvBatchSize), sizeof(config->recvBatchSize))
+        && config->recvBatchSize > OH_TRAFFICFILTER_MAX_RECV_BATCH) {
+        return OH_TRAFFICFILTER_ERROR_INVALID_PARAM;
+    }
+    if (IsFieldInSize(config->size, offsetof(OH_TrafficFilter_Config, queueCount), sizeof(config->queueCount))
+        && config->queueCount > OH_TRAFFICFILTER_MAX_QUEUE_COUNT) {
+        return OH_TRAFFICFILTER_ERROR_INVALID_PARAM;
+    }
+    // rules matched in user space need the packet headers
+    if (IsFieldInSize(config->size, offsetof(OH_TrafficFilter_Config, enableUserSpaceMatch),
+        sizeof(config->enableUserSpaceMatch)) && config->enableUserSpaceMatch &&
+        config->packetCopyMode == OH_TRAFFICFILTER_COPY_MODE_META) {
+        return OH_TRAFFICFILTER_ERROR_INVALID_PARAM;
+    }
     return OH_TRAFFICFILTER_OK;
 }
 
@@ -1137,6 +1223,7 @@ int32_t PacketControllerAdapterManager::CreatePacketController(
     OHOS::sptr<TrafficFilterConfig> cppConfig = nullptr;
     uint32_t packetCopyMode = OH_TRAFFICFILTER_COPY_MODE_FULL;
     uint32_t nfqueueFlags = OH_TRAFFICFILTER_NFQUEUE_FLAG_FAIL_OPEN;
+    uint32_t recvBatchSize = 1;
     int32_t ret = CheckConfig(config);
     if (ret != OH_TRAFFICFILTER_OK) {
         return ret;
@@ -1150,6 +1237,10 @@ int32_t PacketControllerAdapterManager::CreatePacketController(
         ConvertCConfigToIPCCfg(config, *cppConfig);
         packetCopyMode = cppConfig->packetCopyMode_;
         nfqueueFlags = cppConfig->nfqueueFlags_;
+        if (IsFieldInSize(config->size, offsetof(OH_TrafficFilter_Config, recvBatchSize),
+            sizeof(config->recvBatchSize)) && config->recvBatchSize > 1) {
+            recvBatchSize = config->recvBatchSize;
+        }
     }
     std::string packetControllerId = "";
     int32_t fd = -1;
@@ -1159,11 +1250,30 @@ int32_t PacketControllerAdapterManager::CreatePacketController(
         NETMGR_EXT_LOG_E("CreatePacketController: failed, ret=%{public}d", ret);
         return ret;
     }
+    std::vector<int32_t> fanoutFds;
+    if (cppConfig != nullptr && cppConfig->queueCount_ > 1) {
+        ret = NetFirewallClient::GetInstance().GetPacketControllerFanoutFds(packetControllerId, fanoutFds);
+        if (ret != 0) {
+            NETMGR_EXT_LOG_E("CreatePacketController: get fanout fds failed, ret=%{public}d", ret);
+            NetFirewallClient::GetInstance().DestroyPacketController(packetControllerId);
+            return ret;
+        }
+    }
+    uint32_t flowCacheMark = 0;
+    if (cppConfig != nullptr && cppConfig->flowCache_ &&
+        NetFirewallClient::GetInstance().GetPacketControllerFlowMark(packetControllerId, flowCacheMark) != 0) {
+        NETMGR_EXT_LOG_W("CreatePacketController: flow cache unavailable");
+        flowCacheMark = 0;
+    }
     PacketInfo packetInfo {
         .packetControllerId = packetControllerId,
         .fd = fd,
         .packetCopyMode = packetCopyMode,
-        .nfqueueFlags = nfqueueFlags
+        .nfqueueFlags = nfqueueFlags,
+        .recvBatchSize = recvBatchSize,
+        .fanoutFds = fanoutFds,
+        .flowCacheMark = flowCacheMark,
+        .userSpaceMatch = cppConfig != nullptr && cppConfig->userSpaceMatch_
     };
     return AddPacketController(packetInfo, controller);
 }
@@ -1214,11 +1324,18 @@ void PacketControllerAdapterManager::RemovePacketController(OH_TrafficFilter_Pac
     if (controller == nullptr) {
         return;
     }
+    {
+        std::lock_guard<std::mutex> lock(ruleMutex_);
+        userSpaceRules_.erase(controller);
+    }
 
     {
         std::lock_guard<std::mutex> lock(mapMutex_);
         auto it = controllerIdMap_.find(controller);
         if (it != controllerIdMap_.end()) {
+            for (int32_t fanoutFd : it->second.fanoutFds) {
+                close(fanoutFd);
+            }
             controllerIdMap_.erase(it);
             delete controller;
         }
@@ -1259,6 +1376,9 @@ int32_t PacketControllerAdapterManager::AddPacketRule(OH_TrafficFilter_PacketCon
         NETMGR_EXT_LOG_E("AddPacketRule: NetFirewallClient::AddPacketRule failed, ret=%{public}d", ret);
         return static_cast<int32_t>(ret);
     }
+    if (packetInfo.userSpaceMatch) {
+        UpdateUserSpaceRules(controller, cppRule.GetRefPtr());
+    }
     NETMGR_EXT_LOG_I("AddPacketRule: success");
     return OH_TRAFFICFILTER_OK;
 }
@@ -1280,10 +1400,44 @@ int32_t PacketControllerAdapterManager::ClearPacketRule(OH_TrafficFilter_PacketC
         NETMGR_EXT_LOG_E("ClearPacketRule: NetFirewallClient::ClearPacketRule failed, ret=%{public}d", ret);
         return static_cast<int32_t>(ret);
     }
+    if (packetInfo.userSpaceMatch) {
+        UpdateUserSpaceRules(controller, nullptr);
+    }
     NETMGR_EXT_LOG_I("ClearPacketRule: success");
     return OH_TRAFFICFILTER_OK;
 }
 
+/*
+ * Recompiles the classifier of a controller matching in user space after its rules changed, nullptr clears them.
+ * The workers keep the classifier they loaded for the packet in flight.
+ */
+void PacketControllerAdapterManager::UpdateUserSpaceRules(OH_TrafficFilter_PacketController* controller,
+    const TrafficFilterPacketRule* rule)
+{
+    std::lock_guard<std::mutex> lock(ruleMutex_);
+    std::vector<TrafficFilterPacketRule> &rules = userSpaceRules_[controller];
+    if (rule != nullptr) {
+        rules.push_back(*rule);
+    } else {
+        rules.clear();
+    }
+    std::shared_ptr<const PacketRuleClassifier> classifier = PacketRuleClassifier::Build(rules);
+    if (classifier == nullptr) {
+        NETMGR_EXT_LOG_E("UpdateUserSpaceRules: classifier unavailable, no packet is delivered until rules change");
+    }
+    PublishClassifier(controller, classifier);
+}
+
+void PacketControllerAdapterManager::PublishClassifier(OH_TrafficFilter_PacketController* controller,
+    const std::shared_ptr<const PacketRuleClassifier>& classifier)
+{
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    std::atomic_store(&controller->classifier, classifier);
+    for (auto &worker : controller->fanoutWorkers) {
+        std::atomic_store(&worker->classifier, classifier);
+    }
+}
+
 static inline const struct nlattr *NlaGetNext(const struct nlattr *nla, int *remaining)
 {
     int aligned = NLA_ALIGN(nla->nla_len);
@@ -1305,7 +1459,7 @@ static inline int NlaPayloadLen(const struct nlattr *nla)
 
 static inline void *NlaPayload(const struct nlattr *nla)
 {
-    return reinterpret_cast<void *>(reinterpret_cast<char *>(nla) + NLA_HDRLEN);
+    return const_cast<char *>(reinterpret_cast<const char *>(nla)) + NLA_HDRLEN;
 }
 
 static void NfqParsePacketHdr(NfqPkt *pkt, const void *data, int dlen)
@@ -1513,26 +1667,18 @@ static uint16_t ClampHeaderLength(uint16_t totalHeaderLen, uint16_t payloadLen)
     return totalHeaderLen;
 }
 
-static bool AllocateAndCopyHeader(uint8_t *payload, uint16_t headerLen, uint8_t **headerBuffer)
+static bool CopyHeaderToArena(uint8_t *payload, uint16_t headerLen, uint8_t *arena, uint16_t arenaSize)
 {
-    if (payload == nullptr || headerBuffer == nullptr || headerLen == 0 || headerLen > MAX_PACKET_HEADER_SIZE) {
-        return false;
-    }
-    *headerBuffer = new (std::nothrow) uint8_t[headerLen];
-    if (*headerBuffer == nullptr) {
-        return false;
-    }
-    if (memcpy_s(*headerBuffer, headerLen, payload, headerLen) != 0) {
-        delete[] *headerBuffer;
-        *headerBuffer = nullptr;
+    if (payload == nullptr || arena == nullptr || headerLen == 0 || headerLen > arenaSize) {
         return false;
     }
-    return true;
+    return memcpy_s(arena, arenaSize, payload, headerLen) == 0;
 }
 
-static bool ExtractPacketHeader(uint8_t *payload, uint16_t payloadLen, uint8_t **headerBuffer, uint16_t *headerLen)
+static bool ExtractPacketHeader(uint8_t *payload, uint16_t payloadLen, uint8_t *arena, uint16_t arenaSize,
+    uint16_t *headerLen)
 {
-    if (payload == nullptr || payloadLen < IPV4_HEADER_MIN_LEN || headerBuffer == nullptr || headerLen == nullptr) {
+    if (payload == nullptr || payloadLen < IPV4_HEADER_MIN_LEN || arena == nullptr || headerLen == nullptr) {
         return false;
     }
     uint16_t ipHeaderLen = 0;
@@ -1542,20 +1688,13 @@ static bool ExtractPacketHeader(uint8_t *payload, uint16_t payloadLen, uint8_t *
     }
     uint16_t transportHeaderLen = GetTransportHeaderLength(payload, payloadLen, ipHeaderLen, protocol);
     uint16_t totalHeaderLen = ClampHeaderLength(ipHeaderLen + transportHeaderLen, payloadLen);
-    if (!AllocateAndCopyHeader(payload, totalHeaderLen, headerBuffer)) {
+    if (!CopyHeaderToArena(payload, totalHeaderLen, arena, arenaSize)) {
         return false;
     }
     *headerLen = totalHeaderLen;
     return true;
 }
 
-static void FreePacketHeader(uint8_t *headerBuffer)
-{
-    if (headerBuffer != nullptr) {
-        delete[] headerBuffer;
-    }
-}
-
 static void DetectPacketIdGap(OH_TrafficFilter_PacketController *controller, uint32_t packetId)
 {
     if (controller->isFirstPacket) {
@@ -1563,6 +1702,9 @@ static void DetectPacketIdGap(OH_TrafficFilter_PacketController *controller, uin
         controller->lastPacketId = packetId;
     } else {
         int32_t diff = static_cast<int32_t>(packetId - controller->lastPacketId);
+        if (diff > 1) {
+            controller->stats->queueDrops.fetch_add(static_cast<uint64_t>(diff - 1), std::memory_order_relaxed);
+        }
         if (diff != 1 && !(controller->lastPacketId == 0xFFFFFFFFU && packetId == 0)) {
             if (controller->nfqueueFlags == OH_TRAFFICFILTER_NFQUEUE_FLAG_FAIL_OPEN) {
                 NETMGR_EXT_LOG_I("Packet ID gap detected: last=%{public}u, current=%{public}u ,packets is accepted",
@@ -1576,6 +1718,68 @@ static void DetectPacketIdGap(OH_TrafficFilter_PacketController *controller, uin
     }
 }
 
+static int32_t GetHookPointByNfHook(uint8_t hook)
+{
+    switch (hook) {
+        case NFQ_HOOK_LOCAL_IN:  return static_cast<int32_t>(TrafficFilterHookPoint::HOOK_INPUT);
+        case NFQ_HOOK_FORWARD:   return static_cast<int32_t>(TrafficFilterHookPoint::HOOK_FORWARD);
+        case NFQ_HOOK_LOCAL_OUT: return static_cast<int32_t>(TrafficFilterHookPoint::HOOK_OUTPUT);
+        default: return -1;
+    }
+}
+
+// Converts the flags byte of a TCP header to the OH_TRAFFICFILTER_TCP_FLAG_* bits
+static bool ParseTcpFlags(const uint8_t *payload, uint16_t payloadLen, uint8_t &flags)
+{
+    static constexpr std::pair<uint8_t, uint8_t> TCP_FLAG_BITS[] = {
+        {TCP_WIRE_FLAG_FIN, OH_TRAFFICFILTER_TCP_FLAG_FIN}, {TCP_WIRE_FLAG_SYN, OH_TRAFFICFILTER_TCP_FLAG_SYN},
+        {TCP_WIRE_FLAG_RST, OH_TRAFFICFILTER_TCP_FLAG_RST}, {TCP_WIRE_FLAG_PSH, OH_TRAFFICFILTER_TCP_FLAG_PSH},
+        {TCP_WIRE_FLAG_ACK, OH_TRAFFICFILTER_TCP_FLAG_ACK}, {TCP_WIRE_FLAG_URG, OH_TRAFFICFILTER_TCP_FLAG_URG},
+    };
+    uint16_t ipHeaderLen = 0;
+    uint8_t protocol = 0;
+    if (!ParseIPHeaderLength(const_cast<uint8_t *>(payload), payloadLen, ipHeaderLen, protocol) ||
+        protocol != OH_TRAFFICFILTER_PROTO_TCP || payloadLen <= ipHeaderLen + TCP_FLAGS_OFFSET) {
+        return false;
+    }
+    uint8_t wireFlags = payload[ipHeaderLen + TCP_FLAGS_OFFSET];
+    flags = 0;
+    for (const auto &bit : TCP_FLAG_BITS) {
+        if (wireFlags & bit.first) {
+            flags |= bit.second;
+        }
+    }
+    return true;
+}
+
+static bool ShouldDeliverPacket(OH_TrafficFilter_PacketController *controller, const NfqPkt &pkt,
+    const uint8_t *payload, uint16_t payloadLen, const OH_TrafficFilter_PacketDesc &packet)
+{
+    if (!controller->userSpaceMatch) {
+        return true;
+    }
+    // before the rules are compiled, or after compiling them failed, nothing is known to match
+    std::shared_ptr<const PacketRuleClassifier> classifier = std::atomic_load(&controller->classifier);
+    if (classifier == nullptr) {
+        return false;
+    }
+    ClassifierPacket input;
+    input.hookPoint = GetHookPointByNfHook(pkt.hook);
+    input.family = static_cast<int32_t>((packet.srcIp.family == OH_TRAFFICFILTER_IP_FAMILY_V4) ?
+        TrafficFilterIPFamily::IP_FAMILY_V4 : TrafficFilterIPFamily::IP_FAMILY_V6);
+    input.srcAddr = packet.srcIp.addr;
+    input.dstAddr = packet.dstIp.addr;
+    input.protocol = packet.protocol;
+    input.hasPorts = packet.protocol == OH_TRAFFICFILTER_PROTO_TCP || packet.protocol == OH_TRAFFICFILTER_PROTO_UDP;
+    input.srcPort = packet.srcPort;
+    input.dstPort = packet.dstPort;
+    input.hasTcpFlags = ParseTcpFlags(payload, payloadLen, input.tcpFlags);
+    input.indev = pkt.indev;
+    input.outdev = pkt.outdev;
+    input.srcMac = (pkt.hwAddrlen == HWADDR_ETHER_LEN) ? pkt.hwAddr : nullptr;
+    return classifier->ShouldDeliver(input);
+}
+
 static int32_t HandlePacketMessage(OH_TrafficFilter_PacketController *controller, struct nlmsghdr *nlh)
 {
     struct NfqNfg *nfg = static_cast<struct NfqNfg *>(NLMSG_DATA(nlh));
@@ -1589,24 +1793,28 @@ static int32_t HandlePacketMessage(OH_TrafficFilter_PacketController *controller
     NfqPktParseAttrs(&pkt, attrStart, attrRemaining);
 
     uint32_t packetId = NfqPktId(&pkt);
+    NfqWorkerStats &stats = *controller->stats;
+    stats.packetsReceived.fetch_add(1, std::memory_order_relaxed);
     DetectPacketIdGap(controller, packetId);
     const void *payload = nullptr;
     size_t payloadLen = 0;
     if (NfqPktPayload(&pkt, &payload, &payloadLen) < 0 || payload == nullptr) {
         NETMGR_EXT_LOG_W("NFQA_PAYLOAD missing or truncated, accepting standard packet");
-        PacketControllerAdapterManager::GetInstance().SendVerdict(queueNum, packetId, 0, 0);
+        stats.packetsBypassed.fetch_add(1, std::memory_order_relaxed);
+        PacketControllerAdapterManager::GetInstance().QueueVerdict(controller, queueNum, packetId, 0);
         return OH_TRAFFICFILTER_OK;
     }
     OH_TrafficFilter_PacketDesc packet = {};
-    uint8_t *headerBuffer = nullptr;
     uint16_t headerLen = 0;
     if (controller->packetCopyMode == OH_TRAFFICFILTER_COPY_MODE_HEADER) {
         if (!ExtractPacketHeader(static_cast<uint8_t*>(const_cast<void*>(payload)),
-            static_cast<uint16_t>(payloadLen), &headerBuffer, &headerLen)) {
-            PacketControllerAdapterManager::GetInstance().SendVerdict(queueNum, packetId, 0, 0);
+            static_cast<uint16_t>(payloadLen), controller->headerArena, sizeof(controller->headerArena),
+            &headerLen)) {
+            stats.packetsBypassed.fetch_add(1, std::memory_order_relaxed);
+            PacketControllerAdapterManager::GetInstance().QueueVerdict(controller, queueNum, packetId, 0);
             return OH_TRAFFICFILTER_OK;
         }
-        packet.data = headerBuffer;
+        packet.data = controller->headerArena;
         packet.packetLen = headerLen;
         payloadLen = headerLen;
     } else {
@@ -1615,23 +1823,162 @@ static int32_t HandlePacketMessage(OH_TrafficFilter_PacketController *controller
     packet.userData = controller->userData;
     if (!ParsePacketPayload(static_cast<uint8_t*>(const_cast<void*>(payload)),
         static_cast<uint16_t>(payloadLen), packet)) {
-        FreePacketHeader(headerBuffer);
-        PacketControllerAdapterManager::GetInstance().SendVerdict(queueNum, packetId, 0, 0);
+        stats.packetsBypassed.fetch_add(1, std::memory_order_relaxed);
+        PacketControllerAdapterManager::GetInstance().QueueVerdict(controller, queueNum, packetId, 0);
         return OH_TRAFFICFILTER_OK;
     }
 
+    // packets no rule selects are queued only because the rules are matched here, they bypass the callback and
+    // the flow cache so later packets of the flow are classified again
+    if (!ShouldDeliverPacket(controller, pkt, static_cast<const uint8_t*>(payload),
+        static_cast<uint16_t>(payloadLen), packet)) {
+        stats.packetsBypassed.fetch_add(1, std::memory_order_relaxed);
+        PacketControllerAdapterManager::GetInstance().QueueVerdict(controller, queueNum, packetId,
+            NFQ_VERDICT_ACCEPT, false);
+        return OH_TRAFFICFILTER_OK;
+    }
+
+    auto callbackStart = std::chrono::steady_clock::now();
     int verdict = controller->callback(&packet, controller->userData) == OH_TRAFFICFILTER_DECISION_ACCEPT? 1 : 0;
-    FreePacketHeader(headerBuffer);
-    return PacketControllerAdapterManager::GetInstance().SendVerdict(queueNum, packetId, verdict, 0);
+    stats.callbackLatency.Record(TrafficFilterLatencyHistogram::ElapsedNs(callbackStart));
+    PacketControllerAdapterManager::GetInstance().QueueVerdict(controller, queueNum, packetId, verdict);
+    return OH_TRAFFICFILTER_OK;
 }
 
-static bool HandleNetlinkError(struct nlmsghdr *nlh, int &remainingLen)
+static inline struct nlattr *NlaPut(struct nlmsghdr *nlh, uint16_t type, const void *data, uint16_t len)
 {
-    struct nlmsgerr *err = static_cast<struct nlmsgerr *>(NLMSG_DATA(nlh));
-    if (err->error == 0) {
-        nlh = NLMSG_NEXT(nlh, remainingLen);
+    struct nlattr *nla = reinterpret_cast<struct nlattr *>(reinterpret_cast<char *>(nlh) +
+        NLMSG_ALIGN(nlh->nlmsg_len));
+    nla->nla_type = type;
+    nla->nla_len = static_cast<uint16_t>(NLA_HDRLEN + len);
+    memcpy_s(NlaPayload(nla), len, data, len);
+    nlh->nlmsg_len = NLMSG_ALIGN(nlh->nlmsg_len) + NLA_ALIGN(nla->nla_len);
+    return nla;
+}
+
+/*
+ * Sets the flow cache bits of the packet's conntrack entry, leaving the other bits of the mark untouched.
+ */
+static void NfqPutCtMark(struct nlmsghdr *nlh, uint32_t ctMark)
+{
+    struct nlattr *nest = reinterpret_cast<struct nlattr *>(reinterpret_cast<char *>(nlh) +
+        NLMSG_ALIGN(nlh->nlmsg_len));
+    nest->nla_type = NFQA_CT | NLA_F_NESTED;
+    nlh->nlmsg_len = NLMSG_ALIGN(nlh->nlmsg_len) + NLA_HDRLEN;
+    uint32_t netMark = htonl(ctMark);
+    uint32_t netMask = htonl(NETTRAFFICFILTER_FLOW_CACHE_MASK);
+    NlaPut(nlh, CTA_MARK, &netMark, sizeof(netMark));
+    NlaPut(nlh, CTA_MARK_MASK, &netMask, sizeof(netMask));
+    nest->nla_len = static_cast<uint16_t>(reinterpret_cast<char *>(nlh) + nlh->nlmsg_len -
+        reinterpret_cast<char *>(nest));
+}
+
+/*
+ * Writes a verdict straight onto the controller's own netlink socket. The fd handed out by the service is the
+ * socket bound to the queue, so the kernel accepts the verdict without a round trip through netsys. With
+ * NFQNL_MSG_VERDICT_BATCH the verdict applies to every queued packet whose id is not greater than packetId,
+ * the kernel ignores ctMark there. A rejected message is answered with an error carrying seq, batch messages
+ * ask for an acknowledgement as well.
+ */
+static int32_t NfqSendVerdictMsg(int fd, uint32_t seq, uint16_t msgType, uint16_t queueNum, uint32_t packetId,
+    uint32_t verdict, uint32_t mark, uint32_t ctMark = 0)
+{
+    alignas(NLMSG_ALIGNTO) char buf[NLMSG_SPACE(sizeof(struct NfqNfg)) +
+        NLA_ALIGN(NLA_HDRLEN + sizeof(struct NfqVerdictHdr)) + NLA_ALIGN(NLA_HDRLEN + sizeof(uint32_t)) +
+        NLA_HDRLEN + 2 * NLA_ALIGN(NLA_HDRLEN + sizeof(uint32_t))] = {0};
+    struct nlmsghdr *nlh = reinterpret_cast<struct nlmsghdr *>(buf);
+    nlh->nlmsg_len = NLMSG_LENGTH(sizeof(struct NfqNfg));
+    nlh->nlmsg_type = NfqNlType(NFNL_SUBSYS_QUEUE, msgType);
+    nlh->nlmsg_flags = (msgType == NFQNL_MSG_VERDICT_BATCH) ? (NLM_F_REQUEST | NLM_F_ACK) : NLM_F_REQUEST;
+    nlh->nlmsg_seq = seq;
+    struct NfqNfg *nfg = static_cast<struct NfqNfg *>(NLMSG_DATA(nlh));
+    nfg->family = AF_UNSPEC;
+    nfg->version = 0;
+    nfg->resId = htons(queueNum);
+    struct NfqVerdictHdr vh = { htonl(verdict), htonl(packetId) };
+    NlaPut(nlh, NFQA_VERDICT_HDR, &vh, sizeof(vh));
+    if (mark != 0) {
+        uint32_t netMark = htonl(mark);
+        NlaPut(nlh, NFQA_MARK, &netMark, sizeof(netMark));
+    }
+    if (ctMark != 0 && msgType == NFQNL_MSG_VERDICT) {
+        NfqPutCtMark(nlh, ctMark);
+    }
+    struct sockaddr_nl kernel = {};
+    kernel.nl_family = AF_NETLINK;
+    ssize_t sent = sendto(fd, buf, nlh->nlmsg_len, 0, reinterpret_cast<struct sockaddr *>(&kernel), sizeof(kernel));
+    if (sent != static_cast<ssize_t>(nlh->nlmsg_len)) {
+        NETMGR_EXT_LOG_E("NfqSendVerdictMsg failed, errno=%{public}d", errno);
+        return OH_TRAFFICFILTER_ERROR_NFQUEUE_ERROR;
+    }
+    return OH_TRAFFICFILTER_OK;
+}
+
+/*
+ * Remembers the packet ids a verdict message decides under a new sequence number. The kernel answers before the
+ * next receive round is handled, the ring holds more messages than a round can send.
+ */
+static uint32_t TrackVerdictMsg(OH_TrafficFilter_PacketController *controller, uint32_t firstId, uint32_t lastId)
+{
+    NfqVerdictBatch &batch = controller->verdictBatch;
+    if (++batch.lastSeq == 0) {
+        batch.lastSeq = 1;
+    }
+    batch.pending[batch.lastSeq % NFQ_PENDING_VERDICT_MAX] =
+        { batch.lastSeq, batch.queueNum, batch.verdict, firstId, lastId };
+    return batch.lastSeq;
+}
+
+static void ReleaseVerdictMsg(OH_TrafficFilter_PacketController *controller, uint32_t seq)
+{
+    controller->verdictBatch.pending[seq % NFQ_PENDING_VERDICT_MAX].seq = 0;
+}
+
+/*
+ * Looks up the verdict message an error or acknowledgement answers. The ids of a rejected message are sent
+ * through the service one by one, unless none of them is queued any more. Returns false for other messages.
+ */
+static bool HandleVerdictAnswer(OH_TrafficFilter_PacketController *controller, const struct nlmsgerr &err)
+{
+    uint32_t seq = err.msg.nlmsg_seq;
+    NfqPendingVerdict &pending = controller->verdictBatch.pending[seq % NFQ_PENDING_VERDICT_MAX];
+    if (seq == 0 || pending.seq != seq) {
+        return false;
+    }
+    pending.seq = 0;
+    if (err.error == 0 || err.error == -ENOENT) {
         return true;
     }
+    NETMGR_EXT_LOG_W("verdict for ids %{public}u-%{public}u rejected, errno=%{public}d, using service for "
+        "%{public}d ms", pending.firstId, pending.lastId, -err.error, NFQ_DIRECT_VERDICT_RETRY_MS);
+    controller->directVerdictRetry = std::chrono::steady_clock::now() +
+        std::chrono::milliseconds(NFQ_DIRECT_VERDICT_RETRY_MS);
+    uint32_t count = 0;
+    for (uint32_t id = pending.firstId;; id++) {
+        PacketControllerAdapterManager::GetInstance().SendVerdict(pending.queueNum, id,
+            static_cast<int32_t>(pending.verdict), 0);
+        count++;
+        if (id == pending.lastId) {
+            break;
+        }
+    }
+    controller->stats->serviceVerdicts.fetch_add(count, std::memory_order_relaxed);
+    return true;
+}
+
+static bool HandleNetlinkError(OH_TrafficFilter_PacketController *controller,
+    struct nlmsghdr *&nlh, int &remainingLen)
+{
+    struct nlmsgerr *err = static_cast<struct nlmsgerr *>(NLMSG_DATA(nlh));
+    bool complete = nlh->nlmsg_len >= NLMSG_LENGTH(sizeof(struct nlmsgerr));
+    nlh = NLMSG_NEXT(nlh, remainingLen);
+    if (!complete) {
+        NETMGR_EXT_LOG_W("truncated netlink error message");
+        return false;
+    }
+    if (HandleVerdictAnswer(controller, *err) || err->error == 0) {
+        return err->error == 0;
+    }
     int realErrno = -err->error;
     NETMGR_EXT_LOG_E("FATAL: Kernel rejected us! errno = %{public}d, description = %{public}s",
                      realErrno, strerror(realErrno));
@@ -1639,12 +1986,10 @@ static bool HandleNetlinkError(struct nlmsghdr *nlh, int &remainingLen)
 }
 
 static void ProcessNetlinkMessage(OH_TrafficFilter_PacketController *controller,
-    struct nlmsghdr *nlh, int &remainingLen)
+    struct nlmsghdr *&nlh, int &remainingLen)
 {
     if (nlh->nlmsg_type == NLMSG_ERROR) {
-        if (!HandleNetlinkError(nlh, remainingLen)) {
-            return;
-        }
+        HandleNetlinkError(controller, nlh, remainingLen);
     } else if (nlh->nlmsg_type == NLMSG_DONE) {
         nlh = NLMSG_NEXT(nlh, remainingLen);
     } else if (nlh->nlmsg_type == NfqNlType(NFNL_SUBSYS_QUEUE, NFQ_MSG_PACKET)) {
@@ -1656,14 +2001,110 @@ static void ProcessNetlinkMessage(OH_TrafficFilter_PacketController *controller,
     }
 }
 
+static void ProcessNetlinkBuffer(OH_TrafficFilter_PacketController *controller, char *buf, ssize_t len)
+{
+    struct nlmsghdr *nlh = reinterpret_cast<struct nlmsghdr *>(buf);
+    int remainingLen = static_cast<int>(len);
+    while (NLMSG_OK(nlh, remainingLen)) {
+        ProcessNetlinkMessage(controller, nlh, remainingLen);
+    }
+}
+
+/*
+ * ENOBUFS means the kernel could not queue some packet messages to a full socket buffer. The socket stays usable,
+ * the packets that were lost show up as a gap in the packet ids.
+ */
+static bool CountReceiveOverrun(OH_TrafficFilter_PacketController *controller)
+{
+    if (errno != ENOBUFS) {
+        return false;
+    }
+    if (controller->stats->enobufsEvents.fetch_add(1, std::memory_order_relaxed) == 0) {
+        NETMGR_EXT_LOG_W("netlink receive buffer overrun on queue worker %{public}u", controller->workerIndex);
+    }
+    return true;
+}
+
+/*
+ * Receives one netlink datagram per call. Returns false when the socket is no longer usable.
+ */
+static bool ReceiveSingle(OH_TrafficFilter_PacketController *controller, char *buf, size_t bufLen)
+{
+    ssize_t recvLen = recv(controller->fd, buf, bufLen, 0);
+    if (recvLen <= 0) {
+        return recvLen < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || CountReceiveOverrun(controller));
+    }
+    ProcessNetlinkBuffer(controller, buf, recvLen);
+    return true;
+}
+
+/*
+ * Drains up to recvBatchSize datagrams with a single recvmmsg() call. Each datagram gets its own slot of
+ * slotLen bytes inside buf, so verdicts for the whole burst are flushed together afterwards.
+ */
+static bool ReceiveBatch(OH_TrafficFilter_PacketController *controller, char *buf, size_t slotLen)
+{
+    struct mmsghdr msgs[OH_TRAFFICFILTER_MAX_RECV_BATCH];
+    struct iovec iovs[OH_TRAFFICFILTER_MAX_RECV_BATCH];
+    uint32_t batchSize = controller->recvBatchSize;
+    memset_s(msgs, sizeof(msgs), 0, sizeof(msgs));
+    for (uint32_t i = 0; i < batchSize; i++) {
+        iovs[i].iov_base = buf + i * slotLen;
+        iovs[i].iov_len = slotLen;
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    int count = recvmmsg(controller->fd, msgs, batchSize, MSG_DONTWAIT, nullptr);
+    if (count <= 0) {
+        return count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ||
+            CountReceiveOverrun(controller));
+    }
+    for (int i = 0; i < count; i++) {
+        ProcessNetlinkBuffer(controller, static_cast<char *>(iovs[i].iov_base), msgs[i].msg_len);
+    }
+    return true;
+}
+
+/*
+ * With --queue-cpu-fanout the kernel queues a packet received on cpu c to queue (first + c % workerCount), so
+ * worker i is kept on exactly those CPUs and handles its packets where they were received.
+ */
+static void PinWorkerToQueueCpus(const OH_TrafficFilter_PacketController *controller)
+{
+    if (controller->workerCount <= 1) {
+        return;
+    }
+    long cpuCount = sysconf(_SC_NPROCESSORS_CONF);
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    bool hasCpu = false;
+    for (long cpu = 0; cpu < cpuCount && cpu < CPU_SETSIZE; cpu++) {
+        if (static_cast<uint32_t>(cpu) % controller->workerCount == controller->workerIndex) {
+            CPU_SET(cpu, &cpuSet);
+            hasCpu = true;
+        }
+    }
+    if (hasCpu && sched_setaffinity(0, sizeof(cpuSet), &cpuSet) != 0) {
+        NETMGR_EXT_LOG_W("PinWorkerToQueueCpus: worker %{public}u, errno=%{public}d", controller->workerIndex, errno);
+    }
+}
+
 static void *PacketWorkerThread(void *arg)
 {
     OH_TrafficFilter_PacketController *controller = static_cast<OH_TrafficFilter_PacketController *>(arg);
     if (!controller || controller->fd < 0) {
         return nullptr;
     }
+    PinWorkerToQueueCpus(controller);
     int fd = controller->fd;
-    alignas(NLMSG_ALIGNTO) char buf[65536];
+    uint32_t batchSize = controller->recvBatchSize;
+    std::unique_ptr<char[]> buf(new (std::nothrow) char[NFQ_RECV_SLOT_SIZE * batchSize]);
+    if (buf == nullptr) {
+        NETMGR_EXT_LOG_E("PacketWorkerThread: failed to allocate receive buffer");
+        controller->running.store(false);
+        controller->callbackRegistered.store(false);
+        return nullptr;
+    }
     struct pollfd pfd{ fd, POLLIN, 0 };
     while (controller->running.load()) {
         int ret = poll(&pfd, 1, 500);
@@ -1676,19 +2117,14 @@ static void *PacketWorkerThread(void *arg)
         if (ret == 0 || !(pfd.revents & POLLIN)) {
             continue;
         }
-        ssize_t recvLen = recv(fd, buf, sizeof(buf), 0);
-        if (recvLen <= 0) {
-            if (recvLen < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
-                continue;
-            }
+        bool ok = (batchSize > 1) ? ReceiveBatch(controller, buf.get(), NFQ_RECV_SLOT_SIZE) :
+            ReceiveSingle(controller, buf.get(), NFQ_RECV_SLOT_SIZE);
+        PacketControllerAdapterManager::GetInstance().FlushVerdicts(controller);
+        if (!ok) {
             break;
         }
-        struct nlmsghdr *nlh = reinterpret_cast<struct nlmsghdr *>(buf);
-        int remainingLen = static_cast<int>(recvLen);
-        while (NLMSG_OK(nlh, remainingLen)) {
-            ProcessNetlinkMessage(controller, nlh, remainingLen);
-        }
     }
+    PacketControllerAdapterManager::GetInstance().FlushVerdicts(controller);
     controller->running.store(false);
     controller->callbackRegistered.store(false);
     return nullptr;
@@ -1701,6 +2137,107 @@ int32_t PacketControllerAdapterManager::SendVerdict(int32_t queueNum, uint32_t p
     return ret;
 }
 
+void PacketControllerAdapterManager::QueueVerdict(OH_TrafficFilter_PacketController* controller,
+    uint16_t queueNum, uint32_t packetId, int32_t verdict, bool cacheFlow)
+{
+    if (static_cast<uint32_t>(verdict) == NFQ_VERDICT_ACCEPT) {
+        controller->stats->packetsAccepted.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        controller->stats->packetsDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    NfqVerdictBatch &batch = controller->verdictBatch;
+    if (batch.count > 0 && (batch.queueNum != queueNum || batch.verdict != static_cast<uint32_t>(verdict) ||
+        batch.cacheFlow != cacheFlow || batch.count >= NFQ_VERDICT_BATCH_MAX)) {
+        FlushVerdicts(controller);
+    }
+    batch.queueNum = queueNum;
+    batch.verdict = static_cast<uint32_t>(verdict);
+    batch.cacheFlow = cacheFlow;
+    batch.packetIds[batch.count++] = packetId;
+}
+
+/*
+ * A batch verdict covers every queued id up to the last one. No other worker reads the queue, as every queue has
+ * its own socket, but packets whose messages were lost to a receive overrun are still queued and must not be
+ * decided unseen: the batch is only used for ids that follow the last decided one without a gap.
+ */
+static bool CanBatchVerdicts(const OH_TrafficFilter_PacketController *controller)
+{
+    const NfqVerdictBatch &batch = controller->verdictBatch;
+    if (controller->flowCacheMark != 0 || batch.count <= 1 || !batch.hasDecided) {
+        return false;
+    }
+    uint32_t expected = batch.lastDecidedId;
+    for (uint32_t i = 0; i < batch.count; i++) {
+        if (batch.packetIds[i] != ++expected) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint32_t GetFlowCacheCtMark(const OH_TrafficFilter_PacketController *controller, uint32_t verdict)
+{
+    if (controller->flowCacheMark == 0) {
+        return 0;
+    }
+    return (verdict == NFQ_VERDICT_ACCEPT) ? controller->flowCacheMark :
+        (controller->flowCacheMark | NETTRAFFICFILTER_FLOW_CACHE_DROP);
+}
+
+void PacketControllerAdapterManager::FlushVerdicts(OH_TrafficFilter_PacketController* controller)
+{
+    NfqVerdictBatch &batch = controller->verdictBatch;
+    if (batch.count == 0) {
+        return;
+    }
+    uint32_t sent = 0;
+    TrafficFilterLatencyHistogram &latency = controller->stats->verdictLatency;
+    auto now = std::chrono::steady_clock::now();
+    if (now >= controller->directVerdictRetry) {
+        if (CanBatchVerdicts(controller)) {
+            auto start = std::chrono::steady_clock::now();
+            uint32_t seq = TrackVerdictMsg(controller, batch.packetIds[0], batch.packetIds[batch.count - 1]);
+            if (NfqSendVerdictMsg(controller->fd, seq, NFQNL_MSG_VERDICT_BATCH, batch.queueNum,
+                batch.packetIds[batch.count - 1], batch.verdict, 0) == OH_TRAFFICFILTER_OK) {
+                sent = batch.count;
+            } else {
+                ReleaseVerdictMsg(controller, seq);
+            }
+            latency.Record(TrafficFilterLatencyHistogram::ElapsedNs(start));
+        } else {
+            uint32_t ctMark = batch.cacheFlow ? GetFlowCacheCtMark(controller, batch.verdict) : 0;
+            while (sent < batch.count) {
+                auto start = std::chrono::steady_clock::now();
+                uint32_t seq = TrackVerdictMsg(controller, batch.packetIds[sent], batch.packetIds[sent]);
+                int32_t ret = NfqSendVerdictMsg(controller->fd, seq, NFQNL_MSG_VERDICT, batch.queueNum,
+                    batch.packetIds[sent], batch.verdict, 0, ctMark);
+                latency.Record(TrafficFilterLatencyHistogram::ElapsedNs(start));
+                if (ret != OH_TRAFFICFILTER_OK) {
+                    ReleaseVerdictMsg(controller, seq);
+                    break;
+                }
+                sent++;
+            }
+        }
+        // A refused send may be transient, the socket is tried again once the back-off is over
+        if (sent < batch.count) {
+            NETMGR_EXT_LOG_W("FlushVerdicts: direct verdict failed, using service for %{public}d ms",
+                NFQ_DIRECT_VERDICT_RETRY_MS);
+            controller->directVerdictRetry = now + std::chrono::milliseconds(NFQ_DIRECT_VERDICT_RETRY_MS);
+        }
+    }
+    for (uint32_t i = sent; i < batch.count; i++) {
+        auto start = std::chrono::steady_clock::now();
+        SendVerdict(batch.queueNum, batch.packetIds[i], static_cast<int32_t>(batch.verdict), 0);
+        latency.Record(TrafficFilterLatencyHistogram::ElapsedNs(start));
+    }
+    controller->stats->serviceVerdicts.fetch_add(batch.count - sent, std::memory_order_relaxed);
+    batch.hasDecided = true;
+    batch.lastDecidedId = batch.packetIds[batch.count - 1];
+    batch.count = 0;
+}
+
 int32_t PacketControllerAdapterManager::RegisterPacketCallback(OH_TrafficFilter_PacketController* controller,
     OH_TrafficFilter_PacketCallback callback, void* userData)
 {
@@ -1714,35 +2251,117 @@ int32_t PacketControllerAdapterManager::RegisterPacketCallback(OH_TrafficFilter_
         return OH_TRAFFICFILTER_ERROR_NOT_FOUND;
     }
     std::lock_guard<std::mutex> lock(callbackMutex_);
-    if (controller->running.load()) {
-        controller->running.store(false);
-        controller->callbackRegistered.store(false);
-        if (controller->workerThread != 0) {
-            pthread_join(controller->workerThread, nullptr);
-            controller->workerThread = 0;
-        }
-    }
+    StopWorkers(controller);
     callbackMap_[controller] = {callback, userData};
     controller->callback = callback;
     controller->userData = userData;
-    controller->callbackRegistered.store(true);
-    controller->running.store(true);
+    int32_t ret = StartWorkers(controller, packetInfo);
+    if (ret != OH_TRAFFICFILTER_OK) {
+        callbackMap_.erase(controller);
+        return ret;
+    }
+    NETMGR_EXT_LOG_I("RegisterPacketCallback: success");
+    return OH_TRAFFICFILTER_OK;
+}
+
+static void StopWorker(OH_TrafficFilter_PacketController* worker)
+{
+    worker->running.store(false);
+    worker->callbackRegistered.store(false);
+    if (worker->workerThread != 0) {
+        pthread_join(worker->workerThread, nullptr);
+        worker->workerThread = 0;
+    }
+}
+
+static int32_t StartWorker(OH_TrafficFilter_PacketController* worker)
+{
+    worker->directVerdictRetry = {};
+    worker->verdictBatch = NfqVerdictBatch();
+    worker->callbackRegistered.store(true);
+    worker->running.store(true);
+    int pthreadRet = pthread_create(&worker->workerThread, nullptr, PacketWorkerThread, worker);
+    if (pthreadRet != 0) {
+        NETMGR_EXT_LOG_E("pthread_create failed: %{public}s", strerror(pthreadRet));
+        worker->running.store(false);
+        worker->callbackRegistered.store(false);
+        worker->workerThread = 0;
+        return OH_TRAFFICFILTER_ERROR_NFQUEUE_ERROR;
+    }
+    return OH_TRAFFICFILTER_OK;
+}
+
+/*
+ * Starts one worker per queue. The controller handle drains the first queue, every fan-out queue gets an internal
+ * handle. Each queue has a socket of its own, read by its worker only.
+ */
+int32_t PacketControllerAdapterManager::StartWorkers(OH_TrafficFilter_PacketController* controller,
+    const PacketInfo& packetInfo)
+{
+    uint32_t workerCount = static_cast<uint32_t>(packetInfo.fanoutFds.size()) + 1;
     controller->fd = packetInfo.fd;
     controller->packetCopyMode = packetInfo.packetCopyMode;
     controller->nfqueueFlags = packetInfo.nfqueueFlags;
-    int pthreadRet = pthread_create(&controller->workerThread, nullptr, PacketWorkerThread, controller);
-    if (pthreadRet != 0) {
-        NETMGR_EXT_LOG_E("pthread_create failed: %{public}s", strerror(pthreadRet));
-        controller->running.store(false);
-        controller->callbackRegistered.store(false);
-        controller->workerThread = 0;
-        callbackMap_.erase(controller);
+    controller->recvBatchSize = packetInfo.recvBatchSize;
+    controller->workerIndex = 0;
+    controller->workerCount = workerCount;
+    controller->flowCacheMark = packetInfo.flowCacheMark;
+    controller->userSpaceMatch = packetInfo.userSpaceMatch;
+    controller->fanoutWorkers.clear();
+    while (controller->workerStats.size() < workerCount) {
+        std::unique_ptr<NfqWorkerStats> stats(new (std::nothrow) NfqWorkerStats());
+        if (stats == nullptr) {
+            NETMGR_EXT_LOG_E("StartWorkers: failed to allocate worker stats");
+            return OH_TRAFFICFILTER_ERROR_NFQUEUE_ERROR;
+        }
+        controller->workerStats.push_back(std::move(stats));
+    }
+    controller->stats = controller->workerStats[0].get();
+    for (uint32_t i = 1; i < workerCount; i++) {
+        std::unique_ptr<OH_TrafficFilter_PacketController> worker(
+            new (std::nothrow) OH_TrafficFilter_PacketController());
+        if (worker == nullptr) {
+            NETMGR_EXT_LOG_E("StartWorkers: failed to allocate fanout worker");
+            controller->fanoutWorkers.clear();
+            return OH_TRAFFICFILTER_ERROR_NFQUEUE_ERROR;
+        }
+        worker->groupId = controller->groupId;
+        worker->fd = packetInfo.fanoutFds[i - 1];
+        worker->callback = controller->callback;
+        worker->userData = controller->userData;
+        worker->packetCopyMode = packetInfo.packetCopyMode;
+        worker->nfqueueFlags = packetInfo.nfqueueFlags;
+        worker->recvBatchSize = packetInfo.recvBatchSize;
+        worker->workerIndex = i;
+        worker->workerCount = workerCount;
+        worker->flowCacheMark = packetInfo.flowCacheMark;
+        worker->userSpaceMatch = packetInfo.userSpaceMatch;
+        worker->classifier = std::atomic_load(&controller->classifier);
+        worker->stats = controller->workerStats[i].get();
+        controller->fanoutWorkers.push_back(std::move(worker));
+    }
+    if (StartWorker(controller) != OH_TRAFFICFILTER_OK) {
+        controller->fanoutWorkers.clear();
         return OH_TRAFFICFILTER_ERROR_NFQUEUE_ERROR;
     }
-    NETMGR_EXT_LOG_I("RegisterPacketCallback: success");
+    for (auto &worker : controller->fanoutWorkers) {
+        if (StartWorker(worker.get()) != OH_TRAFFICFILTER_OK) {
+            StopWorkers(controller);
+            return OH_TRAFFICFILTER_ERROR_NFQUEUE_ERROR;
+        }
+    }
     return OH_TRAFFICFILTER_OK;
 }
 
+void PacketControllerAdapterManager::StopWorkers(OH_TrafficFilter_PacketController* controller)
+{
+    StopWorker(controller);
+    for (auto &worker : controller->fanoutWorkers) {
+        StopWorker(worker.get());
+    }
+    controller->fanoutWorkers.clear();
+}
+
 int32_t PacketControllerAdapterManager::UnregisterPacketCallback(OH_TrafficFilter_PacketController* controller)
 {
     if (controller == nullptr) {
@@ -1756,15 +2375,76 @@ int32_t PacketControllerAdapterManager::UnregisterPacketCallback(OH_TrafficFilte
     }
     std::lock_guard<std::mutex> lock(callbackMutex_);
     callbackMap_.erase(controller);
-    if (controller->running.load()) {
-        controller->running.store(false);
-        controller->callbackRegistered.store(false);
-        if (controller->workerThread != 0) {
-            pthread_join(controller->workerThread, nullptr);
-            controller->workerThread = 0;
+    StopWorkers(controller);
+    NETMGR_EXT_LOG_I("UnregisterPacketCallback: success");
+    return OH_TRAFFICFILTER_OK;
+}
+
+static_assert(TrafficFilterLatencyHistogram::BUCKET_COUNT == OH_TRAFFICFILTER_LATENCY_BUCKET_COUNT,
+    "latency histogram bucket count mismatch");
+
+static void AccumulateLatency(const TrafficFilterLatencyHistogram &histogram, OH_TrafficFilter_LatencyHistogram &out)
+{
+    TrafficFilterLatencyHistogram::Snapshot snapshot = histogram.Read();
+    out.count += snapshot.count;
+    out.totalNs += snapshot.totalNs;
+    out.maxNs = std::max(out.maxNs, snapshot.maxNs);
+    for (uint32_t i = 0; i < OH_TRAFFICFILTER_LATENCY_BUCKET_COUNT; i++) {
+        out.buckets[i] += snapshot.buckets[i];
+    }
+}
+
+static void AccumulateWorkerStats(const NfqWorkerStats &stats, OH_TrafficFilter_PacketControllerStats &out)
+{
+    out.packetsReceived += stats.packetsReceived.load(std::memory_order_relaxed);
+    out.packetsAccepted += stats.packetsAccepted.load(std::memory_order_relaxed);
+    out.packetsDropped += stats.packetsDropped.load(std::memory_order_relaxed);
+    out.packetsBypassed += stats.packetsBypassed.load(std::memory_order_relaxed);
+    out.queueDrops += stats.queueDrops.load(std::memory_order_relaxed);
+    out.enobufsEvents += stats.enobufsEvents.load(std::memory_order_relaxed);
+    out.serviceVerdicts += stats.serviceVerdicts.load(std::memory_order_relaxed);
+    AccumulateLatency(stats.callbackLatency, out.callbackLatency);
+    AccumulateLatency(stats.verdictLatency, out.verdictLatency);
+}
+
+static void FillPacketControllerStatsBySize(OH_TrafficFilter_PacketControllerStats *stats,
+    const OH_TrafficFilter_PacketControllerStats &result)
+{
+    using Stats = OH_TrafficFilter_PacketControllerStats;
+    static constexpr std::pair<size_t, size_t> FIELDS[] = {
+        {offsetof(Stats, packetsReceived), sizeof(uint64_t)}, {offsetof(Stats, packetsAccepted), sizeof(uint64_t)},
+        {offsetof(Stats, packetsDropped), sizeof(uint64_t)}, {offsetof(Stats, packetsBypassed), sizeof(uint64_t)},
+        {offsetof(Stats, queueDrops), sizeof(uint64_t)}, {offsetof(Stats, enobufsEvents), sizeof(uint64_t)},
+        {offsetof(Stats, serviceVerdicts), sizeof(uint64_t)},
+        {offsetof(Stats, callbackLatency), sizeof(OH_TrafficFilter_LatencyHistogram)},
+        {offsetof(Stats, verdictLatency), sizeof(OH_TrafficFilter_LatencyHistogram)},
+    };
+    uint32_t structSize = stats->size;
+    for (const auto &field : FIELDS) {
+        if (IsFieldInSize(structSize, field.first, field.second)) {
+            memcpy_s(reinterpret_cast<uint8_t *>(stats) + field.first, field.second,
+                reinterpret_cast<const uint8_t *>(&result) + field.first, field.second);
         }
     }
-    NETMGR_EXT_LOG_I("UnregisterPacketCallback: success");
+}
+
+int32_t PacketControllerAdapterManager::GetPacketControllerStats(OH_TrafficFilter_PacketController* controller,
+    OH_TrafficFilter_PacketControllerStats* stats)
+{
+    PacketInfo packetInfo;
+    if (!GetPacketInfo(controller, packetInfo)) {
+        NETMGR_EXT_LOG_E("GetPacketControllerStats: controller handle not found");
+        return OH_TRAFFICFILTER_ERROR_NOT_FOUND;
+    }
+    OH_TrafficFilter_PacketControllerStats result = {};
+    {
+        // workerStats only grows while callbackMutex_ is held
+        std::lock_guard<std::mutex> lock(callbackMutex_);
+        for (const auto &workerStats : controller->workerStats) {
+            AccumulateWorkerStats(*workerStats, result);
+        }
+    }
+    FillPacketControllerStatsBySize(stats, result);
     return OH_TRAFFICFILTER_OK;
 }
 }
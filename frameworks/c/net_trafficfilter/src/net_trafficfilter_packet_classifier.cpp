@@ -0,0 +1,806 @@
+/*
+ * Copyright (C) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "net_trafficfilter_packet_classifier.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <string>
+#include <tuple>
+#include <net/if.h>
+#include "netmgr_ext_log_wrapper.h"
+
+namespace OHOS {
+namespace NetManagerStandard {
+namespace {
+constexpr uint32_t BITS_PER_WORD = 64;
+constexpr uint32_t BITS_PER_BYTE = 8;
+constexpr uint8_t BYTE_MSB = 0x80;
+constexpr uint32_t IPV4_ADDR_BITS = 32;
+constexpr uint32_t IPV6_ADDR_BITS = 128;
+constexpr size_t ADDR_MAX_LEN = 16;
+constexpr size_t FAMILY_COUNT = 2;
+constexpr uint32_t PORT_MAX = 65535;
+constexpr size_t PROTOCOL_COUNT = 256;
+constexpr size_t TCP_FLAG_COMBINATIONS = 64;
+constexpr size_t MAC_LEN = 6;
+constexpr size_t MAC_GROUP_STRIDE = 3;
+constexpr int32_t HEX_BASE = 16;
+constexpr int32_t DECIMAL_BASE = 10;
+constexpr int32_t NO_INDEX = -1;
+
+using TermBits = std::vector<uint64_t>;
+using Address = std::array<uint8_t, ADDR_MAX_LEN>;
+
+struct IpPrefix {
+    Address addr;
+    uint32_t len;
+};
+
+// any matches both families, otherwise the address has to fall inside the prefixes, or outside when inverted
+struct IpCondition {
+    bool any = true;
+    bool invert = false;
+    int32_t family = 0;
+    std::vector<IpPrefix> prefixes;
+};
+
+// inclusive ranges, already complemented for an inverted match
+struct PortCondition {
+    bool any = true;
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+};
+
+struct TermSpec {
+    IpCondition src;
+    IpCondition dst;
+    PortCondition srcPort;
+    PortCondition dstPort;
+    uint8_t protocol = 0;
+    const TrafficFilterTCPFlagsMatch *tcpFlags = nullptr;
+    bool queue = false;
+    uint32_t rule = 0;
+};
+
+struct InterfaceCondition {
+    bool enabled = false;
+    bool invert = false;
+    bool isPrefix = false;
+    std::string name;
+};
+
+// conditions checked on the candidate terms only, they are rare and need per packet lookups
+struct RuleResidual {
+    InterfaceCondition in;
+    InterfaceCondition out;
+    bool macEnabled = false;
+    bool macInvert = false;
+    std::array<uint8_t, MAC_LEN> mac {};
+};
+
+struct Term {
+    bool queue = false;
+    uint32_t rule = 0;
+};
+
+struct DeviceName {
+    bool resolved = false;
+    bool known = false;
+    char name[IF_NAMESIZE] = {0};
+};
+
+enum class ResidualMatch {
+    NO,
+    YES,
+    UNKNOWN
+};
+
+int32_t GetFamilyIndex(int32_t family)
+{
+    if (family == static_cast<int32_t>(TrafficFilterIPFamily::IP_FAMILY_V4)) {
+        return 0;
+    }
+    if (family == static_cast<int32_t>(TrafficFilterIPFamily::IP_FAMILY_V6)) {
+        return 1;
+    }
+    return NO_INDEX;
+}
+
+uint32_t GetAddressBits(int32_t familyIndex)
+{
+    return (familyIndex == 0) ? IPV4_ADDR_BITS : IPV6_ADDR_BITS;
+}
+
+inline void SetTermBit(TermBits &bits, size_t term)
+{
+    bits[term / BITS_PER_WORD] |= (1ULL << (term % BITS_PER_WORD));
+}
+
+inline void ClearTermBit(TermBits &bits, size_t term)
+{
+    bits[term / BITS_PER_WORD] &= ~(1ULL << (term % BITS_PER_WORD));
+}
+
+inline uint32_t GetAddressBit(const uint8_t *addr, uint32_t index)
+{
+    return (addr[index / BITS_PER_BYTE] >> (BITS_PER_BYTE - 1 - index % BITS_PER_BYTE)) & 1;
+}
+
+void SetLowBits(Address &addr, uint32_t bits, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t index = bits - 1 - i;
+        addr[index / BITS_PER_BYTE] |= static_cast<uint8_t>(BYTE_MSB >> (index % BITS_PER_BYTE));
+    }
+}
+
+bool IncrementAddress(Address &addr, uint32_t bits)
+{
+    for (size_t i = bits / BITS_PER_BYTE; i > 0; i--) {
+        if (++addr[i - 1] != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int CompareAddress(const Address &a, const Address &b, uint32_t bits)
+{
+    return memcmp(a.data(), b.data(), bits / BITS_PER_BYTE);
+}
+
+IpPrefix MakePrefix(const TrafficFilterIPAddress &addr, uint32_t len, uint32_t bits)
+{
+    IpPrefix prefix { {}, std::min(len, bits) };
+    std::copy(addr.addr_, addr.addr_ + bits / BITS_PER_BYTE, prefix.addr.begin());
+    return prefix;
+}
+
+// Covers [start, end] with the fewest aligned prefixes, at most two per address bit
+void AppendRangePrefixes(const TrafficFilterIPAddress &start, const TrafficFilterIPAddress &end, uint32_t bits,
+    std::vector<IpPrefix> &prefixes)
+{
+    Address cur {};
+    Address last {};
+    std::copy(start.addr_, start.addr_ + bits / BITS_PER_BYTE, cur.begin());
+    std::copy(end.addr_, end.addr_ + bits / BITS_PER_BYTE, last.begin());
+    if (CompareAddress(cur, last, bits) > 0) {
+        return;
+    }
+    while (true) {
+        uint32_t hostBits = 0;
+        Address blockEnd = cur;
+        while (hostBits < bits && GetAddressBit(cur.data(), bits - 1 - hostBits) == 0) {
+            Address wider = blockEnd;
+            SetLowBits(wider, bits, hostBits + 1);
+            if (CompareAddress(wider, last, bits) > 0) {
+                break;
+            }
+            blockEnd = wider;
+            hostBits++;
+        }
+        prefixes.push_back({cur, bits - hostBits});
+        if (CompareAddress(blockEnd, last, bits) >= 0 || !IncrementAddress(blockEnd, bits)) {
+            break;
+        }
+        cur = blockEnd;
+    }
+}
+
+int32_t GetIpMatchFamily(const TrafficFilterIPMatch &match)
+{
+    switch (match.type_) {
+        case static_cast<int32_t>(TrafficFilterIPMatchType::IP_MATCH_SINGLE):
+            return match.single_.family_;
+        case static_cast<int32_t>(TrafficFilterIPMatchType::IP_MATCH_CIDR):
+            return match.cidr_.base_.family_;
+        case static_cast<int32_t>(TrafficFilterIPMatchType::IP_MATCH_RANGE):
+            return match.range_.start_.family_;
+        case static_cast<int32_t>(TrafficFilterIPMatchType::IP_MATCH_MULTI):
+            return (match.multi_.ipCount_ > 0) ? match.multi_.ips_[0].family_ : 0;
+        default:
+            return 0;
+    }
+}
+
+IpCondition MakeSetCondition(const TrafficFilterIPMatch &match, bool invert)
+{
+    IpCondition cond;
+    cond.any = false;
+    cond.invert = invert;
+    cond.family = GetIpMatchFamily(match);
+    int32_t familyIndex = GetFamilyIndex(cond.family);
+    if (familyIndex == NO_INDEX) {
+        return cond;
+    }
+    uint32_t bits = GetAddressBits(familyIndex);
+    switch (match.type_) {
+        case static_cast<int32_t>(TrafficFilterIPMatchType::IP_MATCH_SINGLE):
+            cond.prefixes.push_back(MakePrefix(match.single_, bits, bits));
+            break;
+        case static_cast<int32_t>(TrafficFilterIPMatchType::IP_MATCH_CIDR):
+            cond.prefixes.push_back(MakePrefix(match.cidr_.base_, match.cidr_.prefixLen_, bits));
+            break;
+        case static_cast<int32_t>(TrafficFilterIPMatchType::IP_MATCH_RANGE):
+            AppendRangePrefixes(match.range_.start_, match.range_.end_, bits, cond.prefixes);
+            break;
+        case static_cast<int32_t>(TrafficFilterIPMatchType::IP_MATCH_MULTI): {
+            uint32_t count = std::min<uint32_t>(match.multi_.ipCount_, std::size(match.multi_.ips_));
+            for (uint32_t i = 0; i < count; i++) {
+                if (match.multi_.ips_[i].family_ == cond.family) {
+                    cond.prefixes.push_back(MakePrefix(match.multi_.ips_[i], bits, bits));
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    return cond;
+}
+
+bool IsMultiIpMatch(const TrafficFilterIPMatch &match)
+{
+    return match.type_ == static_cast<int32_t>(TrafficFilterIPMatchType::IP_MATCH_MULTI);
+}
+
+// address condition of the NFQUEUE term, an inverted multi match is handled by the RETURN terms before it
+IpCondition MakeTargetCondition(const TrafficFilterIPMatch &match)
+{
+    if (match.type_ == static_cast<int32_t>(TrafficFilterIPMatchType::IP_MATCH_ANY) || !match.IsValidType()) {
+        return IpCondition();
+    }
+    if (IsMultiIpMatch(match)) {
+        return match.invert_ ? IpCondition() : MakeSetCondition(match, false);
+    }
+    return MakeSetCondition(match, match.invert_);
+}
+
+// address condition of the RETURN term closing a rule with a multi match
+IpCondition MakeDefaultCondition(const TrafficFilterIPMatch &match)
+{
+    return IsMultiIpMatch(match) ? IpCondition() : MakeTargetCondition(match);
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> ComplementPortRanges(
+    const std::vector<std::pair<uint32_t, uint32_t>> &ranges)
+{
+    std::vector<std::pair<uint32_t, uint32_t>> result;
+    uint32_t next = 0;
+    for (const auto &range : ranges) {
+        if (range.first > next) {
+            result.emplace_back(next, range.first - 1);
+        }
+        next = std::max(next, range.second + 1);
+    }
+    if (next <= PORT_MAX) {
+        result.emplace_back(next, PORT_MAX);
+    }
+    return result;
+}
+
+PortCondition MakePortCondition(const TrafficFilterPortMatch &match)
+{
+    PortCondition cond;
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    switch (match.type_) {
+        case static_cast<int32_t>(TrafficFilterPortMatchType::PORT_MATCH_SINGLE):
+            ranges.emplace_back(match.single_, match.single_);
+            break;
+        case static_cast<int32_t>(TrafficFilterPortMatchType::PORT_MATCH_RANGE):
+            if (!match.invert_ && match.range_.startPort_ == 0 && match.range_.endPort_ == PORT_MAX) {
+                return cond;
+            }
+            ranges.emplace_back(match.range_.startPort_, match.range_.endPort_);
+            break;
+        case static_cast<int32_t>(TrafficFilterPortMatchType::PORT_MATCH_MULTI): {
+            uint32_t count = std::min<uint32_t>(match.multi_.portCount_, std::size(match.multi_.ports_));
+            for (uint32_t i = 0; i < count; i++) {
+                ranges.emplace_back(match.multi_.ports_[i], match.multi_.ports_[i]);
+            }
+            break;
+        }
+        default:
+            return cond;
+    }
+    std::sort(ranges.begin(), ranges.end());
+    cond.any = false;
+    cond.ranges = match.invert_ ? ComplementPortRanges(ranges) : ranges;
+    return cond;
+}
+
+// Mirrors BuildPacketFilterCommands: RETURN for a hit in an inverted multi match, NFQUEUE for the rule itself and
+// RETURN for the remaining packets of a rule with a multi match
+void AppendRuleTerms(const TrafficFilterPacketRule &rule, uint32_t ruleIndex, std::vector<TermSpec> &specs)
+{
+    TermSpec base;
+    base.srcPort = MakePortCondition(rule.srcPort_);
+    base.dstPort = MakePortCondition(rule.dstPort_);
+    base.protocol = (rule.protocol_ == NETTRAFFICFILTER_PROTO_ANY && rule.tcpFlagsMatch_.enable_) ?
+        NETTRAFFICFILTER_PROTO_TCP : rule.protocol_;
+    if (rule.tcpFlagsMatch_.enable_ && rule.tcpFlagsMatch_.flagMask_ != 0) {
+        base.tcpFlags = &rule.tcpFlagsMatch_;
+    }
+    base.rule = ruleIndex;
+    auto append = [&base, &specs](IpCondition src, IpCondition dst, bool queue) {
+        TermSpec spec = base;
+        spec.src = std::move(src);
+        spec.dst = std::move(dst);
+        spec.queue = queue;
+        specs.push_back(std::move(spec));
+    };
+    bool srcMulti = IsMultiIpMatch(rule.srcIp_);
+    bool dstMulti = IsMultiIpMatch(rule.dstIp_);
+    if (srcMulti && rule.srcIp_.invert_) {
+        append(MakeSetCondition(rule.srcIp_, false), MakeTargetCondition(rule.dstIp_), false);
+    }
+    if (dstMulti && rule.dstIp_.invert_) {
+        append(MakeTargetCondition(rule.srcIp_), MakeSetCondition(rule.dstIp_, false), false);
+    }
+    append(MakeTargetCondition(rule.srcIp_), MakeTargetCondition(rule.dstIp_), true);
+    if ((srcMulti && !rule.srcIp_.invert_) || (dstMulti && !rule.dstIp_.invert_)) {
+        append(MakeDefaultCondition(rule.srcIp_), MakeDefaultCondition(rule.dstIp_), false);
+    }
+}
+
+InterfaceCondition MakeInterfaceCondition(const TrafficFilterInterfaceMatch &match)
+{
+    InterfaceCondition cond;
+    if (!match.enabled_ || match.ifName_.empty()) {
+        return cond;
+    }
+    cond.enabled = true;
+    cond.invert = match.invert_;
+    cond.isPrefix = match.isPrefix_;
+    cond.name = match.ifName_;
+    if (cond.name.back() == '+') {
+        cond.name.pop_back();
+        cond.isPrefix = true;
+    }
+    return cond;
+}
+
+int32_t HexValue(char c)
+{
+    if (isdigit(static_cast<unsigned char>(c))) {
+        return c - '0';
+    }
+    char lower = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    return (lower >= 'a' && lower <= 'f') ? (lower - 'a' + DECIMAL_BASE) : NO_INDEX;
+}
+
+bool ParseMacAddress(const std::string &text, std::array<uint8_t, MAC_LEN> &mac)
+{
+    if (text.size() < MAC_LEN * MAC_GROUP_STRIDE - 1) {
+        return false;
+    }
+    for (size_t i = 0; i < MAC_LEN; i++) {
+        int32_t high = HexValue(text[i * MAC_GROUP_STRIDE]);
+        int32_t low = HexValue(text[i * MAC_GROUP_STRIDE + 1]);
+        if (high == NO_INDEX || low == NO_INDEX) {
+            return false;
+        }
+        mac[i] = static_cast<uint8_t>(high * HEX_BASE + low);
+    }
+    return true;
+}
+
+RuleResidual MakeRuleResidual(const TrafficFilterPacketRule &rule)
+{
+    RuleResidual residual;
+    residual.in = MakeInterfaceCondition(rule.inInterface_);
+    residual.out = MakeInterfaceCondition(rule.outInterface_);
+    if (rule.macMatch_.enable_ && ParseMacAddress(rule.macMatch_.srcMac_, residual.mac)) {
+        residual.macEnabled = true;
+        residual.macInvert = rule.macMatch_.invert_;
+    }
+    return residual;
+}
+
+ResidualMatch MatchInterface(const InterfaceCondition &cond, uint32_t ifIndex, DeviceName &device)
+{
+    if (!cond.enabled) {
+        return ResidualMatch::YES;
+    }
+    if (!device.resolved) {
+        device.resolved = true;
+        device.known = (ifIndex == 0) || (if_indextoname(ifIndex, device.name) != nullptr);
+    }
+    if (!device.known) {
+        return ResidualMatch::UNKNOWN;
+    }
+    size_t len = strnlen(device.name, IF_NAMESIZE);
+    bool equal = cond.isPrefix ?
+        (len >= cond.name.size() && strncmp(device.name, cond.name.c_str(), cond.name.size()) == 0) :
+        (cond.name.compare(0, std::string::npos, device.name, len) == 0);
+    return (equal != cond.invert) ? ResidualMatch::YES : ResidualMatch::NO;
+}
+
+ResidualMatch MatchMac(const RuleResidual &residual, const uint8_t *srcMac)
+{
+    if (!residual.macEnabled) {
+        return ResidualMatch::YES;
+    }
+    if (srcMac == nullptr) {
+        return ResidualMatch::UNKNOWN;
+    }
+    bool equal = memcmp(srcMac, residual.mac.data(), MAC_LEN) == 0;
+    return (equal != residual.macInvert) ? ResidualMatch::YES : ResidualMatch::NO;
+}
+
+ResidualMatch MatchResidual(const RuleResidual &residual, const ClassifierPacket &packet,
+    std::array<DeviceName, 2> &devices)
+{
+    const ResidualMatch results[] = {
+        MatchInterface(residual.in, packet.indev, devices[0]),
+        MatchInterface(residual.out, packet.outdev, devices[1]),
+        MatchMac(residual, packet.srcMac)
+    };
+    ResidualMatch combined = ResidualMatch::YES;
+    for (ResidualMatch result : results) {
+        if (result == ResidualMatch::NO) {
+            return ResidualMatch::NO;
+        }
+        if (result == ResidualMatch::UNKNOWN) {
+            combined = ResidualMatch::UNKNOWN;
+        }
+    }
+    return combined;
+}
+
+// Binary trie over address bits, a marked node holds the terms of its prefix and of every shorter one above it
+class PrefixTrie {
+public:
+    void Insert(const IpPrefix &prefix, size_t term, size_t words)
+    {
+        int32_t node = 0;
+        for (uint32_t depth = 0; depth < prefix.len; depth++) {
+            uint32_t bit = GetAddressBit(prefix.addr.data(), depth);
+            if (nodes_[node].child[bit] == NO_INDEX) {
+                nodes_[node].child[bit] = static_cast<int32_t>(nodes_.size());
+                nodes_.emplace_back();
+            }
+            node = nodes_[node].child[bit];
+        }
+        if (nodes_[node].mask == NO_INDEX) {
+            nodes_[node].mask = static_cast<int32_t>(masks_.size());
+            masks_.emplace_back(words, 0);
+        }
+        SetTermBit(masks_[nodes_[node].mask], term);
+    }
+
+    void Finalize()
+    {
+        std::vector<std::pair<int32_t, int32_t>> stack { {0, NO_INDEX} };
+        while (!stack.empty()) {
+            auto [node, inherited] = stack.back();
+            stack.pop_back();
+            int32_t own = nodes_[node].mask;
+            if (own != NO_INDEX && inherited != NO_INDEX) {
+                for (size_t i = 0; i < masks_[own].size(); i++) {
+                    masks_[own][i] |= masks_[inherited][i];
+                }
+            }
+            for (int32_t child : nodes_[node].child) {
+                if (child != NO_INDEX) {
+                    stack.emplace_back(child, (own != NO_INDEX) ? own : inherited);
+                }
+            }
+        }
+    }
+
+    // terms whose prefixes contain the address, nullptr for none
+    const uint64_t *Lookup(const uint8_t *addr, uint32_t bits) const
+    {
+        const uint64_t *result = nullptr;
+        int32_t node = 0;
+        for (uint32_t depth = 0; node != NO_INDEX; depth++) {
+            if (nodes_[node].mask != NO_INDEX) {
+                result = masks_[nodes_[node].mask].data();
+            }
+            if (depth == bits) {
+                break;
+            }
+            node = nodes_[node].child[GetAddressBit(addr, depth)];
+        }
+        return result;
+    }
+
+private:
+    struct Node {
+        int32_t child[2] = {NO_INDEX, NO_INDEX};
+        int32_t mask = NO_INDEX;
+    };
+    std::vector<Node> nodes_ = std::vector<Node>(1);
+    std::vector<TermBits> masks_;
+};
+
+// Elementary port intervals sorted by their first port, intervals with the same terms share one mask
+class PortTable {
+public:
+    void Build(const std::vector<const PortCondition *> &conditions, size_t words)
+    {
+        std::vector<std::tuple<uint32_t, uint32_t, int32_t>> events;
+        for (uint32_t term = 0; term < conditions.size(); term++) {
+            if (conditions[term]->any) {
+                events.emplace_back(0, term, 1);
+                continue;
+            }
+            for (const auto &range : conditions[term]->ranges) {
+                events.emplace_back(range.first, term, 1);
+                events.emplace_back(range.second + 1, term, -1);
+            }
+        }
+        std::sort(events.begin(), events.end());
+        std::vector<int32_t> cover(conditions.size(), 0);
+        TermBits current(words, 0);
+        std::map<TermBits, uint32_t> interned;
+        size_t next = 0;
+        for (uint32_t port = 0; port <= PORT_MAX;) {
+            for (; next < events.size() && std::get<0>(events[next]) == port; next++) {
+                uint32_t term = std::get<1>(events[next]);
+                cover[term] += std::get<2>(events[next]);
+                if (cover[term] > 0) {
+                    SetTermBit(current, term);
+                } else {
+                    ClearTermBit(current, term);
+                }
+            }
+            auto it = interned.find(current);
+            if (it == interned.end()) {
+                it = interned.emplace(current, static_cast<uint32_t>(masks_.size())).first;
+                masks_.push_back(current);
+            }
+            starts_.push_back(port);
+            maskIndex_.push_back(it->second);
+            port = (next < events.size()) ? std::get<0>(events[next]) : PORT_MAX + 1;
+        }
+    }
+
+    const uint64_t *Lookup(uint16_t port) const
+    {
+        auto it = std::upper_bound(starts_.begin(), starts_.end(), static_cast<uint32_t>(port));
+        return masks_[maskIndex_[static_cast<size_t>(it - starts_.begin()) - 1]].data();
+    }
+
+private:
+    std::vector<uint32_t> starts_;
+    std::vector<uint32_t> maskIndex_;
+    std::vector<TermBits> masks_;
+};
+} // namespace
+
+struct PacketRuleClassifier::HookTable {
+    void Build(const std::vector<const TrafficFilterPacketRule *> &rules);
+    bool ShouldDeliver(const ClassifierPacket &packet) const;
+
+private:
+    void BuildAddressDimension(const std::vector<TermSpec> &specs, bool isSource);
+    void BuildPortDimensions(const std::vector<TermSpec> &specs);
+    void BuildProtocolDimension(const std::vector<TermSpec> &specs);
+    void BuildTcpFlagsDimension(const std::vector<TermSpec> &specs);
+
+    size_t words_ = 0;
+    std::vector<Term> terms_;
+    std::vector<RuleResidual> residuals_;
+    std::array<PrefixTrie, FAMILY_COUNT> srcTries_;
+    std::array<PrefixTrie, FAMILY_COUNT> dstTries_;
+    std::array<TermBits, FAMILY_COUNT> srcInverted_;
+    std::array<TermBits, FAMILY_COUNT> dstInverted_;
+    TermBits srcAny_;
+    TermBits dstAny_;
+    PortTable srcPorts_;
+    PortTable dstPorts_;
+    TermBits portless_;
+    std::array<uint32_t, PROTOCOL_COUNT> protocolMaskIndex_ {};
+    std::vector<TermBits> protocolMasks_;
+    std::array<TermBits, TCP_FLAG_COMBINATIONS> tcpFlagMasks_;
+    TermBits tcpFlagsUnknown_;
+};
+
+void PacketRuleClassifier::HookTable::Build(const std::vector<const TrafficFilterPacketRule *> &rules)
+{
+    std::vector<TermSpec> specs;
+    for (uint32_t i = 0; i < rules.size(); i++) {
+        residuals_.push_back(MakeRuleResidual(*rules[i]));
+        AppendRuleTerms(*rules[i], i, specs);
+    }
+    words_ = (specs.size() + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    for (const auto &spec : specs) {
+        terms_.push_back({spec.queue, spec.rule});
+    }
+    BuildAddressDimension(specs, true);
+    BuildAddressDimension(specs, false);
+    BuildPortDimensions(specs);
+    BuildProtocolDimension(specs);
+    BuildTcpFlagsDimension(specs);
+}
+
+void PacketRuleClassifier::HookTable::BuildAddressDimension(const std::vector<TermSpec> &specs, bool isSource)
+{
+    auto &tries = isSource ? srcTries_ : dstTries_;
+    auto &inverted = isSource ? srcInverted_ : dstInverted_;
+    TermBits &any = isSource ? srcAny_ : dstAny_;
+    any.assign(words_, 0);
+    for (auto &bits : inverted) {
+        bits.assign(words_, 0);
+    }
+    for (size_t term = 0; term < specs.size(); term++) {
+        const IpCondition &cond = isSource ? specs[term].src : specs[term].dst;
+        if (cond.any) {
+            SetTermBit(any, term);
+            continue;
+        }
+        int32_t familyIndex = GetFamilyIndex(cond.family);
+        if (familyIndex == NO_INDEX) {
+            continue;
+        }
+        if (cond.invert) {
+            SetTermBit(inverted[familyIndex], term);
+        }
+        for (const auto &prefix : cond.prefixes) {
+            tries[familyIndex].Insert(prefix, term, words_);
+        }
+    }
+    for (auto &trie : tries) {
+        trie.Finalize();
+    }
+}
+
+void PacketRuleClassifier::HookTable::BuildPortDimensions(const std::vector<TermSpec> &specs)
+{
+    std::vector<const PortCondition *> srcConditions;
+    std::vector<const PortCondition *> dstConditions;
+    portless_.assign(words_, 0);
+    for (size_t term = 0; term < specs.size(); term++) {
+        srcConditions.push_back(&specs[term].srcPort);
+        dstConditions.push_back(&specs[term].dstPort);
+        if (specs[term].srcPort.any && specs[term].dstPort.any) {
+            SetTermBit(portless_, term);
+        }
+    }
+    srcPorts_.Build(srcConditions, words_);
+    dstPorts_.Build(dstConditions, words_);
+}
+
+void PacketRuleClassifier::HookTable::BuildProtocolDimension(const std::vector<TermSpec> &specs)
+{
+    TermBits anyProtocol(words_, 0);
+    for (size_t term = 0; term < specs.size(); term++) {
+        if (specs[term].protocol == NETTRAFFICFILTER_PROTO_ANY) {
+            SetTermBit(anyProtocol, term);
+        }
+    }
+    protocolMasks_.push_back(anyProtocol);
+    protocolMaskIndex_.fill(0);
+    for (size_t term = 0; term < specs.size(); term++) {
+        if (specs[term].protocol == NETTRAFFICFILTER_PROTO_ANY) {
+            continue;
+        }
+        uint32_t &index = protocolMaskIndex_[specs[term].protocol];
+        if (index == 0) {
+            index = static_cast<uint32_t>(protocolMasks_.size());
+            protocolMasks_.push_back(anyProtocol);
+        }
+        SetTermBit(protocolMasks_[index], term);
+    }
+}
+
+// A TCP packet whose flags were not copied to user space still reaches the NFQUEUE terms checking them
+void PacketRuleClassifier::HookTable::BuildTcpFlagsDimension(const std::vector<TermSpec> &specs)
+{
+    for (auto &bits : tcpFlagMasks_) {
+        bits.assign(words_, 0);
+    }
+    tcpFlagsUnknown_.assign(words_, 0);
+    for (size_t term = 0; term < specs.size(); term++) {
+        const TrafficFilterTCPFlagsMatch *flags = specs[term].tcpFlags;
+        if (flags == nullptr || specs[term].queue) {
+            SetTermBit(tcpFlagsUnknown_, term);
+        }
+        for (uint32_t value = 0; value < TCP_FLAG_COMBINATIONS; value++) {
+            if (flags == nullptr || (value & flags->flagMask_) == (flags->flagComp_ & flags->flagMask_)) {
+                SetTermBit(tcpFlagMasks_[value], term);
+            }
+        }
+    }
+}
+
+bool PacketRuleClassifier::HookTable::ShouldDeliver(const ClassifierPacket &packet) const
+{
+    int32_t familyIndex = GetFamilyIndex(packet.family);
+    if (familyIndex == NO_INDEX || packet.srcAddr == nullptr || packet.dstAddr == nullptr) {
+        return true;
+    }
+    uint32_t bits = GetAddressBits(familyIndex);
+    const uint64_t *srcHits = srcTries_[familyIndex].Lookup(packet.srcAddr, bits);
+    const uint64_t *dstHits = dstTries_[familyIndex].Lookup(packet.dstAddr, bits);
+    const uint64_t *srcPortBits = packet.hasPorts ? srcPorts_.Lookup(packet.srcPort) : portless_.data();
+    const uint64_t *dstPortBits = packet.hasPorts ? dstPorts_.Lookup(packet.dstPort) : portless_.data();
+    const uint64_t *protocolBits = protocolMasks_[protocolMaskIndex_[packet.protocol]].data();
+    const uint64_t *flagBits = packet.hasTcpFlags ?
+        tcpFlagMasks_[packet.tcpFlags % TCP_FLAG_COMBINATIONS].data() : tcpFlagsUnknown_.data();
+    std::array<DeviceName, 2> devices;
+    for (size_t word = 0; word < words_; word++) {
+        uint64_t srcBits = srcAny_[word] | ((srcHits ? srcHits[word] : 0) ^ srcInverted_[familyIndex][word]);
+        uint64_t dstBits = dstAny_[word] | ((dstHits ? dstHits[word] : 0) ^ dstInverted_[familyIndex][word]);
+        uint64_t candidates = srcBits & dstBits & srcPortBits[word] & dstPortBits[word] & protocolBits[word] &
+            flagBits[word];
+        while (candidates != 0) {
+            size_t term = word * BITS_PER_WORD + static_cast<size_t>(__builtin_ctzll(candidates));
+            candidates &= candidates - 1;
+            ResidualMatch match = MatchResidual(residuals_[terms_[term].rule], packet, devices);
+            // an undecidable condition never hides a packet from the callback
+            if (match == ResidualMatch::YES || (match == ResidualMatch::UNKNOWN && terms_[term].queue)) {
+                return terms_[term].queue;
+            }
+        }
+    }
+    return false;
+}
+
+PacketRuleClassifier::PacketRuleClassifier() = default;
+
+PacketRuleClassifier::~PacketRuleClassifier() = default;
+
+std::shared_ptr<const PacketRuleClassifier> PacketRuleClassifier::Build(
+    const std::vector<TrafficFilterPacketRule> &rules)
+{
+    std::shared_ptr<PacketRuleClassifier> classifier(new (std::nothrow) PacketRuleClassifier());
+    if (classifier == nullptr) {
+        NETMGR_EXT_LOG_E("PacketRuleClassifier: failed to allocate classifier");
+        return nullptr;
+    }
+    for (size_t hook = 0; hook < HOOK_COUNT; hook++) {
+        std::vector<const TrafficFilterPacketRule *> hookRules;
+        for (const auto &rule : rules) {
+            if (rule.hookPoint_ == static_cast<int32_t>(hook)) {
+                hookRules.push_back(&rule);
+            }
+        }
+        // the kernel keeps matching a hook point with conditions only it can evaluate
+        if (hookRules.empty() || !std::all_of(hookRules.begin(), hookRules.end(),
+            [](const TrafficFilterPacketRule *rule) { return IsPacketRuleUserSpaceMatchable(*rule); })) {
+            continue;
+        }
+        std::stable_sort(hookRules.begin(), hookRules.end(),
+            [](const TrafficFilterPacketRule *a, const TrafficFilterPacketRule *b) {
+                return a->priority_ < b->priority_;
+            });
+        std::unique_ptr<HookTable> table(new (std::nothrow) HookTable());
+        if (table == nullptr) {
+            NETMGR_EXT_LOG_E("PacketRuleClassifier: failed to allocate hook table");
+            return nullptr;
+        }
+        table->Build(hookRules);
+        classifier->hooks_[hook] = std::move(table);
+    }
+    return classifier;
+}
+
+bool PacketRuleClassifier::ShouldDeliver(const ClassifierPacket &packet) const
+{
+    if (packet.hookPoint < 0 || packet.hookPoint >= static_cast<int32_t>(HOOK_COUNT)) {
+        return true;
+    }
+    // without a table the hook point is matched by kernel rules, or has no rule and queues nothing
+    const std::unique_ptr<HookTable> &table = hooks_[packet.hookPoint];
+    return table == nullptr || table->ShouldDeliver(packet);
+}
+} // namespace NetManagerStandard
+} // namespace OHOS
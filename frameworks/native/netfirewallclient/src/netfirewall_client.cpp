@@ -313,6 +313,21 @@ int32_t NetFirewallClient::QueryProcess(const std::string& srcIp, uint16_t srcPo
     return ret;
 }
 
+int32_t NetFirewallClient::QueryProcesses(const std::vector<TrafficFilterConnectionTuple>& connections,
+    std::vector<TrafficFilterProcessOwner>& owners)
+{
+    sptr<INetFirewallService> proxy = GetProxy();
+    if (proxy == nullptr) {
+        NETMGR_EXT_LOG_E("QueryProcesses proxy is nullptr");
+        return NETMANAGER_EXT_ERR_GET_PROXY_FAIL;
+    }
+    int32_t ret = proxy->QueryProcesses(connections, owners);
+    if (ret != 0) {
+        NETMGR_EXT_LOG_E("QueryProcesses: service call failed, ret=%{public}d", ret);
+    }
+    return ret;
+}
+
 int32_t NetFirewallClient::AddPacketRule(const std::string& controllerId, const sptr<TrafficFilterPacketRule>& rule)
 {
     sptr<INetFirewallService> proxy = GetProxy();
@@ -365,5 +380,26 @@ int32_t NetFirewallClient::SendVerdict(int32_t queueNum, uint32_t packetId, int3
     }
     return proxy->SendVerdict(queueNum, packetId, verdict, mark);
 }
+
+int32_t NetFirewallClient::GetPacketControllerFanoutFds(const std::string& packetControllerId,
+    std::vector<int32_t>& fds)
+{
+    sptr<INetFirewallService> proxy = GetProxy();
+    if (proxy == nullptr) {
+        NETMGR_EXT_LOG_E("GetPacketControllerFanoutFds proxy is nullptr");
+        return NETMANAGER_EXT_ERR_GET_PROXY_FAIL;
+    }
+    return proxy->GetPacketControllerFanoutFds(packetControllerId, fds);
+}
+
+int32_t NetFirewallClient::GetPacketControllerFlowMark(const std::string& packetControllerId, uint32_t& flowMark)
+{
+    sptr<INetFirewallService> proxy = GetProxy();
+    if (proxy == nullptr) {
+        NETMGR_EXT_LOG_E("GetPacketControllerFlowMark proxy is nullptr");
+        return NETMANAGER_EXT_ERR_GET_PROXY_FAIL;
+    }
+    return proxy->GetPacketControllerFlowMark(packetControllerId, flowMark);
+}
 } // namespace NetManagerStandard
 } // namespace OHOS
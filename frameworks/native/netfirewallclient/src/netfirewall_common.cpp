@@ -927,6 +927,18 @@ bool TrafficFilterConfig::Marshalling(Parcel &parcel) const
         NETMGR_EXT_LOG_E("Write nfqueueFlags failed");
         return false;
     }
+    if (!parcel.WriteUint32(queueCount_)) {
+        NETMGR_EXT_LOG_E("Write queueCount failed");
+        return false;
+    }
+    if (!parcel.WriteBool(flowCache_)) {
+        NETMGR_EXT_LOG_E("Write flowCache failed");
+        return false;
+    }
+    if (!parcel.WriteBool(userSpaceMatch_)) {
+        NETMGR_EXT_LOG_E("Write userSpaceMatch failed");
+        return false;
+    }
     return true;
 }
 
@@ -957,6 +969,18 @@ sptr<TrafficFilterConfig> TrafficFilterConfig::Unmarshalling(Parcel &parcel)
         NETMGR_EXT_LOG_E("Read nfqueueFlags failed");
         return nullptr;
     }
+    if (!parcel.ReadUint32(ptr->queueCount_)) {
+        NETMGR_EXT_LOG_E("Read queueCount failed");
+        return nullptr;
+    }
+    if (!parcel.ReadBool(ptr->flowCache_)) {
+        NETMGR_EXT_LOG_E("Read flowCache failed");
+        return nullptr;
+    }
+    if (!parcel.ReadBool(ptr->userSpaceMatch_)) {
+        NETMGR_EXT_LOG_E("Read userSpaceMatch failed");
+        return nullptr;
+    }
     return ptr;
 }
 
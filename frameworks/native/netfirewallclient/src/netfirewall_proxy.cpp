@@ -14,6 +14,7 @@
  */
 
 #include "netfirewall_proxy.h"
+#include <unistd.h>
 #include "iremote_object.h"
 #include "message_option.h"
 #include "message_parcel.h"
@@ -591,6 +592,53 @@ int32_t NetFirewallProxy::QueryProcess(const std::string& srcIp, uint16_t srcPor
     return FIREWALL_SUCCESS;
 }
 
+int32_t NetFirewallProxy::QueryProcesses(const std::vector<TrafficFilterConnectionTuple>& connections,
+    std::vector<TrafficFilterProcessOwner>& owners)
+{
+    MessageParcel data;
+    if (!data.WriteInterfaceToken(GetDescriptor())) {
+        NETMGR_EXT_LOG_E("WriteInterfaceToken failed");
+        return NETMANAGER_EXT_ERR_WRITE_DESCRIPTOR_TOKEN_FAIL;
+    }
+    if (!data.WriteUint32(static_cast<uint32_t>(connections.size()))) {
+        NETMGR_EXT_LOG_E("WriteUint32 count failed");
+        return NETMANAGER_EXT_ERR_WRITE_DATA_FAIL;
+    }
+    for (const auto& connection : connections) {
+        if (!data.WriteString(connection.srcIp_) || !data.WriteUint16(connection.srcPort_) ||
+            !data.WriteString(connection.dstIp_) || !data.WriteUint16(connection.dstPort_) ||
+            !data.WriteUint8(connection.protocol_)) {
+            NETMGR_EXT_LOG_E("Write connection failed");
+            return NETMANAGER_EXT_ERR_WRITE_DATA_FAIL;
+        }
+    }
+    sptr<IRemoteObject> remote = Remote();
+    if (remote == nullptr) {
+        NETMGR_EXT_LOG_E("Remote is null");
+        return NETMANAGER_EXT_ERR_IPC_CONNECT_STUB_FAIL;
+    }
+    MessageParcel reply;
+    MessageOption option;
+    int32_t ret = remote->SendRequest(static_cast<uint32_t>(QUERY_PROCESSES), data, reply, option);
+    if (ret != FIREWALL_SUCCESS) {
+        NETMGR_EXT_LOG_E("proxy SendRequest failed, error code: [%{public}d]", ret);
+        return ret;
+    }
+    uint32_t count = 0;
+    if (!reply.ReadUint32(count) || count != connections.size()) {
+        NETMGR_EXT_LOG_E("ReadUint32 count failed");
+        return NETMANAGER_EXT_ERR_READ_DATA_FAIL;
+    }
+    owners.assign(count, TrafficFilterProcessOwner());
+    for (auto& owner : owners) {
+        if (!reply.ReadInt32(owner.result_) || !reply.ReadUint32(owner.uid_) || !reply.ReadUint32(owner.pid_)) {
+            NETMGR_EXT_LOG_E("Read process owner failed");
+            return NETMANAGER_EXT_ERR_READ_DATA_FAIL;
+        }
+    }
+    return FIREWALL_SUCCESS;
+}
+
 int32_t NetFirewallProxy::CreatePacketController(uint32_t groupId,
     uint32_t priority,
     const sptr<TrafficFilterConfig>& config,
@@ -765,5 +813,80 @@ int32_t NetFirewallProxy::SendVerdict(int32_t queueNum, uint32_t packetId, int32
     }
     return ret;
 }
+
+int32_t NetFirewallProxy::GetPacketControllerFanoutFds(const std::string& packetControllerId,
+    std::vector<int32_t>& fds)
+{
+    MessageParcel data;
+    if (!data.WriteInterfaceToken(GetDescriptor())) {
+        NETMGR_EXT_LOG_E("WriteInterfaceToken failed");
+        return NETMANAGER_EXT_ERR_WRITE_DESCRIPTOR_TOKEN_FAIL;
+    }
+    if (!data.WriteString(packetControllerId)) {
+        NETMGR_EXT_LOG_E("WriteString packetControllerId failed");
+        return NETMANAGER_EXT_ERR_WRITE_DATA_FAIL;
+    }
+    sptr<IRemoteObject> remote = Remote();
+    if (remote == nullptr) {
+        NETMGR_EXT_LOG_E("Remote is null");
+        return NETMANAGER_EXT_ERR_IPC_CONNECT_STUB_FAIL;
+    }
+    MessageParcel reply;
+    MessageOption option;
+    int32_t ret = remote->SendRequest(static_cast<uint32_t>(GET_PACKET_CONTROLLER_FANOUT_FDS), data, reply, option);
+    if (ret != FIREWALL_SUCCESS) {
+        NETMGR_EXT_LOG_E("proxy SendRequest failed, error code: [%{public}d]", ret);
+        return ret;
+    }
+    uint32_t count = 0;
+    if (!reply.ReadUint32(count) || count > NETTRAFFICFILTER_MAX_QUEUE_COUNT) {
+        NETMGR_EXT_LOG_E("ReadUint32 count failed");
+        return NETMANAGER_EXT_ERR_READ_DATA_FAIL;
+    }
+    fds.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        int32_t fd = reply.ReadFileDescriptor();
+        if (fd < 0) {
+            NETMGR_EXT_LOG_E("ReadFileDescriptor fd failed");
+            for (int32_t opened : fds) {
+                close(opened);
+            }
+            fds.clear();
+            return NETMANAGER_EXT_ERR_READ_DATA_FAIL;
+        }
+        fds.push_back(fd);
+    }
+    return FIREWALL_SUCCESS;
+}
+
+int32_t NetFirewallProxy::GetPacketControllerFlowMark(const std::string& packetControllerId, uint32_t& flowMark)
+{
+    MessageParcel data;
+    if (!data.WriteInterfaceToken(GetDescriptor())) {
+        NETMGR_EXT_LOG_E("WriteInterfaceToken failed");
+        return NETMANAGER_EXT_ERR_WRITE_DESCRIPTOR_TOKEN_FAIL;
+    }
+    if (!data.WriteString(packetControllerId)) {
+        NETMGR_EXT_LOG_E("WriteString packetControllerId failed");
+        return NETMANAGER_EXT_ERR_WRITE_DATA_FAIL;
+    }
+    sptr<IRemoteObject> remote = Remote();
+    if (remote == nullptr) {
+        NETMGR_EXT_LOG_E("Remote is null");
+        return NETMANAGER_EXT_ERR_IPC_CONNECT_STUB_FAIL;
+    }
+    MessageParcel reply;
+    MessageOption option;
+    int32_t ret = remote->SendRequest(static_cast<uint32_t>(GET_PACKET_CONTROLLER_FLOW_MARK), data, reply, option);
+    if (ret != FIREWALL_SUCCESS) {
+        NETMGR_EXT_LOG_E("proxy SendRequest failed, error code: [%{public}d]", ret);
+        return ret;
+    }
+    if (!reply.ReadUint32(flowMark)) {
+        NETMGR_EXT_LOG_E("ReadUint32 flowMark failed");
+        return NETMANAGER_EXT_ERR_READ_DATA_FAIL;
+    }
+    return FIREWALL_SUCCESS;
+}
 } // namespace NetManagerStandard
 } // namespace OHOS
\ No newline at end of file
@@ -61,6 +61,8 @@ public:
 
     virtual int32_t QueryProcess(const std::string& srcIp, uint16_t srcPort,
         const std::string& dstIp, uint16_t dstPort, uint8_t protocol, uint32_t& uid, uint32_t& pid) = 0;
+    virtual int32_t QueryProcesses(const std::vector<TrafficFilterConnectionTuple>& connections,
+        std::vector<TrafficFilterProcessOwner>& owners) = 0;
     virtual int32_t AddPacketRule(const std::string& controllerId,
         const sptr<TrafficFilterPacketRule>& rule) = 0;
     virtual int32_t ClearPacketRule(const std::string& controllerId) = 0;
@@ -70,6 +72,9 @@ public:
 
     virtual int32_t DestroyPacketController(const std::string& packetControllerId) = 0;
     virtual int32_t SendVerdict(int32_t queueNum, uint32_t packetId, int32_t verdict, int32_t mark) = 0;
+    virtual int32_t GetPacketControllerFanoutFds(const std::string& packetControllerId,
+        std::vector<int32_t>& fds) = 0;
+    virtual int32_t GetPacketControllerFlowMark(const std::string& packetControllerId, uint32_t& flowMark) = 0;
 
     enum {
         SET_NET_FIREWALL_STATUS,
@@ -95,6 +100,9 @@ public:
         CREATE_PACKET_CONTROLLER,
         DESTROY_PACKET_CONTROLLER,
         SEND_VERDICT,
+        GET_PACKET_CONTROLLER_FANOUT_FDS,
+        GET_PACKET_CONTROLLER_FLOW_MARK,
+        QUERY_PROCESSES,
     };
     DECLARE_INTERFACE_DESCRIPTOR(u"OHOS.NetManagerStandard.INetFirewallService");
 };
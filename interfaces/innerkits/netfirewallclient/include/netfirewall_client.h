@@ -70,11 +70,15 @@ public:
     int32_t GetTrafficFilterGlobalStatus(bool& isEnabled);
     int32_t QueryProcess(const std::string& srcIp, uint16_t srcPort,
         const std::string& dstIp, uint16_t dstPort, uint8_t protocol, uint32_t& uid, uint32_t& pid);
+    int32_t QueryProcesses(const std::vector<TrafficFilterConnectionTuple>& connections,
+        std::vector<TrafficFilterProcessOwner>& owners);
     int32_t CreatePacketController(uint32_t groupId, uint32_t priority,
         const sptr<TrafficFilterConfig>& config, std::string& packetControllerId, int32_t& fd);
 
     int32_t DestroyPacketController(const std::string& packetControllerId);
     int32_t SendVerdict(int32_t queueNum, uint32_t packetId, int32_t verdict, int32_t mark);
+    int32_t GetPacketControllerFanoutFds(const std::string& packetControllerId, std::vector<int32_t>& fds);
+    int32_t GetPacketControllerFlowMark(const std::string& packetControllerId, uint32_t& flowMark);
     int32_t AddPacketRule(const std::string& controllerId, const sptr<TrafficFilterPacketRule>& rule);
     int32_t ClearPacketRule(const std::string& controllerId);
 
@@ -83,6 +83,13 @@ constexpr int32_t NETTRAFFICFILTER_MAX_PRIORITY = 10000;
 constexpr uint8_t NETTRAFFICFILTER_PROTO_ANY = 0;
 constexpr uint8_t NETTRAFFICFILTER_PROTO_TCP = 6;
 constexpr uint8_t NETTRAFFICFILTER_PROTO_UDP = 17;
+constexpr uint32_t NETTRAFFICFILTER_MAX_QUEUE_COUNT = 8;
+constexpr uint32_t NETTRAFFICFILTER_MAX_QUERY_PROCESS_COUNT = 64;
+// conntrack mark bits of the flow verdict cache: a per-controller slot plus a drop flag
+constexpr uint32_t NETTRAFFICFILTER_FLOW_CACHE_MASK = 0x7F000000;
+constexpr uint32_t NETTRAFFICFILTER_FLOW_CACHE_DROP = 0x40000000;
+constexpr uint32_t NETTRAFFICFILTER_FLOW_CACHE_SLOT_SHIFT = 24;
+constexpr uint32_t NETTRAFFICFILTER_FLOW_CACHE_MAX_SLOT = 0x3F;
 
 enum class TrafficFilterIPFamily {
     IP_FAMILY_UNSPEC = 0,
@@ -306,6 +313,9 @@ struct TrafficFilterConfig final : public Parcelable {
     uint32_t packetCopyLen_;
     uint32_t nfqueueMaxlen_;
     uint32_t nfqueueFlags_;
+    uint32_t queueCount_ = 1;
+    bool flowCache_ = false;
+    bool userSpaceMatch_ = false;
 
     bool Marshalling(Parcel &parcel) const override;
     static sptr<TrafficFilterConfig> Unmarshalling(Parcel &parcel);
@@ -360,6 +370,31 @@ struct TrafficFilterPacketRule final : public Parcelable {
     bool Marshalling(Parcel &parcel) const override;
     static sptr<TrafficFilterPacketRule> Unmarshalling(Parcel &parcel);
 };
+
+// uid and conntrack conditions are only known to the kernel, rules using them cannot be matched in user space
+inline bool IsPacketRuleUserSpaceMatchable(const TrafficFilterPacketRule& rule)
+{
+    bool hasUid = rule.uidStart_ != static_cast<uint32_t>(-1) && rule.uidEnd_ != static_cast<uint32_t>(-1) &&
+        rule.hookPoint_ == static_cast<int32_t>(TrafficFilterHookPoint::HOOK_OUTPUT);
+    bool hasConntrack = rule.conntrackMatch_.enable_ && rule.conntrackMatch_.stateMask_ != 0;
+    return !hasUid && !hasConntrack;
+}
+
+// One connection of a batched QueryProcesses call, ports 0 match any port
+struct TrafficFilterConnectionTuple {
+    std::string srcIp_;
+    uint16_t srcPort_ = 0;
+    std::string dstIp_;
+    uint16_t dstPort_ = 0;
+    uint8_t protocol_ = 0;
+};
+
+// Owner of one queried connection, uid_ and pid_ are valid only when result_ is 0
+struct TrafficFilterProcessOwner {
+    int32_t result_ = 0;
+    uint32_t uid_ = 0;
+    uint32_t pid_ = 0;
+};
 } // namespace NetManagerStandard
 } // namespace OHOS
 
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NETTRAFFICFILTER_LATENCY_HISTOGRAM_H
+#define NETTRAFFICFILTER_LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace OHOS {
+namespace NetManagerStandard {
+/*
+ * Log2 histogram of durations in nanoseconds. Bucket 0 counts samples below 2ns, bucket i counts samples from 2^i
+ * up to 2^(i+1) ns and the last bucket also takes every longer sample. Recording is lock free and may race with
+ * readers, a snapshot taken meanwhile can be off by the samples in flight.
+ */
+class TrafficFilterLatencyHistogram {
+public:
+    static constexpr uint32_t BUCKET_COUNT = 32;
+
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t totalNs = 0;
+        uint64_t maxNs = 0;
+        std::array<uint64_t, BUCKET_COUNT> buckets {};
+    };
+
+    static uint64_t ElapsedNs(std::chrono::steady_clock::time_point start)
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+
+    void Record(uint64_t ns)
+    {
+        uint32_t bucket = (ns < 2) ? 0 : static_cast<uint32_t>(63 - __builtin_clzll(ns));
+        if (bucket >= BUCKET_COUNT) {
+            bucket = BUCKET_COUNT - 1;
+        }
+        buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        totalNs_.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t max = maxNs_.load(std::memory_order_relaxed);
+        while (ns > max && !maxNs_.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    Snapshot Read() const
+    {
+        Snapshot snapshot;
+        snapshot.count = count_.load(std::memory_order_relaxed);
+        snapshot.totalNs = totalNs_.load(std::memory_order_relaxed);
+        snapshot.maxNs = maxNs_.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < BUCKET_COUNT; i++) {
+            snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        }
+        return snapshot;
+    }
+
+    // Upper bound in ns of the bucket holding the given percentile, 0 without samples
+    static uint64_t PercentileUpperBound(const Snapshot& snapshot, uint32_t percent)
+    {
+        uint64_t total = 0;
+        for (uint64_t bucketCount : snapshot.buckets) {
+            total += bucketCount;
+        }
+        if (total == 0) {
+            return 0;
+        }
+        uint64_t rank = (total * percent + 99) / 100;
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < BUCKET_COUNT; i++) {
+            seen += snapshot.buckets[i];
+            if (seen >= rank) {
+                return (i + 1 < BUCKET_COUNT) ? (uint64_t(1) << (i + 1)) : snapshot.maxNs;
+            }
+        }
+        return snapshot.maxNs;
+    }
+
+    // One line summary for dumps, in microseconds
+    std::string Summary() const
+    {
+        constexpr uint64_t NS_PER_US = 1000;
+        constexpr uint32_t MEDIAN = 50;
+        constexpr uint32_t TAIL = 99;
+        Snapshot snapshot = Read();
+        uint64_t avgNs = (snapshot.count == 0) ? 0 : snapshot.totalNs / snapshot.count;
+        return "count=" + std::to_string(snapshot.count) + " avg=" + std::to_string(avgNs / NS_PER_US) +
+            "us p50<=" + std::to_string(PercentileUpperBound(snapshot, MEDIAN) / NS_PER_US) +
+            "us p99<=" + std::to_string(PercentileUpperBound(snapshot, TAIL) / NS_PER_US) +
+            "us max=" + std::to_string(snapshot.maxNs / NS_PER_US) + "us";
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets_ {};
+    std::atomic<uint64_t> count_ {0};
+    std::atomic<uint64_t> totalNs_ {0};
+    std::atomic<uint64_t> maxNs_ {0};
+};
+} // namespace NetManagerStandard
+} // namespace OHOS
+
+#endif // NETTRAFFICFILTER_LATENCY_HISTOGRAM_H
@@ -163,6 +163,27 @@ int32_t OH_TrafficFilter_AddPacketRule(
  */
 int32_t OH_TrafficFilter_ClearPacketRule(OH_TrafficFilter_PacketController* controller);
 
+/**
+ * @brief Get the performance counters of a packet controller
+ *
+ * Reads the counters kept by the receive workers of the controller in the calling process,
+ * the system service is not involved.
+ *
+ * @param controller OH_TrafficFilter_PacketController handle
+ * @param stats Output counters, see {@link OH_TrafficFilter_PacketControllerStats} for the
+ *     initialization rule.
+ * @return <ul><li>{@link OH_TRAFFICFILTER_OK} on success.</li>
+ *     <li>{@link OH_TRAFFICFILTER_ERROR_INVALID_PARAM} if controller or stats is NULL or
+ *     stats->size is too small.</li>
+ *     <li>{@link OH_TRAFFICFILTER_ERROR_NOT_FOUND} if controller is not a valid handle.</li></ul>
+ *
+ * @since 26.1.0
+ */
+int32_t OH_TrafficFilter_GetPacketControllerStats(
+    OH_TrafficFilter_PacketController* controller,
+    OH_TrafficFilter_PacketControllerStats* stats
+);
+
 /**
  * @brief Creates a traffic redirection instance
  * Creates a traffic redirection instance for transparent TCP traffic redirection to proxy server
@@ -269,6 +290,33 @@ int32_t OH_TrafficFilter_QueryProcess(
     OH_TrafficFilter_ProcessInfo* process_info
 );
 
+/**
+ * @brief Queries corresponding process information of several connections in one call
+ *
+ * Resolves every connection against the same snapshot of the system socket table, which is
+ * cheaper than calling {@link OH_TrafficFilter_QueryProcess} once per connection.
+ * Each entry follows the initialization and ABI rules of {@link OH_TrafficFilter_QueryProcess}.
+ *
+ * @param connection_infos Input array of count connection information pointers
+ * @param process_infos Output array of count process information pointers
+ * @param results Output array of count per-connection results, {@link OH_TRAFFICFILTER_OK} when the
+ *     process was found and {@link OH_TRAFFICFILTER_ERROR_NOT_FOUND} otherwise. process_infos[i] is
+ *     written only when results[i] is {@link OH_TRAFFICFILTER_OK}.
+ * @param count Number of connections, 1 to {@link OH_TRAFFICFILTER_MAX_QUERY_PROCESS_COUNT}
+ * @return <ul><li>{@link OH_TRAFFICFILTER_OK} on success, per-connection results are in results.</li>
+ *     <li>{@link OH_TRAFFICFILTER_ERROR_PERMISSION_DENIED} if permission is denied.</li>
+ *     <li>{@link OH_TRAFFICFILTER_ERROR_INVALID_PARAM} if any input parameter is invalid.</li></ul>
+ *
+ * @permission ohos.permission.kernel.TRAFFIC_FILTER
+ * @since 26.1.0
+ */
+int32_t OH_TrafficFilter_QueryProcesses(
+    const OH_TrafficFilter_ConnectionInfo* const* connection_infos,
+    OH_TrafficFilter_ProcessInfo* const* process_infos,
+    int32_t* results,
+    uint32_t count
+);
+
 #ifdef __cplusplus
 }
 #endif
@@ -16,13 +16,59 @@
 #ifndef NET_TRAFFICFILTER_ADAPTER_H
 #define NET_TRAFFICFILTER_ADAPTER_H
 
+#include <chrono>
 #include <mutex>
 #include <string>
 #include <map>
+#include <memory>
+#include <vector>
 #include <sys/time.h>
 #include "net_trafficfilter_type.h"
+#include "net_trafficfilter_packet_classifier.h"
+#include "nettrafficfilter_latency_histogram.h"
 struct OH_TrafficFilter_Redirector {
 };
+
+#define NFQ_VERDICT_BATCH_MAX 256
+#define NFQ_PACKET_HEADER_MAX 256
+#define NFQ_PENDING_VERDICT_MAX 256
+
+// A verdict message sent on the socket, kept until the kernel answered it or the slot is reused
+struct NfqPendingVerdict {
+    uint32_t seq = 0;
+    uint16_t queueNum = 0;
+    uint32_t verdict = 0;
+    uint32_t firstId = 0;
+    uint32_t lastId = 0;
+};
+
+struct NfqVerdictBatch {
+    uint16_t queueNum = 0;
+    uint32_t verdict = 0;
+    bool cacheFlow = true;
+    uint32_t count = 0;
+    uint32_t packetIds[NFQ_VERDICT_BATCH_MAX];
+    // id of the last packet decided, a batch verdict must continue right after it
+    bool hasDecided = false;
+    uint32_t lastDecidedId = 0;
+    // sequence number of the last verdict message, its slot in pending is seq % NFQ_PENDING_VERDICT_MAX
+    uint32_t lastSeq = 0;
+    NfqPendingVerdict pending[NFQ_PENDING_VERDICT_MAX];
+};
+
+// Counters of one receive worker, written by the worker thread only and read by GetPacketControllerStats
+struct alignas(64) NfqWorkerStats {
+    std::atomic<uint64_t> packetsReceived{0};
+    std::atomic<uint64_t> packetsAccepted{0};
+    std::atomic<uint64_t> packetsDropped{0};
+    std::atomic<uint64_t> packetsBypassed{0};
+    std::atomic<uint64_t> queueDrops{0};
+    std::atomic<uint64_t> enobufsEvents{0};
+    std::atomic<uint64_t> serviceVerdicts{0};
+    OHOS::NetManagerStandard::TrafficFilterLatencyHistogram callbackLatency;
+    OHOS::NetManagerStandard::TrafficFilterLatencyHistogram verdictLatency;
+};
+
 struct OH_TrafficFilter_PacketController {
     uint32_t groupId;
     int32_t queueNum;
@@ -35,8 +81,23 @@ struct OH_TrafficFilter_PacketController {
     std::atomic<bool> callbackRegistered{false};
     uint32_t packetCopyMode;
     uint32_t nfqueueFlags;
+    uint32_t recvBatchSize = 1;
     uint32_t lastPacketId = 0;
     bool isFirstPacket = true;
+    // verdicts go through the service until then after the socket refused one
+    std::chrono::steady_clock::time_point directVerdictRetry{};
+    NfqVerdictBatch verdictBatch;
+    uint32_t flowCacheMark = 0;
+    // rules are matched against classifier, without one no packet reaches the callback
+    bool userSpaceMatch = false;
+    alignas(8) uint8_t headerArena[NFQ_PACKET_HEADER_MAX];
+    uint32_t workerIndex = 0;
+    uint32_t workerCount = 1;
+    std::vector<std::unique_ptr<OH_TrafficFilter_PacketController>> fanoutWorkers;
+    std::shared_ptr<const OHOS::NetManagerStandard::PacketRuleClassifier> classifier;
+    NfqWorkerStats* stats = nullptr;
+    // one entry per queue, owned by the controller handle so the counters outlive the fan-out workers
+    std::vector<std::unique_ptr<NfqWorkerStats>> workerStats;
 };
 
 #define NFQA_PACKET_HDR     1
@@ -47,6 +108,13 @@ struct OH_TrafficFilter_PacketController {
 #define NFQA_IFINDEX_OUTDEV 6
 #define NFQA_HWADDR         9
 #define NFQA_PAYLOAD        10
+#define NFQA_CT             11
+
+#define CTA_MARK            8
+#define CTA_MARK_MASK       21
+
+#define NFQNL_MSG_VERDICT       1
+#define NFQNL_MSG_VERDICT_BATCH 3
 
 struct NfqNfg {
     uint8_t  family;
@@ -60,6 +128,11 @@ struct NfqPhdr {
     uint8_t  hook;
 };
 
+struct NfqVerdictHdr {
+    uint32_t verdict;
+    uint32_t id;
+};
+
 struct NfqHwaddr {
     uint16_t hwAddrlen;
     uint16_t pad;
@@ -88,6 +161,8 @@ constexpr uint32_t PROCESS_INFO_MIN_SIZE =
     static_cast<uint32_t>(offsetof(OH_TrafficFilter_ProcessInfo, size) + sizeof(uint32_t));
 constexpr uint32_t REDIRECT_RULE_MIN_SIZE =
     static_cast<uint32_t>(offsetof(OH_TrafficFilter_RedirectRule, proxyPort) + sizeof(uint16_t));
+constexpr uint32_t PACKET_CONTROLLER_STATS_MIN_SIZE =
+    static_cast<uint32_t>(offsetof(OH_TrafficFilter_PacketControllerStats, size) + sizeof(uint32_t));
 constexpr uint32_t PACKET_CONTROLLER_MIN_SIZE =
     static_cast<uint32_t>(offsetof(OH_TrafficFilter_Config, nfqueueFlags) + sizeof(uint32_t));
 constexpr uint32_t PACKET_COPY_LEN_MAX = 0xFFFF;
@@ -116,6 +191,9 @@ public:
     int32_t QueryProcess(const OH_TrafficFilter_ConnectionInfo* connectionInfo,
         OH_TrafficFilter_ProcessInfo* processInfo);
 
+    int32_t QueryProcesses(const OH_TrafficFilter_ConnectionInfo* const* connectionInfos,
+        OH_TrafficFilter_ProcessInfo* const* processInfos, int32_t* results, uint32_t count);
+
 private:
     RedirectorAdapterManager() = default;
     ~RedirectorAdapterManager() = default;
@@ -144,6 +222,11 @@ public:
 
     int32_t UnregisterPacketCallback(OH_TrafficFilter_PacketController* controller);
     int32_t SendVerdict(int32_t queueNum, uint32_t packetId, int32_t verdict, int32_t mark);
+    void QueueVerdict(OH_TrafficFilter_PacketController* controller, uint16_t queueNum,
+        uint32_t packetId, int32_t verdict, bool cacheFlow = true);
+    void FlushVerdicts(OH_TrafficFilter_PacketController* controller);
+    int32_t GetPacketControllerStats(OH_TrafficFilter_PacketController* controller,
+        OH_TrafficFilter_PacketControllerStats* stats);
 
 private:
     PacketControllerAdapterManager() = default;
@@ -154,14 +237,25 @@ private:
         int32_t fd;
         uint32_t packetCopyMode;
         uint32_t nfqueueFlags;
+        uint32_t recvBatchSize;
+        std::vector<int32_t> fanoutFds;
+        uint32_t flowCacheMark;
+        bool userSpaceMatch;
     };
     int32_t CheckConfig(const OH_TrafficFilter_Config* config);
+    int32_t StartWorkers(OH_TrafficFilter_PacketController* controller, const PacketInfo& packetInfo);
+    void StopWorkers(OH_TrafficFilter_PacketController* controller);
     int32_t AddPacketController(const PacketInfo& packetInfo, OH_TrafficFilter_PacketController** controller);
     bool GetPacketInfo(OH_TrafficFilter_PacketController* controller, PacketInfo& packetInfo);
+    void UpdateUserSpaceRules(OH_TrafficFilter_PacketController* controller, const TrafficFilterPacketRule* rule);
+    void PublishClassifier(OH_TrafficFilter_PacketController* controller,
+        const std::shared_ptr<const PacketRuleClassifier>& classifier);
     std::mutex mapMutex_;
     std::map<OH_TrafficFilter_PacketController*, PacketInfo> controllerIdMap_;
     std::mutex callbackMutex_;
     std::map<OH_TrafficFilter_PacketController*, std::pair<OH_TrafficFilter_PacketCallback, void*>> callbackMap_;
+    std::mutex ruleMutex_;
+    std::map<OH_TrafficFilter_PacketController*, std::vector<TrafficFilterPacketRule>> userSpaceRules_;
 };
 }
 }
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NET_TRAFFICFILTER_PACKET_CLASSIFIER_H
+#define NET_TRAFFICFILTER_PACKET_CLASSIFIER_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "netfirewall_common.h"
+
+namespace OHOS {
+namespace NetManagerStandard {
+// Fields of one queued packet, tcpFlags uses the OH_TRAFFICFILTER_TCP_FLAG_* bits
+struct ClassifierPacket {
+    int32_t hookPoint = -1;
+    int32_t family = 0;
+    const uint8_t *srcAddr = nullptr;
+    const uint8_t *dstAddr = nullptr;
+    uint8_t protocol = 0;
+    bool hasPorts = false;
+    uint16_t srcPort = 0;
+    uint16_t dstPort = 0;
+    bool hasTcpFlags = false;
+    uint8_t tcpFlags = 0;
+    uint32_t indev = 0;
+    uint32_t outdev = 0;
+    const uint8_t *srcMac = nullptr;
+};
+
+/*
+ * Compiled form of the packet rules of one controller. Each rule is split into the same ordered NFQUEUE and
+ * RETURN terms NetTrafficFilterIptablesCommandBuilder installs, and every match dimension maps a packet field to
+ * the bit set of terms it satisfies: prefix tries for the addresses, interval tables for the ports and lookup
+ * tables for the protocol and the TCP flags. The first term left in the intersection decides the packet.
+ */
+class PacketRuleClassifier {
+public:
+    ~PacketRuleClassifier();
+
+    static std::shared_ptr<const PacketRuleClassifier> Build(const std::vector<TrafficFilterPacketRule> &rules);
+
+    // true when the rules would have queued the packet to the callback
+    bool ShouldDeliver(const ClassifierPacket &packet) const;
+
+private:
+    static constexpr size_t HOOK_COUNT = 3;
+    struct HookTable;
+
+    PacketRuleClassifier();
+
+    std::array<std::unique_ptr<HookTable>, HOOK_COUNT> hooks_;
+};
+} // namespace NetManagerStandard
+} // namespace OHOS
+
+#endif /* NET_TRAFFICFILTER_PACKET_CLASSIFIER_H */
@@ -85,6 +85,30 @@ extern "C" {
  */
 #define OH_TRAFFICFILTER_DEFAULT_QUEUE_MAXLEN  1024
 
+/**
+ * @brief Maximum number of netlink messages drained by one receive call of a packet controller
+ * @since 26.1.0
+ */
+#define OH_TRAFFICFILTER_MAX_RECV_BATCH  16
+
+/**
+ * @brief Maximum number of NFQueue queues a packet controller can fan out to
+ * @since 26.1.0
+ */
+#define OH_TRAFFICFILTER_MAX_QUEUE_COUNT  8
+
+/**
+ * @brief Maximum number of connections queried by one {@link OH_TrafficFilter_QueryProcesses} call
+ * @since 26.1.0
+ */
+#define OH_TRAFFICFILTER_MAX_QUERY_PROCESS_COUNT  64
+
+/**
+ * @brief Number of buckets of a latency histogram
+ * @since 26.1.0
+ */
+#define OH_TRAFFICFILTER_LATENCY_BUCKET_COUNT  32
+
 /**
  * @brief NFQueue queue flag: FAIL-OPEN mode
  * When userspace process crashes, kernel automatically accepts packets to avoid network interruption
@@ -690,6 +714,36 @@ typedef struct OH_TrafficFilter_Config {
      * @since 26.1.0
      */
     uint32_t nfqueueFlags;
+    /**
+     * @brief Number of netlink messages received per system call by the packet worker,
+     * 0 or 1 means one message per call, the maximum is {@link OH_TRAFFICFILTER_MAX_RECV_BATCH}.
+     * Equal decisions for packets with consecutive ids are answered with one batch verdict message.
+     * @since 26.1.0
+     */
+    uint32_t recvBatchSize;
+    /**
+     * @brief Number of NFQueue queues the packets are balanced across, each drained by its own worker thread,
+     * 0 or 1 means a single queue, the maximum is {@link OH_TRAFFICFILTER_MAX_QUEUE_COUNT}.
+     * Callbacks may be invoked concurrently from different worker threads when greater than 1.
+     * @since 26.1.0
+     */
+    uint32_t queueCount;
+    /**
+     * @brief Remember the decision of the callback for the whole connection of a packet. Later packets of an
+     * accepted or dropped connection are handled in the kernel and no longer delivered to the callback.
+     * The connection is marked by the verdict of each packet, so verdicts are not batched then.
+     * @since 26.1.0
+     */
+    bool enableFlowCache;
+    /**
+     * @brief Match the packet rules in the worker thread instead of expanding them into kernel rules. Every
+     * packet of a hook point with rules is queued, and packets no rule matches are accepted without invoking
+     * the callback, which keeps large rule sets cheap for the kernel. Packets accepted this way are not seen by
+     * controllers of lower priority on the same hook point. Hook points with uid or conntrack conditions keep
+     * their kernel rules. Cannot be combined with {@link OH_TRAFFICFILTER_COPY_MODE_META}.
+     * @since 26.1.0
+     */
+    bool enableUserSpaceMatch;
 } OH_TrafficFilter_Config;
 
 /**
@@ -963,6 +1017,108 @@ typedef struct OH_TrafficFilter_FilterRule {
     OH_TrafficFilter_ConntrackMatch conntrackMatch;
 } OH_TrafficFilter_FilterRule;
 
+/**
+ * @brief Log2 latency histogram
+ *
+ * buckets[0] counts samples below 2 nanoseconds, buckets[i] counts samples from 2^i up to 2^(i+1)
+ * nanoseconds and the last bucket also counts every longer sample.
+ * @since 26.1.0
+ */
+typedef struct OH_TrafficFilter_LatencyHistogram {
+    /**
+     * @brief Number of samples
+     * @since 26.1.0
+     */
+    uint64_t count;
+    /**
+     * @brief Sum of all samples in nanoseconds
+     * @since 26.1.0
+     */
+    uint64_t totalNs;
+    /**
+     * @brief Longest sample in nanoseconds
+     * @since 26.1.0
+     */
+    uint64_t maxNs;
+    /**
+     * @brief Sample count per log2 bucket
+     * @since 26.1.0
+     */
+    uint64_t buckets[OH_TRAFFICFILTER_LATENCY_BUCKET_COUNT];
+} OH_TrafficFilter_LatencyHistogram;
+
+/**
+ * @brief Performance counters of a packet controller.
+ *
+ * Counters accumulate from the creation of the controller over all of its queues and are kept
+ * across callback registrations.
+ *
+ * Initialization rule:
+ * Before calling {@link OH_TrafficFilter_GetPacketControllerStats}, the caller must clear this
+ * structure to zero and then set {@link size} to the actual size of the structure allocated by
+ * the caller, usually sizeof(OH_TrafficFilter_PacketControllerStats).
+ *
+ * ABI compatibility rule:
+ * Only fields fully covered by {@link size} are written by the library. If {@link size} is
+ * larger than the size known by the library, the extra fields are left untouched.
+ *
+ * @since 26.1.0
+ */
+typedef struct OH_TrafficFilter_PacketControllerStats {
+    /**
+     * @brief the actual size of the structure allocated by the caller.
+     * @since 26.1.0
+     */
+    uint32_t size;
+    /**
+     * @brief Packets received from the kernel queues
+     * @since 26.1.0
+     */
+    uint64_t packetsReceived;
+    /**
+     * @brief Packets given an accept verdict
+     * @since 26.1.0
+     */
+    uint64_t packetsAccepted;
+    /**
+     * @brief Packets given a drop verdict
+     * @since 26.1.0
+     */
+    uint64_t packetsDropped;
+    /**
+     * @brief Packets decided without calling the callback, because no rule selected them or
+     *     their payload could not be parsed
+     * @since 26.1.0
+     */
+    uint64_t packetsBypassed;
+    /**
+     * @brief Packets missing from the packet ID sequence, dropped or accepted by the kernel
+     *     according to {@link OH_TRAFFICFILTER_NFQUEUE_FLAG_FAIL_OPEN} because a queue was full
+     * @since 26.1.0
+     */
+    uint64_t queueDrops;
+    /**
+     * @brief Times the receive buffer of a queue socket overflowed (ENOBUFS)
+     * @since 26.1.0
+     */
+    uint64_t enobufsEvents;
+    /**
+     * @brief Verdicts sent through the system service because the queue socket rejected them
+     * @since 26.1.0
+     */
+    uint64_t serviceVerdicts;
+    /**
+     * @brief Time spent in the packet callback
+     * @since 26.1.0
+     */
+    OH_TrafficFilter_LatencyHistogram callbackLatency;
+    /**
+     * @brief Time taken to hand one verdict message to the kernel or the system service
+     * @since 26.1.0
+     */
+    OH_TrafficFilter_LatencyHistogram verdictLatency;
+} OH_TrafficFilter_PacketControllerStats;
+
 /**
  * @brief Traffic redirector
  * @since 26.0.0
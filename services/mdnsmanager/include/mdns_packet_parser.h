@@ -17,6 +17,7 @@
 #define MDNS_PACKET_PARSER_H
 
 #include <any>
+#include <array>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -236,6 +237,63 @@ private:
     const uint8_t *pos_ = nullptr;
 };
 
+// Read-only view over a received payload, used to decide whether a packet is worth a full parse.
+// Entries are read in place and names stay offsets into the payload, compression pointers are only
+// followed when a name is copied into a caller provided buffer, so looking at a packet never allocates.
+class MDnsPayloadView {
+public:
+    struct QuestionView {
+        size_t nameOffset = 0;
+        uint16_t qtype = 0;
+        uint16_t qclass = 0;
+    };
+
+    struct RecordView {
+        size_t nameOffset = 0;
+        uint16_t rtype = 0;
+        uint16_t rclass = 0;
+        uint32_t ttl = 0;
+        uint16_t length = 0;
+        size_t rdataOffset = 0;
+    };
+
+    // Room for the longest name in the dotted form FromBytes produces, plus the trailing dot
+    using NameBuffer = std::array<char, MDNS_MAX_DOMAIN + 1>;
+
+    explicit MDnsPayloadView(const MDnsPayload &payload);
+    ~MDnsPayloadView() = default;
+
+    bool IsValid() const;
+    const DNSProto::Header &GetHeader() const;
+
+    /**
+     * offset of the first question, entries follow in wire order
+     */
+    size_t Begin() const;
+
+    /**
+     * read the entry at pos and move pos past it
+     *
+     * @return false if the entry is truncated or its name is malformed
+     */
+    bool ReadQuestion(size_t &pos, QuestionView &question) const;
+    bool ReadRecord(size_t &pos, RecordView &record) const;
+
+    /**
+     * resolve the name at offset into buffer, in the same form as the names FromBytes produces
+     *
+     * @return false on bad labels, bad compression pointers or names longer than the buffer
+     */
+    bool ReadName(size_t offset, NameBuffer &buffer, std::string_view &name) const;
+
+private:
+    bool SkipName(size_t &pos) const;
+
+    const MDnsPayload &payload_;
+    DNSProto::Header header_;
+    bool valid_ = false;
+};
+
 } // namespace NetManagerStandard
 } // namespace OHOS
 #endif /* MDNS_PACKET_PARSER_H */
@@ -17,7 +17,10 @@
 #define MDNS_MANAGER_H
 
 #include <any>
+#include <atomic>
 #include <list>
+#include <mutex>
+#include <random>
 #include <set>
 #include <string>
 #include <shared_mutex>
@@ -26,6 +29,8 @@
 #include "mdns_common.h"
 #include "mdns_packet_parser.h"
 #include "mdns_socket_listener.h"
+#include "mdns_suffix_map.h"
+#include "mdns_timer_wheel.h"
 #include "common_event_subscriber.h"
 #include "common_event_support.h"
 #include "common_event_manager.h"
@@ -91,8 +96,16 @@ public:
     void Init();
     int32_t Announce(const Result &info, bool off);
     void ReceivePacket(int sock, const MDnsPayload &payload);
+    bool HasQuestionToAnswer(int sock, const MDnsPayloadView &view);
+    bool HasAnswerToProcess(int sock, const MDnsPayloadView &view);
+    void ReceiveQuestion(int sock, const MDnsPayload &payload, const MDnsPayloadView &view);
+    void InvalidateResponseCache();
     void RunTaskQueue(std::list<Task> &queue);
+    void RunTasks();
+    void RunTimers();
+    int NextTimeout();
     void ProcessQuestion(int sock, const MDnsMessage &msg);
+    MDnsPayload BuildQuestionResponse(int sock, const MDnsMessage &msg);
     void ProcessQuestionRecord(const std::any &anyAddr, const DNSProto::RRType &anyAddrType,
                                const DNSProto::Question &qu, int &phase, MDnsMessage &response);
     void ProcessAnswer(int sock, const MDnsMessage &msg);
@@ -129,24 +142,122 @@ private:
             : OHOS::EventFwk::CommonEventSubscriber(subscribeInfo) {};
         virtual void OnReceiveEvent(const EventFwk::CommonEventData &eventData) override;
     };
+    // Stale service waiting for a TCP liveness probe, matched back by name and refresh time
+    struct ProbeTarget {
+        std::string key;
+        std::string serviceName;
+        int64_t refrehTime = -1;
+        std::string addr;
+        bool ipv6 = false;
+        int port = -1;
+    };
+
     void SubscribeCes();
     void handleOfflineService(const std::string &key, std::vector<Result> &res);
+    void ReportServiceLost(const std::string &key, std::vector<Result> &res, std::vector<Result>::iterator &it);
+    void StartLivenessProbe();
+    void ApplyProbeResults(uint64_t generation, const std::vector<ProbeTarget> &targets,
+                           const std::vector<bool> &alive);
+    static std::vector<bool> ProbeConnectivity(const std::vector<ProbeTarget> &targets);
     void KillBrowseCache(const std::string &key, std::vector<Result>::iterator &it);
 
-    int32_t ConnectControl(int32_t sockfd, sockaddr* serverAddr);
+    // Browse query back-off of one service type
+    struct BrowseSchedule {
+        uint32_t intervalMs = 0;
+        int64_t lastQuery = -1;
+        MDnsTimerWheel::TimerId timer = MDnsTimerWheel::INVALID_TIMER;
+    };
+    using TimerList = std::vector<MDnsTimerWheel::TimerId>;
+
+    void ResetTimers();
+    void ScheduleSweep();
+    void StartBrowseSchedule(const std::string &key);
+    void RunBrowseSchedule(const std::string &key);
+    void SendBrowseQuery(const std::string &key);
+    void ScheduleRecordTimers(TimerList &timers, const Result &result, const MDnsTimerWheel::Callback &refresh,
+                              const MDnsTimerWheel::Callback &expire);
+    void ScheduleCacheTimers(const std::string &name);
+    void ScheduleBrowseTimers(const std::string &key, const Result &result);
+    bool HasCacheInterest(const std::string &name, const Result &result);
+    void RefreshCache(const std::string &name);
+    void ExpireCache(const std::string &name, int64_t refrehTime);
+    void RefreshBrowse(const std::string &key);
+    void ExpireBrowse(const std::string &key, const std::string &instance, int64_t refrehTime);
+
+    // Question name and type, the unit of duplicate question suppression
+    using QuestionKey = std::pair<std::string, uint16_t>;
+
+    void ReceiveKnownAnswerQuestion(int sock, const MDnsPayload &payload, bool own);
+    void DeferQuestion(int sock, MDnsMessage &msg);
+    void AnswerDeferredQuestion(int sock);
+    void SuppressKnownAnswers(int sock, const MDnsMessage &msg, MDnsMessage &response);
+    std::vector<DNSProto::ResourceRecord> KnownBrowseAnswers(const std::string &key);
+    bool IsKnownAnswerSubset(const DNSProto::Question &qu, const std::vector<DNSProto::ResourceRecord> &answers);
+    Result &CacheEntry(const std::string &name);
+    void EraseCacheEntry(const std::string &name);
+    std::vector<Result> &BrowseEntry(const std::string &name);
+    bool IsAskedQuestion(std::string_view name, uint16_t qtype, uint16_t qclass);
+    void NoteQuestion(int sock, std::string_view name, uint16_t qtype, uint16_t qclass);
+    bool IsQuestionHeard(int sock, const std::vector<DNSProto::Question> &questions);
+    void NoteAnswers(int sock, const MDnsPayload &payload, const MDnsPayloadView &view);
+    bool IsOwnRecord(uint16_t rtype, std::string_view name, std::string_view target);
+    bool IsRegistered(std::string_view name);
+    bool HasHeardAnswers(int sock);
+    void MulticastQuery(const std::vector<DNSProto::Question> &questions, const std::vector<MDnsPayload> &packets);
+    void MulticastResponse(int sock, const MDnsPayload &response);
+    void RememberSent(const MDnsPayload &payload);
+    void RememberSentLocked(const MDnsPayload &payload);
+    bool IsOwnPacket(const MDnsPayload &payload);
+
     bool IsConnectivity(const std::string &ip, int32_t port);
 
 public:
-    std::map<std::string, Result> srvMap_;
+    // Maps looked up by packet names use transparent comparators, so a std::string_view key needs no copy.
+    // Registered services are also indexed by type, see ProcessQuestionRecord.
+    // Guarded by srvMutex_, packets only take it shared.
+    MDnsSuffixMap<Result> srvMap_;
 
 private:
     int64_t lastRunTime = {-1};
     std::shared_mutex configMutex_;
     MDnsConfig config_;
     MDnsSocketListener listener_;
-    std::map<std::string, std::vector<Result>> browserMap_;
-    std::map<std::string, Result> cacheMap_;
+    std::map<std::string, std::vector<Result>, std::less<>> browserMap_;
+    std::map<std::string, Result, std::less<>> cacheMap_;
+    // Serialised responses per socket and question section, see ReceiveQuestion
+    std::map<int, std::map<std::string, MDnsPayload, std::less<>>> responseCache_;
+    // Bumped whenever responseCache_ is invalidated, a response built across a change is not cached
+    uint64_t responseGeneration_ = 0;
+    // Serialised PTR query per browsed type
+    std::map<std::string, MDnsPayload, std::less<>> browseQueryCache_;
+    std::vector<ProbeTarget> probeTargets_;
+    std::atomic_bool probeInFlight_ = false;
+    // Bumped by Init, a probe started before it no longer reports back
+    std::atomic_uint64_t probeGeneration_ = 0;
+    // Refresh queries, record expiry and browse queries, all run on the listener thread under mutex_
+    MDnsTimerWheel timerWheel_;
+    MDnsTimerWheel::TimerId sweepTimer_ = MDnsTimerWheel::INVALID_TIMER;
+    std::map<std::string, BrowseSchedule, std::less<>> browseSchedule_;
+    std::map<std::string, TimerList, std::less<>> cacheTimers_;
+    std::map<std::string, TimerList, std::less<>> browseTimers_;
+    std::minstd_rand jitter_{std::random_device{}()};
+    // Duplicate suppression state per socket, RFC 6762 7.2 to 7.4. Heard entries go stale after a second.
+    std::map<int, std::list<MDnsMessage>> deferredQuestions_;
+    std::map<int, std::map<QuestionKey, int64_t>> heardQuestions_;
+    std::map<int, std::map<std::string, int64_t>> heardAnswers_;
+    // Packets multicast by this host, so their loopback copies are not taken for another host's
+    std::map<MDnsPayload, int64_t> sentPackets_;
+    // Lock domains, taken in this order and never the other way round:
+    // mutex_ guards browse results, the resolve cache, events, timers and probes,
+    // discoveryMutex_ guards the names in browserMap_ and cacheMap_ for readers not holding mutex_, so adding or
+    // removing one needs both, see CacheEntry. srvMutex_ guards srvMap_, responderMutex_ guards responseCache_,
+    // responseGeneration_, deferredQuestions_, heardQuestions_, heardAnswers_ and sentPackets_,
+    // taskMutex_ guards taskQueue_. Nothing else is locked while holding responderMutex_ or taskMutex_.
     std::recursive_mutex mutex_;
+    std::shared_mutex discoveryMutex_;
+    std::shared_mutex srvMutex_;
+    std::mutex responderMutex_;
+    std::mutex taskMutex_;
     std::list<Task> taskQueue_;
     std::map<std::string, std::list<Task>> taskOnChange_;
     std::map<std::string, sptr<IDiscoveryCallback>> nameCbMap_;
@@ -19,10 +19,13 @@
 #include <atomic>
 #include <cstddef>
 #include <functional>
+#include <map>
 #include <mutex>
+#include <string>
 #include <string_view>
 #include <sys/socket.h>
 #include <thread>
+#include <vector>
 
 #include <ifaddrs.h>
 
@@ -37,6 +40,8 @@ class MDnsSocketListener {
 public:
     using ReceiveHandler = std::function<void(int, const MDnsPayload &)>;
     using FinishedHandler = std::function<void(int)>;
+    // Milliseconds the listener may sleep before the next finished callback, -1 to wait for traffic
+    using TimeoutHandler = std::function<int()>;
 
     MDnsSocketListener();
     ~MDnsSocketListener();
@@ -49,6 +54,7 @@ public:
     ssize_t MulticastAll(const MDnsPayload &payload);
     void SetReceiveHandler(const ReceiveHandler &callback);
     void SetFinishedHandler(const FinishedHandler &callback);
+    void SetTimeoutHandler(const TimeoutHandler &callback);
     ssize_t Multicast(int sock, const MDnsPayload &);
     ssize_t Unicast(int sock, sockaddr *saddr, const MDnsPayload &);
     const std::vector<int> &GetSockets() const;
@@ -57,15 +63,20 @@ public:
     void TriggerRefresh();
 
 private:
+    // One datagram slot of the recvmmsg batch, reused for every receive on the listener thread
+    struct RecvSlot;
+
     void Run();
     bool CanRefresh();
     void ReceiveInSock(int sock);
+    void PrepareRecvBatch();
     uint32_t OpenSocketV4(ifaddrs *ifa);
     uint32_t OpenSocketV6(ifaddrs *ifa, bool ipv6Support);
     bool Ifaceverification(ifaddrs *ifa, ifaddrs *loaddr);
 
     std::vector<int> socks_;
     std::map<int, std::string> iface_;
+    std::map<int, unsigned int> ifIndex_;
     std::map<int, sockaddr_storage> saddr_;
     std::atomic_bool runningFlag_ = false;
     int ctrlPair_[2] = {-1, -1};
@@ -73,6 +84,9 @@ private:
     std::mutex mutex_;
     ReceiveHandler recv_;
     FinishedHandler finished_;
+    TimeoutHandler timeout_;
+    std::vector<RecvSlot> recvSlots_;
+    std::vector<mmsghdr> recvMsgs_;
 };
 
 } // namespace NetManagerStandard
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MDNS_SUFFIX_MAP_H
+#define MDNS_SUFFIX_MAP_H
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "mdns_common.h"
+
+namespace OHOS {
+namespace NetManagerStandard {
+
+// Map keyed by domain name that also indexes every label aligned suffix of its keys, so the entries under a
+// service type (or subtype) are found with one lookup instead of a scan over all keys.
+// "ala._x._tcp.local" is listed under itself, "_x._tcp.local", "_tcp.local" and "local".
+template <typename T>
+class MDnsSuffixMap {
+public:
+    using Map = std::map<std::string, T, std::less<>>;
+    using iterator = typename Map::iterator;
+    using const_iterator = typename Map::const_iterator;
+    // Entries under one suffix ordered by name, the views point into the keys of the map
+    using Matches = std::map<std::string_view, const_iterator>;
+
+    iterator begin()
+    {
+        return map_.begin();
+    }
+
+    iterator end()
+    {
+        return map_.end();
+    }
+
+    const_iterator begin() const
+    {
+        return map_.begin();
+    }
+
+    const_iterator end() const
+    {
+        return map_.end();
+    }
+
+    size_t size() const
+    {
+        return map_.size();
+    }
+
+    bool empty() const
+    {
+        return map_.empty();
+    }
+
+    template <typename K>
+    iterator find(const K &key)
+    {
+        return map_.find(key);
+    }
+
+    template <typename K>
+    const_iterator find(const K &key) const
+    {
+        return map_.find(key);
+    }
+
+    T &operator[](const std::string &key)
+    {
+        auto [it, inserted] = map_.try_emplace(key);
+        if (inserted) {
+            Index(it);
+        }
+        return it->second;
+    }
+
+    std::pair<iterator, bool> emplace(const std::string &key, const T &value)
+    {
+        auto result = map_.emplace(key, value);
+        if (result.second) {
+            Index(result.first);
+        }
+        return result;
+    }
+
+    size_t erase(const std::string &key)
+    {
+        auto it = map_.find(key);
+        if (it == map_.end()) {
+            return 0;
+        }
+        Unindex(it);
+        map_.erase(it);
+        return 1;
+    }
+
+    void clear()
+    {
+        suffixes_.clear();
+        map_.clear();
+    }
+
+    /**
+     * entries whose name is suffix or ends with "." + suffix
+     *
+     * @return nullptr if there is none
+     */
+    const Matches *FindSuffix(std::string_view suffix) const
+    {
+        auto it = suffixes_.find(suffix);
+        return it == suffixes_.end() ? nullptr : &it->second;
+    }
+
+private:
+    template <typename F>
+    static void ForEachSuffix(std::string_view name, const F &func)
+    {
+        size_t pos = 0;
+        while (true) {
+            func(name.substr(pos));
+            size_t dot = name.find(MDNS_DOMAIN_SPLITER, pos);
+            if (dot == std::string_view::npos) {
+                return;
+            }
+            pos = dot + 1;
+        }
+    }
+
+    void Index(const_iterator it)
+    {
+        ForEachSuffix(it->first, [this, it](std::string_view suffix) {
+            auto matches = suffixes_.find(suffix);
+            if (matches == suffixes_.end()) {
+                matches = suffixes_.emplace(std::string(suffix), Matches{}).first;
+            }
+            matches->second.emplace(it->first, it);
+        });
+    }
+
+    void Unindex(const_iterator it)
+    {
+        ForEachSuffix(it->first, [this, it](std::string_view suffix) {
+            auto matches = suffixes_.find(suffix);
+            if (matches == suffixes_.end()) {
+                return;
+            }
+            matches->second.erase(it->first);
+            if (matches->second.empty()) {
+                suffixes_.erase(matches);
+            }
+        });
+    }
+
+    Map map_;
+    std::map<std::string, Matches, std::less<>> suffixes_;
+};
+
+} // namespace NetManagerStandard
+} // namespace OHOS
+#endif /* MDNS_SUFFIX_MAP_H */
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MDNS_TIMER_WHEEL_H
+#define MDNS_TIMER_WHEEL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace OHOS {
+namespace NetManagerStandard {
+
+// Hierarchical timer wheel for record refresh, expiry and browse queries.
+// Times are absolute milliseconds of a monotonic clock, callbacks run inside Advance on the caller's thread.
+class MDnsTimerWheel {
+public:
+    using TimerId = uint64_t;
+    using Callback = std::function<void()>;
+
+    static constexpr TimerId INVALID_TIMER = 0;
+    static constexpr int64_t DEFAULT_TICK_MS = 100;
+
+    explicit MDnsTimerWheel(int64_t tickMs = DEFAULT_TICK_MS);
+
+    /**
+     * Drop every timer and restart the wheel at nowMs
+     */
+    void Reset(int64_t nowMs);
+
+    /**
+     * Run callback once the clock passed to Advance reaches expireMs, never earlier
+     */
+    TimerId Schedule(int64_t expireMs, const Callback &callback);
+
+    /**
+     * Cancel a pending timer and remove it from its slot, returns false when it already fired or was cancelled
+     */
+    bool Cancel(TimerId id);
+
+    /**
+     * Fire every timer due at nowMs, callbacks may schedule or cancel timers
+     *
+     * @return number of callbacks run
+     */
+    size_t Advance(int64_t nowMs);
+
+    /**
+     * Earliest time Advance may have work to do, -1 when no timer is pending.
+     * Timers in the upper levels report the time they cascade, which is never after they expire.
+     */
+    int64_t NextExpire() const;
+
+    size_t Size() const;
+
+private:
+    static constexpr size_t WHEEL_BITS = 6;
+    static constexpr size_t WHEEL_SLOTS = 1 << WHEEL_BITS;
+    static constexpr int64_t WHEEL_MASK = WHEEL_SLOTS - 1;
+    static constexpr size_t WHEEL_LEVELS = 3;
+    static constexpr int64_t WHEEL_SPAN = 1LL << (WHEEL_BITS * WHEEL_LEVELS);
+    // Level of a timer that is in no slot, because Advance took its slot or it is about to fire
+    static constexpr size_t DETACHED = WHEEL_LEVELS;
+
+    struct Timer {
+        int64_t expireTick = 0;
+        Callback callback;
+        // Where the id is stored, so Cancel removes it without searching
+        size_t level = DETACHED;
+        size_t slot = 0;
+        size_t index = 0;
+    };
+    using Slot = std::vector<TimerId>;
+
+    void Place(TimerId id, Timer &timer, int64_t expireTick);
+    void Unlink(const Timer &timer);
+    void Detach(const Slot &slot);
+    void Cascade(size_t level);
+    size_t Fire(TimerId id);
+    size_t Rebase(int64_t nowTick);
+
+    int64_t tickMs_;
+    int64_t currentTick_ = 0;
+    TimerId nextId_ = INVALID_TIMER + 1;
+    // Every slot holds live timers only, Cancel unlinks the id right away
+    std::array<std::array<Slot, WHEEL_SLOTS>, WHEEL_LEVELS> slots_;
+    std::unordered_map<TimerId, Timer> timers_;
+};
+
+} // namespace NetManagerStandard
+} // namespace OHOS
+#endif /* MDNS_TIMER_WHEEL_H */
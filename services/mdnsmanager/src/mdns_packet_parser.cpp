@@ -15,6 +15,7 @@
 
 #include "mdns_packet_parser.h"
 #include "netmgr_ext_log_wrapper.h"
+#include <algorithm>
 #include <cstring>
 
 namespace OHOS {
@@ -68,6 +69,19 @@ std::string UnDotted(const std::string &name)
     return EndsWith(name, MDNS_DOMAIN_SPLITER_STR) ? name.substr(0, name.size() - 1) : name;
 }
 
+constexpr uint32_t BITS_PER_BYTE = 8;
+
+uint16_t PeekNUint16(const uint8_t *raw)
+{
+    return static_cast<uint16_t>((static_cast<uint16_t>(raw[0]) << BITS_PER_BYTE) | raw[1]);
+}
+
+uint32_t PeekNUint32(const uint8_t *raw)
+{
+    return (static_cast<uint32_t>(PeekNUint16(raw)) << (BITS_PER_BYTE * sizeof(uint16_t))) |
+           PeekNUint16(raw + sizeof(uint16_t));
+}
+
 } // namespace
 
 MDnsMessage MDnsPayloadParser::FromBytes(const MDnsPayload &payload)
@@ -419,5 +433,158 @@ uint32_t MDnsPayloadParser::GetError() const
     return errorFlags_ & PARSE_ERROR;
 }
 
+MDnsPayloadView::MDnsPayloadView(const MDnsPayload &payload) : payload_(payload)
+{
+    if (payload_.size() < sizeof(DNSProto::Header)) {
+        return;
+    }
+    const uint8_t *raw = payload_.data();
+    header_.id = PeekNUint16(raw);
+    raw += sizeof(uint16_t);
+    header_.flags = PeekNUint16(raw);
+    raw += sizeof(uint16_t);
+    header_.qdcount = PeekNUint16(raw);
+    raw += sizeof(uint16_t);
+    header_.ancount = PeekNUint16(raw);
+    raw += sizeof(uint16_t);
+    header_.nscount = PeekNUint16(raw);
+    raw += sizeof(uint16_t);
+    header_.arcount = PeekNUint16(raw);
+    valid_ = true;
+}
+
+bool MDnsPayloadView::IsValid() const
+{
+    return valid_;
+}
+
+const DNSProto::Header &MDnsPayloadView::GetHeader() const
+{
+    return header_;
+}
+
+size_t MDnsPayloadView::Begin() const
+{
+    return sizeof(DNSProto::Header);
+}
+
+bool MDnsPayloadView::SkipName(size_t &pos) const
+{
+    const size_t size = payload_.size();
+    while (pos < size) {
+        uint8_t label = payload_[pos];
+        if (label == 0) {
+            pos += 1;
+            return true;
+        }
+        if (label <= MDNS_MAX_DOMAIN_LABEL && pos + label < size) {
+            pos += label + 1;
+        } else if ((label & DNS_STR_PTR_U8_MASK) == DNS_STR_PTR_U8_MASK && pos + 1 < size) {
+            pos += sizeof(uint16_t);
+            return true;
+        } else {
+            return false;
+        }
+    }
+    return false;
+}
+
+bool MDnsPayloadView::ReadQuestion(size_t &pos, QuestionView &question) const
+{
+    question.nameOffset = pos;
+    if (!SkipName(pos) || payload_.size() - pos < sizeof(uint16_t) + sizeof(uint16_t)) {
+        return false;
+    }
+    const uint8_t *raw = payload_.data() + pos;
+    question.qtype = PeekNUint16(raw);
+    question.qclass = PeekNUint16(raw + sizeof(uint16_t));
+    pos += sizeof(uint16_t) + sizeof(uint16_t);
+    return true;
+}
+
+bool MDnsPayloadView::ReadRecord(size_t &pos, RecordView &record) const
+{
+    constexpr size_t fixedSize = sizeof(uint16_t) + sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint16_t);
+    record.nameOffset = pos;
+    if (!SkipName(pos) || payload_.size() - pos < fixedSize) {
+        return false;
+    }
+    const uint8_t *raw = payload_.data() + pos;
+    record.rtype = PeekNUint16(raw);
+    raw += sizeof(uint16_t);
+    record.rclass = PeekNUint16(raw);
+    raw += sizeof(uint16_t);
+    record.ttl = PeekNUint32(raw);
+    raw += sizeof(uint32_t);
+    record.length = PeekNUint16(raw);
+    pos += fixedSize;
+    record.rdataOffset = pos;
+    // Step over the rdata the way FromBytes does, names in PTR and SRV data are walked instead of trusting length
+    switch (record.rtype) {
+        case DNSProto::RRTYPE_PTR:
+            return SkipName(pos);
+        case DNSProto::RRTYPE_SRV: {
+            constexpr size_t srvFixedSize = sizeof(uint16_t) + sizeof(uint16_t) + sizeof(uint16_t);
+            if (payload_.size() - pos < srvFixedSize) {
+                return false;
+            }
+            pos += srvFixedSize;
+            return SkipName(pos);
+        }
+        case DNSProto::RRTYPE_A:
+            if (record.length != sizeof(in_addr)) {
+                return false;
+            }
+            break;
+        case DNSProto::RRTYPE_AAAA:
+            if (record.length != sizeof(in6_addr)) {
+                return false;
+            }
+            break;
+        default:
+            break;
+    }
+    if (payload_.size() - pos < record.length) {
+        return false;
+    }
+    pos += record.length;
+    return true;
+}
+
+bool MDnsPayloadView::ReadName(size_t offset, NameBuffer &buffer, std::string_view &name) const
+{
+    const size_t size = payload_.size();
+    size_t pos = offset;
+    // Like ParseDnsString, a pointer must go back before the labels that lead to it, so the walk ends
+    size_t segment = offset;
+    size_t length = 0;
+    while (pos < size) {
+        uint8_t label = payload_[pos];
+        if (label == 0) {
+            name = std::string_view(buffer.data(), length == 0 ? 0 : length - 1);
+            return true;
+        }
+        if (label <= MDNS_MAX_DOMAIN_LABEL && pos + label < size) {
+            if (buffer.size() - length < static_cast<size_t>(label) + 1) {
+                return false;
+            }
+            std::copy_n(payload_.data() + pos + 1, label, buffer.data() + length);
+            length += label;
+            buffer[length++] = MDNS_DOMAIN_SPLITER;
+            pos += label + 1;
+        } else if ((label & DNS_STR_PTR_U8_MASK) == DNS_STR_PTR_U8_MASK && pos + 1 < size) {
+            size_t next = PeekNUint16(payload_.data() + pos) & ~DNS_STR_PTR_U16_MASK;
+            if (next >= segment) {
+                return false;
+            }
+            pos = next;
+            segment = next;
+        } else {
+            return false;
+        }
+    }
+    return false;
+}
+
 } // namespace NetManagerStandard
 } // namespace OHOS
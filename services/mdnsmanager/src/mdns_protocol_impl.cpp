@@ -15,13 +15,16 @@
 
 #include "mdns_protocol_impl.h"
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <cstddef>
 #include <iostream>
+#include <limits>
 #include <random>
+#include <sys/epoll.h>
 #include <sys/types.h>
+#include <thread>
 #include <unistd.h>
-#include <fcntl.h>
 
 #include "mdns_manager.h"
 #include "mdns_packet_parser.h"
@@ -41,6 +44,31 @@ constexpr uint16_t MDNS_FLUSH_CACHE_BIT = 0x8000;
 constexpr int PHASE_PTR = 1;
 constexpr int PHASE_SRV = 2;
 constexpr int PHASE_DOMAIN = 3;
+constexpr size_t MDNS_RESPONSE_CACHE_SIZE = 64;
+constexpr int64_t PROBE_TIMEOUT_MS = 1000;
+constexpr int PROBE_MAX_TARGETS = 64;
+constexpr uint32_t BROWSE_INITIAL_INTERVAL_MS = 1000;
+// Browsed services are declared lost after DEFAULT_LOST_MS without an answer, so queries back off to half of it
+constexpr uint32_t BROWSE_MAX_INTERVAL_MS = DEFAULT_LOST_MS / 2;
+// RFC 6762 5.2: refresh queries at 80%, 85%, 90% and 95% of the TTL, each with up to 2% random variation
+constexpr int64_t CACHE_REFRESH_PERCENTS[] = {80, 85, 90, 95};
+constexpr int64_t CACHE_REFRESH_JITTER_PERCENT = 2;
+constexpr int64_t PERCENT = 100;
+constexpr int64_t MS_PER_SECOND = 1000;
+// RFC 6762 10.1: a goodbye record is deleted one second after it was received
+constexpr int64_t GOODBYE_EXPIRE_MS = 1000;
+constexpr int TASK_RETRY_MS = 1000;
+// RFC 6762 5.4: the top bit of a question class asks for a unicast response
+constexpr uint16_t MDNS_UNICAST_RESPONSE_BIT = 0x8000;
+// RFC 6762 7.1: known answers with less than half their TTL left neither go out nor suppress an answer
+constexpr int64_t KNOWN_ANSWER_TTL_DIVISOR = 2;
+// RFC 6762 7.2: known-answer lists are split so each packet fits an Ethernet MTU over IPv4 and IPv6
+constexpr size_t KNOWN_ANSWER_PACKET_SIZE = 1440;
+// RFC 6762 7.2: a truncated query is answered 400-500 ms later, once the rest of its known answers arrived
+constexpr int64_t TRUNCATED_QUERY_DELAY_MS = 400;
+constexpr int64_t TRUNCATED_QUERY_JITTER_MS = 100;
+// RFC 6762 7.3 and 7.4: queries and answers another host multicast within this window count as our own
+constexpr int64_t DUPLICATE_SUPPRESSION_MS = 1000;
 static bool g_isScreenOn = true;
 
 std::string AddrToString(const std::any &addr)
@@ -64,6 +92,55 @@ int64_t MilliSecondsSinceEpoch()
         .count();
 }
 
+static int64_t SteadyMilliSeconds()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Identity of a record for known-answer matching, the TTL and the cache flush bit do not take part
+static std::string RecordKey(const DNSProto::ResourceRecord &rr)
+{
+    std::string key = std::to_string(rr.rtype) + MDNS_HOSTPORT_SPLITER_STR + rr.name + MDNS_HOSTPORT_SPLITER_STR;
+    if (const std::string *ptr = std::any_cast<std::string>(&rr.rdata)) {
+        key += *ptr;
+    } else if (const DNSProto::RDataSrv *srv = std::any_cast<DNSProto::RDataSrv>(&rr.rdata)) {
+        key += srv->name + MDNS_HOSTPORT_SPLITER_STR + std::to_string(srv->port);
+    } else if (const TxtRecordEncoded *txt = std::any_cast<TxtRecordEncoded>(&rr.rdata)) {
+        key.append(txt->begin(), txt->end());
+    } else {
+        key += AddrToString(rr.rdata);
+    }
+    return key;
+}
+
+// RFC 6762 7.2: known answers that do not fit go to follow-up packets without questions, every packet but the
+// last has the TC bit set
+static std::vector<MDnsPayload> BuildQueryPackets(const std::vector<DNSProto::Question> &questions,
+                                                  const std::vector<DNSProto::ResourceRecord> &known)
+{
+    MDnsPayloadParser parser;
+    std::vector<MDnsPayload> packets;
+    MDnsMessage msg{};
+    msg.questions = questions;
+    MDnsPayload packet = parser.ToBytes(msg);
+    for (const auto &rr : known) {
+        msg.answers.emplace_back(rr);
+        MDnsPayload next = parser.ToBytes(msg);
+        if (next.size() > KNOWN_ANSWER_PACKET_SIZE && msg.answers.size() > 1) {
+            msg.answers.pop_back();
+            msg.header.flags |= DNSProto::HEADER_FLAGS_TC_MASK;
+            packets.emplace_back(parser.ToBytes(msg));
+            msg = MDnsMessage{};
+            msg.answers.emplace_back(rr);
+            next = parser.ToBytes(msg);
+        }
+        packet.swap(next);
+    }
+    packets.emplace_back(std::move(packet));
+    return packets;
+}
+
 void MDnsProtocolImpl::Init()
 {
     NETMGR_EXT_LOG_D("mdns_log MDnsProtocolImpl init");
@@ -93,24 +170,39 @@ void MDnsProtocolImpl::Init()
                 return;
             }
             // LCOV_EXCL_STOP
-            std::lock_guard<std::recursive_mutex> guard(sp->mutex_);
-            sp->RunTaskQueue(sp->taskQueue_);
+            sp->RunTasks();
+            sp->RunTimers();
         });
-    {
-        std::lock_guard<std::recursive_mutex> guard(mutex_);
-        taskQueue_.clear();
-        taskOnChange_.clear();
-    }
-    AddTask(
+    listener_.SetTimeoutHandler(
         [wp = weak_from_this()]() {
             auto sp = wp.lock();
             // LCOV_EXCL_START
             if (sp == nullptr) {
-                return false;
+                return -1;
             }
             // LCOV_EXCL_STOP
-            return sp->Browse();
-        }, false);
+            return sp->NextTimeout();
+        });
+    {
+        std::lock_guard<std::recursive_mutex> guard(mutex_);
+        taskOnChange_.clear();
+        ResetTimers();
+        // The task queue is cleared below, the result of a running probe would never come back
+        probeGeneration_++;
+        probeTargets_.clear();
+        probeInFlight_ = false;
+    }
+    {
+        std::lock_guard<std::mutex> guard(taskMutex_);
+        taskQueue_.clear();
+    }
+    // Socket numbers may be reused for other interfaces after a reopen
+    InvalidateResponseCache();
+    {
+        std::lock_guard<std::mutex> guard(responderMutex_);
+        heardQuestions_.clear();
+        heardAnswers_.clear();
+    }
 
     SubscribeCes();
 }
@@ -166,65 +258,296 @@ bool MDnsProtocolImpl::Browse()
             continue;
         }
         handleOfflineService(key, res);
-        MDnsPayloadParser parser;
-        MDnsMessage msg{};
-        msg.questions.emplace_back(DNSProto::Question{
+    }
+    StartLivenessProbe();
+    return false;
+}
+
+void MDnsProtocolImpl::RunTimers()
+{
+    std::lock_guard<std::recursive_mutex> guard(mutex_);
+    timerWheel_.Advance(SteadyMilliSeconds());
+}
+
+int MDnsProtocolImpl::NextTimeout()
+{
+    {
+        std::lock_guard<std::mutex> guard(taskMutex_);
+        // Tasks that are not done yet are retried on every wake up
+        if (!taskQueue_.empty()) {
+            return TASK_RETRY_MS;
+        }
+    }
+    std::lock_guard<std::recursive_mutex> guard(mutex_);
+    int64_t next = timerWheel_.NextExpire();
+    if (next < 0) {
+        return -1;
+    }
+    return static_cast<int>(std::clamp<int64_t>(next - SteadyMilliSeconds(), 0, std::numeric_limits<int>::max()));
+}
+
+void MDnsProtocolImpl::ResetTimers()
+{
+    timerWheel_.Reset(SteadyMilliSeconds());
+    sweepTimer_ = MDnsTimerWheel::INVALID_TIMER;
+    {
+        std::lock_guard<std::mutex> guard(responderMutex_);
+        deferredQuestions_.clear();
+    }
+    browseSchedule_.clear();
+    cacheTimers_.clear();
+    browseTimers_.clear();
+    for (const auto &[key, res] : browserMap_) {
+        StartBrowseSchedule(key);
+        for (const auto &result : res) {
+            ScheduleBrowseTimers(key, result);
+        }
+    }
+    for (const auto &[name, result] : cacheMap_) {
+        ScheduleCacheTimers(name);
+    }
+}
+
+// Offline services are looked for every DEFAULT_INTEVAL_MS while anything is browsed
+void MDnsProtocolImpl::ScheduleSweep()
+{
+    if (sweepTimer_ != MDnsTimerWheel::INVALID_TIMER || browserMap_.empty()) {
+        return;
+    }
+    sweepTimer_ = timerWheel_.Schedule(SteadyMilliSeconds() + DEFAULT_INTEVAL_MS, [this]() {
+        sweepTimer_ = MDnsTimerWheel::INVALID_TIMER;
+        Browse();
+        ScheduleSweep();
+    });
+}
+
+void MDnsProtocolImpl::StartBrowseSchedule(const std::string &key)
+{
+    BrowseSchedule &schedule = browseSchedule_[key];
+    timerWheel_.Cancel(schedule.timer);
+    schedule.intervalMs = BROWSE_INITIAL_INTERVAL_MS;
+    schedule.timer = timerWheel_.Schedule(SteadyMilliSeconds(), [this, key]() { RunBrowseSchedule(key); });
+    ScheduleSweep();
+}
+
+// RFC 6762 5.2: the first two queries are one second apart, then the interval doubles
+void MDnsProtocolImpl::RunBrowseSchedule(const std::string &key)
+{
+    auto schedule = browseSchedule_.find(key);
+    if (schedule == browseSchedule_.end()) {
+        return;
+    }
+    if (browserMap_.find(key) == browserMap_.end()) {
+        browseSchedule_.erase(schedule);
+        return;
+    }
+    SendBrowseQuery(key);
+    schedule->second.timer = timerWheel_.Schedule(SteadyMilliSeconds() + schedule->second.intervalMs,
+                                                  [this, key]() { RunBrowseSchedule(key); });
+    schedule->second.intervalMs = std::min(schedule->second.intervalMs * 2, BROWSE_MAX_INTERVAL_MS);
+}
+
+void MDnsProtocolImpl::SendBrowseQuery(const std::string &key)
+{
+    if (!g_isScreenOn) {
+        return;
+    }
+    if (nameCbMap_.find(key) != nameCbMap_.end() && !MDnsManager::GetInstance().IsAvailableCallback(nameCbMap_[key])) {
+        return;
+    }
+    auto schedule = browseSchedule_.find(key);
+    if (schedule != browseSchedule_.end()) {
+        schedule->second.lastQuery = SteadyMilliSeconds();
+    }
+    std::vector<DNSProto::Question> questions{DNSProto::Question{
+        .name = key,
+        .qtype = DNSProto::RRTYPE_PTR,
+        .qclass = DNSProto::RRCLASS_IN,
+    }};
+    // Only the query without known answers stays the same between sends
+    std::vector<DNSProto::ResourceRecord> known = KnownBrowseAnswers(key);
+    if (!known.empty()) {
+        MulticastQuery(questions, BuildQueryPackets(questions, known));
+        return;
+    }
+    auto query = browseQueryCache_.find(key);
+    if (query == browseQueryCache_.end()) {
+        query = browseQueryCache_.emplace(key, BuildQueryPackets(questions, known).front()).first;
+    }
+    MulticastQuery(questions, {query->second});
+}
+
+// RFC 6762 7.1: instances of the type with more than half their TTL left
+std::vector<DNSProto::ResourceRecord> MDnsProtocolImpl::KnownBrowseAnswers(const std::string &key)
+{
+    std::vector<DNSProto::ResourceRecord> known;
+    auto browser = browserMap_.find(key);
+    if (browser == browserMap_.end()) {
+        return known;
+    }
+    int64_t now = MilliSecondsSinceEpoch();
+    for (const auto &result : browser->second) {
+        if (result.state == State::DEAD || result.ttl == 0 || result.refrehTime < 0) {
+            continue;
+        }
+        int64_t ttlMs = MS_PER_SECOND * result.ttl;
+        int64_t remaining = ttlMs - (now - result.refrehTime);
+        if (remaining * KNOWN_ANSWER_TTL_DIVISOR <= ttlMs) {
+            continue;
+        }
+        known.emplace_back(DNSProto::ResourceRecord{
             .name = key,
-            .qtype = DNSProto::RRTYPE_PTR,
-            .qclass = DNSProto::RRCLASS_IN,
+            .rtype = static_cast<uint16_t>(DNSProto::RRTYPE_PTR),
+            .rclass = DNSProto::RRCLASS_IN,
+            .ttl = static_cast<uint32_t>(remaining / MS_PER_SECOND),
+            .rdata = Decorated(result.serviceName + MDNS_DOMAIN_SPLITER_STR + result.serviceType),
         });
-        listener_.MulticastAll(parser.ToBytes(msg));
     }
-    return false;
+    return known;
 }
 
-int32_t MDnsProtocolImpl::ConnectControl(int32_t sockfd, sockaddr* serverAddr)
+// RFC 6762 7.3: an interface where another host just asked the same questions, with no known answer this host
+// lacks, treats the query as sent
+void MDnsProtocolImpl::MulticastQuery(const std::vector<DNSProto::Question> &questions,
+                                      const std::vector<MDnsPayload> &packets)
 {
-    uint32_t flags = static_cast<uint32_t>(fcntl(sockfd, F_GETFL, 0));
-    fcntl(sockfd, F_SETFL, flags | O_NONBLOCK);
-    int32_t ret = connect(sockfd, serverAddr, sizeof(sockaddr));
-    if ((ret < 0) && (errno != EINPROGRESS)) {
-        NETMGR_EXT_LOG_E("connect error: %{public}d", errno);
-        return NETMANAGER_EXT_ERR_INTERNAL;
+    for (const MDnsPayload &packet : packets) {
+        RememberSent(packet);
     }
-    if (ret == 0) {
-        fcntl(sockfd, F_SETFL, flags); /* restore file status flags */
-        NETMGR_EXT_LOG_I("connect success.");
-        return NETMANAGER_EXT_SUCCESS;
+    for (int sock : listener_.GetSockets()) {
+        if (IsQuestionHeard(sock, questions)) {
+            NETMGR_EXT_LOG_D("mdns_log duplicate question suppressed, sock=%{public}d", sock);
+            continue;
+        }
+        for (const MDnsPayload &packet : packets) {
+            listener_.Multicast(sock, packet);
+        }
     }
+}
 
-    fd_set rset;
-    FD_ZERO(&rset);
-    FD_SET(sockfd, &rset);
-    fd_set wset = rset;
-    timeval tval {1, 0};
-    ret = select(sockfd + 1, &rset, &wset, NULL, &tval);
-    if (ret < 0) { // select error.
-        NETMGR_EXT_LOG_E("select error: %{public}d", errno);
-        return NETMANAGER_EXT_ERR_INTERNAL;
+// Timers are relative to refrehTime, so entries received before a reset keep their deadlines
+void MDnsProtocolImpl::ScheduleRecordTimers(TimerList &timers, const Result &result,
+                                            const MDnsTimerWheel::Callback &refresh,
+                                            const MDnsTimerWheel::Callback &expire)
+{
+    for (MDnsTimerWheel::TimerId id : timers) {
+        timerWheel_.Cancel(id);
+    }
+    timers.clear();
+    int64_t received = SteadyMilliSeconds() - (MilliSecondsSinceEpoch() - result.refrehTime);
+    if (result.ttl == 0) {
+        timers.emplace_back(timerWheel_.Schedule(received + GOODBYE_EXPIRE_MS, expire));
+        return;
     }
-    if (ret == 0) { // timeout
-        NETMGR_EXT_LOG_E("connect timeout...");
-        return NETMANAGER_EXT_ERR_INTERNAL;
+    int64_t ttlMs = MS_PER_SECOND * result.ttl;
+    std::uniform_int_distribution<int64_t> jitter(0, ttlMs * CACHE_REFRESH_JITTER_PERCENT / PERCENT);
+    for (int64_t percent : CACHE_REFRESH_PERCENTS) {
+        timers.emplace_back(timerWheel_.Schedule(received + ttlMs * percent / PERCENT + jitter(jitter_), refresh));
     }
-    if (!FD_ISSET(sockfd, &rset) && !FD_ISSET(sockfd, &wset)) {
-        NETMGR_EXT_LOG_E("select error: sockfd not set");
-        return NETMANAGER_EXT_ERR_INTERNAL;
+    timers.emplace_back(timerWheel_.Schedule(received + ttlMs, expire));
+}
+
+void MDnsProtocolImpl::ScheduleCacheTimers(const std::string &name)
+{
+    auto it = cacheMap_.find(name);
+    if (it == cacheMap_.end() || it->second.refrehTime < 0) {
+        return;
+    }
+    ScheduleRecordTimers(cacheTimers_[name], it->second, [this, name]() { RefreshCache(name); },
+                         [this, name, refrehTime = it->second.refrehTime]() { ExpireCache(name, refrehTime); });
+}
+
+void MDnsProtocolImpl::ScheduleBrowseTimers(const std::string &key, const Result &result)
+{
+    if (result.refrehTime < 0) {
+        return;
     }
+    std::string instance = Decorated(result.serviceName + MDNS_DOMAIN_SPLITER_STR + result.serviceType);
+    ScheduleRecordTimers(browseTimers_[instance], result, [this, key]() { RefreshBrowse(key); },
+                         [this, key, instance, refrehTime = result.refrehTime]() {
+                             ExpireBrowse(key, instance, refrehTime);
+                         });
+}
 
-    int32_t result = NETMANAGER_EXT_ERR_INTERNAL;
-    socklen_t len = sizeof(result);
-    if (getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &result, &len) < 0) {
-        NETMGR_EXT_LOG_E("getsockopt error: %{public}d", errno);
-        return NETMANAGER_EXT_ERR_INTERNAL;
+// Only records somebody still waits for or browses are worth a refresh query
+bool MDnsProtocolImpl::HasCacheInterest(const std::string &name, const Result &result)
+{
+    auto pending = taskOnChange_.find(name);
+    if (pending != taskOnChange_.end() && !pending->second.empty()) {
+        return true;
     }
-    if (result != 0) { // connect failed.
-        NETMGR_EXT_LOG_E("connect failed. error: %{public}d", result);
-        return NETMANAGER_EXT_ERR_INTERNAL;
+    if (result.addr.empty()) {
+        return !result.serviceType.empty() && browserMap_.find(Decorated(result.serviceType)) != browserMap_.end();
+    }
+    return std::any_of(cacheMap_.begin(), cacheMap_.end(), [&](const auto &elem) {
+        return elem.first != name && elem.second.domain == name && !elem.second.serviceType.empty() &&
+               browserMap_.find(Decorated(elem.second.serviceType)) != browserMap_.end();
+    });
+}
+
+void MDnsProtocolImpl::RefreshCache(const std::string &name)
+{
+    auto it = cacheMap_.find(name);
+    if (it == cacheMap_.end() || !g_isScreenOn || !HasCacheInterest(name, it->second)) {
+        return;
+    }
+    bool host = !it->second.addr.empty();
+    std::vector<DNSProto::Question> questions;
+    questions.emplace_back(DNSProto::Question{
+        .name = name,
+        .qtype = host ? DNSProto::RRTYPE_A : DNSProto::RRTYPE_SRV,
+        .qclass = DNSProto::RRCLASS_IN,
+    });
+    questions.emplace_back(DNSProto::Question{
+        .name = name,
+        .qtype = host ? DNSProto::RRTYPE_AAAA : DNSProto::RRTYPE_TXT,
+        .qclass = DNSProto::RRCLASS_IN,
+    });
+    NETMGR_EXT_LOG_D("mdns_log RefreshCache [%{public}s]", name.c_str());
+    MulticastQuery(questions, BuildQueryPackets(questions, {}));
+}
+
+void MDnsProtocolImpl::ExpireCache(const std::string &name, int64_t refrehTime)
+{
+    cacheTimers_.erase(name);
+    auto it = cacheMap_.find(name);
+    if (it == cacheMap_.end() || it->second.refrehTime != refrehTime) {
+        return;
+    }
+    NETMGR_EXT_LOG_D("mdns_log ExpireCache [%{public}s]", name.c_str());
+    std::unique_lock<std::shared_mutex> lock(discoveryMutex_);
+    cacheMap_.erase(it);
+}
+
+void MDnsProtocolImpl::RefreshBrowse(const std::string &key)
+{
+    // Instances of one type expire together, a single query refreshes all of them
+    auto schedule = browseSchedule_.find(key);
+    if (schedule != browseSchedule_.end() && schedule->second.lastQuery >= 0 &&
+        SteadyMilliSeconds() - schedule->second.lastQuery < BROWSE_INITIAL_INTERVAL_MS) {
+        return;
+    }
+    if (browserMap_.find(key) != browserMap_.end()) {
+        SendBrowseQuery(key);
+    }
+}
+
+void MDnsProtocolImpl::ExpireBrowse(const std::string &key, const std::string &instance, int64_t refrehTime)
+{
+    browseTimers_.erase(instance);
+    auto browser = browserMap_.find(key);
+    if (browser == browserMap_.end()) {
+        return;
+    }
+    auto &res = browser->second;
+    auto it = std::find_if(res.begin(), res.end(), [&](const Result &elem) {
+        return elem.refrehTime == refrehTime && elem.state != State::DEAD &&
+               Decorated(elem.serviceName + MDNS_DOMAIN_SPLITER_STR + elem.serviceType) == instance;
+    });
+    if (it != res.end()) {
+        NETMGR_EXT_LOG_D("mdns_log ExpireBrowse [%{public}s]", instance.c_str());
+        ReportServiceLost(key, res, it);
     }
-    fcntl(sockfd, F_SETFL, flags); /* restore file status flags */
-    NETMGR_EXT_LOG_I("lost but connect success.");
-    return NETMANAGER_EXT_SUCCESS;
 }
 
 bool MDnsProtocolImpl::IsConnectivity(const std::string &ip, int32_t port)
@@ -233,31 +556,97 @@ bool MDnsProtocolImpl::IsConnectivity(const std::string &ip, int32_t port)
         NETMGR_EXT_LOG_E("ip is empty");
         return false;
     }
+    ProbeTarget target;
+    target.addr = ip;
+    target.ipv6 = (ip.find(':') != std::string::npos);
+    target.port = port;
+    return ProbeConnectivity({target})[0];
+}
 
-    int32_t sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (sockfd < 0) {
-        NETMGR_EXT_LOG_E("create socket error: %{public}d", errno);
-        return false;
+std::vector<bool> MDnsProtocolImpl::ProbeConnectivity(const std::vector<ProbeTarget> &targets)
+{
+    std::vector<bool> alive(targets.size(), false);
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        NETMGR_EXT_LOG_E("mdns_log probe epoll_create1 error: %{public}d", errno);
+        return alive;
+    }
+    std::vector<int> fds(targets.size(), -1);
+    size_t pending = 0;
+    for (size_t i = 0; i < targets.size(); ++i) {
+        sockaddr_storage addr{};
+        socklen_t addrLen = 0;
+        if (targets[i].ipv6) {
+            auto *addr6 = reinterpret_cast<sockaddr_in6 *>(&addr);
+            addr6->sin6_family = AF_INET6;
+            addr6->sin6_port = htons(targets[i].port);
+            if (inet_pton(AF_INET6, targets[i].addr.c_str(), &addr6->sin6_addr) == 1) {
+                addrLen = sizeof(sockaddr_in6);
+            }
+        } else {
+            auto *addr4 = reinterpret_cast<sockaddr_in *>(&addr);
+            addr4->sin_family = AF_INET;
+            addr4->sin_port = htons(targets[i].port);
+            if (inet_pton(AF_INET, targets[i].addr.c_str(), &addr4->sin_addr) == 1) {
+                addrLen = sizeof(sockaddr_in);
+            }
+        }
+        if (addrLen == 0) {
+            continue;
+        }
+        int fd = socket(addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            NETMGR_EXT_LOG_E("create socket error: %{public}d", errno);
+            continue;
+        }
+        if (connect(fd, reinterpret_cast<sockaddr *>(&addr), addrLen) == 0) {
+            alive[i] = true;
+            close(fd);
+            continue;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLOUT;
+        ev.data.u64 = i;
+        if (errno != EINPROGRESS || epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            close(fd);
+            continue;
+        }
+        fds[i] = fd;
+        pending++;
     }
 
-    struct sockaddr_in serverAddr;
-    if (memset_s(&serverAddr, sizeof(serverAddr), 0, sizeof(serverAddr)) != EOK) {
-        NETMGR_EXT_LOG_E("memset_s serverAddr failed!");
-        close(sockfd);
-        return false;
+    // All connects share one deadline, so a batch takes at most PROBE_TIMEOUT_MS whatever its size
+    int64_t deadline = MilliSecondsSinceEpoch() + PROBE_TIMEOUT_MS;
+    epoll_event events[PROBE_MAX_TARGETS];
+    while (pending > 0) {
+        int64_t remaining = deadline - MilliSecondsSinceEpoch();
+        if (remaining <= 0) {
+            break;
+        }
+        int count = epoll_wait(epfd, events, PROBE_MAX_TARGETS, static_cast<int>(remaining));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            break;
+        }
+        for (int i = 0; i < count; ++i) {
+            size_t index = static_cast<size_t>(events[i].data.u64);
+            int result = -1;
+            socklen_t len = sizeof(result);
+            alive[index] = (getsockopt(fds[index], SOL_SOCKET, SO_ERROR, &result, &len) == 0 && result == 0);
+            close(fds[index]);
+            fds[index] = -1;
+            pending--;
+        }
     }
-
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_addr.s_addr = inet_addr(ip.c_str());
-    serverAddr.sin_port = htons(port);
-    if (ConnectControl(sockfd, (struct sockaddr*)&serverAddr) != NETMANAGER_EXT_SUCCESS) {
-        NETMGR_EXT_LOG_I("connect error: %{public}d", errno);
-        close(sockfd);
-        return false;
+    for (int fd : fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
     }
-
-    close(sockfd);
-    return true;
+    close(epfd);
+    return alive;
 }
 
 void MDnsProtocolImpl::handleOfflineService(const std::string &key, std::vector<Result> &res)
@@ -266,29 +655,112 @@ void MDnsProtocolImpl::handleOfflineService(const std::string &key, std::vector<
     for (auto it = res.begin(); it != res.end();) {
         if (lastRunTime - it->refrehTime > DEFAULT_LOST_MS && it->state == State::LIVE) {
             std::string fullName = Decorated(it->serviceName + MDNS_DOMAIN_SPLITER_STR + it->serviceType);
-            if ((cacheMap_.find(fullName) != cacheMap_.end()) &&
-                IsConnectivity(cacheMap_[fullName].addr, cacheMap_[fullName].port)) {
-                it++;
-                continue;
-            }
-
-            it->state = State::DEAD;
-            if (nameCbMap_.find(key) != nameCbMap_.end() && nameCbMap_[key] != nullptr) {
-                NETMGR_EXT_LOG_W("mdns_log HandleServiceLost");
-                nameCbMap_[key]->HandleServiceLost(ConvertResultToInfo(*it), NETMANAGER_EXT_SUCCESS);
+            auto cached = cacheMap_.find(fullName);
+            if (cached != cacheMap_.end()) {
+                // The instance usually only knows its host, the address is cached under the host domain
+                const Result *host = &cached->second;
+                auto hostIt = cacheMap_.find(host->domain);
+                if (host->addr.empty() && hostIt != cacheMap_.end()) {
+                    host = &hostIt->second;
+                }
+                if (!host->addr.empty()) {
+                    if (!probeInFlight_ && probeTargets_.size() < static_cast<size_t>(PROBE_MAX_TARGETS)) {
+                        ProbeTarget target;
+                        target.key = key;
+                        target.serviceName = it->serviceName;
+                        target.refrehTime = it->refrehTime;
+                        target.addr = host->addr;
+                        target.ipv6 = host->ipv6;
+                        target.port = cached->second.port;
+                        probeTargets_.push_back(std::move(target));
+                    }
+                    it++;
+                    continue;
+                }
             }
-            it = res.erase(it);
-            cacheMap_.erase(fullName);
+            ReportServiceLost(key, res, it);
         } else {
             it++;
         }
     }
 }
 
+void MDnsProtocolImpl::ReportServiceLost(const std::string &key, std::vector<Result> &res,
+                                         std::vector<Result>::iterator &it)
+{
+    std::string fullName = Decorated(it->serviceName + MDNS_DOMAIN_SPLITER_STR + it->serviceType);
+    it->state = State::DEAD;
+    if (nameCbMap_.find(key) != nameCbMap_.end() && nameCbMap_[key] != nullptr) {
+        NETMGR_EXT_LOG_W("mdns_log HandleServiceLost");
+        nameCbMap_[key]->HandleServiceLost(ConvertResultToInfo(*it), NETMANAGER_EXT_SUCCESS);
+    }
+    it = res.erase(it);
+    EraseCacheEntry(fullName);
+}
+
+// Probes run on their own thread without mutex_, results come back through the task queue. A probe belongs to
+// the generation it was started in, Init starts a new one and the results of older probes are dropped.
+void MDnsProtocolImpl::StartLivenessProbe()
+{
+    if (probeTargets_.empty() || probeInFlight_) {
+        return;
+    }
+    probeInFlight_ = true;
+    uint64_t generation = probeGeneration_;
+    std::thread([wp = weak_from_this(), generation, targets = std::move(probeTargets_)]() {
+        std::vector<bool> alive = ProbeConnectivity(targets);
+        auto sp = wp.lock();
+        // LCOV_EXCL_START
+        if (sp == nullptr || sp->probeGeneration_ != generation) {
+            return;
+        }
+        // LCOV_EXCL_STOP
+        sp->AddTask([wp, generation, targets, alive]() {
+            auto sp = wp.lock();
+            if (sp != nullptr) {
+                sp->ApplyProbeResults(generation, targets, alive);
+            }
+            return true;
+        });
+    }).detach();
+    probeTargets_.clear();
+}
+
+void MDnsProtocolImpl::ApplyProbeResults(uint64_t generation, const std::vector<ProbeTarget> &targets,
+                                         const std::vector<bool> &alive)
+{
+    std::lock_guard<std::recursive_mutex> guard(mutex_);
+    if (generation != probeGeneration_) {
+        return;
+    }
+    probeInFlight_ = false;
+    for (size_t i = 0; i < targets.size() && i < alive.size(); ++i) {
+        if (alive[i]) {
+            continue;
+        }
+        auto browser = browserMap_.find(targets[i].key);
+        if (browser == browserMap_.end()) {
+            continue;
+        }
+        auto &res = browser->second;
+        // Skip services that were refreshed or removed while the probe was running
+        auto it = std::find_if(res.begin(), res.end(), [&](const Result &elem) {
+            return elem.serviceName == targets[i].serviceName && elem.state == State::LIVE &&
+                   elem.refrehTime == targets[i].refrehTime;
+        });
+        if (it != res.end()) {
+            ReportServiceLost(targets[i].key, res, it);
+        }
+    }
+}
+
 void MDnsProtocolImpl::SetConfig(const MDnsConfig &config)
 {
-    std::unique_lock<std::shared_mutex> lock(configMutex_);
-    config_ = config;
+    {
+        std::unique_lock<std::shared_mutex> lock(configMutex_);
+        config_ = config;
+    }
+    InvalidateResponseCache();
 }
 
 MDnsConfig MDnsProtocolImpl::GetConfig()
@@ -317,11 +789,12 @@ int32_t MDnsProtocolImpl::Register(const Result &info)
         return NET_MDNS_ERR_ILLEGAL_ARGUMENT;
     }
     {
-        std::lock_guard<std::recursive_mutex> guard(mutex_);
+        std::unique_lock<std::shared_mutex> lock(srvMutex_);
         if (srvMap_.find(name) != srvMap_.end()) {
             return NET_MDNS_ERR_SERVICE_INSTANCE_DUPLICATE;
         }
         srvMap_.emplace(name, info);
+        InvalidateResponseCache();
     }
     listener_.Start();
     return Announce(info, false);
@@ -331,13 +804,20 @@ int32_t MDnsProtocolImpl::UnRegister(const std::string &key)
 {
     NETMGR_EXT_LOG_D("mdns_log UnRegister");
     std::string name = Decorated(key);
-    std::lock_guard<std::recursive_mutex> guard(mutex_);
-    if (srvMap_.find(name) != srvMap_.end()) {
-        Announce(srvMap_[name], true);
+    Result info;
+    {
+        std::unique_lock<std::shared_mutex> lock(srvMutex_);
+        auto it = srvMap_.find(name);
+        if (it == srvMap_.end()) {
+            return NET_MDNS_ERR_SERVICE_INSTANCE_NOT_FOUND;
+        }
+        info = it->second;
         srvMap_.erase(name);
-        return NETMANAGER_EXT_SUCCESS;
+        InvalidateResponseCache();
     }
-    return NET_MDNS_ERR_SERVICE_INSTANCE_NOT_FOUND;
+    // Questions already miss the service, the goodbye goes out with nothing locked
+    Announce(info, true);
+    return NETMANAGER_EXT_SUCCESS;
 }
 
 bool MDnsProtocolImpl::DiscoveryFromCache(const std::string &serviceType, const sptr<IDiscoveryCallback> &cb)
@@ -354,7 +834,7 @@ bool MDnsProtocolImpl::DiscoveryFromCache(const std::string &serviceType, const
         return false;
     }
 
-    for (auto &res : browserMap_[name]) {
+    for (auto &res : BrowseEntry(name)) {
         if (res.state == State::REMOVE || res.state == State::DEAD) {
             continue;
         }
@@ -374,7 +854,7 @@ bool MDnsProtocolImpl::DiscoveryFromNet(const std::string &serviceType, const sp
     NETMGR_EXT_LOG_D("mdns_log DiscoveryFromNet");
     std::string name = Decorated(serviceType);
     std::lock_guard<std::recursive_mutex> guard(mutex_);
-    browserMap_.insert({name, std::vector<Result>{}});
+    BrowseEntry(name);
     nameCbMap_[name] = cb;
     // key is serviceTYpe
     AddEvent(name, [wp = weak_from_this(), name, cb]() {
@@ -391,7 +871,7 @@ bool MDnsProtocolImpl::DiscoveryFromNet(const std::string &serviceType, const sp
         if (!MDnsManager::GetInstance().IsAvailableCallback(cb)) {
             return true;
         }
-        for (auto &res : sp->browserMap_[name]) {
+        for (auto &res : sp->BrowseEntry(name)) {
             std::string fullName = sp->Decorated(res.serviceName + MDNS_DOMAIN_SPLITER_STR + res.serviceType);
             NETMGR_EXT_LOG_W("mdns_log DiscoveryFromNet name:[%{public}s] fullName:[%{public}s]", name.c_str(),
                              fullName.c_str());
@@ -405,26 +885,14 @@ bool MDnsProtocolImpl::DiscoveryFromNet(const std::string &serviceType, const sp
                 res.state = State::DEAD;
                 NETMGR_EXT_LOG_D("mdns_log HandleServiceLost");
                 cb->HandleServiceLost(sp->ConvertResultToInfo(res), NETMANAGER_EXT_SUCCESS);
-                if (sp->cacheMap_.find(fullName) != sp->cacheMap_.end()) {
-                    sp->cacheMap_.erase(fullName);
-                }
+                sp->EraseCacheEntry(fullName);
             }
         }
         return false;
     });
 
-    AddTask(
-        [=]() {
-            MDnsPayloadParser parser;
-            MDnsMessage msg{};
-            msg.questions.emplace_back(DNSProto::Question{
-                .name = name,
-                .qtype = DNSProto::RRTYPE_PTR,
-                .qclass = DNSProto::RRCLASS_IN,
-            });
-            listener_.MulticastAll(parser.ToBytes(msg));
-            return true;
-        }, false);
+    StartBrowseSchedule(name);
+    listener_.TriggerRefresh();
     return true;
 }
 
@@ -447,10 +915,10 @@ bool MDnsProtocolImpl::ResolveInstanceFromCache(const std::string &name, const s
     }
 
     NETMGR_EXT_LOG_I("mdns_log rr.name : [%{public}s]", name.c_str());
-    Result r = cacheMap_[name];
+    Result r = CacheEntry(name);
     if (IsDomainCacheAvailable(r.domain)) {
-        r.ipv6 = cacheMap_[r.domain].ipv6;
-        r.addr = cacheMap_[r.domain].addr;
+        r.ipv6 = CacheEntry(r.domain).ipv6;
+        r.addr = CacheEntry(r.domain).addr;
 
         NETMGR_EXT_LOG_D("mdns_log Add Task DomainCache Available, [%{public}s]", r.domain.c_str());
         AddTask([cb, info = ConvertResultToInfo(r)]() {
@@ -472,8 +940,8 @@ bool MDnsProtocolImpl::ResolveInstanceFromCache(const std::string &name, const s
             if (!sp->IsDomainCacheAvailable(r.domain)) {
                 return false;
             }
-            r.ipv6 = sp->cacheMap_[r.domain].ipv6;
-            r.addr = sp->cacheMap_[r.domain].addr;
+            r.ipv6 = sp->CacheEntry(r.domain).ipv6;
+            r.addr = sp->CacheEntry(r.domain).addr;
             if (nullptr != cb) {
                 cb->HandleResolveResult(sp->ConvertResultToInfo(r), NETMANAGER_EXT_SUCCESS);
             }
@@ -488,8 +956,8 @@ bool MDnsProtocolImpl::ResolveInstanceFromNet(const std::string &name, const spt
     NETMGR_EXT_LOG_D("mdns_log ResolveInstanceFromNet");
     {
         std::lock_guard<std::recursive_mutex> guard(mutex_);
-        cacheMap_[name].state = State::ADD;
-        ExtractNameAndType(name, cacheMap_[name].serviceName, cacheMap_[name].serviceType);
+        CacheEntry(name).state = State::ADD;
+        ExtractNameAndType(name, CacheEntry(name).serviceName, CacheEntry(name).serviceType);
     }
     MDnsPayloadParser parser;
     MDnsMessage msg{};
@@ -525,7 +993,7 @@ bool MDnsProtocolImpl::ResolveFromCache(const std::string &domain, const sptr<IR
     if (!IsDomainCacheAvailable(domain)) {
         return false;
     }
-    AddTask([wp = weak_from_this(), cb, info = ConvertResultToInfo(cacheMap_[domain])]() {
+    AddTask([wp = weak_from_this(), cb, info = ConvertResultToInfo(CacheEntry(domain))]() {
         auto sp = wp.lock();
         // LCOV_EXCL_START
         if (sp == nullptr) {
@@ -545,8 +1013,8 @@ bool MDnsProtocolImpl::ResolveFromNet(const std::string &domain, const sptr<IRes
     NETMGR_EXT_LOG_D("mdns_log ResolveFromNet");
     {
         std::lock_guard<std::recursive_mutex> guard(mutex_);
-        cacheMap_[domain];
-        cacheMap_[domain].domain = domain;
+        CacheEntry(domain);
+        CacheEntry(domain).domain = domain;
     }
     MDnsPayloadParser parser;
     MDnsMessage msg{};
@@ -618,7 +1086,9 @@ int32_t MDnsProtocolImpl::Announce(const Result &info, bool off)
                                                            .ttl = off ? 0U : DEFAULT_TTL,
                                                            .rdata = info.txt});
     MDnsPayloadParser parser;
-    ssize_t size = listener_.MulticastAll(parser.ToBytes(response));
+    MDnsPayload payload = parser.ToBytes(response);
+    RememberSent(payload);
+    ssize_t size = listener_.MulticastAll(payload);
     return size > 0 ? NETMANAGER_EXT_SUCCESS : NET_MDNS_ERR_SEND;
 }
 
@@ -627,6 +1097,18 @@ void MDnsProtocolImpl::ReceivePacket(int sock, const MDnsPayload &payload)
     if (payload.size() == 0) {
         return;
     }
+    // Most chatter on a busy network is about other devices, drop it before building a message
+    MDnsPayloadView view(payload);
+    if (view.IsValid()) {
+        if ((view.GetHeader().flags & DNSProto::HEADER_FLAGS_QR_MASK) == 0) {
+            ReceiveQuestion(sock, payload, view);
+            return;
+        }
+        NoteAnswers(sock, payload, view);
+        if (!HasAnswerToProcess(sock, view)) {
+            return;
+        }
+    }
     MDnsPayloadParser parser;
     MDnsMessage msg = parser.FromBytes(payload);
     if (parser.GetError() != 0) {
@@ -640,6 +1122,79 @@ void MDnsProtocolImpl::ReceivePacket(int sock, const MDnsPayload &payload)
     }
 }
 
+// Mirrors ProcessQuestionRecord, true if any question would be answered. Malformed entries return true so the
+// full parse reports them.
+bool MDnsProtocolImpl::HasQuestionToAnswer(int sock, const MDnsPayloadView &view)
+{
+    const sockaddr *saddrIf = listener_.GetSockAddr(sock);
+    if (saddrIf == nullptr) {
+        return false;
+    }
+    uint16_t addrType = (saddrIf->sa_family == AF_INET6) ? DNSProto::RRTYPE_AAAA : DNSProto::RRTYPE_A;
+    std::shared_lock<std::shared_mutex> lock(srvMutex_);
+    size_t pos = view.Begin();
+    for (uint16_t i = 0; i < view.GetHeader().qdcount; ++i) {
+        MDnsPayloadView::QuestionView qu;
+        MDnsPayloadView::NameBuffer buffer;
+        std::string_view name;
+        if (!view.ReadQuestion(pos, qu) || !view.ReadName(qu.nameOffset, buffer, name)) {
+            return true;
+        }
+        bool any = (qu.qtype == DNSProto::RRTYPE_ANY);
+        if ((any || qu.qtype == DNSProto::RRTYPE_PTR) && srvMap_.FindSuffix(name) != nullptr) {
+            return true;
+        }
+        if ((any || qu.qtype == DNSProto::RRTYPE_SRV || qu.qtype == DNSProto::RRTYPE_TXT) &&
+            srvMap_.find(name) != srvMap_.end()) {
+            return true;
+        }
+        if ((any || qu.qtype == addrType) && name == GetHostDomain()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Mirrors ProcessAnswerRecord and the Update* guards, true if any answer or additional record would be used.
+// Malformed entries return true so the full parse reports them.
+bool MDnsProtocolImpl::HasAnswerToProcess(int sock, const MDnsPayloadView &view)
+{
+    const sockaddr *saddrIf = listener_.GetSockAddr(sock);
+    if (saddrIf == nullptr) {
+        return false;
+    }
+    bool v6 = (saddrIf->sa_family == AF_INET6);
+    const DNSProto::Header &header = view.GetHeader();
+    std::lock_guard<std::recursive_mutex> guard(mutex_);
+    size_t pos = view.Begin();
+    for (uint16_t i = 0; i < header.qdcount; ++i) {
+        MDnsPayloadView::QuestionView qu;
+        if (!view.ReadQuestion(pos, qu)) {
+            return true;
+        }
+    }
+    uint32_t records = static_cast<uint32_t>(header.ancount) + header.nscount + header.arcount;
+    for (uint32_t i = 0; i < records; ++i) {
+        MDnsPayloadView::RecordView rr;
+        MDnsPayloadView::NameBuffer buffer;
+        std::string_view name;
+        if (!view.ReadRecord(pos, rr) || !view.ReadName(rr.nameOffset, buffer, name)) {
+            return true;
+        }
+        bool authority = (i >= header.ancount && i < static_cast<uint32_t>(header.ancount) + header.nscount);
+        if (authority || (cacheMap_.find(name) == cacheMap_.end() && browserMap_.find(name) == browserMap_.end() &&
+            IsRegistered(name))) {
+            continue;
+        }
+        if ((rr.rtype == DNSProto::RRTYPE_PTR && browserMap_.find(name) != browserMap_.end()) ||
+            rr.rtype == DNSProto::RRTYPE_SRV || rr.rtype == DNSProto::RRTYPE_TXT ||
+            (rr.rtype == DNSProto::RRTYPE_A && !v6) || (rr.rtype == DNSProto::RRTYPE_AAAA && v6)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void MDnsProtocolImpl::AppendRecord(std::vector<DNSProto::ResourceRecord> &rrlist, DNSProto::RRType type,
                                     const std::string &name, const std::any &rdata)
 {
@@ -650,12 +1205,423 @@ void MDnsProtocolImpl::AppendRecord(std::vector<DNSProto::ResourceRecord> &rrlis
                                                  .rdata = rdata});
 }
 
+// Responses only depend on the question section, the socket, srvMap_ and the config, so the wire bytes are
+// kept per socket and question section until one of the latter changes. Empty entries remember questions
+// that get no answer.
+void MDnsProtocolImpl::ReceiveQuestion(int sock, const MDnsPayload &payload, const MDnsPayloadView &view)
+{
+    const DNSProto::Header &header = view.GetHeader();
+    bool own = IsOwnPacket(payload);
+    // Known answers, truncation and answers just heard from other responders all change the response
+    bool plain = header.ancount == 0 && (header.flags & DNSProto::HEADER_FLAGS_TC_MASK) == 0 && !HasHeardAnswers(sock);
+    size_t end = view.Begin();
+    bool cacheable = true;
+    bool asked = false;
+    {
+        // Only the browsed and cached names are read, so the listener does not wait for mutex_
+        std::shared_lock<std::shared_mutex> lock(discoveryMutex_);
+        for (uint16_t i = 0; i < header.qdcount && cacheable; ++i) {
+            MDnsPayloadView::QuestionView qu;
+            MDnsPayloadView::NameBuffer buffer;
+            std::string_view name;
+            cacheable = view.ReadQuestion(end, qu);
+            if (cacheable && !own && view.ReadName(qu.nameOffset, buffer, name)) {
+                asked = IsAskedQuestion(name, qu.qtype, qu.qclass) || asked;
+                if (plain) {
+                    NoteQuestion(sock, name, qu.qtype, qu.qclass);
+                }
+            }
+        }
+    }
+    if (!plain) {
+        bool deferred = false;
+        {
+            std::lock_guard<std::mutex> guard(responderMutex_);
+            deferred = deferredQuestions_.find(sock) != deferredQuestions_.end();
+        }
+        // Follow-up packets of a truncated query hold no questions, they only matter while one is deferred
+        if (!cacheable || asked || deferred || HasQuestionToAnswer(sock, view)) {
+            ReceiveKnownAnswerQuestion(sock, payload, own);
+        }
+        return;
+    }
+    std::string_view key(reinterpret_cast<const char *>(payload.data()) + view.Begin(), end - view.Begin());
+    uint64_t generation = 0;
+    bool hit = false;
+    MDnsPayload cachedResponse;
+    {
+        std::lock_guard<std::mutex> guard(responderMutex_);
+        generation = responseGeneration_;
+        auto &cache = responseCache_[sock];
+        auto cached = cacheable ? cache.find(key) : cache.end();
+        if (cached != cache.end()) {
+            hit = true;
+            cachedResponse = cached->second;
+            if (!cachedResponse.empty()) {
+                RememberSentLocked(cachedResponse);
+            }
+        }
+    }
+    // The cache may be invalidated meanwhile, the copy keeps the send outside responderMutex_
+    if (hit) {
+        if (!cachedResponse.empty()) {
+            listener_.Multicast(sock, cachedResponse);
+        }
+        return;
+    }
+    // Built without the responder locked, Register and UnRegister bump the generation meanwhile
+    MDnsPayload response;
+    if (HasQuestionToAnswer(sock, view)) {
+        MDnsPayloadParser parser;
+        MDnsMessage msg = parser.FromBytes(payload);
+        if (parser.GetError() != 0) {
+            NETMGR_EXT_LOG_E("parser payload failed");
+            return;
+        }
+        response = BuildQuestionResponse(sock, msg);
+    }
+    {
+        std::lock_guard<std::mutex> guard(responderMutex_);
+        if (cacheable && generation == responseGeneration_) {
+            auto &cache = responseCache_[sock];
+            if (cache.size() >= MDNS_RESPONSE_CACHE_SIZE) {
+                cache.clear();
+            }
+            cache.emplace(key, response);
+        }
+    }
+    MulticastResponse(sock, response);
+}
+
+void MDnsProtocolImpl::ReceiveKnownAnswerQuestion(int sock, const MDnsPayload &payload, bool own)
+{
+    MDnsPayloadParser parser;
+    MDnsMessage msg = parser.FromBytes(payload);
+    if (parser.GetError() != 0) {
+        NETMGR_EXT_LOG_E("parser payload failed");
+        return;
+    }
+    bool truncated = (msg.header.flags & DNSProto::HEADER_FLAGS_TC_MASK) != 0;
+    // The rest of a truncated known-answer list is unknown, it may hold records this host lacks
+    if (!own && !truncated) {
+        std::lock_guard<std::recursive_mutex> guard(mutex_);
+        for (const auto &qu : msg.questions) {
+            if (IsKnownAnswerSubset(qu, msg.answers)) {
+                NoteQuestion(sock, qu.name, qu.qtype, qu.qclass);
+            }
+        }
+    }
+    if (truncated || msg.questions.empty()) {
+        DeferQuestion(sock, msg);
+        return;
+    }
+    MulticastResponse(sock, BuildQuestionResponse(sock, msg));
+}
+
+// RFC 6762 7.2: follow-up packets carry no questions, their known answers join the query deferred last on the
+// socket. The listener does not report source addresses, so packets are matched by interface only.
+void MDnsProtocolImpl::DeferQuestion(int sock, MDnsMessage &msg)
+{
+    {
+        std::lock_guard<std::mutex> guard(responderMutex_);
+        auto deferred = deferredQuestions_.find(sock);
+        if (msg.questions.empty()) {
+            if (deferred != deferredQuestions_.end() && !deferred->second.empty()) {
+                auto &answers = deferred->second.back().answers;
+                answers.insert(answers.end(), msg.answers.begin(), msg.answers.end());
+            }
+            return;
+        }
+        deferredQuestions_[sock].emplace_back(std::move(msg));
+    }
+    std::uniform_int_distribution<int64_t> jitter(0, TRUNCATED_QUERY_JITTER_MS);
+    std::lock_guard<std::recursive_mutex> guard(mutex_);
+    timerWheel_.Schedule(SteadyMilliSeconds() + TRUNCATED_QUERY_DELAY_MS + jitter(jitter_),
+                         [this, sock]() { AnswerDeferredQuestion(sock); });
+}
+
+void MDnsProtocolImpl::AnswerDeferredQuestion(int sock)
+{
+    MDnsMessage msg;
+    {
+        std::lock_guard<std::mutex> guard(responderMutex_);
+        auto deferred = deferredQuestions_.find(sock);
+        if (deferred == deferredQuestions_.end() || deferred->second.empty()) {
+            return;
+        }
+        msg = std::move(deferred->second.front());
+        deferred->second.pop_front();
+        if (deferred->second.empty()) {
+            deferredQuestions_.erase(deferred);
+        }
+    }
+    MulticastResponse(sock, BuildQuestionResponse(sock, msg));
+}
+
+void MDnsProtocolImpl::InvalidateResponseCache()
+{
+    std::lock_guard<std::mutex> guard(responderMutex_);
+    responseCache_.clear();
+    ++responseGeneration_;
+}
+
 void MDnsProtocolImpl::ProcessQuestion(int sock, const MDnsMessage &msg)
+{
+    MulticastResponse(sock, BuildQuestionResponse(sock, msg));
+}
+
+void MDnsProtocolImpl::MulticastResponse(int sock, const MDnsPayload &response)
+{
+    if (response.empty()) {
+        return;
+    }
+    RememberSent(response);
+    listener_.Multicast(sock, response);
+}
+
+void MDnsProtocolImpl::RememberSent(const MDnsPayload &payload)
+{
+    std::lock_guard<std::mutex> guard(responderMutex_);
+    RememberSentLocked(payload);
+}
+
+// Caller holds responderMutex_
+void MDnsProtocolImpl::RememberSentLocked(const MDnsPayload &payload)
+{
+    int64_t now = SteadyMilliSeconds();
+    for (auto it = sentPackets_.begin(); it != sentPackets_.end();) {
+        it = (now - it->second >= DUPLICATE_SUPPRESSION_MS) ? sentPackets_.erase(it) : std::next(it);
+    }
+    sentPackets_[payload] = now;
+}
+
+bool MDnsProtocolImpl::IsOwnPacket(const MDnsPayload &payload)
+{
+    std::lock_guard<std::mutex> guard(responderMutex_);
+    auto sent = sentPackets_.find(payload);
+    return sent != sentPackets_.end() && SteadyMilliSeconds() - sent->second < DUPLICATE_SUPPRESSION_MS;
+}
+
+// Our own known answers for the question, the peer's list must not hold anything else
+bool MDnsProtocolImpl::IsKnownAnswerSubset(const DNSProto::Question &qu,
+                                           const std::vector<DNSProto::ResourceRecord> &answers)
+{
+    std::set<std::string> known;
+    if (qu.qtype == DNSProto::RRTYPE_PTR) {
+        for (const auto &rr : KnownBrowseAnswers(qu.name)) {
+            known.emplace(RecordKey(rr));
+        }
+    }
+    return std::all_of(answers.begin(), answers.end(), [&](const DNSProto::ResourceRecord &rr) {
+        return rr.name != qu.name || known.find(RecordKey(rr)) != known.end();
+    });
+}
+
+// Adds the entry when missing. Caller holds mutex_, ReceiveQuestion reads the names under discoveryMutex_ only.
+MDnsProtocolImpl::Result &MDnsProtocolImpl::CacheEntry(const std::string &name)
+{
+    auto it = cacheMap_.find(name);
+    if (it != cacheMap_.end()) {
+        return it->second;
+    }
+    std::unique_lock<std::shared_mutex> lock(discoveryMutex_);
+    return cacheMap_[name];
+}
+
+void MDnsProtocolImpl::EraseCacheEntry(const std::string &name)
+{
+    std::unique_lock<std::shared_mutex> lock(discoveryMutex_);
+    cacheMap_.erase(name);
+}
+
+std::vector<MDnsProtocolImpl::Result> &MDnsProtocolImpl::BrowseEntry(const std::string &name)
+{
+    auto it = browserMap_.find(name);
+    if (it != browserMap_.end()) {
+        return it->second;
+    }
+    std::unique_lock<std::shared_mutex> lock(discoveryMutex_);
+    return browserMap_[name];
+}
+
+// Questions this host may ask itself, QU questions get no multicast answer to share.
+// Caller holds mutex_ or discoveryMutex_.
+bool MDnsProtocolImpl::IsAskedQuestion(std::string_view name, uint16_t qtype, uint16_t qclass)
+{
+    if ((qclass & MDNS_UNICAST_RESPONSE_BIT) != 0) {
+        return false;
+    }
+    return (qtype == DNSProto::RRTYPE_PTR) ? browserMap_.find(name) != browserMap_.end()
+                                            : cacheMap_.find(name) != cacheMap_.end();
+}
+
+void MDnsProtocolImpl::NoteQuestion(int sock, std::string_view name, uint16_t qtype, uint16_t qclass)
+{
+    if (!IsAskedQuestion(name, qtype, qclass)) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(responderMutex_);
+    auto &heard = heardQuestions_[sock];
+    if (heard.size() >= MDNS_RESPONSE_CACHE_SIZE) {
+        heard.clear();
+    }
+    heard[QuestionKey(name, qtype)] = SteadyMilliSeconds();
+}
+
+bool MDnsProtocolImpl::IsQuestionHeard(int sock, const std::vector<DNSProto::Question> &questions)
+{
+    std::lock_guard<std::mutex> guard(responderMutex_);
+    auto heard = heardQuestions_.find(sock);
+    if (heard == heardQuestions_.end() || questions.empty()) {
+        return false;
+    }
+    int64_t now = SteadyMilliSeconds();
+    return std::all_of(questions.begin(), questions.end(), [&](const DNSProto::Question &qu) {
+        auto it = heard->second.find(QuestionKey(qu.name, qu.qtype));
+        return it != heard->second.end() && now - it->second < DUPLICATE_SUPPRESSION_MS;
+    });
+}
+
+// Records this host answers for, target is the PTR rdata. Caller holds srvMutex_.
+bool MDnsProtocolImpl::IsOwnRecord(uint16_t rtype, std::string_view name, std::string_view target)
+{
+    switch (rtype) {
+        case DNSProto::RRTYPE_PTR: {
+            const auto *matches = srvMap_.FindSuffix(name);
+            return matches != nullptr && matches->find(target) != matches->end();
+        }
+        case DNSProto::RRTYPE_SRV:
+        case DNSProto::RRTYPE_TXT:
+            return srvMap_.find(name) != srvMap_.end();
+        case DNSProto::RRTYPE_A:
+        case DNSProto::RRTYPE_AAAA:
+            return name == GetHostDomain();
+        default:
+            return false;
+    }
+}
+
+bool MDnsProtocolImpl::IsRegistered(std::string_view name)
+{
+    std::shared_lock<std::shared_mutex> lock(srvMutex_);
+    return srvMap_.find(name) != srvMap_.end();
+}
+
+// RFC 6762 7.4: answers for our records that another responder multicast are not repeated for a second.
+// Only packets that name one of our records are parsed.
+void MDnsProtocolImpl::NoteAnswers(int sock, const MDnsPayload &payload, const MDnsPayloadView &view)
+{
+    if (IsOwnPacket(payload)) {
+        return;
+    }
+    std::shared_lock<std::shared_mutex> lock(srvMutex_);
+    if (srvMap_.empty()) {
+        return;
+    }
+    const DNSProto::Header &header = view.GetHeader();
+    size_t pos = view.Begin();
+    for (uint16_t i = 0; i < header.qdcount; ++i) {
+        MDnsPayloadView::QuestionView qu;
+        if (!view.ReadQuestion(pos, qu)) {
+            return;
+        }
+    }
+    bool found = false;
+    for (uint16_t i = 0; i < header.ancount && !found; ++i) {
+        MDnsPayloadView::RecordView rr;
+        MDnsPayloadView::NameBuffer buffer;
+        MDnsPayloadView::NameBuffer targetBuffer;
+        std::string_view name;
+        std::string_view target;
+        if (!view.ReadRecord(pos, rr) || !view.ReadName(rr.nameOffset, buffer, name)) {
+            return;
+        }
+        if (rr.rtype == DNSProto::RRTYPE_PTR && !view.ReadName(rr.rdataOffset, targetBuffer, target)) {
+            continue;
+        }
+        found = IsOwnRecord(rr.rtype, name, target);
+    }
+    if (!found) {
+        return;
+    }
+    MDnsPayloadParser parser;
+    MDnsMessage msg = parser.FromBytes(payload);
+    if (parser.GetError() != 0) {
+        return;
+    }
+    std::vector<std::string> keys;
+    for (const auto &rr : msg.answers) {
+        const std::string *target = std::any_cast<std::string>(&rr.rdata);
+        if (rr.ttl * KNOWN_ANSWER_TTL_DIVISOR >= DEFAULT_TTL &&
+            IsOwnRecord(rr.rtype, rr.name, target == nullptr ? std::string_view() : std::string_view(*target))) {
+            keys.emplace_back(RecordKey(rr));
+        }
+    }
+    lock.unlock();
+    int64_t now = SteadyMilliSeconds();
+    std::lock_guard<std::mutex> guard(responderMutex_);
+    auto &heard = heardAnswers_[sock];
+    for (auto &key : keys) {
+        heard[std::move(key)] = now;
+    }
+}
+
+bool MDnsProtocolImpl::HasHeardAnswers(int sock)
+{
+    std::lock_guard<std::mutex> guard(responderMutex_);
+    auto heard = heardAnswers_.find(sock);
+    if (heard == heardAnswers_.end()) {
+        return false;
+    }
+    int64_t now = SteadyMilliSeconds();
+    for (auto it = heard->second.begin(); it != heard->second.end();) {
+        it = (now - it->second >= DUPLICATE_SUPPRESSION_MS) ? heard->second.erase(it) : std::next(it);
+    }
+    if (heard->second.empty()) {
+        heardAnswers_.erase(heard);
+        return false;
+    }
+    return true;
+}
+
+// RFC 6762 7.1 and 7.4: drop records the querier listed with at least half their TTL left, and records another
+// responder just multicast on this interface
+void MDnsProtocolImpl::SuppressKnownAnswers(int sock, const MDnsMessage &msg, MDnsMessage &response)
+{
+    std::set<std::string> known;
+    for (const auto &rr : msg.answers) {
+        if (rr.ttl * KNOWN_ANSWER_TTL_DIVISOR >= DEFAULT_TTL) {
+            known.emplace(RecordKey(rr));
+        }
+    }
+    {
+        std::lock_guard<std::mutex> guard(responderMutex_);
+        auto heard = heardAnswers_.find(sock);
+        int64_t now = SteadyMilliSeconds();
+        if (heard != heardAnswers_.end()) {
+            for (const auto &[key, time] : heard->second) {
+                if (now - time < DUPLICATE_SUPPRESSION_MS) {
+                    known.emplace(key);
+                }
+            }
+        }
+    }
+    if (known.empty()) {
+        return;
+    }
+    auto isKnown = [&known](const DNSProto::ResourceRecord &rr) { return known.find(RecordKey(rr)) != known.end(); };
+    response.answers.erase(std::remove_if(response.answers.begin(), response.answers.end(), isKnown),
+                           response.answers.end());
+    response.additional.erase(std::remove_if(response.additional.begin(), response.additional.end(), isKnown),
+                              response.additional.end());
+}
+
+MDnsPayload MDnsProtocolImpl::BuildQuestionResponse(int sock, const MDnsMessage &msg)
 {
     const sockaddr *saddrIf = listener_.GetSockAddr(sock);
     if (saddrIf == nullptr) {
         NETMGR_EXT_LOG_W("mdns_log ProcessQuestion saddrIf is null");
-        return;
+        return {};
     }
     std::any anyAddr;
     DNSProto::RRType anyAddrType;
@@ -675,32 +1641,36 @@ void MDnsProtocolImpl::ProcessQuestion(int sock, const MDnsMessage &msg)
     if (phase < PHASE_DOMAIN) {
         AppendRecord(response.additional, anyAddrType, GetHostDomain(), anyAddr);
     }
+    SuppressKnownAnswers(sock, msg, response);
 
     if (phase != 0 && response.answers.size() > 0) {
-        listener_.Multicast(sock, MDnsPayloadParser().ToBytes(response));
+        return MDnsPayloadParser().ToBytes(response);
     }
+    return {};
 }
 
 void MDnsProtocolImpl::ProcessQuestionRecord(const std::any &anyAddr, const DNSProto::RRType &anyAddrType,
                                              const DNSProto::Question &qu, int &phase, MDnsMessage &response)
 {
     NETMGR_EXT_LOG_D("mdns_log ProcessQuestionRecord");
-    std::lock_guard<std::recursive_mutex> guard(mutex_);
+    std::shared_lock<std::shared_mutex> lock(srvMutex_);
     std::string name = qu.name;
     if (qu.qtype == DNSProto::RRTYPE_ANY || qu.qtype == DNSProto::RRTYPE_PTR) {
-        std::for_each(srvMap_.begin(), srvMap_.end(), [&](const auto &elem) -> void {
-            if (EndsWith(elem.first, name)) {
-                AppendRecord(response.answers, DNSProto::RRTYPE_PTR, name, elem.first);
-                AppendRecord(response.additional, DNSProto::RRTYPE_SRV, elem.first,
+        const auto *matches = srvMap_.FindSuffix(name);
+        if (matches != nullptr) {
+            for (const auto &match : *matches) {
+                const auto &[instance, result] = *match.second;
+                AppendRecord(response.answers, DNSProto::RRTYPE_PTR, name, instance);
+                AppendRecord(response.additional, DNSProto::RRTYPE_SRV, instance,
                              DNSProto::RDataSrv{
                                  .priority = 0,
                                  .weight = 0,
-                                 .port = static_cast<uint16_t>(elem.second.port),
+                                 .port = static_cast<uint16_t>(result.port),
                                  .name = GetHostDomain(),
                              });
-                AppendRecord(response.additional, DNSProto::RRTYPE_TXT, elem.first, elem.second.txt);
+                AppendRecord(response.additional, DNSProto::RRTYPE_TXT, instance, result.txt);
             }
-        });
+        }
         phase = std::max(phase, PHASE_PTR);
     }
     if (qu.qtype == DNSProto::RRTYPE_ANY || qu.qtype == DNSProto::RRTYPE_SRV) {
@@ -766,7 +1736,7 @@ void MDnsProtocolImpl::UpdatePtr(bool v6, const DNSProto::ResourceRecord &rr, st
     if (browserMap_.find(name) == browserMap_.end()) {
         return;
     }
-    auto &results = browserMap_[name];
+    auto &results = BrowseEntry(name);
     std::string srvName;
     std::string srvType;
     ExtractNameAndType(*data, srvName, srvType);
@@ -795,6 +1765,7 @@ void MDnsProtocolImpl::UpdatePtr(bool v6, const DNSProto::ResourceRecord &rr, st
     }
     res->ttl = rr.ttl;
     res->refrehTime = MilliSecondsSinceEpoch();
+    ScheduleBrowseTimers(name, *res);
 }
 
 void MDnsProtocolImpl::UpdateSrv(bool v6, const DNSProto::ResourceRecord &rr, std::set<std::string> &changed)
@@ -805,12 +1776,12 @@ void MDnsProtocolImpl::UpdateSrv(bool v6, const DNSProto::ResourceRecord &rr, st
     }
     std::string name = rr.name;
     if (cacheMap_.find(name) == cacheMap_.end()) {
-        ExtractNameAndType(name, cacheMap_[name].serviceName, cacheMap_[name].serviceType);
-        cacheMap_[name].state = State::ADD;
-        cacheMap_[name].domain = srv->name;
-        cacheMap_[name].port = srv->port;
+        ExtractNameAndType(name, CacheEntry(name).serviceName, CacheEntry(name).serviceType);
+        CacheEntry(name).state = State::ADD;
+        CacheEntry(name).domain = srv->name;
+        CacheEntry(name).port = srv->port;
     }
-    Result &result = cacheMap_[name];
+    Result &result = CacheEntry(name);
     if (result.domain != srv->name || result.port != srv->port || result.state == State::DEAD) {
         if (result.state != State::ADD) {
             result.state = State::REFRESH;
@@ -826,6 +1797,7 @@ void MDnsProtocolImpl::UpdateSrv(bool v6, const DNSProto::ResourceRecord &rr, st
     }
     result.ttl = rr.ttl;
     result.refrehTime = MilliSecondsSinceEpoch();
+    ScheduleCacheTimers(name);
 }
 
 void MDnsProtocolImpl::UpdateTxt(bool v6, const DNSProto::ResourceRecord &rr, std::set<std::string> &changed)
@@ -836,11 +1808,11 @@ void MDnsProtocolImpl::UpdateTxt(bool v6, const DNSProto::ResourceRecord &rr, st
     }
     std::string name = rr.name;
     if (cacheMap_.find(name) == cacheMap_.end()) {
-        ExtractNameAndType(name, cacheMap_[name].serviceName, cacheMap_[name].serviceType);
-        cacheMap_[name].state = State::ADD;
-        cacheMap_[name].txt = *txt;
+        ExtractNameAndType(name, CacheEntry(name).serviceName, CacheEntry(name).serviceType);
+        CacheEntry(name).state = State::ADD;
+        CacheEntry(name).txt = *txt;
     }
-    Result &result = cacheMap_[name];
+    Result &result = CacheEntry(name);
     if (result.txt != *txt || result.state == State::DEAD) {
         if (result.state != State::ADD) {
             result.state = State::REFRESH;
@@ -855,6 +1827,7 @@ void MDnsProtocolImpl::UpdateTxt(bool v6, const DNSProto::ResourceRecord &rr, st
     }
     result.ttl = rr.ttl;
     result.refrehTime = MilliSecondsSinceEpoch();
+    ScheduleCacheTimers(name);
 }
 
 void MDnsProtocolImpl::UpdateAddr(bool v6, const DNSProto::ResourceRecord &rr, std::set<std::string> &changed)
@@ -869,12 +1842,12 @@ void MDnsProtocolImpl::UpdateAddr(bool v6, const DNSProto::ResourceRecord &rr, s
     }
     std::string name = rr.name;
     if (cacheMap_.find(name) == cacheMap_.end()) {
-        ExtractNameAndType(name, cacheMap_[name].serviceName, cacheMap_[name].serviceType);
-        cacheMap_[name].state = State::ADD;
-        cacheMap_[name].ipv6 = v6rr;
-        cacheMap_[name].addr = addr;
+        ExtractNameAndType(name, CacheEntry(name).serviceName, CacheEntry(name).serviceType);
+        CacheEntry(name).state = State::ADD;
+        CacheEntry(name).ipv6 = v6rr;
+        CacheEntry(name).addr = addr;
     }
-    Result &result = cacheMap_[name];
+    Result &result = CacheEntry(name);
     if (result.addr != addr || result.ipv6 != v6rr || result.state == State::DEAD) {
         result.state = State::REFRESH;
         result.addr = addr;
@@ -888,6 +1861,7 @@ void MDnsProtocolImpl::UpdateAddr(bool v6, const DNSProto::ResourceRecord &rr, s
     }
     result.ttl = rr.ttl;
     result.refrehTime = MilliSecondsSinceEpoch();
+    ScheduleCacheTimers(name);
 }
 
 void MDnsProtocolImpl::ProcessAnswerRecord(bool v6, const DNSProto::ResourceRecord &rr, std::set<std::string> &changed)
@@ -896,7 +1870,7 @@ void MDnsProtocolImpl::ProcessAnswerRecord(bool v6, const DNSProto::ResourceReco
     std::lock_guard<std::recursive_mutex> guard(mutex_);
     std::string name = rr.name;
     if (cacheMap_.find(name) == cacheMap_.end() && browserMap_.find(name) == browserMap_.end() &&
-        srvMap_.find(name) != srvMap_.end()) {
+        IsRegistered(name)) {
         return;
     }
     if (rr.rtype == DNSProto::RRTYPE_PTR) {
@@ -934,7 +1908,7 @@ std::string MDnsProtocolImpl::GetHostDomain()
 void MDnsProtocolImpl::AddTask(const Task &task, bool atonce)
 {
     {
-        std::lock_guard<std::recursive_mutex> guard(mutex_);
+        std::lock_guard<std::mutex> guard(taskMutex_);
         taskQueue_.emplace_back(task);
     }
     if (atonce) {
@@ -959,24 +1933,28 @@ MDnsServiceInfo MDnsProtocolImpl::ConvertResultToInfo(const MDnsProtocolImpl::Re
 bool MDnsProtocolImpl::IsCacheAvailable(const std::string &key)
 {
     constexpr int64_t ms2S = 1000LL;
-    NETMGR_EXT_LOG_D("mdns_log IsCacheAvailable, ttl=[%{public}u]", cacheMap_[key].ttl);
-    return cacheMap_.find(key) != cacheMap_.end() &&
-           (ms2S * cacheMap_[key].ttl) > static_cast<uint32_t>(MilliSecondsSinceEpoch() - cacheMap_[key].refrehTime);
+    // Looked up without operator[], a miss must not leave an empty entry behind
+    auto it = cacheMap_.find(key);
+    if (it == cacheMap_.end()) {
+        return false;
+    }
+    NETMGR_EXT_LOG_D("mdns_log IsCacheAvailable, ttl=[%{public}u]", it->second.ttl);
+    return (ms2S * it->second.ttl) > static_cast<uint32_t>(MilliSecondsSinceEpoch() - it->second.refrehTime);
 }
 
 bool MDnsProtocolImpl::IsDomainCacheAvailable(const std::string &key)
 {
-    return IsCacheAvailable(key) && !cacheMap_[key].addr.empty();
+    return IsCacheAvailable(key) && !CacheEntry(key).addr.empty();
 }
 
 bool MDnsProtocolImpl::IsInstanceCacheAvailable(const std::string &key)
 {
-    return IsCacheAvailable(key) && !cacheMap_[key].domain.empty();
+    return IsCacheAvailable(key) && !CacheEntry(key).domain.empty();
 }
 
 bool MDnsProtocolImpl::IsBrowserAvailable(const std::string &key)
 {
-    return browserMap_.find(key) != browserMap_.end() && !browserMap_[key].empty();
+    return browserMap_.find(key) != browserMap_.end() && !BrowseEntry(key).empty();
 }
 
 void MDnsProtocolImpl::AddEvent(const std::string &key, const Task &task)
@@ -996,20 +1974,40 @@ void MDnsProtocolImpl::RunTaskQueue(std::list<Task> &queue)
     tmp.swap(queue);
 }
 
+// The queue is run under mutex_ but without taskMutex_, client calls keep queueing while it runs
+void MDnsProtocolImpl::RunTasks()
+{
+    std::list<Task> tasks;
+    {
+        std::lock_guard<std::mutex> guard(taskMutex_);
+        tasks.swap(taskQueue_);
+    }
+    if (tasks.empty()) {
+        return;
+    }
+    {
+        std::lock_guard<std::recursive_mutex> guard(mutex_);
+        RunTaskQueue(tasks);
+    }
+    // Tasks not done yet go back ahead of the new ones, in their original order
+    std::lock_guard<std::mutex> guard(taskMutex_);
+    taskQueue_.splice(taskQueue_.begin(), tasks);
+}
+
 void MDnsProtocolImpl::KillCache(const std::string &key)
 {
     NETMGR_EXT_LOG_D("mdns_log KillCache");
     if (IsBrowserAvailable(key) && browserMap_.find(key) != browserMap_.end()) {
-        for (auto it = browserMap_[key].begin(); it != browserMap_[key].end();) {
+        for (auto it = BrowseEntry(key).begin(); it != BrowseEntry(key).end();) {
             KillBrowseCache(key, it);
         }
     }
     if (IsCacheAvailable(key)) {
         std::lock_guard<std::recursive_mutex> guard(mutex_);
-        auto &elem = cacheMap_[key];
+        auto &elem = CacheEntry(key);
         if (elem.state == State::REMOVE) {
             elem.state = State::DEAD;
-            cacheMap_.erase(key);
+            EraseCacheEntry(key);
         } else if (elem.state == State::ADD || elem.state == State::REFRESH) {
             elem.state = State::LIVE;
         }
@@ -1026,8 +2024,8 @@ void MDnsProtocolImpl::KillBrowseCache(const std::string &key, std::vector<Resul
             nameCbMap_[key]->HandleServiceLost(ConvertResultToInfo(*it), NETMANAGER_EXT_SUCCESS);
         }
         std::string fullName = Decorated(it->serviceName + MDNS_DOMAIN_SPLITER_STR + it->serviceType);
-        cacheMap_.erase(fullName);
-        it = browserMap_[key].erase(it);
+        EraseCacheEntry(fullName);
+        it = BrowseEntry(key).erase(it);
     } else if (it->state == State::ADD || it->state == State::REFRESH) {
         it->state = State::LIVE;
         it++;
@@ -1039,9 +2037,10 @@ void MDnsProtocolImpl::KillBrowseCache(const std::string &key, std::vector<Resul
 int32_t MDnsProtocolImpl::StopCbMap(const std::string &serviceType)
 {
     NETMGR_EXT_LOG_D("mdns_log StopCbMap");
-    std::lock_guard<std::recursive_mutex> guard(mutex_);
     std::string name = Decorated(serviceType);
     sptr<IDiscoveryCallback> cb = nullptr;
+    std::vector<MDnsServiceInfo> lost;
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
     if (nameCbMap_.find(name) != nameCbMap_.end()) {
         cb = nameCbMap_[name];
         nameCbMap_.erase(name);
@@ -1052,11 +2051,25 @@ int32_t MDnsProtocolImpl::StopCbMap(const std::string &serviceType)
         if (cb != nullptr) {
             NETMGR_EXT_LOG_I("mdns_log StopCbMap res size:[%{public}zu]", it->second.size());
             for (auto &&res : it->second) {
-                NETMGR_EXT_LOG_W("mdns_log HandleServiceLost");
-                cb->HandleServiceLost(ConvertResultToInfo(res), NETMANAGER_EXT_SUCCESS);
+                lost.emplace_back(ConvertResultToInfo(res));
             }
         }
-        browserMap_.erase(name);
+        {
+            std::unique_lock<std::shared_mutex> lock(discoveryMutex_);
+            browserMap_.erase(name);
+        }
+        browseQueryCache_.erase(name);
+    }
+    auto schedule = browseSchedule_.find(name);
+    if (schedule != browseSchedule_.end()) {
+        timerWheel_.Cancel(schedule->second.timer);
+        browseSchedule_.erase(schedule);
+    }
+    // The client is called back with the browse results unlocked, a slow client must not stall packets
+    lock.unlock();
+    for (const auto &info : lost) {
+        NETMGR_EXT_LOG_W("mdns_log HandleServiceLost");
+        cb->HandleServiceLost(info, NETMANAGER_EXT_SUCCESS);
     }
     return NETMANAGER_SUCCESS;
 }
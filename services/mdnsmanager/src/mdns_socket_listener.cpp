@@ -20,7 +20,7 @@
 #include <ifaddrs.h>
 #include <net/if.h>
 #include <netinet/in.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/types.h>
@@ -47,6 +47,9 @@ constexpr const char *CONTROL_TAG_REFRESH = "R";
 
 constexpr uint16_t MDNS_PORT = 5353;
 constexpr size_t RECV_BUFFER = 2000;
+constexpr size_t RECV_BATCH = 8;
+constexpr size_t RECV_MAX_ROUNDS = 4;
+constexpr int EPOLL_TIMEOUT_MS = 1000;
 constexpr int WAIT_THREAD_MS = 5;
 constexpr int SOCKET_INIT_INTERVAL_MS = 1000;
 constexpr size_t MDNS_MAX_SOCKET = 16;
@@ -188,11 +191,24 @@ int InitSocketV6(int sock, ifaddrs *ifa, int port)
 
 } // namespace
 
-MDnsSocketListener::MDnsSocketListener()
+struct MDnsSocketListener::RecvSlot {
+    MDnsPayload payload;
+    sockaddr_storage addr;
+    iovec iov;
+    union {
+        cmsghdr cm;
+        char control[CMSG_SPACE(sizeof(in6_pktinfo))];
+    } controlUn;
+};
+
+MDnsSocketListener::MDnsSocketListener() : recvSlots_(RECV_BATCH), recvMsgs_(RECV_BATCH)
 {
     if (socketpair(AF_LOCAL, SOCK_STREAM | SOCK_CLOEXEC, 0, ctrlPair_) != 0) {
         NETMGR_EXT_LOG_F("mdns_log bind failed, errno:[%{public}d]", errno);
     }
+    for (RecvSlot &slot : recvSlots_) {
+        slot.payload.reserve(RECV_BUFFER);
+    }
 }
 
 MDnsSocketListener::~MDnsSocketListener()
@@ -301,6 +317,7 @@ uint32_t MDnsSocketListener::OpenSocketV4(ifaddrs *ifa)
     } else {
         socks_.emplace_back(sock);
         iface_[sock] = ifa->ifa_name;
+        ifIndex_[sock] = if_nametoindex(ifa->ifa_name);
         reinterpret_cast<sockaddr_in *>(&saddr_[sock])->sin_family = AF_INET;
         reinterpret_cast<sockaddr_in *>(&saddr_[sock])->sin_addr = saddr->sin_addr;
     }
@@ -333,6 +350,7 @@ uint32_t MDnsSocketListener::OpenSocketV6(ifaddrs *ifa, bool ipv6Support)
     } else {
         socks_.emplace_back(sock);
         iface_[sock] = ifa->ifa_name;
+        ifIndex_[sock] = if_nametoindex(ifa->ifa_name);
         reinterpret_cast<sockaddr_in6 *>(&saddr_[sock])->sin6_family = AF_INET6;
         reinterpret_cast<sockaddr_in6 *>(&saddr_[sock])->sin6_addr = saddr->sin6_addr;
     }
@@ -375,87 +393,102 @@ void MDnsSocketListener::CloseAllSocket()
     }
     socks_.clear();
     iface_.clear();
+    ifIndex_.clear();
 }
 
 void MDnsSocketListener::Run()
 {
+    // Sockets only change while the listener is stopped, so the interest list is built once per run
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        NETMGR_EXT_LOG_E("mdns_log epoll_create1 failed, errno:[%{public}d]", errno);
+        return;
+    }
+    epoll_event ev{.events = EPOLLIN};
+    ev.data.fd = ctrlPair_[0];
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, ctrlPair_[0], &ev) != 0) {
+        NETMGR_EXT_LOG_E("mdns_log epoll_ctl ctrl failed, errno:[%{public}d]", errno);
+    }
+    for (size_t i = 0; i < socks_.size() && i < MDNS_MAX_SOCKET; ++i) {
+        ev.data.fd = socks_[i];
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, socks_[i], &ev) != 0) {
+            NETMGR_EXT_LOG_E("mdns_log epoll_ctl sock [%{public}d] failed, errno:[%{public}d]", socks_[i], errno);
+        }
+    }
+    epoll_event events[MDNS_MAX_SOCKET + 1];
     while (runningFlag_) {
-        fd_set rfds;
-        FD_ZERO(&rfds);
-        FD_SET(ctrlPair_[0], &rfds);
         if (static_cast<bool>(finished_)) {
             finished_(ctrlPair_[0]);
         }
-        int nfds = ctrlPair_[0] + 1;
-        for (size_t i = 0; i < socks_.size(); ++i) {
-            FD_SET(socks_[i], &rfds);
-            nfds = std::max(nfds, socks_[i] + 1);
-        }
-        timeval timeout{.tv_sec = 1, .tv_usec = 0};
-        int res = select(nfds, &rfds, 0, 0, &timeout);
-        if (res < 0) {
-            continue;
-        }
-        if (FD_ISSET(ctrlPair_[0], &rfds)) {
-            CanRefresh();
-        }
-        for (size_t i = 0; i < socks_.size() && i < MDNS_MAX_SOCKET; ++i) {
-            if (FD_ISSET(socks_[i], &rfds)) {
-                ReceiveInSock(socks_[i]);
+        int timeout = static_cast<bool>(timeout_) ? timeout_() : EPOLL_TIMEOUT_MS;
+        int res = epoll_wait(epfd, events, static_cast<int>(MDNS_MAX_SOCKET + 1), timeout);
+        for (int i = 0; i < res; ++i) {
+            if (events[i].data.fd == ctrlPair_[0]) {
+                CanRefresh();
+            } else {
+                ReceiveInSock(events[i].data.fd);
             }
         }
     }
+    close(epfd);
     NETMGR_EXT_LOG_I("mdns_log listener stopped");
 }
 
 // LCOV_EXCL_START
-void MDnsSocketListener::ReceiveInSock(int sock)
+void MDnsSocketListener::PrepareRecvBatch()
 {
-    sockaddr_storage addr{};
-    sockaddr *saddr = (sockaddr *)&addr;
-    socklen_t addrlen = sizeof(addr);
-    MDnsPayload payload(RECV_BUFFER);
-    msghdr msg{};
-    iovec iov[1];
-    cmsghdr *cmptr;
-    union {
-        cmsghdr cm;
-        char control[CMSG_SPACE(sizeof(in6_pktinfo))];
-    } control_un;
-    msg.msg_control = control_un.control;
-    msg.msg_controllen = sizeof(control_un.control);
-    msg.msg_flags = 0;
-    msg.msg_name = saddr;
-    msg.msg_namelen = addrlen;
-    iov[0].iov_base = payload.data();
-    iov[0].iov_len = payload.size();
-    msg.msg_iov = iov;
-    msg.msg_iovlen = 1;
-
-    ssize_t recvLen = recvmsg(sock, &msg, 0);
-    if (recvLen <= 0) {
-        NETMGR_EXT_LOG_E("mdns_log recvmsg return: [%{public}zd], errno:[%{public}d]", recvLen, errno);
-        return;
+    for (size_t i = 0; i < RECV_BATCH; ++i) {
+        RecvSlot &slot = recvSlots_[i];
+        // Capacity was reserved up front, growing back to RECV_BUFFER never reallocates
+        slot.payload.resize(RECV_BUFFER);
+        slot.iov.iov_base = slot.payload.data();
+        slot.iov.iov_len = slot.payload.size();
+        msghdr &msg = recvMsgs_[i].msg_hdr;
+        msg.msg_name = &slot.addr;
+        msg.msg_namelen = sizeof(slot.addr);
+        msg.msg_iov = &slot.iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = slot.controlUn.control;
+        msg.msg_controllen = sizeof(slot.controlUn.control);
+        msg.msg_flags = 0;
+        recvMsgs_[i].msg_len = 0;
     }
+}
 
-    int ifIndex = -1;
-    for (cmptr = CMSG_FIRSTHDR(&msg); cmptr != nullptr; cmptr = CMSG_NXTHDR(&msg, cmptr)) {
-        if (cmptr->cmsg_level == IPPROTO_IP && cmptr->cmsg_type == IP_PKTINFO) {
-            ifIndex = reinterpret_cast<in_pktinfo *>(CMSG_DATA(cmptr))->ipi_ifindex;
+void MDnsSocketListener::ReceiveInSock(int sock)
+{
+    auto bound = ifIndex_.find(sock);
+    unsigned int sockIfIndex = (bound == ifIndex_.end()) ? 0 : bound->second;
+    // Drain bursts in batches, bounded so a chatty interface cannot starve the others
+    for (size_t round = 0; round < RECV_MAX_ROUNDS; ++round) {
+        PrepareRecvBatch();
+        int count = recvmmsg(sock, recvMsgs_.data(), RECV_BATCH, MSG_DONTWAIT, nullptr);
+        if (count <= 0) {
+            if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                NETMGR_EXT_LOG_E("mdns_log recvmmsg return: [%{public}d], errno:[%{public}d]", count, errno);
+            }
+            return;
+        }
+        for (int i = 0; i < count; ++i) {
+            msghdr &msg = recvMsgs_[i].msg_hdr;
+            unsigned int ifIndex = 0;
+            for (cmsghdr *cmptr = CMSG_FIRSTHDR(&msg); cmptr != nullptr; cmptr = CMSG_NXTHDR(&msg, cmptr)) {
+                if (cmptr->cmsg_level == IPPROTO_IP && cmptr->cmsg_type == IP_PKTINFO) {
+                    ifIndex = static_cast<unsigned int>(reinterpret_cast<in_pktinfo *>(CMSG_DATA(cmptr))->ipi_ifindex);
+                }
+                if (cmptr->cmsg_level == IPPROTO_IPV6 && cmptr->cmsg_type == IPV6_2292PKTINFO) {
+                    ifIndex = reinterpret_cast<in6_pktinfo *>(CMSG_DATA(cmptr))->ipi6_ifindex;
+                }
+            }
+            if (ifIndex == sockIfIndex && recvMsgs_[i].msg_len > 0 && recv_) {
+                recvSlots_[i].payload.resize(recvMsgs_[i].msg_len);
+                recv_(sock, recvSlots_[i].payload);
+            }
         }
-        if (cmptr->cmsg_level == IPPROTO_IPV6 && cmptr->cmsg_type == IPV6_2292PKTINFO) {
-            ifIndex = static_cast<int>(reinterpret_cast<in6_pktinfo *>(CMSG_DATA(cmptr))->ipi6_ifindex);
+        if (static_cast<size_t>(count) < RECV_BATCH) {
+            return;
         }
     }
-
-    char ifName[IFNAMSIZ] = {0};
-    if (if_indextoname(static_cast<unsigned>(ifIndex), ifName) == nullptr) {
-        NETMGR_EXT_LOG_E("mdns_log if_indextoname failed, errno:[%{public}d]", errno);
-    }
-    if (ifName == iface_[sock] && recvLen > 0 && recv_) {
-        payload.resize(static_cast<size_t>(recvLen));
-        recv_(sock, payload);
-    }
 }
 // LCOV_EXCL_STOP
 
@@ -545,6 +578,11 @@ void MDnsSocketListener::SetFinishedHandler(const FinishedHandler &callback)
     finished_ = callback;
 }
 
+void MDnsSocketListener::SetTimeoutHandler(const TimeoutHandler &callback)
+{
+    timeout_ = callback;
+}
+
 // LCOV_EXCL_START
 std::string_view MDnsSocketListener::GetIface(int sock) const
 {
@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mdns_timer_wheel.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace OHOS {
+namespace NetManagerStandard {
+
+MDnsTimerWheel::MDnsTimerWheel(int64_t tickMs) : tickMs_(tickMs > 0 ? tickMs : DEFAULT_TICK_MS) {}
+
+void MDnsTimerWheel::Reset(int64_t nowMs)
+{
+    for (auto &level : slots_) {
+        for (auto &slot : level) {
+            slot.clear();
+        }
+    }
+    timers_.clear();
+    currentTick_ = std::max<int64_t>(nowMs, 0) / tickMs_;
+}
+
+MDnsTimerWheel::TimerId MDnsTimerWheel::Schedule(int64_t expireMs, const Callback &callback)
+{
+    TimerId id = nextId_++;
+    // Rounded up, so a timer never fires before its expire time
+    int64_t expireTick = (std::max<int64_t>(expireMs, 0) + tickMs_ - 1) / tickMs_;
+    Timer &timer = timers_[id];
+    timer.expireTick = expireTick;
+    timer.callback = callback;
+    // The current tick was already processed, anything due now fires on the next one
+    Place(id, timer, std::max(expireTick, currentTick_ + 1));
+    return id;
+}
+
+bool MDnsTimerWheel::Cancel(TimerId id)
+{
+    auto it = timers_.find(id);
+    if (it == timers_.end()) {
+        return false;
+    }
+    if (it->second.level != DETACHED) {
+        Unlink(it->second);
+    }
+    timers_.erase(it);
+    return true;
+}
+
+size_t MDnsTimerWheel::Size() const
+{
+    return timers_.size();
+}
+
+void MDnsTimerWheel::Place(TimerId id, Timer &timer, int64_t expireTick)
+{
+    int64_t delta = std::min(expireTick - currentTick_, WHEEL_SPAN - 1);
+    // Timers beyond the span park in the last level and are placed again when it cascades
+    int64_t tick = currentTick_ + delta;
+    for (size_t level = 0; level < WHEEL_LEVELS; ++level) {
+        if (delta < (1LL << (WHEEL_BITS * (level + 1)))) {
+            timer.level = level;
+            timer.slot = static_cast<size_t>((tick >> (WHEEL_BITS * level)) & WHEEL_MASK);
+            Slot &slot = slots_[level][timer.slot];
+            timer.index = slot.size();
+            slot.push_back(id);
+            return;
+        }
+    }
+}
+
+void MDnsTimerWheel::Unlink(const Timer &timer)
+{
+    // The last id of the slot takes the place of the removed one
+    Slot &slot = slots_[timer.level][timer.slot];
+    TimerId moved = slot.back();
+    slot[timer.index] = moved;
+    slot.pop_back();
+    if (timer.index < slot.size()) {
+        timers_[moved].index = timer.index;
+    }
+}
+
+void MDnsTimerWheel::Detach(const Slot &slot)
+{
+    for (TimerId id : slot) {
+        timers_[id].level = DETACHED;
+    }
+}
+
+void MDnsTimerWheel::Cascade(size_t level)
+{
+    Slot slot;
+    slot.swap(slots_[level][(currentTick_ >> (WHEEL_BITS * level)) & WHEEL_MASK]);
+    for (TimerId id : slot) {
+        Timer &timer = timers_[id];
+        Place(id, timer, std::max(timer.expireTick, currentTick_));
+    }
+}
+
+size_t MDnsTimerWheel::Fire(TimerId id)
+{
+    auto it = timers_.find(id);
+    if (it == timers_.end()) {
+        return 0;
+    }
+    Callback callback = std::move(it->second.callback);
+    timers_.erase(it);
+    if (callback) {
+        callback();
+    }
+    return 1;
+}
+
+size_t MDnsTimerWheel::Rebase(int64_t nowTick)
+{
+    std::vector<std::pair<int64_t, TimerId>> due;
+    for (auto &level : slots_) {
+        for (auto &slot : level) {
+            slot.clear();
+        }
+    }
+    currentTick_ = nowTick;
+    for (auto &[id, timer] : timers_) {
+        if (timer.expireTick <= nowTick) {
+            timer.level = DETACHED;
+            due.emplace_back(timer.expireTick, id);
+        } else {
+            Place(id, timer, timer.expireTick);
+        }
+    }
+    std::sort(due.begin(), due.end());
+    size_t fired = 0;
+    for (const auto &elem : due) {
+        fired += Fire(elem.second);
+    }
+    return fired;
+}
+
+size_t MDnsTimerWheel::Advance(int64_t nowMs)
+{
+    int64_t nowTick = std::max<int64_t>(nowMs, 0) / tickMs_;
+    if (nowTick <= currentTick_) {
+        return 0;
+    }
+    if (timers_.empty()) {
+        Reset(nowMs);
+        return 0;
+    }
+    // A long sleep or a first run on a fresh wheel: sort it out once instead of walking every tick
+    if (nowTick - currentTick_ >= WHEEL_SPAN) {
+        return Rebase(nowTick);
+    }
+    size_t fired = 0;
+    while (currentTick_ < nowTick) {
+        ++currentTick_;
+        if ((currentTick_ & WHEEL_MASK) == 0) {
+            for (size_t level = WHEEL_LEVELS - 1; level > 0; --level) {
+                // A level only cascades when every level below it wrapped around
+                if ((currentTick_ & ((1LL << (WHEEL_BITS * level)) - 1)) == 0) {
+                    Cascade(level);
+                }
+            }
+        }
+        Slot &current = slots_[0][currentTick_ & WHEEL_MASK];
+        if (current.empty()) {
+            continue;
+        }
+        Slot slot;
+        slot.swap(current);
+        // Callbacks may cancel timers of this slot, which are no longer stored in it
+        Detach(slot);
+        for (TimerId id : slot) {
+            auto it = timers_.find(id);
+            if (it != timers_.end() && it->second.expireTick > currentTick_) {
+                Place(id, it->second, it->second.expireTick);
+                continue;
+            }
+            fired += Fire(id);
+        }
+    }
+    return fired;
+}
+
+int64_t MDnsTimerWheel::NextExpire() const
+{
+    if (timers_.empty()) {
+        return -1;
+    }
+    // Timers parked beyond the span count as the end of their slot, which keeps the slots of a level in order
+    auto earliest = [this](const Slot &slot, int64_t lastTick) {
+        int64_t tick = std::numeric_limits<int64_t>::max();
+        for (TimerId id : slot) {
+            auto it = timers_.find(id);
+            if (it != timers_.end()) {
+                tick = std::min({tick, it->second.expireTick, lastTick});
+            }
+        }
+        return tick;
+    };
+    // Only the first live slot of each level can hold the earliest timer of that level
+    int64_t next = std::numeric_limits<int64_t>::max();
+    for (size_t level = 0; level < WHEEL_LEVELS; ++level) {
+        size_t shift = WHEEL_BITS * level;
+        int64_t base = currentTick_ >> shift;
+        for (int64_t i = 1; i <= static_cast<int64_t>(WHEEL_SLOTS); ++i) {
+            int64_t lastTick = ((base + i + 1) << shift) - 1;
+            int64_t tick = earliest(slots_[level][(base + i) & WHEEL_MASK], lastTick);
+            if (tick != std::numeric_limits<int64_t>::max()) {
+                next = std::min(next, tick);
+                break;
+            }
+        }
+    }
+    if (next == std::numeric_limits<int64_t>::max()) {
+        return (currentTick_ + 1) * tickMs_;
+    }
+    return std::max(next, currentTick_ + 1) * tickMs_;
+}
+
+} // namespace NetManagerStandard
+} // namespace OHOS
@@ -87,6 +87,15 @@ public:
      */
     int64_t Insert(const OHOS::NativeRdb::ValuesBucket &insertValues, const std::string tableName);
 
+    /**
+     * Insert several rows into the table with one statement
+     *
+     * @param insertValues Values inserted, one bucket per row
+     * @param tableName Table name
+     * @return Error or number of inserted rows
+     */
+    int64_t BatchInsert(const std::vector<OHOS::NativeRdb::ValuesBucket> &insertValues, const std::string tableName);
+
     /**
      * Update value in table
      *
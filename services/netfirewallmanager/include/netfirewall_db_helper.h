@@ -16,6 +16,9 @@
 #ifndef FIREWALL_DB_HELPER_H
 #define FIREWALL_DB_HELPER_H
 
+#include <functional>
+#include <map>
+#include <shared_mutex>
 #include <string>
 
 #include "netfirewall_database.h"
@@ -331,10 +334,33 @@ private:
     void FirewallPortToDbPort(const std::vector<NetFirewallPortParam> &ports, std::vector<DataBasePort> &dbports);
     void DbPortToFirewallPort(const std::vector<DataBasePort> &dbports, std::vector<NetFirewallPortParam> &ports);
 
+    // Rule cache, the caller must hold databaseMutex_ for the ones that touch the database
+    bool EnsureRuleCache();
+    bool LoadRuleCacheLocked();
+    void InvalidateRuleCache();
+    void CacheRule(const NetFirewallRule &rule);
+    void EraseCachedRuleName(const NetFirewallRule &rule);
+    void UncacheRules(const std::function<bool(const NetFirewallRule &)> &match);
+    void CollectCachedRules(const std::function<bool(const NetFirewallRule &)> &match,
+        std::vector<NetFirewallRule> &rules);
+    static void ToStoredRule(const NetFirewallRule &rule, NetFirewallRule &stored);
+    int32_t QueryCachedFirewallRule(const int32_t userId, const sptr<RequestParam> &requestParam,
+        sptr<FirewallRulePage> &info);
+    void AgeInterceptRecordsLocked(const int32_t userId, int64_t nowSec, size_t incoming);
+
 private:
     static std::shared_ptr<NetFirewallDbHelper> instance_;
     std::mutex databaseMutex_;
     std::shared_ptr<NetFirewallDataBase> firewallDatabase_;
+    // Write-through copy of the rule table, lock order is databaseMutex_ then ruleCacheMutex_
+    std::shared_mutex ruleCacheMutex_;
+    bool ruleCacheLoaded_ = false;
+    std::map<int32_t, NetFirewallRule> ruleCache_;
+    // userId -> (ruleName -> ruleId), the sorted view used for paging
+    std::map<int32_t, std::multimap<std::string, int32_t>> userRuleNames_;
+    // Intercept record rows and the last date aging time per user, guarded by databaseMutex_
+    std::map<int32_t, int64_t> recordCount_;
+    std::map<int32_t, int64_t> recordAgingTime_;
 };
 } // namespace NetManagerStandard
 } // namespace OHOS
@@ -16,8 +16,11 @@
 #ifndef NET_FIREWALL_INTERCEPT_RECORDER_H
 #define NET_FIREWALL_INTERCEPT_RECORDER_H
 
+#include <array>
+#include <atomic>
 #include <string>
 #include <shared_mutex>
+#include <unordered_map>
 
 #include "ffrt.h"
 #include "i_net_intercept_record_callback.h"
@@ -26,6 +29,69 @@
 
 namespace OHOS {
 namespace NetManagerStandard {
+constexpr size_t INTERCEPT_RECORD_RING_SIZE = 1024;
+
+// Bounded lock-free multi-producer multi-consumer ring of intercept records
+class InterceptRecordRing {
+public:
+    InterceptRecordRing();
+
+    /**
+     * Put a record into the ring
+     *
+     * @param record record object
+     * @return false when the ring is full and the record was dropped
+     */
+    bool Push(const sptr<InterceptRecord> &record);
+
+    /**
+     * Take the oldest record out of the ring
+     *
+     * @param record the record taken out
+     * @return false when the ring is empty
+     */
+    bool Pop(sptr<InterceptRecord> &record);
+
+    size_t Size() const;
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        sptr<InterceptRecord> record;
+    };
+    static constexpr size_t MASK = INTERCEPT_RECORD_RING_SIZE - 1;
+    static_assert((INTERCEPT_RECORD_RING_SIZE & MASK) == 0, "ring size must be a power of two");
+    std::array<Cell, INTERCEPT_RECORD_RING_SIZE> cells_;
+    alignas(64) std::atomic<size_t> enqueuePos_ = 0;
+    alignas(64) std::atomic<size_t> dequeuePos_ = 0;
+};
+
+// Flow identity used to merge repeated intercept records
+struct InterceptFlowKey {
+    std::string localIp;
+    std::string remoteIp;
+    uint16_t localPort = 0;
+    uint16_t remotePort = 0;
+    uint16_t protocol = 0;
+    int32_t appUid = 0;
+
+    bool operator==(const InterceptFlowKey &other) const
+    {
+        return localPort == other.localPort && remotePort == other.remotePort && protocol == other.protocol &&
+            appUid == other.appUid && localIp == other.localIp && remoteIp == other.remoteIp;
+    }
+};
+
+struct InterceptFlowKeyHash {
+    size_t operator()(const InterceptFlowKey &key) const;
+};
+
+// Suppression window of one flow, hits counts the records merged into it
+struct InterceptFlowWindow {
+    uint64_t start = 0;
+    uint32_t hits = 0;
+};
+
 class NetFirewallInterceptRecorder : public std::enable_shared_from_this<NetFirewallInterceptRecorder> {
 public:
     // Firewall interception log callback
@@ -143,15 +209,20 @@ public:
     bool ShouldSkipNotify(sptr<InterceptRecord> &record);
 
 private:
+    void PruneFlowWindows(uint64_t now);
+
     std::shared_mutex setRecordMutex_;
     std::mutex setRecordWithoutSkipMutex_;
     std::shared_mutex callbackMutex_;
     std::mutex interceptRecordCallbackMutex_;
     std::atomic<int32_t> currentUserId_ = 0;
-    std::vector<sptr<InterceptRecord>> recordCache_;
+    InterceptRecordRing recordCache_;
+    std::atomic<uint64_t> droppedRecords_ = 0;
     std::vector<sptr<InterceptRecord>> recordCacheWithoutSkip_;
     std::vector<sptr<INetInterceptRecordCallback>> interceptRecordCallbacks_;
     sptr<OHOS::NetsysNative::INetFirewallCallback> callback_ = nullptr;
+    std::mutex flowWindowMutex_;
+    std::unordered_map<InterceptFlowKey, InterceptFlowWindow, InterceptFlowKeyHash> flowWindows_;
     sptr<InterceptRecord> oldRecord_ = nullptr;
     static std::shared_ptr<NetFirewallInterceptRecorder> instance_;
 };
@@ -16,6 +16,7 @@
 #ifndef NET_FIREWALL_RULES_MANAGER_H
 #define NET_FIREWALL_RULES_MANAGER_H
 
+#include <map>
 #include <string>
 #include <shared_mutex>
 
@@ -128,6 +129,20 @@ private:
 
     void UpdateUserRuleSize(const int32_t userId, bool isInc);
 
+    int32_t LoadEnabledRules();
+
+    void InvalidateEnabledRules();
+
+    void UpdateEnabledRule(const NetFirewallRule &rule);
+
+    void RemoveEnabledRule(const int32_t ruleId);
+
+    void GetEnabledRulesByType(std::vector<NetFirewallRule> &rules, NetFirewallRuleType type);
+
+    bool IsRuleVisibleToNative(const NetFirewallRule &rule);
+
+    bool IsSameNativeRule(const NetFirewallRule &oldRule, const NetFirewallRule &newRule);
+
 private:
     // Cache the current state
     std::atomic<int64_t> allUserRule_ = 0;
@@ -137,6 +152,9 @@ private:
     std::map<int32_t, int64_t> userRuleSize_;
     std::atomic<uint64_t> currentSetRuleSecond_ = 0;
     std::atomic<int64_t> lastRulePushResult_ = -1;
+    // In-memory copy of the enabled rules of all users keyed by rule id, guarded by setFirewallRuleMutex_
+    std::map<int32_t, NetFirewallRule> enabledRules_;
+    bool enabledRulesLoaded_ = false;
 };
 } // namespace NetManagerStandard
 } // namespace OHOS
@@ -34,6 +34,7 @@
 #include "ffrt.h"
 #include "nettrafficfilter_redirect_manager.h"
 #include "nettrafficfilter_packetrule_manager.h"
+#include "nettrafficfilter_latency_histogram.h"
 
 namespace OHOS {
 namespace NetManagerStandard {
@@ -209,6 +210,12 @@ public:
     int32_t QueryProcess(const std::string& srcIp, uint16_t srcPort,
         const std::string& dstIp, uint16_t dstPort, uint8_t protocol, uint32_t& uid, uint32_t& pid) override;
 
+    /**
+     * Query the owners of several connections against one socket table snapshot
+     */
+    int32_t QueryProcesses(const std::vector<TrafficFilterConnectionTuple>& connections,
+        std::vector<TrafficFilterProcessOwner>& owners) override;
+
     /**
      * Create packet controller for traffic filtering
      */
@@ -220,6 +227,17 @@ public:
      */
     int32_t DestroyPacketController(const std::string& packetControllerId) override;
 
+    /**
+     * Get the netlink fds of the extra queues a packet controller fans out to
+     */
+    int32_t GetPacketControllerFanoutFds(const std::string& packetControllerId,
+        std::vector<int32_t>& fds) override;
+
+    /**
+     * Get the conntrack mark of the flow verdict cache of a packet controller, 0 when the cache is disabled
+     */
+    int32_t GetPacketControllerFlowMark(const std::string& packetControllerId, uint32_t& flowMark) override;
+
     /**
      * Add packet rule to packet controller
      */
@@ -275,6 +293,10 @@ private:
 
     std::string GetBundleName();
 
+    int32_t ParseOwnedQueueNumber(const std::string& packetControllerId, uint16_t& queueNum);
+
+    int32_t GetOwnedQueueInfo(const std::string& packetControllerId, QueueInfo& info);
+
     SpaceType GetUserSpaceType(int32_t userId);
 
     void HandleSpaceSwitched(int32_t userId);
@@ -293,6 +315,9 @@ private:
     mutable std::mutex saMutex_;
     SpaceType currentSpaceType_ = SpaceType::UNKNOWN;
     std::mutex spaceTypeMutex_;
+    // Verdicts packet controllers could not write to their queue socket and sent through the service
+    TrafficFilterLatencyHistogram relayedVerdictLatency_;
+    std::atomic<uint64_t> relayedVerdictFailures_ = 0;
 };
 } // namespace NetManagerStandard
 } // namespace OHOS
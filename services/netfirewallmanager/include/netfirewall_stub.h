@@ -77,10 +77,16 @@ private:
 
     int32_t OnQueryProcess(MessageParcel &data, MessageParcel &reply);
 
+    int32_t OnQueryProcesses(MessageParcel &data, MessageParcel &reply);
+
     int32_t OnCreatePacketController(MessageParcel &data, MessageParcel &reply);
 
     int32_t OnDestroyPacketController(MessageParcel &data, MessageParcel &reply);
 
+    int32_t OnGetPacketControllerFanoutFds(MessageParcel &data, MessageParcel &reply);
+
+    int32_t OnGetPacketControllerFlowMark(MessageParcel &data, MessageParcel &reply);
+
     int32_t CheckFirewallPermission(std::string &strPermission);
 
     int32_t OnAddPacketRule(MessageParcel &data, MessageParcel &reply);
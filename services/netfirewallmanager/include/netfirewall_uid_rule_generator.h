@@ -75,7 +75,8 @@ private:
     std::string BuildInputCtmarkRule(
         const std::string& chainName,
         int32_t queueNum,
-        uint32_t markValue);
+        uint32_t markValue,
+        uint16_t queueCount = 1);
 
     std::string GenerateIsolationKey(const std::string& bundleName, uint32_t groupId);
 
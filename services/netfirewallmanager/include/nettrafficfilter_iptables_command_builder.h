@@ -16,7 +16,9 @@
 #ifndef NETTRAFFICFILTER_IPTABLES_COMMAND_BUILDER_H
 #define NETTRAFFICFILTER_IPTABLES_COMMAND_BUILDER_H
 
+#include <functional>
 #include <string>
+#include <vector>
 #include "netfirewall_common.h"
 
 namespace OHOS {
@@ -25,6 +27,13 @@ enum IptablesName {
     NAT = 0,
     FILTER
 };
+
+// Commands of one packet rule, the match chains have to be created before the commands are run
+struct PacketFilterCommands {
+    std::vector<std::string> matchChains;
+    std::vector<std::string> commands;
+};
+
 class NetTrafficFilterIptablesCommandBuilder {
 public:
     static std::string BuildRedirectCommandWithPosition(const TrafficFilterRedirectRule& rule,
@@ -48,10 +57,17 @@ public:
     static std::string GetHookPointName(TrafficFilterHookPoint hookPoint);
     static int32_t ExecuteIptablesCommand(const std::string& command, TrafficFilterIPFamily family);
 
+    static std::string BuildNfqueueTarget(int32_t queueNum, uint16_t queueCount = 1);
+    static std::vector<std::string> BuildFlowCacheCommands(const std::string& chainName, uint32_t flowCacheMark);
+    static std::string BuildPacketQueueAllCommand(const std::string& chainName, int32_t queueNum,
+        uint16_t queueCount = 1);
     static std::string BuildPacketFilterCommand(const TrafficFilterPacketRule& rule,
-        const std::string& chainName, int32_t queueNum);
-    static std::vector<std::string> BuildPacketFilterCommands(
-        const TrafficFilterPacketRule& rule, const std::string& chainName, int32_t queueNum);
+        const std::string& chainName, int32_t queueNum, uint16_t queueCount = 1);
+    static std::vector<std::string> BuildPacketFilterCommands(const TrafficFilterPacketRule& rule,
+        const std::string& chainName, int32_t queueNum, uint16_t queueCount = 1);
+    static PacketFilterCommands BuildPacketFilterChainCommands(const TrafficFilterPacketRule& rule,
+        const std::string& chainName, uint32_t firstMatchChain, int32_t queueNum, uint16_t queueCount = 1);
+    static std::string GenerateMatchChainName(const std::string& chainName, uint32_t index);
     static std::string BuildPacketFilterCommand(const TrafficFilterPacketRule& rule,
         const TrafficFilterIPMatch& srcIp, const TrafficFilterIPMatch& dstIp,
         const TrafficFilterPortMatch& srcPort, const TrafficFilterPortMatch& dstPort,
@@ -78,6 +94,51 @@ private:
         const TrafficFilterPortMatch& srcPort, const TrafficFilterPortMatch& dstPort);
 };
 
+/*
+ * Collects iptables commands for both families and runs them in one pass. Steps that are identical for IPv4 and
+ * IPv6 are merged into a single dual-stack call, the order of the commands within each family is kept.
+ * Steps are committed in groups: when a step fails, the steps of its group already applied are undone in reverse
+ * order and the later groups still run.
+ */
+class NetTrafficFilterIptablesTransaction {
+public:
+    using Executor = std::function<int32_t(const std::string&, TrafficFilterIPFamily)>;
+
+    NetTrafficFilterIptablesTransaction();
+    explicit NetTrafficFilterIptablesTransaction(Executor executor);
+    // steps added from now on form a new group
+    void BeginGroup();
+    void Add(const std::string& command, TrafficFilterIPFamily family, bool ignoreError = false,
+        const std::string& undoCommand = "");
+    int32_t Commit();
+    bool Empty() const;
+
+private:
+    struct Entry {
+        std::string command;
+        bool ignoreError;
+        std::string undoCommand;
+        size_t group;
+        bool operator==(const Entry& other) const
+        {
+            return command == other.command && ignoreError == other.ignoreError &&
+                undoCommand == other.undoCommand && group == other.group;
+        }
+    };
+    struct AppliedEntry {
+        const Entry* entry;
+        TrafficFilterIPFamily family;
+    };
+    int32_t Execute(const Entry& entry, TrafficFilterIPFamily family, std::vector<AppliedEntry>& applied);
+    int32_t CommitGroup(const std::vector<Entry>& v4Entries, size_t& v4Pos, const std::vector<Entry>& v6Entries,
+        size_t& v6Pos);
+    void Undo(const std::vector<AppliedEntry>& applied);
+    Executor executor_;
+    size_t group_ = 0;
+    std::vector<Entry> v4Entries_;
+    std::vector<Entry> v6Entries_;
+};
+
 } // namespace NetManagerStandard
 } // namespace OHOS
 
@@ -15,8 +15,11 @@
 #ifndef NETTRAFFICFILTER_NFQUEUE_CORE_H
 #define NETTRAFFICFILTER_NFQUEUE_CORE_H
 
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include "netfirewall_common.h"
@@ -26,6 +29,17 @@
 
 namespace OHOS {
 namespace NetManagerStandard {
+struct FanoutQueue {
+    uint16_t queueNum;
+    int fd;
+    OHOS::sptr<NfqCtx> nfqHandle;
+    OHOS::sptr<NfqQueue> qh;
+};
+// Netlink handles of one queue number, published for the per-packet verdict path
+struct QueueHandles {
+    OHOS::sptr<NfqCtx> nfqHandle;
+    OHOS::sptr<NfqQueue> qh;
+};
 struct QueueInfo {
     uint32_t groupId;
     uint32_t priority;
@@ -38,6 +52,10 @@ struct QueueInfo {
     int fd;
     OHOS::sptr<NfqCtx> nfqHandle;
     OHOS::sptr<NfqQueue> qh;
+    uint16_t queueCount = 1;
+    std::vector<FanoutQueue> fanoutQueues;
+    uint32_t flowCacheMark = 0;
+    bool userSpaceMatch = false;
 };
 class NetTrafficFilterNFQueueCore {
 public:
@@ -48,10 +66,17 @@ public:
     int32_t DestroyQueue(uint16_t queueNum);
     int32_t DestroyByBundleName(const std::string &bundleName);
 
-    int32_t AllocateQueueNumber(const std::string &bundleName, uint32_t groupId);
+    int32_t AllocateQueueNumber(const std::string &bundleName, uint32_t groupId, uint16_t queueCount = 1);
     QueueInfo GetQueueInfo(uint16_t queueNum);
+    std::shared_ptr<const QueueHandles> GetQueueHandles(uint16_t queueNum);
 
 private:
+    static constexpr uint32_t QUEUE_SLOT_CHUNK_BITS = 8;
+    static constexpr uint32_t QUEUE_SLOT_CHUNK_SIZE = 1 << QUEUE_SLOT_CHUNK_BITS;
+    static constexpr uint32_t QUEUE_SLOT_CHUNK_COUNT = (UINT16_MAX + 1) / QUEUE_SLOT_CHUNK_SIZE;
+    struct QueueSlotChunk {
+        std::array<std::shared_ptr<const QueueHandles>, QUEUE_SLOT_CHUNK_SIZE> slots;
+    };
     class TrafficFilterHapObserver : public AppExecFwk::ApplicationStateObserverStub {
     public:
         explicit TrafficFilterHapObserver(NetTrafficFilterNFQueueCore& nfqueueCore,
@@ -66,7 +91,12 @@ private:
     };
     NetTrafficFilterNFQueueCore();
     ~NetTrafficFilterNFQueueCore();
-    OHOS::sptr<NfqCtx> CreateNFQHandle(const std::string &bundleName);
+    OHOS::sptr<NfqCtx> OpenNFQHandle();
+    bool IsQueueNumberInUse(uint16_t queueNum);
+    uint16_t GetQueueCount(const OHOS::sptr<TrafficFilterConfig>& config);
+    bool CreateFanoutQueues(QueueInfo &info, const OHOS::sptr<TrafficFilterConfig>& config);
+    void DestroyFanoutQueues(QueueInfo &info);
+    uint32_t AllocateFlowCacheMark();
 #ifndef NETMANAGER_TEST
     bool CreateIptables(uint32_t priority, QueueInfo &info, int32_t callingUid, uint32_t groupId);
     void DestroyIptables(const QueueInfo &info);
@@ -80,14 +110,18 @@ private:
     uint32_t GetQueueFlags(const OHOS::sptr<TrafficFilterConfig>& config);
     bool ConfigureNFQueue(OHOS::sptr<NfqCtx>& ctx,
         OHOS::sptr<NfqQueue>& qh, const OHOS::sptr<TrafficFilterConfig>& config);
-    void UpdateNFQHandleFromBundleName(const std::string &bundleName, const OHOS::sptr<NfqCtx>& nfqHandle);
-    OHOS::sptr<NfqCtx> GetNFQHandleFromBundleName(const std::string& bundleName);
+    void PublishQueueHandles(uint16_t queueNum, const OHOS::sptr<NfqCtx>& nfqHandle, const OHOS::sptr<NfqQueue>& qh);
+    void PublishQueueInfo(const QueueInfo &info);
+    void RetractQueueInfo(const QueueInfo &info);
     std::map<int32_t, QueueInfo> queues_;
 
     std::mutex mutex_;
     std::map<int32_t, OHOS::sptr<TrafficFilterHapObserver>> uidToObserverMap_;
     mutable std::mutex observerMutex_;
     uint16_t nextQueueId_ = 0;
+    // Read-mostly mirror of queues_ indexed by queue number, written under mutex_ and read without it.
+    // Chunks are allocated on first use and live as long as the core.
+    std::array<std::atomic<QueueSlotChunk*>, QUEUE_SLOT_CHUNK_COUNT> queueSlotChunks_ {};
 };
 } // namespace NetManagerStandard
 } // namespace OHOS
@@ -76,12 +76,17 @@ private:
         const std::string& chainName, bool needV6);
     void CleanPhysicalRules(const QueueInfo& info, const std::set<int32_t>& hookPoints);
     void DeleteChainForIpFamilies(const std::string& chainName);
+    int32_t CreateMatchChains(const std::vector<std::string>& matchChains, const std::string& chainName,
+        TrafficFilterIPFamily family);
+    void ReleaseMatchChains(const std::string& chainName, TrafficFilterIPFamily family);
     std::vector<ResumeEntry> CollectResumeEntries();
     int32_t ResumeJumpRules(const std::vector<ResumeEntry>& entries);
 
     std::mutex mutex_;
     std::map<uint32_t, HookPointRules> queueNumToRules_;
     std::map<int32_t, FilterRuleCtx> queueNumToRuleCtx_;
+    // match chains created under each controller chain, per family since iptables and ip6tables keep their own
+    std::map<std::pair<std::string, TrafficFilterIPFamily>, uint32_t> matchChainCounts_;
 };
 
 } // namespace NetManagerStandard
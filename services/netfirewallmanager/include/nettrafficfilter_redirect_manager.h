@@ -17,14 +17,20 @@
 #define NETTRAFFICFILTER_REDIRECT_MANAGER_H
 
 #include <algorithm>
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <set>
 #include <string>
 #include <map>
+#include <unordered_map>
 #include <vector>
+#include <linux/inet_diag.h>
 #include "netfirewall_common.h"
+#include "nettrafficfilter_iptables_command_builder.h"
 #include "nettrafficfilter_redirector_context.h"
 #include "application_state_observer_stub.h"
 #include "app_mgr_client.h"
@@ -55,8 +61,49 @@ public:
     int32_t GetTrafficFilterGlobalStatus(bool& isEnabled);
     int32_t QueryProcess(const std::string& srcIp, uint16_t srcPort,
         const std::string& dstIp, uint16_t dstPort, uint8_t protocol, uint32_t& uid, uint32_t& pid);
+    int32_t QueryProcesses(const std::vector<TrafficFilterConnectionTuple>& connections,
+        std::vector<TrafficFilterProcessOwner>& owners);
+    void GetDumpMessage(std::string& message);
 
 private:
+    // Binary local endpoint of a socket, port 0 keys the bucket of every socket on that address
+    struct SocketEndpointKey {
+        uint8_t protocol = 0;
+        uint8_t family = 0;
+        uint16_t port = 0;
+        std::array<uint8_t, NETTRAFFICFILTER_IP_ADDRLEN> addr {};
+
+        bool operator==(const SocketEndpointKey& other) const
+        {
+            return protocol == other.protocol && family == other.family && port == other.port &&
+                addr == other.addr;
+        }
+    };
+
+    struct SocketEndpointKeyHash {
+        size_t operator()(const SocketEndpointKey& key) const;
+    };
+
+    // A socket reported by sock_diag, filed under its local endpoint
+    struct SocketDiagEntry {
+        SocketEndpointKey remote;
+        uint64_t cookie = 0;
+    };
+    using SocketCookieMap = std::unordered_map<SocketEndpointKey, std::vector<SocketDiagEntry>, SocketEndpointKeyHash>;
+
+    // Snapshot of the system socket table, indexed by the local endpoint of every socket.
+    // Sockets whose address does not parse are kept in unindexed lists and always scanned.
+    struct SocketOwnerTable {
+        NetPortStatesInfo states;
+        std::unordered_map<SocketEndpointKey, std::vector<size_t>, SocketEndpointKeyHash> index;
+        std::vector<size_t> unindexedTcp;
+        std::vector<size_t> unindexedUdp;
+        // sock_diag cookie of each entry when the table was built, 0 where the socket was not identified
+        std::vector<uint64_t> tcpCookies;
+        std::vector<uint64_t> udpCookies;
+        std::chrono::steady_clock::time_point snapshotTime;
+    };
+
     NetTrafficFilterRedirectManager();
     NetTrafficFilterRedirectManager(const NetTrafficFilterRedirectManager&) = delete;
     NetTrafficFilterRedirectManager& operator=(const NetTrafficFilterRedirectManager&) = delete;
@@ -106,11 +153,17 @@ private:
         const std::string& chainName, const std::vector<TrafficFilterRedirectRule>& oldRules,
         const std::set<TrafficFilterHookPoint>& affectedHookPoints);
 
-    void SortRedirectorList();
-    int32_t UpdateGlobalJumpRules(TrafficFilterHookPoint hookPoint, TrafficFilterIPFamily family);
+    void InsertRedirectorOrdered(const std::string& redirectorId, uint32_t priority);
+    uint32_t GetHookFamilyMask(const std::shared_ptr<NetTrafficFilterRedirectorContext>& redirector) const;
+    void ForgetInstalledJumps(const std::string& chainName, const std::set<TrafficFilterHookPoint>& hookPoints);
+    int32_t CommitJumpRules(NetTrafficFilterIptablesTransaction& transaction);
+    int32_t UpdateGlobalJumpRules(TrafficFilterHookPoint hookPoint, TrafficFilterIPFamily family,
+        NetTrafficFilterIptablesTransaction& transaction);
+    int32_t CollectGlobalJumpRules(TrafficFilterHookPoint hookPoint, NetTrafficFilterIptablesTransaction& transaction);
     std::vector<std::string> GetActiveRedirectorsForHookPoint(TrafficFilterHookPoint hookPoint,
         TrafficFilterIPFamily family) const;
-    int32_t RemoveJumpRulesFromHookPoint(TrafficFilterHookPoint hookPoint, TrafficFilterIPFamily family);
+    int32_t RemoveJumpRulesFromHookPoint(TrafficFilterHookPoint hookPoint, TrafficFilterIPFamily family,
+        const std::vector<std::string>& installedChains, NetTrafficFilterIptablesTransaction& transaction);
     int32_t ApplyRulesToChain(const std::shared_ptr<NetTrafficFilterRedirectorContext>& redirector,
                               const std::string& chainName);
     int32_t AppendRedirectRulesToChain(const std::vector<TrafficFilterRedirectRule>& sortedRules,
@@ -122,15 +175,41 @@ private:
         const std::string& srcIp, uint16_t srcPort, const std::string& dstIp, uint16_t dstPort);
     bool MatchUdpConnection(const UdpNetPortStatesInfo& udpInfo,
         const std::string& srcIp, uint16_t srcPort, const std::string& dstIp, uint16_t dstPort);
+    static bool MakeSocketEndpointKey(uint8_t protocol, const std::string& ip, uint16_t port, SocketEndpointKey& key);
+    static std::shared_ptr<SocketOwnerTable> BuildSocketOwnerTable(NetPortStatesInfo& states,
+        std::chrono::steady_clock::time_point snapshotTime);
+    static void IndexSocket(SocketOwnerTable& table, uint8_t protocol, const std::string& ip, uint16_t port,
+        size_t pos);
+    static void AppendSocketCandidates(const SocketOwnerTable& table, uint8_t protocol, const std::string& ip,
+        uint16_t port, std::vector<size_t>& candidates);
+    int32_t GetSocketOwnerTable(std::chrono::steady_clock::time_point queryTime, bool needFresh,
+        std::shared_ptr<const SocketOwnerTable>& table);
+    bool LookupSocketOwner(const SocketOwnerTable& table, const TrafficFilterConnectionTuple& connection,
+        TrafficFilterProcessOwner& owner, size_t& pos);
+    static void LoadSocketCookies(SocketOwnerTable& table);
+    static bool DumpSocketCookies(int fd, uint8_t protocol, uint8_t family, SocketCookieMap& cookies);
+    static uint64_t FindSocketCookie(const SocketCookieMap& cookies, const SocketEndpointKey& local,
+        const SocketEndpointKey* remote);
+    static bool GetSocketKeys(const SocketOwnerTable& table, bool isTcp, size_t pos, SocketEndpointKey& local,
+        SocketEndpointKey& remote);
+    static bool IsSocketOwnerCurrent(const SocketOwnerTable& table, bool isTcp, size_t pos);
+    static bool SendSocketDiagRequest(int fd, const struct inet_diag_req_v2& req, uint16_t flags);
+    static bool ReceiveSocketDiag(int fd, bool isDump,
+        const std::function<void(const struct inet_diag_msg&)>& onSocket);
 
     std::map<std::string, std::shared_ptr<NetTrafficFilterRedirectorContext>> redirectors_;
     std::map<std::string, std::vector<std::string>> bundleNameToRedirectorsMap_;
     std::vector<std::string> redirectorIdList_;
+    // Redirector chains each hook point currently jumps to, in order. A missing entry is rebuilt in full.
+    std::map<std::pair<TrafficFilterHookPoint, TrafficFilterIPFamily>, std::vector<std::string>> installedJumps_;
     std::atomic<uint32_t> redirectorIdCounter_;
     mutable std::mutex mutex_;
     std::map<int32_t, sptr<TrafficFilterHapObserver>> uidToObserverMap_;
     mutable std::mutex observerMutex_;
     bool isGloballyEnabled_ = true;
+    std::shared_ptr<const SocketOwnerTable> socketTable_;
+    std::mutex socketTableMutex_;
+    std::mutex socketRefreshMutex_;
 };
 
 } // namespace NetManagerStandard
@@ -22,6 +22,7 @@
 #include <string>
 #include <vector>
 #include "netfirewall_common.h"
+#include "nettrafficfilter_latency_histogram.h"
 
 namespace OHOS {
 namespace NetManagerStandard {
@@ -39,6 +40,9 @@ public:
     bool HasRules() const;
     std::set<TrafficFilterHookPoint> GetUsedHookPoints() const;
     int32_t RestoreRules(const std::vector<TrafficFilterRedirectRule>& rules);
+    // Cached bit set of the hook point and family pairs the rules use, dropped whenever the rules change
+    bool GetHookFamilyMask(uint32_t& mask) const;
+    void SetHookFamilyMask(uint32_t mask);
 
     std::string GetRedirectorId() const { return redirectorId_; }
     std::string GetBundleName() const { return bundleName_; }
@@ -53,6 +57,9 @@ public:
         callingUid_ = uid;
         callingPid_ = pid;
     }
+    // Time spent running the iptables commands that apply or clear the rules of this redirector
+    void RecordIptablesTime(uint64_t ns) { iptablesLatency_.Record(ns); }
+    std::string GetIptablesTimeSummary() const { return iptablesLatency_.Summary(); }
 
 private:
     std::string redirectorId_;
@@ -60,10 +67,13 @@ private:
     uint32_t groupId_;
     uint32_t priority_;
     std::vector<TrafficFilterRedirectRule> rules_;
+    bool hookFamilyMaskValid_ = false;
+    uint32_t hookFamilyMask_ = 0;
     mutable std::mutex mutex_;
     bool isPaused_;
     int32_t callingUid_;
     int32_t callingPid_;
+    TrafficFilterLatencyHistogram iptablesLatency_;
 };
 
 } // namespace NetManagerStandard
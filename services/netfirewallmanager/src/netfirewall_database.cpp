@@ -135,6 +135,31 @@ int64_t NetFirewallDataBase::Insert(const OHOS::NativeRdb::ValuesBucket &insertV
 }
 
 
+int64_t NetFirewallDataBase::BatchInsert(const std::vector<OHOS::NativeRdb::ValuesBucket> &insertValues,
+    const std::string tableName)
+{
+    if (store_ == nullptr) {
+        NETMGR_EXT_LOG_E("BatchInsert store_ is nullptr");
+        return FIREWALL_RDB_NO_INIT;
+    }
+    int64_t insertNum = 0;
+    int32_t ret = store_->BatchInsert(insertNum, tableName, insertValues);
+    if (ret == OHOS::NativeRdb::E_SQLITE_CORRUPT) {
+        NETMGR_EXT_LOG_E("BatchInsert error, restore db");
+        if (RestoreDatabase() && store_ != nullptr) {
+            ret = store_->BatchInsert(insertNum, tableName, insertValues);
+        }
+    }
+    if (ret != OHOS::NativeRdb::E_OK) {
+        NETMGR_EXT_LOG_E("BatchInsert ret :%{public}d", ret);
+        return FIREWALL_RDB_EXECUTE_FAILTURE;
+    }
+    if (tableName == FIREWALL_TABLE_NAME) {
+        BackupDatebase();
+    }
+    return insertNum;
+}
+
 int32_t NetFirewallDataBase::Update(const std::string &tableName, int32_t &changedRows,
     const OHOS::NativeRdb::ValuesBucket &values, const std::string &whereClause,
     const std::vector<std::string> &whereArgs)
@@ -13,6 +13,8 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <cinttypes>
 #include <securec.h>
 #include <string>
 
@@ -27,6 +29,7 @@ const std::string DOMAIN_NUM = "domainNum";
 const std::string FUZZY_NUM = "fuzzyDomainNum";
 const std::string SQL_SUM = "SELECT SUM(";
 const std::string SQL_FROM = ") FROM ";
+constexpr int64_t RECORD_AGING_INTERVAL_SEC = 60 * 60;
 }
 
 namespace OHOS {
@@ -209,7 +212,11 @@ int32_t NetFirewallDbHelper::AddFirewallRuleRecord(const NetFirewallRule &rule)
     if (ret < FIREWALL_OK) {
         NETMGR_EXT_LOG_E("AddFirewallRule Insert error: %{public}d", ret);
         (void)firewallDatabase_->RollBack();
+        return ret;
     }
+    NetFirewallRule addedRule = rule;
+    addedRule.ruleId = ret;
+    CacheRule(addedRule);
     return ret;
 }
 
@@ -233,10 +240,7 @@ int32_t NetFirewallDbHelper::CheckIfNeedUpdateEx(const std::string &tableName, b
     GetResultRightRecordEx(resultSet, rules);
     isUpdate = rowCount > 0 && !rules.empty();
     if (!rules.empty()) {
-        oldRule.ruleId = rules[0].ruleId;
-        oldRule.userId = rules[0].userId;
-        oldRule.ruleType = rules[0].ruleType;
-        oldRule.isEnabled = rules[0].isEnabled;
+        oldRule = rules[0];
     }
     return FIREWALL_OK;
 }
@@ -253,6 +257,11 @@ int32_t NetFirewallDbHelper::UpdateFirewallRuleRecord(const NetFirewallRule &rul
     if (ret < FIREWALL_OK) {
         NETMGR_EXT_LOG_E("Update error: %{public}d", ret);
         (void)firewallDatabase_->RollBack();
+        InvalidateRuleCache();
+        return ret;
+    }
+    if (changedRows > 0) {
+        CacheRule(rule);
     }
     return ret;
 }
@@ -530,6 +539,10 @@ int32_t NetFirewallDbHelper::QueryAndGetResult(const NativeRdb::RdbPredicates &r
 
 int32_t NetFirewallDbHelper::QueryAllFirewallRuleRecord(std::vector<NetFirewallRule> &rules)
 {
+    if (EnsureRuleCache()) {
+        CollectCachedRules([](const NetFirewallRule &) { return true; }, rules);
+        return FIREWALL_OK;
+    }
     std::lock_guard<std::mutex> guard(databaseMutex_);
     NETMGR_EXT_LOG_I("Query detail: all user");
     std::vector<std::string> columns;
@@ -540,6 +553,13 @@ int32_t NetFirewallDbHelper::QueryAllFirewallRuleRecord(std::vector<NetFirewallR
 int32_t NetFirewallDbHelper::QueryAllUserEnabledFirewallRules(std::vector<NetFirewallRule> &rules,
     NetFirewallRuleType type)
 {
+    if (EnsureRuleCache()) {
+        bool allType = type == NetFirewallRuleType::RULE_ALL || type == NetFirewallRuleType::RULE_INVALID;
+        CollectCachedRules([type, allType](const NetFirewallRule &rule) {
+            return rule.isEnabled && (allType || rule.ruleType == type);
+        }, rules);
+        return FIREWALL_OK;
+    }
     std::lock_guard<std::mutex> guard(databaseMutex_);
     NETMGR_EXT_LOG_I("Query detail: all user");
     std::vector<std::string> columns;
@@ -555,6 +575,12 @@ int32_t NetFirewallDbHelper::QueryAllUserEnabledFirewallRules(std::vector<NetFir
 int32_t NetFirewallDbHelper::QueryEnabledFirewallRules(int32_t userId, int32_t appUid,
     std::vector<NetFirewallRule> &rules)
 {
+    if (EnsureRuleCache()) {
+        CollectCachedRules([userId, appUid](const NetFirewallRule &rule) {
+            return rule.userId == userId && rule.isEnabled && rule.appUid == appUid;
+        }, rules);
+        return FIREWALL_OK;
+    }
     std::lock_guard<std::mutex> guard(databaseMutex_);
     NETMGR_EXT_LOG_I("QueryEnabledFirewallRules : userId=%{public}d ", userId);
     std::vector<std::string> columns;
@@ -572,6 +598,12 @@ int32_t NetFirewallDbHelper::QueryEnabledFirewallRules(int32_t userId, int32_t a
 int32_t NetFirewallDbHelper::QueryFirewallRuleRecord(int32_t ruleId, int32_t userId,
     std::vector<NetFirewallRule> &rules)
 {
+    if (EnsureRuleCache()) {
+        CollectCachedRules([ruleId, userId](const NetFirewallRule &rule) {
+            return rule.ruleId == ruleId && rule.userId == userId;
+        }, rules);
+        return FIREWALL_OK;
+    }
     std::lock_guard<std::mutex> guard(databaseMutex_);
     NETMGR_EXT_LOG_I("Query detail: ruleId=%{public}d userId=%{public}d", ruleId, userId);
     std::vector<std::string> columns;
@@ -621,7 +653,12 @@ int32_t NetFirewallDbHelper::DeleteFirewallRuleRecord(int32_t userId, int32_t ru
     int32_t ret = DeleteAndNoOtherOperation(whereClause, whereArgs);
     if (ret != FIREWALL_OK) {
         NETMGR_EXT_LOG_E("failed: detale(ruleId): %{public}d", ret);
+        InvalidateRuleCache();
+        return ret;
     }
+    UncacheRules([userId, ruleId](const NetFirewallRule &rule) {
+        return rule.userId == userId && rule.ruleId == ruleId;
+    });
     return ret;
 }
 
@@ -633,7 +670,10 @@ int32_t NetFirewallDbHelper::DeleteFirewallRuleRecordByUserId(int32_t userId)
     int32_t ret = DeleteAndNoOtherOperation(whereClause, whereArgs);
     if (ret != FIREWALL_OK) {
         NETMGR_EXT_LOG_E("failed: detale(ruleId): %{public}d", ret);
+        InvalidateRuleCache();
+        return ret;
     }
+    UncacheRules([userId](const NetFirewallRule &rule) { return rule.userId == userId; });
     return ret;
 }
 
@@ -645,12 +685,24 @@ int32_t NetFirewallDbHelper::DeleteFirewallRuleRecordByAppId(int32_t appUid)
     int32_t ret = DeleteAndNoOtherOperation(whereClause, whereArgs);
     if (ret != FIREWALL_OK) {
         NETMGR_EXT_LOG_E("failed: detale(ruleId): %{public}d", ret);
+        InvalidateRuleCache();
+        return ret;
     }
+    UncacheRules([appUid](const NetFirewallRule &rule) { return rule.appUid == appUid; });
     return ret;
 }
 
 bool NetFirewallDbHelper::IsFirewallRuleExist(int32_t ruleId, NetFirewallRule &oldRule)
 {
+    if (EnsureRuleCache()) {
+        std::shared_lock<std::shared_mutex> lock(ruleCacheMutex_);
+        auto it = ruleCache_.find(ruleId);
+        if (it == ruleCache_.end()) {
+            return false;
+        }
+        oldRule = it->second;
+        return true;
+    }
     std::lock_guard<std::mutex> guard(databaseMutex_);
     bool isExist = false;
     int32_t ret = CheckIfNeedUpdateEx(FIREWALL_TABLE_NAME, isExist, ruleId, oldRule);
@@ -662,6 +714,12 @@ bool NetFirewallDbHelper::IsFirewallRuleExist(int32_t ruleId, NetFirewallRule &o
 
 int32_t NetFirewallDbHelper::QueryFirewallRuleByUserIdCount(int32_t userId, int64_t &rowCount)
 {
+    if (EnsureRuleCache()) {
+        std::shared_lock<std::shared_mutex> lock(ruleCacheMutex_);
+        auto it = userRuleNames_.find(userId);
+        rowCount = it == userRuleNames_.end() ? 0 : static_cast<int64_t>(it->second.size());
+        return FIREWALL_OK;
+    }
     RdbPredicates rdbPredicates(FIREWALL_TABLE_NAME);
     rdbPredicates.BeginWrap()->EqualTo(NET_FIREWALL_USER_ID, std::to_string(userId))->EndWrap();
 
@@ -670,22 +728,59 @@ int32_t NetFirewallDbHelper::QueryFirewallRuleByUserIdCount(int32_t userId, int6
 
 int32_t NetFirewallDbHelper::QueryFirewallRuleAllCount(int64_t &rowCount)
 {
+    if (EnsureRuleCache()) {
+        std::shared_lock<std::shared_mutex> lock(ruleCacheMutex_);
+        rowCount = static_cast<int64_t>(ruleCache_.size());
+        return FIREWALL_OK;
+    }
     RdbPredicates rdbPredicates(FIREWALL_TABLE_NAME);
     return Count(rowCount, rdbPredicates);
 }
 
 int32_t NetFirewallDbHelper::QueryFirewallRuleAllDomainCount()
 {
+    if (EnsureRuleCache()) {
+        std::shared_lock<std::shared_mutex> lock(ruleCacheMutex_);
+        int32_t count = 0;
+        for (const auto &[ruleId, rule] : ruleCache_) {
+            count += static_cast<int32_t>(rule.domains.size());
+        }
+        return count;
+    }
     return QuerySql(SQL_SUM + DOMAIN_NUM + SQL_FROM + FIREWALL_TABLE_NAME);
 }
 
 int32_t NetFirewallDbHelper::QueryFirewallRuleAllFuzzyDomainCount()
 {
+    if (EnsureRuleCache()) {
+        std::shared_lock<std::shared_mutex> lock(ruleCacheMutex_);
+        int32_t count = 0;
+        for (const auto &[ruleId, rule] : ruleCache_) {
+            count += static_cast<int32_t>(std::count_if(rule.domains.begin(), rule.domains.end(),
+                [](const auto &domain) { return domain.isWildcard; }));
+        }
+        return count;
+    }
     return QuerySql(SQL_SUM + FUZZY_NUM + SQL_FROM + FIREWALL_TABLE_NAME);
 }
 
 int32_t NetFirewallDbHelper::QueryFirewallRuleDomainByUserIdCount(int32_t userId)
 {
+    if (EnsureRuleCache()) {
+        std::shared_lock<std::shared_mutex> lock(ruleCacheMutex_);
+        auto it = userRuleNames_.find(userId);
+        if (it == userRuleNames_.end()) {
+            return 0;
+        }
+        int32_t count = 0;
+        for (const auto &[ruleName, ruleId] : it->second) {
+            auto ruleIt = ruleCache_.find(ruleId);
+            if (ruleIt != ruleCache_.end()) {
+                count += static_cast<int32_t>(ruleIt->second.domains.size());
+            }
+        }
+        return count;
+    }
     return QuerySql(SQL_SUM + DOMAIN_NUM + SQL_FROM + FIREWALL_TABLE_NAME + " WHERE (" + NET_FIREWALL_USER_ID + " = " +
         std::to_string(userId) + ")");
 }
@@ -699,6 +794,9 @@ int32_t NetFirewallDbHelper::QueryFirewallRule(const int32_t userId, const sptr<
         return FIREWALL_FAILURE;
     }
     // LCOV_EXCL_STOP
+    if (EnsureRuleCache()) {
+        return QueryCachedFirewallRule(userId, requestParam, info);
+    }
     std::lock_guard<std::mutex> guard(databaseMutex_);
     int64_t rowCount = 0;
     RdbPredicates rdbPredicates(FIREWALL_TABLE_NAME);
@@ -771,6 +869,15 @@ bool NetFirewallDbHelper::IsDnsRuleExist(const sptr<NetFirewallRule> &rule)
     if (rule->ruleType != NetFirewallRuleType::RULE_DNS) {
         return false;
     }
+    if (EnsureRuleCache()) {
+        std::shared_lock<std::shared_mutex> lock(ruleCacheMutex_);
+        return std::any_of(ruleCache_.begin(), ruleCache_.end(), [&rule](const auto &entry) {
+            const NetFirewallRule &cached = entry.second;
+            return cached.userId == rule->userId && cached.ruleType == rule->ruleType &&
+                cached.appUid == rule->appUid && (cached.dns.primaryDns == rule->dns.primaryDns ||
+                cached.dns.standbyDns == rule->dns.standbyDns);
+        });
+    }
     std::lock_guard<std::mutex> guard(databaseMutex_);
     RdbPredicates rdbPredicates(FIREWALL_TABLE_NAME);
     rdbPredicates.BeginWrap()
@@ -798,35 +905,241 @@ bool NetFirewallDbHelper::IsDnsRuleExist(const sptr<NetFirewallRule> &rule)
     return rowCount > 0;
 }
 
-int32_t NetFirewallDbHelper::AddInterceptRecord(const int32_t userId, std::vector<sptr<InterceptRecord>> &records)
+int32_t NetFirewallDbHelper::QueryCachedFirewallRule(const int32_t userId, const sptr<RequestParam> &requestParam,
+    sptr<FirewallRulePage> &info)
+{
+    std::shared_lock<std::shared_mutex> lock(ruleCacheMutex_);
+    auto userIt = userRuleNames_.find(userId);
+    int64_t rowCount = userIt == userRuleNames_.end() ? 0 : static_cast<int64_t>(userIt->second.size());
+    if (rowCount == 0 || requestParam->pageSize == 0) {
+        NETMGR_EXT_LOG_I("QueryFirewallRule: no rule found or pageSize is 0");
+        return FIREWALL_OK;
+    }
+    info->totalPage = rowCount / requestParam->pageSize;
+    int32_t remainder = rowCount % requestParam->pageSize;
+    if (remainder > 0) {
+        info->totalPage += 1;
+    }
+    NETMGR_EXT_LOG_I("QueryFirewallRule: userId=%{public}d page=%{public}d pageSize=%{public}d total=%{public}d",
+        userId, requestParam->page, requestParam->pageSize, info->totalPage);
+    if (info->totalPage < requestParam->page) {
+        return FIREWALL_FAILURE;
+    }
+    int64_t offset = std::max<int64_t>(0, static_cast<int64_t>(requestParam->page - 1) * requestParam->pageSize);
+    const auto &names = userIt->second;
+    auto appendPage = [this, &info, offset, requestParam](auto begin, auto end) {
+        int64_t index = 0;
+        for (auto it = begin; it != end && static_cast<int64_t>(info->data.size()) < requestParam->pageSize; ++it) {
+            if (index++ < offset) {
+                continue;
+            }
+            auto ruleIt = ruleCache_.find(it->second);
+            if (ruleIt != ruleCache_.end()) {
+                info->data.push_back(ruleIt->second);
+            }
+        }
+    };
+    if (requestParam->orderType == NetFirewallOrderType::ORDER_ASC) {
+        appendPage(names.begin(), names.end());
+    } else {
+        appendPage(names.rbegin(), names.rend());
+    }
+    return FIREWALL_OK;
+}
+
+bool NetFirewallDbHelper::EnsureRuleCache()
 {
+    {
+        std::shared_lock<std::shared_mutex> lock(ruleCacheMutex_);
+        if (ruleCacheLoaded_) {
+            return true;
+        }
+    }
     std::lock_guard<std::mutex> guard(databaseMutex_);
-    int32_t ret = firewallDatabase_->BeginTransaction();
-    // Aging by date, record up to 8 days of data
-    std::string whereClause = { "userId = ? AND time < ?" };
-    std::vector<std::string> whereArgs = { std::to_string(userId),
-        std::to_string(records.back()->time - RECORD_MAX_SAVE_TIME) };
+    return LoadRuleCacheLocked();
+}
+
+bool NetFirewallDbHelper::LoadRuleCacheLocked()
+{
+    std::unique_lock<std::shared_mutex> lock(ruleCacheMutex_);
+    if (ruleCacheLoaded_) {
+        return true;
+    }
+    std::vector<std::string> columns;
+    std::vector<NetFirewallRule> rules;
+    RdbPredicates rdbPredicates(FIREWALL_TABLE_NAME);
+    if (QueryFirewallRuleRecord(rdbPredicates, columns, rules) < FIREWALL_OK) {
+        NETMGR_EXT_LOG_E("LoadRuleCache query error");
+        return false;
+    }
+    ruleCache_.clear();
+    userRuleNames_.clear();
+    for (auto &rule : rules) {
+        userRuleNames_[rule.userId].emplace(rule.ruleName, rule.ruleId);
+        int32_t ruleId = rule.ruleId;
+        ruleCache_[ruleId] = std::move(rule);
+    }
+    ruleCacheLoaded_ = true;
+    NETMGR_EXT_LOG_I("LoadRuleCache size=%{public}zu", ruleCache_.size());
+    return true;
+}
+
+void NetFirewallDbHelper::InvalidateRuleCache()
+{
+    std::unique_lock<std::shared_mutex> lock(ruleCacheMutex_);
+    ruleCacheLoaded_ = false;
+    ruleCache_.clear();
+    userRuleNames_.clear();
+}
+
+void NetFirewallDbHelper::EraseCachedRuleName(const NetFirewallRule &rule)
+{
+    auto userIt = userRuleNames_.find(rule.userId);
+    if (userIt == userRuleNames_.end()) {
+        return;
+    }
+    auto range = userIt->second.equal_range(rule.ruleName);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == rule.ruleId) {
+            userIt->second.erase(it);
+            break;
+        }
+    }
+    if (userIt->second.empty()) {
+        userRuleNames_.erase(userIt);
+    }
+}
+
+void NetFirewallDbHelper::CacheRule(const NetFirewallRule &rule)
+{
+    std::unique_lock<std::shared_mutex> lock(ruleCacheMutex_);
+    // Not loaded yet, the first load reads the change back from the database
+    if (!ruleCacheLoaded_) {
+        return;
+    }
+    auto it = ruleCache_.find(rule.ruleId);
+    if (it != ruleCache_.end()) {
+        EraseCachedRuleName(it->second);
+    }
+    NetFirewallRule stored;
+    ToStoredRule(rule, stored);
+    userRuleNames_[stored.userId].emplace(stored.ruleName, stored.ruleId);
+    ruleCache_[stored.ruleId] = std::move(stored);
+}
+
+void NetFirewallDbHelper::UncacheRules(const std::function<bool(const NetFirewallRule &)> &match)
+{
+    std::unique_lock<std::shared_mutex> lock(ruleCacheMutex_);
+    for (auto it = ruleCache_.begin(); it != ruleCache_.end();) {
+        if (!match(it->second)) {
+            ++it;
+            continue;
+        }
+        EraseCachedRuleName(it->second);
+        it = ruleCache_.erase(it);
+    }
+}
+
+void NetFirewallDbHelper::CollectCachedRules(const std::function<bool(const NetFirewallRule &)> &match,
+    std::vector<NetFirewallRule> &rules)
+{
+    std::shared_lock<std::shared_mutex> lock(ruleCacheMutex_);
+    for (const auto &[ruleId, rule] : ruleCache_) {
+        if (match(rule)) {
+            rules.push_back(rule);
+        }
+    }
+}
+
+void NetFirewallDbHelper::ToStoredRule(const NetFirewallRule &rule, NetFirewallRule &stored)
+{
+    // Keep only the columns FillValuesOfFirewallRule writes for the rule type
+    stored.ruleId = rule.ruleId;
+    stored.userId = rule.userId;
+    stored.ruleName = rule.ruleName;
+    stored.ruleDescription = rule.ruleDescription;
+    stored.ruleDirection = rule.ruleDirection;
+    stored.ruleAction = rule.ruleAction;
+    stored.ruleType = rule.ruleType;
+    stored.isEnabled = rule.isEnabled;
+    stored.appUid = rule.appUid;
+    switch (rule.ruleType) {
+        case NetFirewallRuleType::RULE_IP:
+            stored.protocol = rule.protocol;
+            stored.localIps = rule.localIps;
+            stored.remoteIps = rule.remoteIps;
+            stored.localPorts = rule.localPorts;
+            stored.remotePorts = rule.remotePorts;
+            stored.interface = rule.interface;
+            break;
+        case NetFirewallRuleType::RULE_DNS:
+            stored.dns.primaryDns = rule.dns.primaryDns;
+            stored.dns.standbyDns = rule.dns.standbyDns;
+            break;
+        case NetFirewallRuleType::RULE_DOMAIN:
+            stored.domains = rule.domains;
+            break;
+        default:
+            break;
+    }
+}
+
+void NetFirewallDbHelper::AgeInterceptRecordsLocked(const int32_t userId, int64_t nowSec, size_t incoming)
+{
     int32_t changedRows = 0;
-    ret = firewallDatabase_->Delete(INTERCEPT_RECORD_TABLE, changedRows, whereClause, whereArgs);
+    auto countIt = recordCount_.find(userId);
+    // Aging by date, record up to 8 days of data, checked at most once per interval
+    auto agingIt = recordAgingTime_.find(userId);
+    if (agingIt == recordAgingTime_.end() || nowSec - agingIt->second >= RECORD_AGING_INTERVAL_SEC) {
+        std::string whereClause = { "userId = ? AND time < ?" };
+        std::vector<std::string> whereArgs = { std::to_string(userId), std::to_string(nowSec - RECORD_MAX_SAVE_TIME) };
+        if (firewallDatabase_->Delete(INTERCEPT_RECORD_TABLE, changedRows, whereClause, whereArgs) == FIREWALL_OK) {
+            recordAgingTime_[userId] = nowSec;
+            if (countIt != recordCount_.end()) {
+                countIt->second -= changedRows;
+            }
+        }
+    }
+    // The row count is queried once per user and then tracked across inserts and deletes
+    if (countIt == recordCount_.end()) {
+        int64_t currentRows = 0;
+        RdbPredicates rdbPredicates(INTERCEPT_RECORD_TABLE);
+        rdbPredicates.BeginWrap()->EqualTo(NET_FIREWALL_USER_ID, std::to_string(userId))->EndWrap();
+        firewallDatabase_->Count(currentRows, rdbPredicates);
+        countIt = recordCount_.emplace(userId, currentRows).first;
+    }
+    // Aging by number, record up to 1000 pieces of data, the oldest rows have the lowest ids
+    int64_t excess = countIt->second + static_cast<int64_t>(incoming) - RECORD_MAX_DATA_NUM;
+    if (excess <= 0) {
+        return;
+    }
+    std::string whereClause("id in (select id from ");
+    whereClause += INTERCEPT_RECORD_TABLE;
+    whereClause += " where userId = ? order by id limit ? )";
+    std::vector<std::string> whereArgs = { std::to_string(userId), std::to_string(excess) };
+    changedRows = 0;
+    if (firewallDatabase_->Delete(INTERCEPT_RECORD_TABLE, changedRows, whereClause, whereArgs) == FIREWALL_OK) {
+        countIt->second -= changedRows;
+    } else {
+        recordCount_.erase(countIt);
+    }
+}
 
-    int64_t currentRows = 0;
-    RdbPredicates rdbPredicates(INTERCEPT_RECORD_TABLE);
-    rdbPredicates.BeginWrap()->EqualTo(NET_FIREWALL_USER_ID, std::to_string(userId))->EndWrap();
-    firewallDatabase_->Count(currentRows, rdbPredicates);
-    // Aging by number, record up to 1000 pieces of data
-    size_t size = records.size();
-    size_t leftRows = static_cast<size_t>(RECORD_MAX_DATA_NUM - currentRows);
-    if (leftRows < size) {
-        std::string whereClause("id in (select id from ");
-        whereClause += INTERCEPT_RECORD_TABLE;
-        whereClause += " where userId = ? order by id limit ? )";
-        std::vector<std::string> whereArgs = { std::to_string(userId), std::to_string(size - leftRows) };
-        ret = firewallDatabase_->Delete(INTERCEPT_RECORD_TABLE, changedRows, whereClause, whereArgs);
-    }
-    // New data written to the database
-    ValuesBucket values;
-    for (size_t i = 0; i < size; i++) {
-        values.Clear();
+int32_t NetFirewallDbHelper::AddInterceptRecord(const int32_t userId, std::vector<sptr<InterceptRecord>> &records)
+{
+    if (records.empty()) {
+        return FIREWALL_OK;
+    }
+    // Only the newest rows would survive the aging by number
+    size_t first = records.size() > static_cast<size_t>(RECORD_MAX_DATA_NUM) ?
+        records.size() - static_cast<size_t>(RECORD_MAX_DATA_NUM) : 0;
+    std::vector<ValuesBucket> valuesList;
+    valuesList.reserve(records.size() - first);
+    for (size_t i = first; i < records.size(); i++) {
+        if (records[i] == nullptr) {
+            continue;
+        }
+        ValuesBucket values;
         values.PutInt(NET_FIREWALL_USER_ID, userId);
         values.PutInt(NET_FIREWALL_RECORD_TIME, static_cast<int32_t>(records[i]->time / MILLIS_PER_SEC));
         values.PutString(NET_FIREWALL_RECORD_LOCAL_IP, records[i]->localIp);
@@ -836,14 +1149,25 @@ int32_t NetFirewallDbHelper::AddInterceptRecord(const int32_t userId, std::vecto
         values.PutInt(NET_FIREWALL_RECORD_PROTOCOL, static_cast<int32_t>(records[i]->protocol));
         values.PutInt(NET_FIREWALL_RECORD_UID, records[i]->appUid);
         values.PutString(NET_FIREWALL_DOMAIN, records[i]->domain);
-
-        ret = firewallDatabase_->Insert(values, INTERCEPT_RECORD_TABLE);
-        if (ret < FIREWALL_OK) {
-            NETMGR_EXT_LOG_E("AddInterceptRecord error: %{public}d", ret);
-            firewallDatabase_->Commit();
-            return -1;
-        }
+        valuesList.emplace_back(std::move(values));
+    }
+    if (valuesList.empty()) {
+        return FIREWALL_OK;
+    }
+    int64_t nowSec = static_cast<int64_t>(records.back() != nullptr ? records.back()->time / MILLIS_PER_SEC :
+        GetCurrentMilliseconds() / MILLIS_PER_SEC);
+    std::lock_guard<std::mutex> guard(databaseMutex_);
+    firewallDatabase_->BeginTransaction();
+    AgeInterceptRecordsLocked(userId, nowSec, valuesList.size());
+    // New data written to the database with one statement
+    int64_t inserted = firewallDatabase_->BatchInsert(valuesList, INTERCEPT_RECORD_TABLE);
+    if (inserted < FIREWALL_OK) {
+        NETMGR_EXT_LOG_E("AddInterceptRecord error: %{public}" PRId64, inserted);
+        firewallDatabase_->Commit();
+        recordCount_.erase(userId);
+        return -1;
     }
+    recordCount_[userId] += inserted;
     return firewallDatabase_->Commit();
 }
 
@@ -854,6 +1178,7 @@ int32_t NetFirewallDbHelper::DeleteInterceptRecord(const int32_t userId)
     std::vector<std::string> whereArgs = { std::to_string(userId) };
     int32_t changedRows = 0;
     int32_t ret = firewallDatabase_->Delete(INTERCEPT_RECORD_TABLE, changedRows, whereClause, whereArgs);
+    recordCount_.erase(userId);
     if (ret < FIREWALL_OK) {
         NETMGR_EXT_LOG_E("DeleteInterceptRecord error: %{public}d", ret);
         return -1;
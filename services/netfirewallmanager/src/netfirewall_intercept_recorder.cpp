@@ -13,6 +13,8 @@
  * limitations under the License.
  */
 
+#include <cinttypes>
+
 #include "net_manager_constants.h"
 #include "netmgr_ext_log_wrapper.h"
 #include "netfirewall_intercept_recorder.h"
@@ -24,9 +26,71 @@ namespace NetManagerStandard {
 constexpr int32_t RECORD_CACHE_SIZE = 100;
 constexpr int64_t RECORD_TASK_DELAY_TIME_MS = 3 * 60 * 1000;
 constexpr int64_t IPC_FLUSH_INTERVAL_MS = 1000;
+constexpr size_t FLOW_WINDOW_MAX_SIZE = 256;
 
 std::shared_ptr<NetFirewallInterceptRecorder> NetFirewallInterceptRecorder::instance_ = nullptr;
 
+InterceptRecordRing::InterceptRecordRing()
+{
+    for (size_t i = 0; i < INTERCEPT_RECORD_RING_SIZE; i++) {
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool InterceptRecordRing::Push(const sptr<InterceptRecord> &record)
+{
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    Cell *cell = nullptr;
+    while (true) {
+        cell = &cells_[pos & MASK];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
+    cell->record = record;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool InterceptRecordRing::Pop(sptr<InterceptRecord> &record)
+{
+    size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+    Cell *cell = nullptr;
+    while (true) {
+        cell = &cells_[pos & MASK];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+        if (diff == 0) {
+            if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = dequeuePos_.load(std::memory_order_relaxed);
+        }
+    }
+    record = std::move(cell->record);
+    cell->record = nullptr;
+    cell->sequence.store(pos + INTERCEPT_RECORD_RING_SIZE, std::memory_order_release);
+    return true;
+}
+
+size_t InterceptRecordRing::Size() const
+{
+    size_t enqueuePos = enqueuePos_.load(std::memory_order_acquire);
+    size_t dequeuePos = dequeuePos_.load(std::memory_order_acquire);
+    return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+}
+
 std::shared_ptr<NetFirewallInterceptRecorder> NetFirewallInterceptRecorder::GetInstance()
 {
     static std::mutex instanceMutex;
@@ -112,15 +176,20 @@ void NetFirewallInterceptRecorder::SetCurrentUserId(int32_t userId)
 
 int32_t NetFirewallInterceptRecorder::GetRecordCacheSize()
 {
-    std::shared_lock<std::shared_mutex> locker(setRecordMutex_);
-    return recordCache_.size();
+    return static_cast<int32_t>(recordCache_.Size());
 }
 
 void NetFirewallInterceptRecorder::PutRecordCache(sptr<InterceptRecord> record)
 {
-    std::lock_guard<std::shared_mutex> locker(setRecordMutex_);
-    if (record != nullptr) {
-        recordCache_.emplace_back(record);
+    if (record == nullptr) {
+        return;
+    }
+    if (!recordCache_.Push(record)) {
+        uint64_t dropped = ++droppedRecords_;
+        if (dropped % RECORD_CACHE_SIZE != 1) {
+            return;
+        }
+        NETMGR_EXT_LOG_W("PutRecordCache ring full, dropped=%{public}" PRIu64, dropped);
     }
 }
 
@@ -135,9 +204,14 @@ void NetFirewallInterceptRecorder::PutRecordCacheWithoutSkip(sptr<InterceptRecor
 void NetFirewallInterceptRecorder::SyncRecordCache()
 {
     std::lock_guard<std::shared_mutex> locker(setRecordMutex_);
-    if (!recordCache_.empty()) {
-        NetFirewallDbHelper::GetInstance().AddInterceptRecord(currentUserId_, recordCache_);
-        recordCache_.clear();
+    std::vector<sptr<InterceptRecord>> records;
+    records.reserve(recordCache_.Size());
+    sptr<InterceptRecord> record = nullptr;
+    while (recordCache_.Pop(record)) {
+        records.emplace_back(std::move(record));
+    }
+    if (!records.empty()) {
+        NetFirewallDbHelper::GetInstance().AddInterceptRecord(currentUserId_, records);
     }
 }
 
@@ -164,12 +238,54 @@ int32_t NetFirewallInterceptRecorder::UnRegisterInterceptCallback()
     return ret;
 }
 
+size_t InterceptFlowKeyHash::operator()(const InterceptFlowKey &key) const
+{
+    size_t seed = std::hash<std::string>()(key.localIp);
+    auto combine = [&seed](size_t value) {
+        // boost::hash_combine
+        seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    };
+    combine(std::hash<std::string>()(key.remoteIp));
+    combine((static_cast<size_t>(key.localPort) << 16) | key.remotePort);
+    combine(static_cast<size_t>((static_cast<uint64_t>(key.protocol) << 32) ^ static_cast<uint32_t>(key.appUid)));
+    return seed;
+}
+
+void NetFirewallInterceptRecorder::PruneFlowWindows(uint64_t now)
+{
+    const auto intervalMs = static_cast<uint64_t>(INTERCEPT_BUFF_INTERVAL_MS);
+    for (auto it = flowWindows_.begin(); it != flowWindows_.end();) {
+        if (now - it->second.start < intervalMs) {
+            ++it;
+            continue;
+        }
+        if (it->second.hits > 1) {
+            NETMGR_EXT_LOG_I("intercept flow merged: appUid=%{public}d protocol=%{public}u hits=%{public}u",
+                it->first.appUid, it->first.protocol, it->second.hits);
+        }
+        it = flowWindows_.erase(it);
+    }
+    // Still full of live flows, start over rather than grow without bound
+    if (flowWindows_.size() >= FLOW_WINDOW_MAX_SIZE) {
+        flowWindows_.clear();
+    }
+}
+
 bool NetFirewallInterceptRecorder::ShouldSkipNotify(sptr<InterceptRecord> &record)
 {
     if (!record) {
         return true;
     }
     const auto intervalMs = static_cast<decltype(record->time)>(INTERCEPT_BUFF_INTERVAL_MS);
+    std::lock_guard<std::mutex> locker(flowWindowMutex_);
+    InterceptFlowKey key = { record->localIp, record->remoteIp, record->localPort, record->remotePort,
+        record->protocol, record->appUid };
+    auto it = flowWindows_.find(key);
+    if (it != flowWindows_.end() && (record->time - it->second.start) < intervalMs) {
+        it->second.hits++;
+        return true;
+    }
+    // Same flow as the last reported record, e.g. a window that has been pruned
     if (oldRecord_ != nullptr && (record->time - oldRecord_->time) < intervalMs) {
         if (record->localIp == oldRecord_->localIp && record->remoteIp == oldRecord_->remoteIp &&
             record->localPort == oldRecord_->localPort && record->remotePort == oldRecord_->remotePort &&
@@ -177,6 +293,18 @@ bool NetFirewallInterceptRecorder::ShouldSkipNotify(sptr<InterceptRecord> &recor
             return true;
         }
     }
+    if (it != flowWindows_.end()) {
+        if (it->second.hits > 1) {
+            NETMGR_EXT_LOG_I("intercept flow merged: appUid=%{public}d protocol=%{public}u hits=%{public}u",
+                key.appUid, key.protocol, it->second.hits);
+        }
+        it->second = { record->time, 1 };
+    } else {
+        if (flowWindows_.size() >= FLOW_WINDOW_MAX_SIZE) {
+            PruneFlowWindows(record->time);
+        }
+        flowWindows_.emplace(std::move(key), InterceptFlowWindow { record->time, 1 });
+    }
     oldRecord_ = record;
     return false;
 }
@@ -13,6 +13,7 @@
  * limitations under the License.
  */
 
+#include <cstring>
 #include <sys/socket.h>
 #include <sys/types.h>
 
@@ -25,7 +26,7 @@
 #include "netfirewall_default_rule_parser.h"
 #include "netmanager_hitrace.h"
 #include "os_account_manager.h"
-
+#include "parcel.h"
 
 namespace OHOS {
 namespace NetManagerStandard {
@@ -68,9 +69,12 @@ int32_t NetFirewallRuleManager::AddNetFirewallRule(const sptr<NetFirewallRule> &
         } else {
             allUserRule_++;
             UpdateUserRuleSize(rule->userId, true);
+            NetFirewallRule addedRule = *rule;
+            addedRule.ruleId = ruleId;
+            UpdateEnabledRule(addedRule);
         }
     }
-    if (ret == FIREWALL_OK && isNotify && rule->isEnabled) {
+    if (ret == FIREWALL_OK && isNotify && IsRuleVisibleToNative(*rule)) {
         ret = DistributeRulesToNative(rule->ruleType);
     }
     return ret;
@@ -121,9 +125,14 @@ int32_t NetFirewallRuleManager::UpdateNetFirewallRule(const sptr<NetFirewallRule
     if (ret != FIREWALL_SUCCESS) {
         return ret;
     }
+    UpdateEnabledRule(*rule);
     if (oldRule.ruleId <= 0 || (!oldRule.isEnabled && !rule->isEnabled)) {
         return FIREWALL_SUCCESS;
     }
+    if (oldRule.isEnabled && rule->isEnabled && IsSameNativeRule(oldRule, *rule)) {
+        NETMGR_EXT_LOG_I("UpdateNetFirewallRule: native rule not changed, skip distribute");
+        return FIREWALL_SUCCESS;
+    }
     if (oldRule.isEnabled && (rule->ruleType != oldRule.ruleType || !rule->isEnabled)) {
         ret = DistributeRulesToNative(oldRule.ruleType);
     }
@@ -153,10 +162,11 @@ int32_t NetFirewallRuleManager::DeleteNetFirewallRule(const int32_t userId, cons
         return FIREWALL_ERR_INTERNAL;
     }
     allUserRule_--;
+    RemoveEnabledRule(ruleId);
     if (oldRule.ruleId > 0) {
         UpdateUserRuleSize(userId, false);
     }
-    if (oldRule.ruleId <= 0 || !oldRule.isEnabled) {
+    if (oldRule.ruleId <= 0 || !IsRuleVisibleToNative(oldRule)) {
         return FIREWALL_SUCCESS;
     }
     return DistributeRulesToNative(oldRule.ruleType);
@@ -172,6 +182,7 @@ int32_t NetFirewallRuleManager::DeleteNetFirewallRuleByUserId(const int32_t user
         return FIREWALL_ERR_INTERNAL;
     }
     // reset
+    InvalidateEnabledRules();
     allUserRule_ = userRuleSize_.count(userId) ? (allUserRule_ - userRuleSize_.at(userId)) : 0;
     DeleteUserRuleSize(userId);
     return FIREWALL_SUCCESS;
@@ -193,6 +204,7 @@ int32_t NetFirewallRuleManager::DeleteNetFirewallRuleByAppId(const int32_t appUi
     }
     allUserRule_ = 0;
     userRuleSize_.clear();
+    InvalidateEnabledRules();
     bool hasEnabledIpRule = false;
     bool hasEnabledDomainRule = false;
     bool hasEnabledDnsRule = false;
@@ -542,6 +554,8 @@ int32_t NetFirewallRuleManager::OpenOrCloseNativeFirewall(bool isOpen)
         return FIREWALL_SUCCESS;
     }
     NetFirewallPolicyManager::GetInstance().InitNetfirewallPolicy();
+    // full resync from the database
+    InvalidateEnabledRules();
     int32_t ret = SetRulesToNativeByType(NetFirewallRuleType::RULE_ALL);
     SetNetFirewallDumpMessage(ret);
     NetmanagerHiTrace::NetmanagerFinishSyncTrace("OpenOrCloseNativeFirewall");
@@ -568,7 +582,7 @@ int32_t NetFirewallRuleManager::SetRulesToNativeByType(const NetFirewallRuleType
 {
     int32_t ret = FIREWALL_SUCCESS;
     std::vector<NetFirewallRule> rules;
-    GetEnabledNetFirewallRules(rules, type);
+    GetEnabledRulesByType(rules, type);
     switch (type) {
         case NetFirewallRuleType::RULE_IP:
             ret = HandleIpTypeForDistributeRules(rules);
@@ -597,6 +611,85 @@ int32_t NetFirewallRuleManager::SetRulesToNativeByType(const NetFirewallRuleType
     return ret;
 }
 
+int32_t NetFirewallRuleManager::LoadEnabledRules()
+{
+    std::vector<NetFirewallRule> rules;
+    int32_t ret = GetEnabledNetFirewallRules(rules, NetFirewallRuleType::RULE_ALL);
+    if (ret != FIREWALL_SUCCESS) {
+        return ret;
+    }
+    enabledRules_.clear();
+    for (auto &rule : rules) {
+        int32_t ruleId = rule.ruleId;
+        enabledRules_.emplace(ruleId, std::move(rule));
+    }
+    enabledRulesLoaded_ = true;
+    NETMGR_EXT_LOG_I("LoadEnabledRules: size=%{public}zu", enabledRules_.size());
+    return FIREWALL_SUCCESS;
+}
+
+void NetFirewallRuleManager::InvalidateEnabledRules()
+{
+    enabledRules_.clear();
+    enabledRulesLoaded_ = false;
+}
+
+void NetFirewallRuleManager::UpdateEnabledRule(const NetFirewallRule &rule)
+{
+    // Not loaded yet, the next load picks the change up from the database
+    if (!enabledRulesLoaded_) {
+        return;
+    }
+    if (!rule.isEnabled) {
+        enabledRules_.erase(rule.ruleId);
+        return;
+    }
+    enabledRules_[rule.ruleId] = rule;
+}
+
+void NetFirewallRuleManager::RemoveEnabledRule(const int32_t ruleId)
+{
+    enabledRules_.erase(ruleId);
+}
+
+void NetFirewallRuleManager::GetEnabledRulesByType(std::vector<NetFirewallRule> &rules, NetFirewallRuleType type)
+{
+    if (!enabledRulesLoaded_ && LoadEnabledRules() != FIREWALL_SUCCESS) {
+        // fall back to the database query
+        GetEnabledNetFirewallRules(rules, type);
+        return;
+    }
+    for (const auto &[ruleId, rule] : enabledRules_) {
+        if (type == NetFirewallRuleType::RULE_ALL || rule.ruleType == type) {
+            rules.push_back(rule);
+        }
+    }
+}
+
+bool NetFirewallRuleManager::IsRuleVisibleToNative(const NetFirewallRule &rule)
+{
+    // DistributeRulesToNative pushes the enabled rules of every user once any user has the firewall open
+    return rule.isEnabled && NetFirewallPolicyManager::GetInstance().IsFirewallOpen();
+}
+
+bool NetFirewallRuleManager::IsSameNativeRule(const NetFirewallRule &oldRule, const NetFirewallRule &newRule)
+{
+    // Name and description never reach netsys, compare everything else
+    NetFirewallRule compareRule = newRule;
+    compareRule.ruleName = oldRule.ruleName;
+    compareRule.ruleDescription = oldRule.ruleDescription;
+    Parcel oldParcel;
+    Parcel newParcel;
+    if (!oldRule.Marshalling(oldParcel) || !compareRule.Marshalling(newParcel)) {
+        return false;
+    }
+    if (oldParcel.GetDataSize() != newParcel.GetDataSize()) {
+        return false;
+    }
+    return memcmp(reinterpret_cast<const void *>(oldParcel.GetData()),
+        reinterpret_cast<const void *>(newParcel.GetData()), oldParcel.GetDataSize()) == 0;
+}
+
 void NetFirewallRuleManager::UpdateUserRuleSize(const int32_t userId, bool isInc)
 {
     if (!userRuleSize_.count(userId)) {
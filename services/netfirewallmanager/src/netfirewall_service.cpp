@@ -13,6 +13,7 @@
  * limitations under the License.
  */
 
+#include <charconv>
 #include <sys/socket.h>
 #include <sys/types.h>
 
@@ -253,6 +254,9 @@ void NetFirewallService::GetDumpMessage(std::string &message)
     message.append("\n");
     message.append("\tLastRulePushTime: " + GetLastRulePushTime() + "\n");
     message.append("\tLastRulePushResult: " + GetLastRulePushResult() + "\n");
+    NetTrafficFilterRedirectManager::GetInstance().GetDumpMessage(message);
+    message.append("\tRelayedVerdicts: " + relayedVerdictLatency_.Summary() +
+        " failed=" + std::to_string(relayedVerdictFailures_.load()) + "\n");
 }
 
 std::string NetFirewallService::GetServiceState()
@@ -614,6 +618,16 @@ int32_t NetFirewallService::QueryProcess(const std::string& srcIp, uint16_t srcP
     return ret;
 }
 
+int32_t NetFirewallService::QueryProcesses(const std::vector<TrafficFilterConnectionTuple>& connections,
+    std::vector<TrafficFilterProcessOwner>& owners)
+{
+    int32_t ret = NetTrafficFilterRedirectManager::GetInstance().QueryProcesses(connections, owners);
+    if (ret != FIREWALL_SUCCESS) {
+        NETMGR_EXT_LOG_E("QueryProcesses failed, ret: %{public}d", ret);
+    }
+    return ret;
+}
+
 int32_t NetFirewallService::CreatePacketController(uint32_t groupId, uint32_t priority,
     const sptr<TrafficFilterConfig>& config, std::string& packetControllerId, int32_t& fd)
 {
@@ -621,7 +635,12 @@ int32_t NetFirewallService::CreatePacketController(uint32_t groupId, uint32_t pr
     if (bundleName.empty()) {
         return TRAFFICFILTER_ERROR_INVALID_PARAM;
     }
-    int32_t queueNum = NetTrafficFilterNFQueueCore::GetInstance().AllocateQueueNumber(bundleName, groupId);
+    uint32_t queueCount = (config != nullptr && config->queueCount_ > 1) ? config->queueCount_ : 1;
+    if (queueCount > NETTRAFFICFILTER_MAX_QUEUE_COUNT) {
+        return TRAFFICFILTER_ERROR_INVALID_PARAM;
+    }
+    int32_t queueNum = NetTrafficFilterNFQueueCore::GetInstance().AllocateQueueNumber(bundleName, groupId,
+        static_cast<uint16_t>(queueCount));
     if (queueNum == -1) {
         return TRAFFICFILTER_ERROR_GROUP_ID_IN_USE;
     }
@@ -637,6 +656,17 @@ int32_t NetFirewallService::CreatePacketController(uint32_t groupId, uint32_t pr
 }
 
 int32_t NetFirewallService::DestroyPacketController(const std::string& packetControllerId)
+{
+    uint16_t queueNum = 0;
+    int32_t ret = ParseOwnedQueueNumber(packetControllerId, queueNum);
+    if (ret != FIREWALL_SUCCESS) {
+        return ret;
+    }
+    return NetTrafficFilterNFQueueCore::GetInstance().DestroyQueue(queueNum);
+}
+
+// A packet controller id is "<bundleName>:<queueNum>", only the calling bundle may use its own ids
+int32_t NetFirewallService::ParseOwnedQueueNumber(const std::string& packetControllerId, uint16_t& queueNum)
 {
     std::string::size_type pos1 = packetControllerId.find(':');
     if (pos1 == std::string::npos) {
@@ -647,9 +677,54 @@ int32_t NetFirewallService::DestroyPacketController(const std::string& packetCon
     if (bundleName != bundleNameInId) {
         return NETMANAGER_EXT_ERR_INVALID_PARAMETER;
     }
-    std::string queueNumStr = packetControllerId.substr(pos1 + 1);
-    uint32_t queueNum = std::stoi(queueNumStr);
-    return NetTrafficFilterNFQueueCore::GetInstance().DestroyQueue(queueNum);
+    const char *first = packetControllerId.data() + pos1 + 1;
+    const char *last = packetControllerId.data() + packetControllerId.size();
+    auto result = std::from_chars(first, last, queueNum);
+    if (result.ec != std::errc() || result.ptr != last) {
+        NETMGR_EXT_LOG_E("invalid packet controller id %{public}s", packetControllerId.c_str());
+        return NETMANAGER_EXT_ERR_INVALID_PARAMETER;
+    }
+    return FIREWALL_SUCCESS;
+}
+
+int32_t NetFirewallService::GetOwnedQueueInfo(const std::string& packetControllerId, QueueInfo& info)
+{
+    uint16_t queueNum = 0;
+    int32_t ret = ParseOwnedQueueNumber(packetControllerId, queueNum);
+    if (ret != FIREWALL_SUCCESS) {
+        return ret;
+    }
+    info = NetTrafficFilterNFQueueCore::GetInstance().GetQueueInfo(queueNum);
+    if (info.packetControllerId != packetControllerId) {
+        return TRAFFICFILTER_ERROR_NOT_FOUND;
+    }
+    return FIREWALL_SUCCESS;
+}
+
+int32_t NetFirewallService::GetPacketControllerFanoutFds(const std::string& packetControllerId,
+    std::vector<int32_t>& fds)
+{
+    QueueInfo info;
+    int32_t ret = GetOwnedQueueInfo(packetControllerId, info);
+    if (ret != FIREWALL_SUCCESS) {
+        return ret;
+    }
+    fds.clear();
+    for (const auto &fanout : info.fanoutQueues) {
+        fds.push_back(fanout.fd);
+    }
+    return FIREWALL_SUCCESS;
+}
+
+int32_t NetFirewallService::GetPacketControllerFlowMark(const std::string& packetControllerId, uint32_t& flowMark)
+{
+    QueueInfo info;
+    int32_t ret = GetOwnedQueueInfo(packetControllerId, info);
+    if (ret != FIREWALL_SUCCESS) {
+        return ret;
+    }
+    flowMark = info.flowCacheMark;
+    return FIREWALL_SUCCESS;
 }
 
 std::string NetFirewallService::GetBundleName()
@@ -745,12 +820,23 @@ int32_t NetFirewallService::ClearPacketRule(const std::string& controllerId)
 
 int32_t NetFirewallService::SendVerdict(int32_t queueNum, uint32_t packetId, int32_t verdict, int32_t mark)
 {
-    QueueInfo info = NetTrafficFilterNFQueueCore::GetInstance().GetQueueInfo(queueNum);
-    if (info.nfqHandle == nullptr || info.qh == nullptr) {
+    if (queueNum < 0 || queueNum > UINT16_MAX) {
+        NETMGR_EXT_LOG_E("SendVerdict: invalid queueNum=%{public}d", queueNum);
+        return TRAFFICFILTER_ERROR_INVALID_PARAM;
+    }
+    std::shared_ptr<const QueueHandles> handles =
+        NetTrafficFilterNFQueueCore::GetInstance().GetQueueHandles(static_cast<uint16_t>(queueNum));
+    if (handles == nullptr) {
         NETMGR_EXT_LOG_E("SendVerdict: invalid queue info, queueNum=%{public}d", queueNum);
         return TRAFFICFILTER_ERROR_INVALID_PARAM;
     }
-    int32_t ret = NetsysController::GetInstance().NfqPktVerdictMark(info.nfqHandle, info.qh, packetId, verdict, mark);
+    auto start = std::chrono::steady_clock::now();
+    int32_t ret = NetsysController::GetInstance().NfqPktVerdictMark(handles->nfqHandle, handles->qh, packetId,
+        verdict, mark);
+    relayedVerdictLatency_.Record(TrafficFilterLatencyHistogram::ElapsedNs(start));
+    if (ret != 0) {
+        relayedVerdictFailures_++;
+    }
     return ret;
 }
 } // namespace NetManagerStandard
@@ -72,6 +72,8 @@ NetFirewallStub::NetFirewallStub()
         &NetFirewallStub::OnGetTrafficFilterGlobalStatus};
     memberFuncMap_[static_cast<uint32_t>(QUERY_PROCESS)] = {PERMISSION_TRAFFIC_FILTER,
         &NetFirewallStub::OnQueryProcess};
+    memberFuncMap_[static_cast<uint32_t>(QUERY_PROCESSES)] = {PERMISSION_TRAFFIC_FILTER,
+        &NetFirewallStub::OnQueryProcesses};
     memberFuncMap_[static_cast<uint32_t>(CREATE_PACKET_CONTROLLER)] = {PERMISSION_TRAFFIC_FILTER,
         &NetFirewallStub::OnCreatePacketController};
     memberFuncMap_[static_cast<uint32_t>(DESTROY_PACKET_CONTROLLER)] = {PERMISSION_TRAFFIC_FILTER,
@@ -82,6 +84,10 @@ NetFirewallStub::NetFirewallStub()
         &NetFirewallStub::OnClearPacketRule};
     memberFuncMap_[static_cast<uint32_t>(SEND_VERDICT)] = {PERMISSION_TRAFFIC_FILTER,
         &NetFirewallStub::OnSendVerdict};
+    memberFuncMap_[static_cast<uint32_t>(GET_PACKET_CONTROLLER_FANOUT_FDS)] = {PERMISSION_TRAFFIC_FILTER,
+        &NetFirewallStub::OnGetPacketControllerFanoutFds};
+    memberFuncMap_[static_cast<uint32_t>(GET_PACKET_CONTROLLER_FLOW_MARK)] = {PERMISSION_TRAFFIC_FILTER,
+        &NetFirewallStub::OnGetPacketControllerFlowMark};
 }
 
 int32_t NetFirewallStub::CheckFirewallPermission(std::string &strPermission)
@@ -503,6 +509,36 @@ int32_t NetFirewallStub::OnQueryProcess(MessageParcel &data, MessageParcel &repl
     return ret;
 }
 
+int32_t NetFirewallStub::OnQueryProcesses(MessageParcel &data, MessageParcel &reply)
+{
+    uint32_t count = 0;
+    if (!data.ReadUint32(count) || count == 0 || count > NETTRAFFICFILTER_MAX_QUERY_PROCESS_COUNT) {
+        return NETMANAGER_EXT_ERR_READ_DATA_FAIL;
+    }
+    std::vector<TrafficFilterConnectionTuple> connections(count);
+    for (auto &connection : connections) {
+        if (!data.ReadString(connection.srcIp_) || !data.ReadUint16(connection.srcPort_) ||
+            !data.ReadString(connection.dstIp_) || !data.ReadUint16(connection.dstPort_) ||
+            !data.ReadUint8(connection.protocol_)) {
+            return NETMANAGER_EXT_ERR_READ_DATA_FAIL;
+        }
+    }
+    std::vector<TrafficFilterProcessOwner> owners;
+    int32_t ret = QueryProcesses(connections, owners);
+    if (ret == TRAFFICFILTER_OK) {
+        if (!reply.WriteUint32(static_cast<uint32_t>(owners.size()))) {
+            return NETMANAGER_EXT_ERR_WRITE_REPLY_FAIL;
+        }
+        for (const auto &owner : owners) {
+            if (!reply.WriteInt32(owner.result_) || !reply.WriteUint32(owner.uid_) || !reply.WriteUint32(owner.pid_)) {
+                NETMGR_EXT_LOG_E("Write process owner failed");
+                return NETMANAGER_EXT_ERR_WRITE_REPLY_FAIL;
+            }
+        }
+    }
+    return ret;
+}
+
 int32_t NetFirewallStub::OnCreatePacketController(MessageParcel &data, MessageParcel &reply)
 {
     uint32_t groupId;
@@ -546,6 +582,41 @@ int32_t NetFirewallStub::OnDestroyPacketController(MessageParcel &data, MessageP
     return DestroyPacketController(packetControllerId);
 }
 
+int32_t NetFirewallStub::OnGetPacketControllerFanoutFds(MessageParcel &data, MessageParcel &reply)
+{
+    std::string packetControllerId;
+    if (!data.ReadString(packetControllerId)) {
+        return NETMANAGER_EXT_ERR_READ_DATA_FAIL;
+    }
+    std::vector<int32_t> fds;
+    int32_t ret = GetPacketControllerFanoutFds(packetControllerId, fds);
+    if (ret == FIREWALL_SUCCESS) {
+        if (!reply.WriteUint32(static_cast<uint32_t>(fds.size()))) {
+            return NETMANAGER_EXT_ERR_WRITE_REPLY_FAIL;
+        }
+        for (int32_t fd : fds) {
+            if (!reply.WriteFileDescriptor(fd)) {
+                return NETMANAGER_EXT_ERR_WRITE_REPLY_FAIL;
+            }
+        }
+    }
+    return ret;
+}
+
+int32_t NetFirewallStub::OnGetPacketControllerFlowMark(MessageParcel &data, MessageParcel &reply)
+{
+    std::string packetControllerId;
+    if (!data.ReadString(packetControllerId)) {
+        return NETMANAGER_EXT_ERR_READ_DATA_FAIL;
+    }
+    uint32_t flowMark = 0;
+    int32_t ret = GetPacketControllerFlowMark(packetControllerId, flowMark);
+    if (ret == FIREWALL_SUCCESS && !reply.WriteUint32(flowMark)) {
+        return NETMANAGER_EXT_ERR_WRITE_REPLY_FAIL;
+    }
+    return ret;
+}
+
 int32_t NetFirewallStub::OnAddPacketRule(MessageParcel &data, MessageParcel &reply)
 {
     std::string controllerId;
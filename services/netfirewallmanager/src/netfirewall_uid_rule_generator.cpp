@@ -348,12 +348,13 @@ int32_t UidRuleGenerator::GenerateCreateMangleRulesCommands(
 std::string UidRuleGenerator::BuildInputCtmarkRule(
     const std::string& chainName,
     int32_t queueNum,
-    uint32_t markValue)
+    uint32_t markValue,
+    uint16_t queueCount)
 {
     std::ostringstream rule;
     rule << "-t filter -A " << chainName
          << " " << GenerateCTMarkMatchParam(markValue);
-    rule << " -j NFQUEUE --queue-num " << queueNum;
+    rule << " -j " << NetTrafficFilterIptablesCommandBuilder::BuildNfqueueTarget(queueNum, queueCount);
     return rule.str();
 }
 
@@ -422,7 +423,7 @@ int32_t UidRuleGenerator::RestoreInputUidRule(int32_t queueNum, TrafficFilterIPF
     if (!ctx->hasInputRule) {
         return TRAFFICFILTER_OK;
     }
-    std::string filterCmd = BuildInputCtmarkRule(info.chainNameIn, queueNum, ctx->ctMarkValue);
+    std::string filterCmd = BuildInputCtmarkRule(info.chainNameIn, queueNum, ctx->ctMarkValue, info.queueCount);
     int32_t ret = NetTrafficFilterIptablesCommandBuilder::ExecuteIptablesCommand(filterCmd, family);
     if (ret != TRAFFICFILTER_OK) {
         return TRAFFICFILTER_ERROR_INVALID_PARAM;
@@ -457,7 +458,7 @@ int32_t UidRuleGenerator::HandleInputUidRule(
         ctx->ctMarkValue = markValue;
         isNewContext = true;
     }
-    std::string filterCmd = BuildInputCtmarkRule(info.chainNameIn, queueNum, markValue);
+    std::string filterCmd = BuildInputCtmarkRule(info.chainNameIn, queueNum, markValue, info.queueCount);
     ret = ExecuteCmd(filterCmd);
     if (ret != TRAFFICFILTER_OK) {
         if (isNewContext) {
@@ -16,7 +16,9 @@
 #include "nettrafficfilter_iptables_command_builder.h"
 #include "netmgr_ext_log_wrapper.h"
 #include "netsys_controller.h"
+#include <algorithm>
 #include <arpa/inet.h>
+#include <iomanip>
 #include <sstream>
 #include <securec.h>
 
@@ -26,6 +28,12 @@ const std::string DNAT_TARGET = "DNAT";
 constexpr uint32_t UID_UNSPEC = static_cast<uint32_t>(-1);
 constexpr uint32_t PORT_MAX = 65535;
 constexpr uint32_t DEFAULT_IPTABLE_LEN = 128;
+constexpr uint32_t MAX_MULTIPORT = 15;
+// xtables keeps chain names in 29 bytes including the terminating NUL
+constexpr size_t MAX_CHAIN_NAME_LEN = 28;
+constexpr uint32_t FNV_OFFSET_BASIS = 2166136261U;
+constexpr uint32_t FNV_PRIME = 16777619U;
+constexpr int CHAIN_HASH_WIDTH = 8;
 
 static const char* GetTcpFlagName(uint8_t bit)
 {
@@ -58,6 +66,8 @@ constexpr uint8_t BIT_SHIFT_STEP = 1;
 static constexpr const char* FILTER_TABLE_APPEND = "-t filter -A ";
 static constexpr const char* TARGET_JUMP_PREFIX = " -j ";
 static constexpr const char* NFQUEUE_ACTION_PREFIX = "NFQUEUE --queue-num ";
+static constexpr const char* NFQUEUE_BALANCE_PREFIX = "NFQUEUE --queue-balance ";
+static constexpr const char* NFQUEUE_CPU_FANOUT = " --queue-cpu-fanout";
 static constexpr const char* RETURN_TARGET = "RETURN";
 static constexpr const char* TCP_FLAGS_MATCH_PREFIX = " -m tcp --tcp-flags ";
 static constexpr const char* CONNTRACK_MATCH_PREFIX = " -m conntrack --ctstate ";
@@ -68,11 +78,6 @@ static constexpr const char* PROTO_PREFIX = " -p ";
 static constexpr const char* OWNER_MATCH_PREFIX = " -m owner --uid-owner ";
 static constexpr const char* UID_RANGE_SEPARATOR = "-";
 
-static std::string BuildNfqueueAction(int32_t queueNum)
-{
-    return std::string(NFQUEUE_ACTION_PREFIX) + std::to_string(queueNum);
-}
-
 static std::string FormatBitMask(uint8_t mask, const char* (*getBitName)(uint8_t))
 {
     std::string result;
@@ -527,11 +532,168 @@ int32_t NetTrafficFilterIptablesCommandBuilder::ExecuteIptablesCommand(
     return 0;
 }
 
+NetTrafficFilterIptablesTransaction::NetTrafficFilterIptablesTransaction()
+    : executor_(NetTrafficFilterIptablesCommandBuilder::ExecuteIptablesCommand)
+{
+}
+
+NetTrafficFilterIptablesTransaction::NetTrafficFilterIptablesTransaction(Executor executor)
+    : executor_(std::move(executor))
+{
+}
+
+void NetTrafficFilterIptablesTransaction::BeginGroup()
+{
+    group_++;
+}
+
+void NetTrafficFilterIptablesTransaction::Add(const std::string& command, TrafficFilterIPFamily family,
+    bool ignoreError, const std::string& undoCommand)
+{
+    if (command.empty()) {
+        return;
+    }
+    if (family != TrafficFilterIPFamily::IP_FAMILY_V6) {
+        v4Entries_.push_back({command, ignoreError, undoCommand, group_});
+    }
+    if (family != TrafficFilterIPFamily::IP_FAMILY_V4) {
+        v6Entries_.push_back({command, ignoreError, undoCommand, group_});
+    }
+}
+
+bool NetTrafficFilterIptablesTransaction::Empty() const
+{
+    return v4Entries_.empty() && v6Entries_.empty();
+}
+
+int32_t NetTrafficFilterIptablesTransaction::Execute(const Entry& entry, TrafficFilterIPFamily family,
+    std::vector<AppliedEntry>& applied)
+{
+    int32_t ret = executor_(entry.command, family);
+    if (ret == TRAFFICFILTER_OK) {
+        applied.push_back({&entry, family});
+    } else if (entry.ignoreError) {
+        // nothing was changed, so there is nothing to undo either
+        return TRAFFICFILTER_OK;
+    }
+    return ret;
+}
+
+void NetTrafficFilterIptablesTransaction::Undo(const std::vector<AppliedEntry>& applied)
+{
+    for (auto it = applied.rbegin(); it != applied.rend(); ++it) {
+        if (it->entry->undoCommand.empty()) {
+            continue;
+        }
+        if (executor_(it->entry->undoCommand, it->family) != TRAFFICFILTER_OK) {
+            NETMGR_EXT_LOG_E("Failed to undo iptables command: %{private}s", it->entry->command.c_str());
+        }
+    }
+}
+
+int32_t NetTrafficFilterIptablesTransaction::CommitGroup(const std::vector<Entry>& v4Entries, size_t& v4Pos,
+    const std::vector<Entry>& v6Entries, size_t& v6Pos)
+{
+    size_t group = (v4Pos < v4Entries.size() && (v6Pos == v6Entries.size() ||
+        v4Entries[v4Pos].group <= v6Entries[v6Pos].group)) ? v4Entries[v4Pos].group : v6Entries[v6Pos].group;
+    size_t v4End = v4Pos;
+    while (v4End < v4Entries.size() && v4Entries[v4End].group == group) {
+        v4End++;
+    }
+    size_t v6End = v6Pos;
+    while (v6End < v6Entries.size() && v6Entries[v6End].group == group) {
+        v6End++;
+    }
+    std::vector<AppliedEntry> applied;
+    int32_t ret = TRAFFICFILTER_OK;
+    while (ret == TRAFFICFILTER_OK && (v4Pos < v4End || v6Pos < v6End)) {
+        if (v4Pos < v4End && v6Pos < v6End && v4Entries[v4Pos] == v6Entries[v6Pos]) {
+            ret = Execute(v4Entries[v4Pos++], TrafficFilterIPFamily::IP_FAMILY_V4V6, applied);
+            v6Pos++;
+        } else if (v4Pos < v4End && (v6Pos == v6End || std::find(v6Entries.begin() +
+            static_cast<std::ptrdiff_t>(v6Pos), v6Entries.begin() + static_cast<std::ptrdiff_t>(v6End),
+            v4Entries[v4Pos]) == v6Entries.begin() + static_cast<std::ptrdiff_t>(v6End))) {
+            // the IPv4 step has no IPv6 counterpart left, run it on its own
+            ret = Execute(v4Entries[v4Pos++], TrafficFilterIPFamily::IP_FAMILY_V4, applied);
+        } else {
+            ret = Execute(v6Entries[v6Pos++], TrafficFilterIPFamily::IP_FAMILY_V6, applied);
+        }
+    }
+    if (ret != TRAFFICFILTER_OK) {
+        NETMGR_EXT_LOG_W("iptables transaction step failed, undoing %{public}zu steps", applied.size());
+        Undo(applied);
+    }
+    v4Pos = v4End;
+    v6Pos = v6End;
+    return ret;
+}
+
+int32_t NetTrafficFilterIptablesTransaction::Commit()
+{
+    std::vector<Entry> v4Entries = std::move(v4Entries_);
+    std::vector<Entry> v6Entries = std::move(v6Entries_);
+    v4Entries_.clear();
+    v6Entries_.clear();
+    size_t v4Pos = 0;
+    size_t v6Pos = 0;
+    int32_t result = TRAFFICFILTER_OK;
+    while (v4Pos < v4Entries.size() || v6Pos < v6Entries.size()) {
+        int32_t ret = CommitGroup(v4Entries, v4Pos, v6Entries, v6Pos);
+        if (result == TRAFFICFILTER_OK) {
+            result = ret;
+        }
+    }
+    return result;
+}
+
+std::string NetTrafficFilterIptablesCommandBuilder::BuildNfqueueTarget(int32_t queueNum, uint16_t queueCount)
+{
+    if (queueCount <= 1) {
+        return std::string(NFQUEUE_ACTION_PREFIX) + std::to_string(queueNum);
+    }
+    // the kernel spreads flows over queueNum..queueNum+queueCount-1, picking the queue of the receiving CPU
+    return std::string(NFQUEUE_BALANCE_PREFIX) + std::to_string(queueNum) + ":" +
+        std::to_string(queueNum + queueCount - 1) + NFQUEUE_CPU_FANOUT;
+}
+
+/*
+ * Connections whose conntrack mark carries the controller's flow cache slot were already decided by its
+ * callback, so they are accepted or dropped here instead of being queued again.
+ */
+std::vector<std::string> NetTrafficFilterIptablesCommandBuilder::BuildFlowCacheCommands(
+    const std::string& chainName, uint32_t flowCacheMark)
+{
+    std::vector<std::string> commands;
+    if (chainName.empty() || flowCacheMark == 0) {
+        return commands;
+    }
+    auto buildCommand = [&chainName](uint32_t mark, const char* target) {
+        std::ostringstream cmd;
+        cmd << FILTER_TABLE_APPEND << chainName << " -m connmark --mark 0x" << std::hex << mark << "/0x"
+            << NETTRAFFICFILTER_FLOW_CACHE_MASK << TARGET_JUMP_PREFIX << target;
+        return cmd.str();
+    };
+    commands.push_back(buildCommand(flowCacheMark, "ACCEPT"));
+    commands.push_back(buildCommand(flowCacheMark | NETTRAFFICFILTER_FLOW_CACHE_DROP, "DROP"));
+    return commands;
+}
+
+// Queues every packet reaching the chain, the rules are then matched by the controller in user space
+std::string NetTrafficFilterIptablesCommandBuilder::BuildPacketQueueAllCommand(
+    const std::string& chainName, int32_t queueNum, uint16_t queueCount)
+{
+    if (chainName.empty()) {
+        return "";
+    }
+    return std::string(FILTER_TABLE_APPEND) + chainName + TARGET_JUMP_PREFIX +
+        BuildNfqueueTarget(queueNum, queueCount);
+}
+
 std::string NetTrafficFilterIptablesCommandBuilder::BuildPacketFilterCommand(
-    const TrafficFilterPacketRule& rule, const std::string& chainName, int32_t queueNum)
+    const TrafficFilterPacketRule& rule, const std::string& chainName, int32_t queueNum, uint16_t queueCount)
 {
     return BuildPacketFilterCommand(rule, rule.srcIp_, rule.dstIp_, rule.srcPort_, rule.dstPort_, chainName,
-        BuildNfqueueAction(queueNum));
+        BuildNfqueueTarget(queueNum, queueCount));
 }
 
 std::string NetTrafficFilterIptablesCommandBuilder::BuildPacketFilterCommand(
@@ -539,7 +701,7 @@ std::string NetTrafficFilterIptablesCommandBuilder::BuildPacketFilterCommand(
     const TrafficFilterPortMatch& dstPort, const std::string& chainName, int32_t queueNum)
 {
     return BuildPacketFilterCommand(rule, rule.srcIp_, rule.dstIp_, srcPort, dstPort, chainName,
-        BuildNfqueueAction(queueNum));
+        BuildNfqueueTarget(queueNum));
 }
 
 std::string NetTrafficFilterIptablesCommandBuilder::BuildPacketFilterCommand(
@@ -676,10 +838,23 @@ static TrafficFilterIPMatch GetDefaultIPMatch(const TrafficFilterIPMatch& ipMatc
     return IsMultiIPMatch(ipMatch) ? TrafficFilterIPMatch() : ipMatch;
 }
 
+static void AppendPacketFilterForAllIPs(std::vector<std::string>& commands,
+    const TrafficFilterPacketRule& rule, const std::vector<TrafficFilterIPMatch>& srcIps,
+    const std::vector<TrafficFilterIPMatch>& dstIps, const std::vector<TrafficFilterPortMatch>& srcPortSplits,
+    const std::vector<TrafficFilterPortMatch>& dstPortSplits, const std::string& chainName,
+    const std::string& action)
+{
+    for (const auto& srcIp : srcIps) {
+        for (const auto& dstIp : dstIps) {
+            AppendPacketFilterForAllPorts(commands, rule, srcIp, dstIp, srcPortSplits, dstPortSplits, chainName,
+                action);
+        }
+    }
+}
+
 std::vector<std::string> NetTrafficFilterIptablesCommandBuilder::BuildPacketFilterCommands(
-    const TrafficFilterPacketRule& rule, const std::string& chainName, int32_t queueNum)
+    const TrafficFilterPacketRule& rule, const std::string& chainName, int32_t queueNum, uint16_t queueCount)
 {
-    constexpr uint32_t MAX_MULTIPORT = 15;
     std::vector<std::string> commands;
     auto srcPortSplits = SplitPortMatch(rule.srcPort_, MAX_MULTIPORT);
     auto dstPortSplits = SplitPortMatch(rule.dstPort_, MAX_MULTIPORT);
@@ -693,17 +868,13 @@ std::vector<std::string> NetTrafficFilterIptablesCommandBuilder::BuildPacketFilt
     auto appendAll = [&](const std::vector<TrafficFilterIPMatch>& srcIps,
                          const std::vector<TrafficFilterIPMatch>& dstIps,
                          const std::string& action) {
-        for (const auto& srcIp : srcIps) {
-            for (const auto& dstIp : dstIps) {
-                AppendPacketFilterForAllPorts(commands, rule, srcIp, dstIp,
-                    srcPortSplits, dstPortSplits, chainName, action);
-            }
-        }
+        AppendPacketFilterForAllIPs(commands, rule, srcIps, dstIps, srcPortSplits, dstPortSplits, chainName,
+            action);
     };
 
     appendAll(srcBlock, dstTarget, RETURN_TARGET);
     appendAll(srcTarget, dstBlock, RETURN_TARGET);
-    appendAll(srcTarget, dstTarget, BuildNfqueueAction(queueNum));
+    appendAll(srcTarget, dstTarget, BuildNfqueueTarget(queueNum, queueCount));
 
     if (srcNonInvMulti || dstNonInvMulti) {
         appendAll(std::vector<TrafficFilterIPMatch>{GetDefaultIPMatch(rule.srcIp_)},
@@ -712,5 +883,121 @@ std::vector<std::string> NetTrafficFilterIptablesCommandBuilder::BuildPacketFilt
 
     return commands;
 }
+
+struct PacketMatchOptions {
+    std::vector<TrafficFilterIPMatch> srcIps;
+    std::vector<TrafficFilterIPMatch> dstIps;
+    std::vector<TrafficFilterPortMatch> srcPorts;
+    std::vector<TrafficFilterPortMatch> dstPorts;
+};
+
+// One value of a match chain, the dimensions the chain does not check are left to match anything
+struct PacketMatchValue {
+    TrafficFilterIPMatch srcIp = TrafficFilterIPMatch();
+    TrafficFilterIPMatch dstIp = TrafficFilterIPMatch();
+    TrafficFilterPortMatch srcPort = TrafficFilterPortMatch();
+    TrafficFilterPortMatch dstPort = TrafficFilterPortMatch();
+};
+
+static void AppendMatchChainCommands(PacketFilterCommands& result, const TrafficFilterPacketRule& rule,
+    const std::string& chainName, uint32_t firstMatchChain, const PacketMatchOptions& options,
+    const std::string& queueTarget)
+{
+    PacketMatchValue shared;
+    std::vector<std::vector<PacketMatchValue>> stages;
+    auto addDimension = [&shared, &stages](const auto& values, auto member) {
+        if (values.size() == 1) {
+            shared.*member = values.front();
+            return;
+        }
+        std::vector<PacketMatchValue> stage(values.size());
+        for (size_t i = 0; i < values.size(); ++i) {
+            stage[i].*member = values[i];
+        }
+        stages.push_back(std::move(stage));
+    };
+    addDimension(options.srcIps, &PacketMatchValue::srcIp);
+    addDimension(options.dstIps, &PacketMatchValue::dstIp);
+    addDimension(options.srcPorts, &PacketMatchValue::srcPort);
+    addDimension(options.dstPorts, &PacketMatchValue::dstPort);
+
+    // a match chain only checks its own list, the port matches still need the protocol of the rule
+    TrafficFilterPacketRule stageRule{};
+    bool needTcp = (rule.protocol_ == NETTRAFFICFILTER_PROTO_TCP) ||
+                   (rule.protocol_ == NETTRAFFICFILTER_PROTO_ANY && rule.tcpFlagsMatch_.enable_);
+    stageRule.protocol_ = needTcp ? NETTRAFFICFILTER_PROTO_TCP : rule.protocol_;
+    for (size_t i = 0; i < stages.size(); ++i) {
+        result.matchChains.push_back(NetTrafficFilterIptablesCommandBuilder::GenerateMatchChainName(chainName,
+            firstMatchChain + static_cast<uint32_t>(i)));
+    }
+    // fill the chains from the last one so a chain is complete before anything jumps to it
+    for (size_t i = stages.size(); i > 0; --i) {
+        const std::string& target = (i == stages.size()) ? queueTarget : result.matchChains[i];
+        for (const auto& value : stages[i - 1]) {
+            result.commands.push_back(NetTrafficFilterIptablesCommandBuilder::BuildPacketFilterCommand(stageRule,
+                value.srcIp, value.dstIp, value.srcPort, value.dstPort, result.matchChains[i - 1], target));
+        }
+    }
+    result.commands.push_back(NetTrafficFilterIptablesCommandBuilder::BuildPacketFilterCommand(rule, shared.srcIp,
+        shared.dstIp, shared.srcPort, shared.dstPort, chainName, result.matchChains.front()));
+}
+
+/*
+ * Appends the index to the controller chain name. A name that would not fit iptables keeps the start of the
+ * controller chain name and a hash of all of it, so match chains of different controller chains stay apart.
+ */
+std::string NetTrafficFilterIptablesCommandBuilder::GenerateMatchChainName(const std::string& chainName,
+    uint32_t index)
+{
+    std::string indexSuffix = "_" + std::to_string(index);
+    if (chainName.size() + indexSuffix.size() <= MAX_CHAIN_NAME_LEN) {
+        return chainName + indexSuffix;
+    }
+    uint32_t hash = FNV_OFFSET_BASIS;
+    for (unsigned char c : chainName) {
+        hash = (hash ^ c) * FNV_PRIME;
+    }
+    std::ostringstream suffix;
+    suffix << "_" << std::hex << std::setw(CHAIN_HASH_WIDTH) << std::setfill('0') << hash << indexSuffix;
+    return chainName.substr(0, MAX_CHAIN_NAME_LEN - suffix.str().size()) + suffix.str();
+}
+
+/*
+ * Same terms as BuildPacketFilterCommands, but a queue term that would expand into several commands is installed
+ * as one jump carrying the conditions all of them share. Every multi-valued address or port list then gets a match
+ * chain holding one rule per value that jumps on to the next list, so a packet is compared against the sum of the
+ * list lengths instead of their product and a packet missing the shared conditions costs a single comparison.
+ * RETURN terms stay in the controller chain, a RETURN inside a match chain would only leave the match chain.
+ */
+PacketFilterCommands NetTrafficFilterIptablesCommandBuilder::BuildPacketFilterChainCommands(
+    const TrafficFilterPacketRule& rule, const std::string& chainName, uint32_t firstMatchChain, int32_t queueNum,
+    uint16_t queueCount)
+{
+    PacketFilterCommands result;
+    auto srcPortSplits = SplitPortMatch(rule.srcPort_, MAX_MULTIPORT);
+    auto dstPortSplits = SplitPortMatch(rule.dstPort_, MAX_MULTIPORT);
+    auto srcTarget = GetTargetIPOptions(rule.srcIp_);
+    auto dstTarget = GetTargetIPOptions(rule.dstIp_);
+    std::string queueTarget = BuildNfqueueTarget(queueNum, queueCount);
+    size_t expansion = srcTarget.size() * dstTarget.size() * srcPortSplits.size() * dstPortSplits.size();
+
+    AppendPacketFilterForAllIPs(result.commands, rule, GetBlockIPOptions(rule.srcIp_), dstTarget, srcPortSplits,
+        dstPortSplits, chainName, RETURN_TARGET);
+    AppendPacketFilterForAllIPs(result.commands, rule, srcTarget, GetBlockIPOptions(rule.dstIp_), srcPortSplits,
+        dstPortSplits, chainName, RETURN_TARGET);
+    if (expansion <= 1) {
+        AppendPacketFilterForAllIPs(result.commands, rule, srcTarget, dstTarget, srcPortSplits, dstPortSplits,
+            chainName, queueTarget);
+    } else {
+        PacketMatchOptions options{srcTarget, dstTarget, srcPortSplits, dstPortSplits};
+        AppendMatchChainCommands(result, rule, chainName, firstMatchChain, options, queueTarget);
+    }
+
+    if ((IsMultiIPMatch(rule.srcIp_) && !rule.srcIp_.invert_) || (IsMultiIPMatch(rule.dstIp_) && !rule.dstIp_.invert_)) {
+        AppendPacketFilterForAllIPs(result.commands, rule, {GetDefaultIPMatch(rule.srcIp_)},
+            {GetDefaultIPMatch(rule.dstIp_)}, srcPortSplits, dstPortSplits, chainName, RETURN_TARGET);
+    }
+    return result;
+}
 } // namespace NetManagerStandard
 } // namespace OHOS
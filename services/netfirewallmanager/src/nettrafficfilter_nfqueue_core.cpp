@@ -38,6 +38,9 @@ NetTrafficFilterNFQueueCore::NetTrafficFilterNFQueueCore() {}
 NetTrafficFilterNFQueueCore::~NetTrafficFilterNFQueueCore()
 {
     Cleanup();
+    for (auto &chunk : queueSlotChunks_) {
+        delete chunk.exchange(nullptr);
+    }
 }
 
 NetTrafficFilterNFQueueCore &NetTrafficFilterNFQueueCore::GetInstance()
@@ -46,23 +49,9 @@ NetTrafficFilterNFQueueCore &NetTrafficFilterNFQueueCore::GetInstance()
     return instance;
 }
 
-OHOS::sptr<NfqCtx> NetTrafficFilterNFQueueCore::GetNFQHandleFromBundleName(const std::string &bundleName)
-{
-    for (const auto it : queues_) {
-        if (it.second.bundleName == bundleName) {
-            return it.second.nfqHandle;
-        }
-    }
-    return nullptr;
-}
-
-OHOS::sptr<NfqCtx> NetTrafficFilterNFQueueCore::CreateNFQHandle(const std::string &bundleName)
+OHOS::sptr<NfqCtx> NetTrafficFilterNFQueueCore::OpenNFQHandle()
 {
-    OHOS::sptr<NfqCtx> nfqHandle = GetNFQHandleFromBundleName(bundleName);
-    if (nfqHandle != nullptr) {
-        return nfqHandle;
-    }
-    nfqHandle = NetsysController::GetInstance().NfqOpen();
+    OHOS::sptr<NfqCtx> nfqHandle = NetsysController::GetInstance().NfqOpen();
     if (nfqHandle == nullptr) {
         return nullptr;
     }
@@ -82,7 +71,23 @@ OHOS::sptr<NfqCtx> NetTrafficFilterNFQueueCore::CreateNFQHandle(const std::strin
     return nfqHandle;
 }
 
-int32_t NetTrafficFilterNFQueueCore::AllocateQueueNumber(const std::string &bundleName, uint32_t groupId)
+bool NetTrafficFilterNFQueueCore::IsQueueNumberInUse(uint16_t queueNum)
+{
+    if (queues_.find(queueNum) != queues_.end()) {
+        return true;
+    }
+    for (const auto &pair : queues_) {
+        for (const auto &fanout : pair.second.fanoutQueues) {
+            if (fanout.queueNum == queueNum) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+int32_t NetTrafficFilterNFQueueCore::AllocateQueueNumber(const std::string &bundleName, uint32_t groupId,
+    uint16_t queueCount)
 {
     std::lock_guard<std::mutex> lock(mutex_);
     for (const auto it : queues_) {
@@ -90,9 +95,24 @@ int32_t NetTrafficFilterNFQueueCore::AllocateQueueNumber(const std::string &bund
             return -1;
         }
     }
+    if (queueCount == 0 || queueCount > NETTRAFFICFILTER_MAX_QUEUE_COUNT) {
+        return -1;
+    }
+    // fan-out queues use the consecutive numbers after the first one, as required by --queue-balance
+    auto rangeInUse = [this, queueCount](uint16_t first) {
+        if (static_cast<uint32_t>(first) + queueCount - 1 > UINT16_MAX) {
+            return true;
+        }
+        for (uint16_t i = 0; i < queueCount; i++) {
+            if (IsQueueNumberInUse(first + i)) {
+                return true;
+            }
+        }
+        return false;
+    };
     uint16_t newQueueId = nextQueueId_ % UINT16_MAX + 1;
     uint16_t counter = 0;
-    while (queues_.find(newQueueId) != queues_.end()) {
+    while (rangeInUse(newQueueId)) {
         newQueueId = newQueueId % UINT16_MAX + 1;
         counter++;
         if (counter >= UINT16_MAX) {
@@ -112,6 +132,56 @@ QueueInfo NetTrafficFilterNFQueueCore::GetQueueInfo(uint16_t queueNum)
     return QueueInfo{0, 0, 0, "", "", "", "", "", -1, nullptr, nullptr};
 }
 
+std::shared_ptr<const QueueHandles> NetTrafficFilterNFQueueCore::GetQueueHandles(uint16_t queueNum)
+{
+    QueueSlotChunk *chunk = queueSlotChunks_[queueNum >> QUEUE_SLOT_CHUNK_BITS].load(std::memory_order_acquire);
+    if (chunk == nullptr) {
+        return nullptr;
+    }
+    return std::atomic_load_explicit(&chunk->slots[queueNum & (QUEUE_SLOT_CHUNK_SIZE - 1)],
+        std::memory_order_acquire);
+}
+
+void NetTrafficFilterNFQueueCore::PublishQueueHandles(uint16_t queueNum, const OHOS::sptr<NfqCtx>& nfqHandle,
+    const OHOS::sptr<NfqQueue>& qh)
+{
+    auto &chunkSlot = queueSlotChunks_[queueNum >> QUEUE_SLOT_CHUNK_BITS];
+    QueueSlotChunk *chunk = chunkSlot.load(std::memory_order_acquire);
+    if (chunk == nullptr) {
+        if (nfqHandle == nullptr) {
+            return;
+        }
+        chunk = new (std::nothrow) QueueSlotChunk();
+        if (chunk == nullptr) {
+            NETMGR_EXT_LOG_E("PublishQueueHandles: alloc chunk failed, queue %{public}u", queueNum);
+            return;
+        }
+        chunkSlot.store(chunk, std::memory_order_release);
+    }
+    std::shared_ptr<const QueueHandles> handles;
+    if (nfqHandle != nullptr && qh != nullptr) {
+        handles = std::make_shared<const QueueHandles>(QueueHandles{nfqHandle, qh});
+    }
+    std::atomic_store_explicit(&chunk->slots[queueNum & (QUEUE_SLOT_CHUNK_SIZE - 1)], handles,
+        std::memory_order_release);
+}
+
+void NetTrafficFilterNFQueueCore::PublishQueueInfo(const QueueInfo &info)
+{
+    PublishQueueHandles(info.queueNum, info.nfqHandle, info.qh);
+    for (const auto &fanout : info.fanoutQueues) {
+        PublishQueueHandles(fanout.queueNum, fanout.nfqHandle, fanout.qh);
+    }
+}
+
+void NetTrafficFilterNFQueueCore::RetractQueueInfo(const QueueInfo &info)
+{
+    PublishQueueHandles(info.queueNum, nullptr, nullptr);
+    for (const auto &fanout : info.fanoutQueues) {
+        PublishQueueHandles(fanout.queueNum, nullptr, nullptr);
+    }
+}
+
 void NetTrafficFilterNFQueueCore::Cleanup()
 {
     {
@@ -124,16 +194,11 @@ void NetTrafficFilterNFQueueCore::Cleanup()
         uidToObserverMap_.clear();
     }
     std::lock_guard<std::mutex> lock(mutex_);
-    std::set<std::string> bundleNames;
     for (auto &pair : queues_) {
-        bundleNames.insert(pair.second.bundleName);
+        RetractQueueInfo(pair.second);
+        DestroyFanoutQueues(pair.second);
         NetsysController::GetInstance().NfqQueueDestroy(pair.second.nfqHandle, pair.second.qh);
-    }
-    for (auto it : bundleNames) {
-        OHOS::sptr<NfqCtx> nfqHandle = GetNFQHandleFromBundleName(it);
-        if (nfqHandle) {
-            NetsysController::GetInstance().NfqClose(nfqHandle);
-        }
+        NetsysController::GetInstance().NfqClose(pair.second.nfqHandle);
     }
     queues_.clear();
     nextQueueId_ = 0;
@@ -170,6 +235,14 @@ uint32_t NetTrafficFilterNFQueueCore::GetQueueMaxLen(const OHOS::sptr<TrafficFil
     return DEFAULT_MAX_QUEUE_LEN;
 }
 
+uint16_t NetTrafficFilterNFQueueCore::GetQueueCount(const OHOS::sptr<TrafficFilterConfig>& config)
+{
+    if (config != nullptr && config->queueCount_ > 1 && config->queueCount_ <= NETTRAFFICFILTER_MAX_QUEUE_COUNT) {
+        return static_cast<uint16_t>(config->queueCount_);
+    }
+    return 1;
+}
+
 uint32_t NetTrafficFilterNFQueueCore::GetQueueFlags(const OHOS::sptr<TrafficFilterConfig>& config)
 {
     if (config != nullptr) {
@@ -220,12 +293,65 @@ bool NetTrafficFilterNFQueueCore::ConfigureNFQueue(OHOS::sptr<NfqCtx> &ctx,
     return true;
 }
 
+bool NetTrafficFilterNFQueueCore::CreateFanoutQueues(QueueInfo &info, const OHOS::sptr<TrafficFilterConfig>& config)
+{
+    // every fan-out queue owns its netlink socket so that each worker thread of the app drains its own queue
+    for (uint16_t i = 1; i < info.queueCount; i++) {
+        OHOS::sptr<NfqCtx> nfqHandle = OpenNFQHandle();
+        if (nfqHandle == nullptr) {
+            DestroyFanoutQueues(info);
+            return false;
+        }
+        uint16_t queueNum = info.queueNum + i;
+        OHOS::sptr<NfqQueue> qh = NetsysController::GetInstance().NfqQueueCreate(nfqHandle, queueNum);
+        if (qh == nullptr) {
+            NetsysController::GetInstance().NfqClose(nfqHandle);
+            DestroyFanoutQueues(info);
+            return false;
+        }
+        info.fanoutQueues.push_back(FanoutQueue{queueNum, nfqHandle->fd, nfqHandle, qh});
+        if (!ConfigureNFQueue(nfqHandle, qh, config)) {
+            DestroyFanoutQueues(info);
+            return false;
+        }
+    }
+    return true;
+}
+
+void NetTrafficFilterNFQueueCore::DestroyFanoutQueues(QueueInfo &info)
+{
+    for (auto &fanout : info.fanoutQueues) {
+        NetsysController::GetInstance().NfqQueueDestroy(fanout.nfqHandle, fanout.qh);
+        NetsysController::GetInstance().NfqClose(fanout.nfqHandle);
+    }
+    info.fanoutQueues.clear();
+}
+
+uint32_t NetTrafficFilterNFQueueCore::AllocateFlowCacheMark()
+{
+    for (uint32_t slot = 1; slot <= NETTRAFFICFILTER_FLOW_CACHE_MAX_SLOT; slot++) {
+        uint32_t mark = slot << NETTRAFFICFILTER_FLOW_CACHE_SLOT_SHIFT;
+        bool inUse = false;
+        for (const auto &pair : queues_) {
+            if (pair.second.flowCacheMark == mark) {
+                inUse = true;
+                break;
+            }
+        }
+        if (!inUse) {
+            return mark;
+        }
+    }
+    return 0;
+}
+
 int32_t NetTrafficFilterNFQueueCore::CreateQueue(uint32_t groupId, uint32_t priority, uint16_t queueNum,
                                                  const std::string &bundleName,
                                                  const OHOS::sptr<TrafficFilterConfig>& config)
 {
     std::lock_guard<std::mutex> lock(mutex_);
-    OHOS::sptr<NfqCtx> nfqHandle = CreateNFQHandle(bundleName);
+    // every queue owns its netlink socket, the app worker reading it is then the only reader and may batch verdicts
+    OHOS::sptr<NfqCtx> nfqHandle = OpenNFQHandle();
     if (nfqHandle == nullptr) {
         return TRAFFICFILTER_ERROR_NFQUEUE_ERROR;
     }
@@ -236,35 +362,41 @@ int32_t NetTrafficFilterNFQueueCore::CreateQueue(uint32_t groupId, uint32_t prio
     }
     if (!ConfigureNFQueue(nfqHandle, qh, config)) {
         NetsysController::GetInstance().NfqQueueDestroy(nfqHandle, qh);
+        NetsysController::GetInstance().NfqClose(nfqHandle);
         return TRAFFICFILTER_ERROR_NFQUEUE_ERROR;
     }
     int32_t callingUid = IPCSkeleton::GetCallingUid();
     int32_t callingPid = IPCSkeleton::GetCallingPid();
     QueueInfo info{groupId, priority, queueNum, bundleName, "", "", "", "", nfqHandle->fd, nfqHandle, qh};
     info.packetControllerId = bundleName + ":" + std::to_string(queueNum);
+    info.queueCount = GetQueueCount(config);
+    info.userSpaceMatch = config != nullptr && config->userSpaceMatch_;
+    if (config != nullptr && config->flowCache_) {
+        info.flowCacheMark = AllocateFlowCacheMark();
+        if (info.flowCacheMark == 0) {
+            NETMGR_EXT_LOG_W("CreateQueue: no flow cache slot left, queue %{public}u runs without cache", queueNum);
+        }
+    }
+    if (!CreateFanoutQueues(info, config)) {
+        NetsysController::GetInstance().NfqQueueDestroy(nfqHandle, qh);
+        NetsysController::GetInstance().NfqClose(nfqHandle);
+        return TRAFFICFILTER_ERROR_NFQUEUE_ERROR;
+    }
 #ifndef NETMANAGER_TEST
     if (!CreateIptables(priority, info, callingUid, groupId)) {
         DestroyIptables(info);
+        DestroyFanoutQueues(info);
         NetsysController::GetInstance().NfqQueueDestroy(nfqHandle, qh);
+        NetsysController::GetInstance().NfqClose(nfqHandle);
         return TRAFFICFILTER_ERROR_NFQUEUE_ERROR;
     }
 #endif
-    UpdateNFQHandleFromBundleName(bundleName, nfqHandle);
     queues_[queueNum] = info;
+    PublishQueueInfo(info);
     HandleTrafficFilterObserverRegistration(bundleName, queueNum, callingUid, callingPid);
     return TRAFFICFILTER_OK;
 }
 
-void NetTrafficFilterNFQueueCore::UpdateNFQHandleFromBundleName(const std::string &bundleName,
-    const OHOS::sptr<NfqCtx>& nfqHandle)
-{
-    for (auto iterator = queues_.begin(); iterator != queues_.end(); ++iterator) {
-        if (iterator->second.bundleName == bundleName) {
-            iterator->second.nfqHandle = nfqHandle;
-        }
-    }
-}
-
 void NetTrafficFilterNFQueueCore::HandleTrafficFilterObserverRegistration(
     const std::string bundleName, uint16_t queueNum, int32_t uid, int32_t pid)
 {
@@ -374,20 +506,17 @@ void NetTrafficFilterNFQueueCore::DestroyIptables(const QueueInfo &info)
 int32_t NetTrafficFilterNFQueueCore::DestroyByBundleName(const std::string &bundleName)
 {
     std::vector<uint16_t> queueNums;
-    OHOS::sptr<NfqCtx> handle = nullptr;
     {
         std::lock_guard<std::mutex> lock(mutex_);
-        handle = GetNFQHandleFromBundleName(bundleName);
-        if (handle == nullptr) {
-            return TRAFFICFILTER_ERROR_NOT_FOUND;
-        }
-        for (size_t i = 0; i < NFQ_MAX_QUEUES; i++) {
-            if (handle->queues[i] == nullptr) {
-                continue;
+        for (const auto &pair : queues_) {
+            if (pair.second.bundleName == bundleName) {
+                queueNums.emplace_back(pair.second.queueNum);
             }
-            queueNums.emplace_back(handle->queues[i]->queueNum);
         }
     }
+    if (queueNums.empty()) {
+        return TRAFFICFILTER_ERROR_NOT_FOUND;
+    }
     for (const auto& queueNum : queueNums) {
         DestroyQueue(queueNum);
     }
@@ -401,27 +530,17 @@ int32_t NetTrafficFilterNFQueueCore::DestroyQueue(uint16_t queueNum)
     if (it == queues_.end()) {
         return TRAFFICFILTER_ERROR_NOT_FOUND;
     }
-    bool handleInUse = false;
-    for (auto iterator = queues_.begin(); iterator != queues_.end(); ++iterator) {
-        if (it == iterator) {
-            continue;
-        }
-        if (iterator->second.nfqHandle == it->second.nfqHandle) {
-            handleInUse = true;
-            break;
-        }
-    }
+    // stop handing out the handles before they are destroyed below
+    RetractQueueInfo(it->second);
     if (it->second.qh != nullptr) {
         NetTrafficFilterPacketRuleManager::GetInstance().ClearPacketRule(it->second.packetControllerId);
         NetsysController::GetInstance().NfqQueueDestroy(it->second.nfqHandle, it->second.qh);
-        UpdateNFQHandleFromBundleName(it->second.bundleName, it->second.nfqHandle);
     }
 #ifndef NETMANAGER_TEST
     DestroyIptables(it->second);
 #endif
-    if (!handleInUse) {
-        NetsysController::GetInstance().NfqClose(it->second.nfqHandle);
-    }
+    DestroyFanoutQueues(it->second);
+    NetsysController::GetInstance().NfqClose(it->second.nfqHandle);
     queues_.erase(it);
     return TRAFFICFILTER_OK;
 }
\ No newline at end of file
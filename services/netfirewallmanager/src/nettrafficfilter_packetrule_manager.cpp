@@ -21,6 +21,7 @@
 #include "netmgr_ext_log_wrapper.h"
 #include "ipc_skeleton.h"
 #include "netfirewall_uid_rule_generator.h"
+#include <algorithm>
 #include <charconv>
 
 namespace OHOS {
@@ -172,26 +173,99 @@ int32_t NetTrafficFilterPacketRuleManager::ExecuteRulesForIpFamily(
     const std::vector<TrafficFilterPacketRule>& rules, const std::string& chainName, int32_t queueNum,
     TrafficFilterIPFamily family)
 {
+    QueueInfo info = NetTrafficFilterNFQueueCore::GetInstance().GetQueueInfo(queueNum);
+    if (!rules.empty()) {
+        for (const auto& cmd : NetTrafficFilterIptablesCommandBuilder::BuildFlowCacheCommands(
+            chainName, info.flowCacheMark)) {
+            int32_t ret = NetTrafficFilterIptablesCommandBuilder::ExecuteIptablesCommand(cmd, family);
+            if (ret != FIREWALL_SUCCESS) {
+                NETMGR_EXT_LOG_E("insert flow cache rule failed, ret=%{public}d", ret);
+                return ret;
+            }
+        }
+    }
+    // a controller matching in user space only needs the packets queued, one rule replaces the whole list
+    bool queueAll = info.userSpaceMatch && std::all_of(rules.begin(), rules.end(), IsPacketRuleUserSpaceMatchable);
+    uint32_t nextMatchChain = 1;
     for (const auto& rule : rules) {
         if (!IsRuleForFamily(rule, family)) {
             continue;
         }
-        std::vector<std::string> commands =
-            NetTrafficFilterIptablesCommandBuilder::BuildPacketFilterCommands(rule, chainName, queueNum);
-        for (const auto& cmd : commands) {
+        PacketFilterCommands built;
+        if (queueAll) {
+            built.commands.push_back(NetTrafficFilterIptablesCommandBuilder::BuildPacketQueueAllCommand(
+                chainName, queueNum, info.queueCount));
+        } else {
+            built = NetTrafficFilterIptablesCommandBuilder::BuildPacketFilterChainCommands(rule, chainName,
+                nextMatchChain, queueNum, info.queueCount);
+        }
+        int32_t ret = CreateMatchChains(built.matchChains, chainName, family);
+        if (ret != FIREWALL_SUCCESS) {
+            return ret;
+        }
+        nextMatchChain += static_cast<uint32_t>(built.matchChains.size());
+        for (const auto& cmd : built.commands) {
             if (cmd.empty()) {
                 continue;
             }
-            int32_t ret = NetTrafficFilterIptablesCommandBuilder::ExecuteIptablesCommand(cmd, family);
+            ret = NetTrafficFilterIptablesCommandBuilder::ExecuteIptablesCommand(cmd, family);
             if (ret != FIREWALL_SUCCESS) {
                 NETMGR_EXT_LOG_E("insert rule failed, ret=%{public}d", ret);
                 return ret;
             }
         }
+        if (queueAll) {
+            break;
+        }
+    }
+    return FIREWALL_SUCCESS;
+}
+
+int32_t NetTrafficFilterPacketRuleManager::CreateMatchChains(const std::vector<std::string>& matchChains,
+    const std::string& chainName, TrafficFilterIPFamily family)
+{
+    for (const auto& matchChain : matchChains) {
+        std::string createCmd = NetTrafficFilterIptablesCommandBuilder::BuildCreateChainCommand(
+            matchChain, IptablesName::FILTER);
+        int32_t ret = NetTrafficFilterIptablesCommandBuilder::ExecuteIptablesCommand(createCmd, family);
+        if (ret != FIREWALL_SUCCESS) {
+            NETMGR_EXT_LOG_E("create match chain failed, ret=%{public}d", ret);
+            return ret;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        matchChainCounts_[{chainName, family}]++;
     }
     return FIREWALL_SUCCESS;
 }
 
+// Only called once nothing jumps to the match chains any more, they are flushed first as they jump to each other
+void NetTrafficFilterPacketRuleManager::ReleaseMatchChains(const std::string& chainName,
+    TrafficFilterIPFamily family)
+{
+    uint32_t count = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = matchChainCounts_.find({chainName, family});
+        if (it == matchChainCounts_.end()) {
+            return;
+        }
+        count = it->second;
+        matchChainCounts_.erase(it);
+    }
+    for (uint32_t i = 1; i <= count; ++i) {
+        NetTrafficFilterIptablesCommandBuilder::ExecuteIptablesCommand(
+            NetTrafficFilterIptablesCommandBuilder::BuildFlushChainCommand(
+                NetTrafficFilterIptablesCommandBuilder::GenerateMatchChainName(chainName, i), IptablesName::FILTER),
+            family);
+    }
+    for (uint32_t i = 1; i <= count; ++i) {
+        NetTrafficFilterIptablesCommandBuilder::ExecuteIptablesCommand(
+            NetTrafficFilterIptablesCommandBuilder::BuildDeleteChainCommand(
+                NetTrafficFilterIptablesCommandBuilder::GenerateMatchChainName(chainName, i), IptablesName::FILTER),
+            family);
+    }
+}
+
 int32_t NetTrafficFilterPacketRuleManager::ApplyRulesForHookPoint(int32_t queueNum, int32_t hookPoint,
     const std::string& chainName, TrafficFilterIPFamily family)
 {
@@ -202,6 +276,7 @@ int32_t NetTrafficFilterPacketRuleManager::ApplyRulesForHookPoint(int32_t queueN
         NETMGR_EXT_LOG_E("flush chain failed, ret=%{public}d", ret);
         return ret;
     }
+    ReleaseMatchChains(chainName, family);
 
     std::vector<TrafficFilterPacketRule> rules;
     {
@@ -394,6 +469,9 @@ void NetTrafficFilterPacketRuleManager::CleanPhysicalRules(const QueueInfo& info
     const std::string* chains[] = {&info.chainNameIn, &info.chainNameOut, &info.chainNameFwd};
     for (const std::string* chain : chains) {
         FlushChainForIpFamilies(*chain);
+        for (size_t i = 0; i < FAMILY_COUNT; ++i) {
+            ReleaseMatchChains(*chain, FAMILIES[i]);
+        }
         DeleteChainForIpFamilies(*chain);
     }
 }
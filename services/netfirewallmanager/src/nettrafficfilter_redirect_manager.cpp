@@ -22,9 +22,15 @@
 #include "ipc_skeleton.h"
 #include "bundle_mgr_proxy.h"
 #include "bundle_mgr_client.h"
+#include <algorithm>
 #include <arpa/inet.h>
+#include <iterator>
 #include <sstream>
 #include <iomanip>
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+#include <sys/socket.h>
+#include <unistd.h>
 #include "netmanager_base_common_utils.h"
 
 namespace OHOS {
@@ -33,6 +39,16 @@ constexpr int32_t IPV6_PREFIX_MAX = 128;
 constexpr int32_t IPV4_PREFIX_MAX = 32;
 constexpr int32_t BUNDLE_LEN_MAX = 255;
 constexpr int32_t REDIRECTOR_ID_START = 1000;
+// Cached socket table age after which a query dumps it again, misses always re-check a younger dump
+constexpr int64_t SOCKET_OWNER_CACHE_TTL_MS = 500;
+constexpr size_t SOCKET_DIAG_RECV_BUF_SIZE = 32768;
+constexpr uint32_t SOCKET_DIAG_ALL_STATES = ~0U;
+constexpr uint32_t SOCKET_COOKIE_HIGH_SHIFT = 32;
+constexpr size_t IPV4_ADDR_BYTES = 4;
+constexpr uint32_t SOCKET_KEY_PROTOCOL_SHIFT = 24;
+constexpr uint32_t SOCKET_KEY_FAMILY_SHIFT = 16;
+constexpr size_t SOCKET_KEY_HASH_PRIME = 31;
+constexpr uint32_t HOOK_FAMILY_BITS = 2;
 
 static bool ValidateIPMatchType(int32_t type)
 {
@@ -59,20 +75,47 @@ static uint8_t GetMaxPrefixLenByFamily(int32_t family)
     return IPV4_PREFIX_MAX;
 }
 
-void NetTrafficFilterRedirectManager::SortRedirectorList()
+static uint32_t GetHookFamilyBit(TrafficFilterHookPoint hookPoint, TrafficFilterIPFamily family)
 {
-    NETMGR_EXT_LOG_I("SortRedirectorList started with %{public}zu redirectors", redirectorIdList_.size());
-    std::sort(redirectorIdList_.begin(), redirectorIdList_.end(),
-        [this](const std::string& a, const std::string& b) {
-            auto itA = redirectors_.find(a);
-            auto itB = redirectors_.find(b);
-            if (itA == redirectors_.end() || itB == redirectors_.end() ||
-                itA->second == nullptr || itB->second == nullptr) {
+    if (hookPoint < TrafficFilterHookPoint::HOOK_INPUT || hookPoint > TrafficFilterHookPoint::HOOK_POSTROUTING) {
+        return 0;
+    }
+    uint32_t familyBit = 0;
+    if (family == TrafficFilterIPFamily::IP_FAMILY_V6) {
+        familyBit = 1;
+    } else if (family != TrafficFilterIPFamily::IP_FAMILY_V4) {
+        return 0;
+    }
+    return 1U << (static_cast<uint32_t>(hookPoint) * HOOK_FAMILY_BITS + familyBit);
+}
+
+// redirectorIdList_ stays ordered by priority, a new redirector goes after the ones of the same priority
+void NetTrafficFilterRedirectManager::InsertRedirectorOrdered(const std::string& redirectorId, uint32_t priority)
+{
+    auto pos = std::upper_bound(redirectorIdList_.begin(), redirectorIdList_.end(), priority,
+        [this](uint32_t value, const std::string& id) {
+            auto it = redirectors_.find(id);
+            if (it == redirectors_.end() || it->second == nullptr) {
                 return false;
             }
-            return itA->second->GetPriority() < itB->second->GetPriority();
+            return value < it->second->GetPriority();
         });
-    NETMGR_EXT_LOG_I("SortRedirectorList completed");
+    redirectorIdList_.insert(pos, redirectorId);
+    NETMGR_EXT_LOG_I("InsertRedirectorOrdered: %{public}zu redirectors", redirectorIdList_.size());
+}
+
+uint32_t NetTrafficFilterRedirectManager::GetHookFamilyMask(
+    const std::shared_ptr<NetTrafficFilterRedirectorContext>& redirector) const
+{
+    uint32_t mask = 0;
+    if (redirector->GetHookFamilyMask(mask)) {
+        return mask;
+    }
+    for (const auto& rule : redirector->GetRules()) {
+        mask |= GetHookFamilyBit(static_cast<TrafficFilterHookPoint>(rule.hookPoint_), DetermineRuleFamily(rule));
+    }
+    redirector->SetHookFamilyMask(mask);
+    return mask;
 }
 
 std::vector<std::string> NetTrafficFilterRedirectManager::GetActiveRedirectorsForHookPoint(
@@ -81,6 +124,10 @@ std::vector<std::string> NetTrafficFilterRedirectManager::GetActiveRedirectorsFo
     NETMGR_EXT_LOG_I("GetActiveRedirectorsForHookPoint: hookPoint=%{public}d, family=%{public}d",
         static_cast<int32_t>(hookPoint), static_cast<int32_t>(family));
     std::vector<std::string> activeRedirectors;
+    uint32_t hookFamilyBit = GetHookFamilyBit(hookPoint, family);
+    if (hookFamilyBit == 0) {
+        return activeRedirectors;
+    }
     for (const auto& redirectorId : redirectorIdList_) {
         auto it = redirectors_.find(redirectorId);
         if (it == redirectors_.end()) {
@@ -93,22 +140,7 @@ std::vector<std::string> NetTrafficFilterRedirectManager::GetActiveRedirectorsFo
         if (redirector->IsPaused()) {
             continue;
         }
-        if (!redirector->HasRules()) {
-            continue;
-        }
-        std::vector<TrafficFilterRedirectRule> rules = redirector->GetRules();
-        bool hasMatchedRule = false;
-        for (const auto& rule : rules) {
-            if (rule.hookPoint_ != static_cast<int32_t>(hookPoint)) {
-                continue;
-            }
-            TrafficFilterIPFamily ruleFamily = DetermineRuleFamily(rule);
-            if (ruleFamily == family) {
-                hasMatchedRule = true;
-                break;
-            }
-        }
-        if (!hasMatchedRule) {
+        if ((GetHookFamilyMask(redirector) & hookFamilyBit) == 0) {
             continue;
         }
         activeRedirectors.push_back(redirectorId);
@@ -116,8 +148,53 @@ std::vector<std::string> NetTrafficFilterRedirectManager::GetActiveRedirectorsFo
     return activeRedirectors;
 }
 
-int32_t NetTrafficFilterRedirectManager::RemoveJumpRulesFromHookPoint(
-    TrafficFilterHookPoint hookPoint, TrafficFilterIPFamily family)
+/*
+ * Turns the installed jumps of a hook point into the wanted ones with one delete per dropped chain and one
+ * positioned insert per new chain. Returns false without adding anything when the chains kept in place are not
+ * in the same order, the hook point then has to be rebuilt. Every step carries its undo, a delete puts the jump
+ * back where it was when it was removed.
+ */
+static bool CollectJumpRuleChanges(const std::string& hookPointName, const std::vector<std::string>& installed,
+    const std::vector<std::string>& wanted, TrafficFilterIPFamily family,
+    NetTrafficFilterIptablesTransaction& transaction)
+{
+    std::set<std::string> installedSet(installed.begin(), installed.end());
+    std::set<std::string> wantedSet(wanted.begin(), wanted.end());
+    std::vector<std::string> keptInstalled;
+    std::vector<std::string> keptWanted;
+    std::copy_if(installed.begin(), installed.end(), std::back_inserter(keptInstalled),
+        [&wantedSet](const std::string& chain) { return wantedSet.count(chain) != 0; });
+    std::copy_if(wanted.begin(), wanted.end(), std::back_inserter(keptWanted),
+        [&installedSet](const std::string& chain) { return installedSet.count(chain) != 0; });
+    if (keptInstalled != keptWanted) {
+        return false;
+    }
+    uint32_t deleted = 0;
+    for (size_t i = 0; i < installed.size(); ++i) {
+        if (wantedSet.count(installed[i]) == 0) {
+            transaction.Add(NetTrafficFilterIptablesCommandBuilder::BuildDeleteJumpCommand(hookPointName,
+                installed[i]), family, true, NetTrafficFilterIptablesCommandBuilder::BuildInsertJumpToChainCommand(
+                hookPointName, installed[i], static_cast<uint32_t>(i + 1) - deleted));
+            deleted++;
+        }
+    }
+    for (size_t i = 0; i < wanted.size(); ++i) {
+        if (installedSet.count(wanted[i]) == 0) {
+            transaction.Add(NetTrafficFilterIptablesCommandBuilder::BuildInsertJumpToChainCommand(hookPointName,
+                wanted[i], static_cast<uint32_t>(i + 1)), family, false,
+                NetTrafficFilterIptablesCommandBuilder::BuildDeleteJumpCommand(hookPointName, wanted[i]));
+        }
+    }
+    return true;
+}
+
+/*
+ * Deletes the jumps of every redirector from the hook point, the installed ones first and in their order. Each of
+ * them is on top of the hook point when it goes, so undoing the deletes in reverse puts them back in order.
+ */
+int32_t NetTrafficFilterRedirectManager::RemoveJumpRulesFromHookPoint(TrafficFilterHookPoint hookPoint,
+    TrafficFilterIPFamily family, const std::vector<std::string>& installedChains,
+    NetTrafficFilterIptablesTransaction& transaction)
 {
     NETMGR_EXT_LOG_I("RemoveJumpRulesFromHookPoint: hookPoint=%{public}d, family=%{public}d",
         static_cast<int32_t>(hookPoint), static_cast<int32_t>(family));
@@ -126,64 +203,121 @@ int32_t NetTrafficFilterRedirectManager::RemoveJumpRulesFromHookPoint(
         NETMGR_EXT_LOG_E("invalid hook point name, hookPoint=%{public}d", static_cast<int32_t>(hookPoint));
         return -1;
     }
+    std::vector<std::string> chains = installedChains;
+    std::set<std::string> installedSet(installedChains.begin(), installedChains.end());
     for (const auto& [redirectorId, redirector] : redirectors_) {
         if (redirector == nullptr) {
             continue;
         }
         std::string chainName = NetTrafficFilterIptablesCommandBuilder::GenerateChainName(
             redirector->GetCallingUid(), redirector->GetGroupId());
-        std::string jumpCmd = NetTrafficFilterIptablesCommandBuilder::BuildDeleteJumpCommand(hookPointName, chainName);
-        if (NetTrafficFilterIptablesCommandBuilder::ExecuteIptablesCommand(jumpCmd, family) != TRAFFICFILTER_OK) {
-            NETMGR_EXT_LOG_I("Jump rule not found or already removed, hookPoint=%{public}d, chain=%{public}s",
-                static_cast<int32_t>(hookPoint), chainName.c_str());
+        if (installedSet.count(chainName) == 0) {
+            chains.push_back(chainName);
         }
     }
+    for (const auto& chainName : chains) {
+        std::string jumpCmd = NetTrafficFilterIptablesCommandBuilder::BuildDeleteJumpCommand(hookPointName, chainName);
+        // the jump may not exist or may already be removed
+        transaction.Add(jumpCmd, family, true,
+            NetTrafficFilterIptablesCommandBuilder::BuildInsertJumpToChainCommand(hookPointName, chainName, 1));
+    }
     NETMGR_EXT_LOG_I("RemoveJumpRulesFromHookPoint completed");
     return TRAFFICFILTER_OK;
 }
 
-int32_t NetTrafficFilterRedirectManager::UpdateGlobalJumpRules(
-    TrafficFilterHookPoint hookPoint, TrafficFilterIPFamily family)
+int32_t NetTrafficFilterRedirectManager::UpdateGlobalJumpRules(TrafficFilterHookPoint hookPoint,
+    TrafficFilterIPFamily family, NetTrafficFilterIptablesTransaction& transaction)
 {
     NETMGR_EXT_LOG_I("UpdateGlobalJumpRules: hookPoint=%{public}d, family=%{public}d",
         static_cast<int32_t>(hookPoint), static_cast<int32_t>(family));
-    if (RemoveJumpRulesFromHookPoint(hookPoint, family) != TRAFFICFILTER_OK) {
-        NETMGR_EXT_LOG_W("Failed to remove jump rules");
-    }
-    std::vector<std::string> activeRedirectors = GetActiveRedirectorsForHookPoint(hookPoint, family);
     std::string hookPointName = NetTrafficFilterIptablesCommandBuilder::GetHookPointName(hookPoint);
     if (hookPointName.empty()) {
         NETMGR_EXT_LOG_E("invalid hook point name, hookPoint=%{public}d",
             static_cast<int32_t>(hookPoint));
         return -1;
     }
-    uint32_t position = 1;
-    for (const auto& redirectorId : activeRedirectors) {
+    std::vector<std::string> wantedChains;
+    for (const auto& redirectorId : GetActiveRedirectorsForHookPoint(hookPoint, family)) {
         auto it = redirectors_.find(redirectorId);
         if (it == redirectors_.end()) {
             continue;
         }
-        auto redirector = it->second;
-        std::string chainName = NetTrafficFilterIptablesCommandBuilder::GenerateChainName(
-            redirector->GetCallingUid(), redirector->GetGroupId());
-        std::string addJumpCmd = NetTrafficFilterIptablesCommandBuilder::BuildInsertJumpToChainCommand(
-            hookPointName, chainName, position);
-        if (addJumpCmd.empty()) {
-            NETMGR_EXT_LOG_E("empty add jump command");
-            return -1;
+        wantedChains.push_back(NetTrafficFilterIptablesCommandBuilder::GenerateChainName(
+            it->second->GetCallingUid(), it->second->GetGroupId()));
+    }
+
+    // the entry is only put back once the changes are queued, a failure leaves the hook point to a full rebuild
+    auto key = std::make_pair(hookPoint, family);
+    auto installedIt = installedJumps_.find(key);
+    std::vector<std::string> installedChains;
+    bool known = installedIt != installedJumps_.end();
+    if (known) {
+        installedChains = std::move(installedIt->second);
+        installedJumps_.erase(installedIt);
+    }
+    if (!known || !CollectJumpRuleChanges(hookPointName, installedChains, wantedChains, family, transaction)) {
+        if (RemoveJumpRulesFromHookPoint(hookPoint, family, installedChains, transaction) != TRAFFICFILTER_OK) {
+            NETMGR_EXT_LOG_W("Failed to remove jump rules");
         }
-        int32_t ret = NetTrafficFilterIptablesCommandBuilder::ExecuteIptablesCommand(addJumpCmd, family);
-        if (ret != TRAFFICFILTER_OK) {
-            NETMGR_EXT_LOG_E("Failed to add jump rule for redirector %{public}s, position=%{public}u",
-                redirectorId.c_str(), position);
-            return ret;
+        uint32_t position = 1;
+        for (const auto& chainName : wantedChains) {
+            std::string addJumpCmd = NetTrafficFilterIptablesCommandBuilder::BuildInsertJumpToChainCommand(
+                hookPointName, chainName, position);
+            if (addJumpCmd.empty()) {
+                NETMGR_EXT_LOG_E("empty add jump command");
+                return -1;
+            }
+            transaction.Add(addJumpCmd, family, false,
+                NetTrafficFilterIptablesCommandBuilder::BuildDeleteJumpCommand(hookPointName, chainName));
+            position++;
         }
-        position++;
     }
+    installedJumps_[key] = std::move(wantedChains);
     NETMGR_EXT_LOG_I("UpdateGlobalJumpRules completed");
     return TRAFFICFILTER_OK;
 }
 
+void NetTrafficFilterRedirectManager::ForgetInstalledJumps(const std::string& chainName,
+    const std::set<TrafficFilterHookPoint>& hookPoints)
+{
+    for (auto& [key, chains] : installedJumps_) {
+        if (hookPoints.count(key.first) != 0) {
+            chains.erase(std::remove(chains.begin(), chains.end(), chainName), chains.end());
+        }
+    }
+}
+
+int32_t NetTrafficFilterRedirectManager::CommitJumpRules(NetTrafficFilterIptablesTransaction& transaction)
+{
+    int32_t ret = transaction.Commit();
+    if (ret != TRAFFICFILTER_OK) {
+        // part of the changes may be in place, every hook point is rebuilt in full next time
+        installedJumps_.clear();
+    }
+    return ret;
+}
+
+int32_t NetTrafficFilterRedirectManager::CollectGlobalJumpRules(TrafficFilterHookPoint hookPoint,
+    NetTrafficFilterIptablesTransaction& transaction)
+{
+    // each hook point is applied, or undone on a failure, on its own
+    transaction.BeginGroup();
+    // a caller may drop the transaction on failure, the changes already recorded would then never be applied
+    if (UpdateGlobalJumpRules(hookPoint, TrafficFilterIPFamily::IP_FAMILY_V4, transaction) != TRAFFICFILTER_OK) {
+        NETMGR_EXT_LOG_E("Failed to build IPv4 jump rules for hook point %{public}d",
+            static_cast<int32_t>(hookPoint));
+        installedJumps_.clear();
+        return -1;
+    }
+    if (UpdateGlobalJumpRules(hookPoint, TrafficFilterIPFamily::IP_FAMILY_V6, transaction) != TRAFFICFILTER_OK) {
+        NETMGR_EXT_LOG_E("Failed to build IPv6 jump rules for hook point %{public}d",
+            static_cast<int32_t>(hookPoint));
+        installedJumps_.clear();
+        return -1;
+    }
+    return TRAFFICFILTER_OK;
+}
+
 TrafficFilterIPFamily NetTrafficFilterRedirectManager::GetIPFamilyFromMatch(const TrafficFilterIPMatch& ipMatch)
 {
     NETMGR_EXT_LOG_I("GetIPFamilyFromMatch: type=%{public}d", ipMatch.type_);
@@ -478,8 +612,7 @@ int32_t NetTrafficFilterRedirectManager::CreateRedirector(const std::string& bun
     redirector->SetCallingInfo(callingUid, callingPid);
     redirectors_[redirectorId] = redirector;
     bundleNameToRedirectorsMap_[bundleName].push_back(redirectorId);
-    redirectorIdList_.push_back(redirectorId);
-    SortRedirectorList();
+    InsertRedirectorOrdered(redirectorId, priority);
 
     NETMGR_EXT_LOG_I("Redirector created: id=%{public}s, bundleName=%{public}s, groupId=%{public}u, "
         "uid=%{public}d, pid=%{public}d, chain=%{public}s",
@@ -534,6 +667,7 @@ int32_t NetTrafficFilterRedirectManager::CleanupRedirectorIptablesResources(cons
         deleteChainCmd, TrafficFilterIPFamily::IP_FAMILY_V4V6) != TRAFFICFILTER_OK) {
         NETMGR_EXT_LOG_W("Failed to delete chain");
     }
+    ForgetInstalledJumps(chainName, usedHookPoints);
 
     NETMGR_EXT_LOG_I("CleanupRedirectorIptablesResources completed");
     return TRAFFICFILTER_OK;
@@ -569,19 +703,16 @@ void NetTrafficFilterRedirectManager::RebuildGlobalJumpRulesAfterDestroy(
 {
     NETMGR_EXT_LOG_I("RebuildGlobalJumpRulesAfterDestroy: %{public}zu hook points", usedHookPoints.size());
 
+    NetTrafficFilterIptablesTransaction transaction;
     for (auto hookPoint : usedHookPoints) {
-        int32_t retV4 = UpdateGlobalJumpRules(hookPoint, TrafficFilterIPFamily::IP_FAMILY_V4);
-        if (retV4 != TRAFFICFILTER_OK) {
-            NETMGR_EXT_LOG_W("Failed to update IPv4 jump rules for hook point %{public}d",
-                static_cast<int32_t>(hookPoint));
-        }
-
-        int32_t retV6 = UpdateGlobalJumpRules(hookPoint, TrafficFilterIPFamily::IP_FAMILY_V6);
-        if (retV6 != TRAFFICFILTER_OK) {
-            NETMGR_EXT_LOG_W("Failed to update IPv6 jump rules for hook point %{public}d",
+        if (CollectGlobalJumpRules(hookPoint, transaction) != TRAFFICFILTER_OK) {
+            NETMGR_EXT_LOG_W("Failed to update jump rules for hook point %{public}d",
                 static_cast<int32_t>(hookPoint));
         }
     }
+    if (CommitJumpRules(transaction) != TRAFFICFILTER_OK) {
+        NETMGR_EXT_LOG_W("Failed to apply rebuilt jump rules");
+    }
 
     NETMGR_EXT_LOG_I("RebuildGlobalJumpRulesAfterDestroy completed");
 }
@@ -840,19 +971,13 @@ int32_t NetTrafficFilterRedirectManager::AppendRedirectRulesToChain(
 
 int32_t NetTrafficFilterRedirectManager::ApplyGlobalJumpRules(TrafficFilterHookPoint hookPoint)
 {
-    int32_t ret = UpdateGlobalJumpRules(hookPoint, TrafficFilterIPFamily::IP_FAMILY_V4);
-    if (ret != TRAFFICFILTER_OK) {
+    NetTrafficFilterIptablesTransaction transaction;
+    if (CollectGlobalJumpRules(hookPoint, transaction) != TRAFFICFILTER_OK) {
         NETMGR_EXT_LOG_E("Failed to update jump rules");
         return -1;
     }
-    ret = UpdateGlobalJumpRules(hookPoint, TrafficFilterIPFamily::IP_FAMILY_V6);
-    if (ret != TRAFFICFILTER_OK) {
-        NETMGR_EXT_LOG_E("Failed to update V6 jump rules, rolling back V4");
-        int32_t rollbackRet = UpdateGlobalJumpRules(hookPoint, TrafficFilterIPFamily::IP_FAMILY_V4);
-        if (rollbackRet != TRAFFICFILTER_OK) {
-            NETMGR_EXT_LOG_E("V4 rollback also failed for hookPoint=%{public}d",
-                static_cast<int32_t>(hookPoint));
-        }
+    if (CommitJumpRules(transaction) != TRAFFICFILTER_OK) {
+        NETMGR_EXT_LOG_E("Failed to apply jump rules for hookPoint=%{public}d", static_cast<int32_t>(hookPoint));
         return -1;
     }
     return TRAFFICFILTER_OK;
@@ -889,16 +1014,19 @@ int32_t NetTrafficFilterRedirectManager::AddRedirectRule(const std::string& redi
         return TRAFFICFILTER_ERROR_INVALID_PARAM;
     }
     if (isGloballyEnabled_) {
+        auto iptablesStart = std::chrono::steady_clock::now();
+        const char* failedStep = nullptr;
         if (ApplyRulesToChain(redirector, chainName) != TRAFFICFILTER_OK) {
-            if (RollbackRedirectorRules(redirector, chainName, oldRules, affectedHookPoints) != TRAFFICFILTER_OK) {
-                NETMGR_EXT_LOG_E("Rollback failed after ApplyRulesToChain failure");
-            }
-            return -1;
+            failedStep = "ApplyRulesToChain";
+        } else if (ApplyGlobalJumpRules(newHookPoint) != TRAFFICFILTER_OK) {
+            failedStep = "ApplyGlobalJumpRules";
         }
-        if (ApplyGlobalJumpRules(newHookPoint) != TRAFFICFILTER_OK) {
-            if (RollbackRedirectorRules(redirector, chainName, oldRules, affectedHookPoints) != TRAFFICFILTER_OK) {
-                NETMGR_EXT_LOG_E("Rollback failed after ApplyGlobalJumpRules failure");
-            }
+        if (failedStep != nullptr &&
+            RollbackRedirectorRules(redirector, chainName, oldRules, affectedHookPoints) != TRAFFICFILTER_OK) {
+            NETMGR_EXT_LOG_E("Rollback failed after %{public}s failure", failedStep);
+        }
+        redirector->RecordIptablesTime(TrafficFilterLatencyHistogram::ElapsedNs(iptablesStart));
+        if (failedStep != nullptr) {
             return -1;
         }
     } else {
@@ -931,6 +1059,7 @@ int32_t NetTrafficFilterRedirectManager::ClearRedirectRule(const std::string& re
         redirector->GetCallingUid(), redirector->GetGroupId());
 
     NETMGR_EXT_LOG_I("Removing jump rules for hookPoints");
+    auto iptablesStart = std::chrono::steady_clock::now();
     std::set<TrafficFilterHookPoint> usedHookPoints = redirector->GetUsedHookPoints();
     for (auto hookPoint : usedHookPoints) {
         std::string hookPointName = NetTrafficFilterIptablesCommandBuilder::GetHookPointName(hookPoint);
@@ -942,11 +1071,13 @@ int32_t NetTrafficFilterRedirectManager::ClearRedirectRule(const std::string& re
                 static_cast<int32_t>(hookPoint));
         }
     }
+    ForgetInstalledJumps(chainName, usedHookPoints);
 
     std::string clearChainCmd = NetTrafficFilterIptablesCommandBuilder::BuildFlushChainCommand(chainName);
     NETMGR_EXT_LOG_I("Flushing chain for clear rules: %{public}s", chainName.c_str());
     int32_t ret = NetTrafficFilterIptablesCommandBuilder::ExecuteIptablesCommand(
         clearChainCmd, TrafficFilterIPFamily::IP_FAMILY_V4V6);
+    redirector->RecordIptablesTime(TrafficFilterLatencyHistogram::ElapsedNs(iptablesStart));
     if (ret != TRAFFICFILTER_OK) {
         NETMGR_EXT_LOG_E("Failed to flush chain during clear rules");
         return -1;
@@ -994,6 +1125,7 @@ int32_t NetTrafficFilterRedirectManager::PauseAllRedirectors()
                     static_cast<int32_t>(hookPoint));
             }
         }
+        ForgetInstalledJumps(chainName, usedHookPoints);
 
         redirector->SetPaused(true);
     }
@@ -1036,20 +1168,16 @@ int32_t NetTrafficFilterRedirectManager::ResumeAllRedirectors()
         }
     }
 
+    NetTrafficFilterIptablesTransaction transaction;
     for (auto hookPoint : hookPointsToReorder) {
-        int32_t retV4 = UpdateGlobalJumpRules(hookPoint, TrafficFilterIPFamily::IP_FAMILY_V4);
-        if (retV4 != TRAFFICFILTER_OK) {
-            NETMGR_EXT_LOG_E("Failed to update IPv4 jump rules for hook point %{public}d",
-                static_cast<int32_t>(hookPoint));
-            return -1;
-        }
-        int32_t retV6 = UpdateGlobalJumpRules(hookPoint, TrafficFilterIPFamily::IP_FAMILY_V6);
-        if (retV6 != TRAFFICFILTER_OK) {
-            NETMGR_EXT_LOG_E("Failed to update IPv6 jump rules for hook point %{public}d",
-                static_cast<int32_t>(hookPoint));
+        if (CollectGlobalJumpRules(hookPoint, transaction) != TRAFFICFILTER_OK) {
             return -1;
         }
     }
+    if (CommitJumpRules(transaction) != TRAFFICFILTER_OK) {
+        NETMGR_EXT_LOG_E("Failed to apply jump rules while resuming redirectors");
+        return -1;
+    }
 
     NETMGR_EXT_LOG_I("Resumed all redirectors");
     return TRAFFICFILTER_OK;
@@ -1112,18 +1240,16 @@ int32_t NetTrafficFilterRedirectManager::RebuildRedirectorRulesByBundleName(cons
             }
         }
     }
+    NetTrafficFilterIptablesTransaction transaction;
     for (auto hookPoint : hookPointsToReorder) {
-        if (UpdateGlobalJumpRules(hookPoint, TrafficFilterIPFamily::IP_FAMILY_V4) != TRAFFICFILTER_OK) {
-            NETMGR_EXT_LOG_E("Failed to update IPv4 jump rules for hook point %{public}d",
-                static_cast<int32_t>(hookPoint));
-            return -1;
-        }
-        if (UpdateGlobalJumpRules(hookPoint, TrafficFilterIPFamily::IP_FAMILY_V6) != TRAFFICFILTER_OK) {
-            NETMGR_EXT_LOG_E("Failed to update IPv6 jump rules for hook point %{public}d",
-                static_cast<int32_t>(hookPoint));
+        if (CollectGlobalJumpRules(hookPoint, transaction) != TRAFFICFILTER_OK) {
             return -1;
         }
     }
+    if (CommitJumpRules(transaction) != TRAFFICFILTER_OK) {
+        NETMGR_EXT_LOG_E("Failed to apply jump rules for bundleName: %{public}s", bundleName.c_str());
+        return -1;
+    }
     NETMGR_EXT_LOG_I("Rebuilt redirector rules for bundleName: %{public}s", bundleName.c_str());
     return TRAFFICFILTER_OK;
 }
@@ -1333,6 +1459,26 @@ int32_t NetTrafficFilterRedirectManager::GlobalDisableTrafficFilter()
     return TRAFFICFILTER_OK;
 }
 
+void NetTrafficFilterRedirectManager::GetDumpMessage(std::string& message)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    message.append("\tTrafficFilter: " + std::string(isGloballyEnabled_ ? "Enable" : "Disable") +
+        ", redirectors: " + std::to_string(redirectorIdList_.size()) + "\n");
+    for (const auto& redirectorId : redirectorIdList_) {
+        auto it = redirectors_.find(redirectorId);
+        if (it == redirectors_.end() || it->second == nullptr) {
+            continue;
+        }
+        const auto& redirector = it->second;
+        message.append("\t\tRedirector " + redirectorId + " bundle=" + redirector->GetBundleName() +
+            " group=" + std::to_string(redirector->GetGroupId()) +
+            " priority=" + std::to_string(redirector->GetPriority()) +
+            " rules=" + std::to_string(redirector->GetRules().size()) +
+            (redirector->IsPaused() ? " paused" : "") +
+            " iptables: " + redirector->GetIptablesTimeSummary() + "\n");
+    }
+}
+
 int32_t NetTrafficFilterRedirectManager::GetTrafficFilterGlobalStatus(bool& isEnabled)
 {
     NETMGR_EXT_LOG_I("GetTrafficFilterGlobalStatus called");
@@ -1345,33 +1491,432 @@ int32_t NetTrafficFilterRedirectManager::GetTrafficFilterGlobalStatus(bool& isEn
 int32_t NetTrafficFilterRedirectManager::QueryProcess(const std::string& srcIp, uint16_t srcPort,
     const std::string& dstIp, uint16_t dstPort, uint8_t protocol, uint32_t& uid, uint32_t& pid)
 {
+    TrafficFilterConnectionTuple connection;
+    connection.srcIp_ = srcIp;
+    connection.srcPort_ = srcPort;
+    connection.dstIp_ = dstIp;
+    connection.dstPort_ = dstPort;
+    connection.protocol_ = protocol;
+    std::vector<TrafficFilterProcessOwner> owners;
+    int32_t ret = QueryProcesses({connection}, owners);
+    if (ret != TRAFFICFILTER_OK) {
+        return ret;
+    }
+    if (owners[0].result_ != TRAFFICFILTER_OK) {
+        NETMGR_EXT_LOG_E("QueryProcess: no matching process found");
+        return owners[0].result_;
+    }
+    uid = owners[0].uid_;
+    pid = owners[0].pid_;
+    return TRAFFICFILTER_OK;
+}
+
+int32_t NetTrafficFilterRedirectManager::QueryProcesses(const std::vector<TrafficFilterConnectionTuple>& connections,
+    std::vector<TrafficFilterProcessOwner>& owners)
+{
+    if (connections.empty() || connections.size() > NETTRAFFICFILTER_MAX_QUERY_PROCESS_COUNT) {
+        NETMGR_EXT_LOG_E("QueryProcesses: invalid count=%{public}zu", connections.size());
+        return TRAFFICFILTER_ERROR_INVALID_PARAM;
+    }
+    auto queryTime = std::chrono::steady_clock::now();
+    std::shared_ptr<const SocketOwnerTable> table;
+    int32_t ret = GetSocketOwnerTable(queryTime, false, table);
+    if (ret != 0) {
+        return ret;
+    }
+    owners.assign(connections.size(), TrafficFilterProcessOwner());
+    bool hasMiss = false;
+    bool cached = table->snapshotTime < queryTime;
+    for (size_t i = 0; i < connections.size(); i++) {
+        size_t pos = 0;
+        if (!LookupSocketOwner(*table, connections[i], owners[i], pos)) {
+            hasMiss = true;
+        } else if (cached && owners[i].result_ == TRAFFICFILTER_OK &&
+            !IsSocketOwnerCurrent(*table, connections[i].protocol_ == NETTRAFFICFILTER_PROTO_TCP, pos)) {
+            // The socket may have changed hands since the snapshot, resolve it again from a fresh dump
+            owners[i].result_ = TRAFFICFILTER_ERROR_NOT_FOUND;
+            hasMiss = true;
+        }
+    }
+    if (!hasMiss || table->snapshotTime >= queryTime) {
+        return TRAFFICFILTER_OK;
+    }
+    // A cached snapshot predates the query, so the missing sockets may simply be younger than it
+    ret = GetSocketOwnerTable(queryTime, true, table);
+    if (ret != 0) {
+        return ret;
+    }
+    for (size_t i = 0; i < connections.size(); i++) {
+        if (owners[i].result_ == TRAFFICFILTER_ERROR_NOT_FOUND) {
+            size_t pos = 0;
+            LookupSocketOwner(*table, connections[i], owners[i], pos);
+        }
+    }
+    return TRAFFICFILTER_OK;
+}
+
+int32_t NetTrafficFilterRedirectManager::GetSocketOwnerTable(std::chrono::steady_clock::time_point queryTime,
+    bool needFresh, std::shared_ptr<const SocketOwnerTable>& table)
+{
+    auto isUsable = [queryTime, needFresh](const std::shared_ptr<const SocketOwnerTable>& cached) {
+        if (cached == nullptr) {
+            return false;
+        }
+        if (needFresh) {
+            return cached->snapshotTime >= queryTime;
+        }
+        return queryTime - cached->snapshotTime < std::chrono::milliseconds(SOCKET_OWNER_CACHE_TTL_MS);
+    };
+    {
+        std::lock_guard<std::mutex> lock(socketTableMutex_);
+        if (isUsable(socketTable_)) {
+            table = socketTable_;
+            return TRAFFICFILTER_OK;
+        }
+    }
+    // Concurrent queries wait for one dump instead of each issuing their own
+    std::lock_guard<std::mutex> refreshLock(socketRefreshMutex_);
+    {
+        std::lock_guard<std::mutex> lock(socketTableMutex_);
+        if (isUsable(socketTable_)) {
+            table = socketTable_;
+            return TRAFFICFILTER_OK;
+        }
+    }
+    auto snapshotTime = std::chrono::steady_clock::now();
     NetPortStatesInfo netPortStatesInfo;
     int32_t ret = NetsysController::GetInstance().GetSystemNetPortStates(netPortStatesInfo);
     if (ret != 0) {
         NETMGR_EXT_LOG_E("QueryProcess: GetSystemNetPortStates failed, ret=%{public}d", ret);
         return ret;
     }
-    if (protocol == NETTRAFFICFILTER_PROTO_TCP) {
-        for (const auto& tcpInfo : netPortStatesInfo.tcpNetPortStatesInfo_) {
-            if (MatchTcpConnection(tcpInfo, srcIp, srcPort, dstIp, dstPort)) {
-                uid = tcpInfo.tcpUid_;
-                pid = tcpInfo.tcpPid_;
-                NETMGR_EXT_LOG_I("QueryProcess found TCP connection: uid=%{public}u, pid=%{public}u", uid, pid);
-                return TRAFFICFILTER_OK;
+    std::shared_ptr<const SocketOwnerTable> fresh = BuildSocketOwnerTable(netPortStatesInfo, snapshotTime);
+    {
+        std::lock_guard<std::mutex> lock(socketTableMutex_);
+        socketTable_ = fresh;
+    }
+    table = fresh;
+    return TRAFFICFILTER_OK;
+}
+
+std::shared_ptr<NetTrafficFilterRedirectManager::SocketOwnerTable> NetTrafficFilterRedirectManager::
+    BuildSocketOwnerTable(NetPortStatesInfo& states, std::chrono::steady_clock::time_point snapshotTime)
+{
+    auto table = std::make_shared<SocketOwnerTable>();
+    table->states.tcpNetPortStatesInfo_ = std::move(states.tcpNetPortStatesInfo_);
+    table->states.udpNetPortStatesInfo_ = std::move(states.udpNetPortStatesInfo_);
+    table->snapshotTime = snapshotTime;
+    const auto& tcpStates = table->states.tcpNetPortStatesInfo_;
+    for (size_t pos = 0; pos < tcpStates.size(); pos++) {
+        IndexSocket(*table, NETTRAFFICFILTER_PROTO_TCP, tcpStates[pos].tcpLocalIp_, tcpStates[pos].tcpLocalPort_,
+            pos);
+    }
+    const auto& udpStates = table->states.udpNetPortStatesInfo_;
+    for (size_t pos = 0; pos < udpStates.size(); pos++) {
+        IndexSocket(*table, NETTRAFFICFILTER_PROTO_UDP, udpStates[pos].udpLocalIp_, udpStates[pos].udpLocalPort_,
+            pos);
+    }
+    LoadSocketCookies(*table);
+    return table;
+}
+
+void NetTrafficFilterRedirectManager::IndexSocket(SocketOwnerTable& table, uint8_t protocol, const std::string& ip,
+    uint16_t port, size_t pos)
+{
+    SocketEndpointKey key;
+    if (!MakeSocketEndpointKey(protocol, ip, port, key)) {
+        (protocol == NETTRAFFICFILTER_PROTO_TCP ? table.unindexedTcp : table.unindexedUdp).push_back(pos);
+        return;
+    }
+    table.index[key].push_back(pos);
+    if (port != 0) {
+        key.port = 0;
+        table.index[key].push_back(pos);
+    }
+}
+
+bool NetTrafficFilterRedirectManager::MakeSocketEndpointKey(uint8_t protocol, const std::string& ip, uint16_t port,
+    SocketEndpointKey& key)
+{
+    key.protocol = protocol;
+    key.port = port;
+    if (inet_pton(AF_INET, ip.c_str(), key.addr.data()) == 1) {
+        key.family = AF_INET;
+        return true;
+    }
+    if (inet_pton(AF_INET6, ip.c_str(), key.addr.data()) == 1) {
+        key.family = AF_INET6;
+        return true;
+    }
+    return false;
+}
+
+size_t NetTrafficFilterRedirectManager::SocketEndpointKeyHash::operator()(const SocketEndpointKey& key) const
+{
+    size_t hash = (static_cast<size_t>(key.protocol) << SOCKET_KEY_PROTOCOL_SHIFT) ^
+        (static_cast<size_t>(key.family) << SOCKET_KEY_FAMILY_SHIFT) ^ key.port;
+    for (uint8_t byte : key.addr) {
+        hash = hash * SOCKET_KEY_HASH_PRIME + byte;
+    }
+    return hash;
+}
+
+void NetTrafficFilterRedirectManager::AppendSocketCandidates(const SocketOwnerTable& table, uint8_t protocol,
+    const std::string& ip, uint16_t port, std::vector<size_t>& candidates)
+{
+    SocketEndpointKey key;
+    if (!MakeSocketEndpointKey(protocol, ip, port, key)) {
+        return;
+    }
+    auto it = table.index.find(key);
+    if (it != table.index.end()) {
+        candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+    }
+}
+
+bool NetTrafficFilterRedirectManager::LookupSocketOwner(const SocketOwnerTable& table,
+    const TrafficFilterConnectionTuple& connection, TrafficFilterProcessOwner& owner, size_t& pos)
+{
+    owner.result_ = TRAFFICFILTER_ERROR_NOT_FOUND;
+    bool isTcp = connection.protocol_ == NETTRAFFICFILTER_PROTO_TCP;
+    if (!isTcp && connection.protocol_ != NETTRAFFICFILTER_PROTO_UDP) {
+        // No socket table covers other protocols, a fresher dump cannot resolve it either
+        return true;
+    }
+    // Both matchers require the local endpoint to be the source or the destination, the index only narrows
+    // the scan and the matchers still decide, so results equal the linear scan over the same snapshot
+    std::vector<size_t> candidates;
+    AppendSocketCandidates(table, connection.protocol_, connection.dstIp_, connection.dstPort_, candidates);
+    AppendSocketCandidates(table, connection.protocol_, connection.srcIp_, connection.srcPort_, candidates);
+    const auto& unindexed = isTcp ? table.unindexedTcp : table.unindexedUdp;
+    candidates.insert(candidates.end(), unindexed.begin(), unindexed.end());
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    for (size_t candidate : candidates) {
+        pos = candidate;
+        if (isTcp) {
+            const auto& tcpInfo = table.states.tcpNetPortStatesInfo_[pos];
+            if (MatchTcpConnection(tcpInfo, connection.srcIp_, connection.srcPort_, connection.dstIp_,
+                connection.dstPort_)) {
+                owner.result_ = TRAFFICFILTER_OK;
+                owner.uid_ = tcpInfo.tcpUid_;
+                owner.pid_ = tcpInfo.tcpPid_;
+                return true;
             }
+            continue;
         }
-    } else if (protocol == NETTRAFFICFILTER_PROTO_UDP) {
-        for (const auto& udpInfo : netPortStatesInfo.udpNetPortStatesInfo_) {
-            if (MatchUdpConnection(udpInfo, srcIp, srcPort, dstIp, dstPort)) {
-                uid = udpInfo.udpUid_;
-                pid = udpInfo.udpPid_;
-                NETMGR_EXT_LOG_I("QueryProcess found UDP connection: uid=%{public}u, pid=%{public}u", uid, pid);
-                return TRAFFICFILTER_OK;
+        const auto& udpInfo = table.states.udpNetPortStatesInfo_[pos];
+        if (MatchUdpConnection(udpInfo, connection.srcIp_, connection.srcPort_, connection.dstIp_,
+            connection.dstPort_)) {
+            owner.result_ = TRAFFICFILTER_OK;
+            owner.uid_ = udpInfo.udpUid_;
+            owner.pid_ = udpInfo.udpPid_;
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint64_t GetSocketCookie(const struct inet_diag_msg& msg)
+{
+    return (static_cast<uint64_t>(msg.id.idiag_cookie[1]) << SOCKET_COOKIE_HIGH_SHIFT) | msg.id.idiag_cookie[0];
+}
+
+static void SetDiagAddress(const std::array<uint8_t, NETTRAFFICFILTER_IP_ADDRLEN>& addr, __be32* diagAddr)
+{
+    std::copy_n(addr.begin(), addr.size(), reinterpret_cast<uint8_t*>(diagAddr));
+}
+
+// The port dump carries no socket identity, so the sockets are dumped once more through sock_diag when the table is
+// built and every entry keeps the cookie of its socket. Cookies are never reused while the system runs.
+void NetTrafficFilterRedirectManager::LoadSocketCookies(SocketOwnerTable& table)
+{
+    const auto& tcpStates = table.states.tcpNetPortStatesInfo_;
+    const auto& udpStates = table.states.udpNetPortStatesInfo_;
+    table.tcpCookies.assign(tcpStates.size(), 0);
+    table.udpCookies.assign(udpStates.size(), 0);
+    int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+    if (fd < 0) {
+        NETMGR_EXT_LOG_E("LoadSocketCookies: socket failed, errno=%{public}d", errno);
+        return;
+    }
+    SocketCookieMap tcpCookies;
+    SocketCookieMap udpCookies;
+    for (uint8_t family : {AF_INET, AF_INET6}) {
+        DumpSocketCookies(fd, NETTRAFFICFILTER_PROTO_TCP, family, tcpCookies);
+        DumpSocketCookies(fd, NETTRAFFICFILTER_PROTO_UDP, family, udpCookies);
+    }
+    close(fd);
+    SocketEndpointKey local;
+    SocketEndpointKey remote;
+    for (size_t pos = 0; pos < tcpStates.size(); pos++) {
+        if (GetSocketKeys(table, true, pos, local, remote)) {
+            table.tcpCookies[pos] = FindSocketCookie(tcpCookies, local, &remote);
+        }
+    }
+    for (size_t pos = 0; pos < udpStates.size(); pos++) {
+        if (GetSocketKeys(table, false, pos, local, remote)) {
+            table.udpCookies[pos] = FindSocketCookie(udpCookies, local, nullptr);
+        }
+    }
+}
+
+bool NetTrafficFilterRedirectManager::DumpSocketCookies(int fd, uint8_t protocol, uint8_t family,
+    SocketCookieMap& cookies)
+{
+    struct inet_diag_req_v2 req = {};
+    req.sdiag_family = family;
+    req.sdiag_protocol = protocol;
+    req.idiag_states = SOCKET_DIAG_ALL_STATES;
+    if (!SendSocketDiagRequest(fd, req, NLM_F_DUMP)) {
+        return false;
+    }
+    size_t addrLen = (family == AF_INET) ? IPV4_ADDR_BYTES : NETTRAFFICFILTER_IP_ADDRLEN;
+    return ReceiveSocketDiag(fd, true, [protocol, addrLen, &cookies](const struct inet_diag_msg& msg) {
+        SocketEndpointKey local;
+        SocketDiagEntry entry;
+        local.protocol = entry.remote.protocol = protocol;
+        local.family = entry.remote.family = msg.idiag_family;
+        local.port = ntohs(msg.id.idiag_sport);
+        entry.remote.port = ntohs(msg.id.idiag_dport);
+        std::copy_n(reinterpret_cast<const uint8_t*>(msg.id.idiag_src), addrLen, local.addr.begin());
+        std::copy_n(reinterpret_cast<const uint8_t*>(msg.id.idiag_dst), addrLen, entry.remote.addr.begin());
+        entry.cookie = GetSocketCookie(msg);
+        cookies[local].push_back(entry);
+    });
+}
+
+// The port dump has no remote end for UDP, so a UDP entry is only identified when a single socket uses its
+// local endpoint. An entry matching several sockets keeps cookie 0.
+uint64_t NetTrafficFilterRedirectManager::FindSocketCookie(const SocketCookieMap& cookies,
+    const SocketEndpointKey& local, const SocketEndpointKey* remote)
+{
+    auto it = cookies.find(local);
+    if (it == cookies.end()) {
+        return 0;
+    }
+    uint64_t cookie = 0;
+    for (const auto& entry : it->second) {
+        if (remote != nullptr && !(entry.remote == *remote)) {
+            continue;
+        }
+        if (cookie != 0) {
+            return 0;
+        }
+        cookie = entry.cookie;
+    }
+    return cookie;
+}
+
+bool NetTrafficFilterRedirectManager::GetSocketKeys(const SocketOwnerTable& table, bool isTcp, size_t pos,
+    SocketEndpointKey& local, SocketEndpointKey& remote)
+{
+    if (!isTcp) {
+        const auto& udpInfo = table.states.udpNetPortStatesInfo_[pos];
+        if (!MakeSocketEndpointKey(NETTRAFFICFILTER_PROTO_UDP, udpInfo.udpLocalIp_, udpInfo.udpLocalPort_, local)) {
+            return false;
+        }
+        remote = SocketEndpointKey();
+        remote.protocol = local.protocol;
+        remote.family = local.family;
+        return true;
+    }
+    const auto& tcpInfo = table.states.tcpNetPortStatesInfo_[pos];
+    return MakeSocketEndpointKey(NETTRAFFICFILTER_PROTO_TCP, tcpInfo.tcpLocalIp_, tcpInfo.tcpLocalPort_, local) &&
+        MakeSocketEndpointKey(NETTRAFFICFILTER_PROTO_TCP, tcpInfo.tcpRemoteIp_, tcpInfo.tcpRemotePort_, remote) &&
+        local.family == remote.family;
+}
+
+// A cached hit is served only while the kernel still finds the socket of the entry under the cookie it had when
+// the table was built, otherwise the socket was closed or replaced after the snapshot
+bool NetTrafficFilterRedirectManager::IsSocketOwnerCurrent(const SocketOwnerTable& table, bool isTcp, size_t pos)
+{
+    const auto& cookies = isTcp ? table.tcpCookies : table.udpCookies;
+    SocketEndpointKey local;
+    SocketEndpointKey remote;
+    if (pos >= cookies.size() || cookies[pos] == 0 || !GetSocketKeys(table, isTcp, pos, local, remote)) {
+        return false;
+    }
+    struct inet_diag_req_v2 req = {};
+    req.sdiag_family = local.family;
+    req.sdiag_protocol = local.protocol;
+    req.idiag_states = SOCKET_DIAG_ALL_STATES;
+    // udp_diag looks the socket up like a received datagram, with the remote end as the source
+    const SocketEndpointKey& src = isTcp ? local : remote;
+    const SocketEndpointKey& dst = isTcp ? remote : local;
+    req.id.idiag_sport = htons(src.port);
+    req.id.idiag_dport = htons(dst.port);
+    SetDiagAddress(src.addr, req.id.idiag_src);
+    SetDiagAddress(dst.addr, req.id.idiag_dst);
+    req.id.idiag_cookie[0] = static_cast<uint32_t>(cookies[pos]);
+    req.id.idiag_cookie[1] = static_cast<uint32_t>(cookies[pos] >> SOCKET_COOKIE_HIGH_SHIFT);
+    int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+    if (fd < 0) {
+        NETMGR_EXT_LOG_E("IsSocketOwnerCurrent: socket failed, errno=%{public}d", errno);
+        return false;
+    }
+    bool found = false;
+    if (SendSocketDiagRequest(fd, req, 0)) {
+        ReceiveSocketDiag(fd, false, [&found, &cookies, pos](const struct inet_diag_msg& msg) {
+            found = GetSocketCookie(msg) == cookies[pos];
+        });
+    }
+    close(fd);
+    return found;
+}
+
+bool NetTrafficFilterRedirectManager::SendSocketDiagRequest(int fd, const struct inet_diag_req_v2& req,
+    uint16_t flags)
+{
+    struct {
+        struct nlmsghdr nlh;
+        struct inet_diag_req_v2 req;
+    } msg = {};
+    msg.nlh.nlmsg_len = sizeof(msg);
+    msg.nlh.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    msg.nlh.nlmsg_flags = NLM_F_REQUEST | flags;
+    msg.req = req;
+    struct sockaddr_nl kernel = {};
+    kernel.nl_family = AF_NETLINK;
+    ssize_t sent = sendto(fd, &msg, sizeof(msg), 0, reinterpret_cast<struct sockaddr*>(&kernel), sizeof(kernel));
+    if (sent != static_cast<ssize_t>(sizeof(msg))) {
+        NETMGR_EXT_LOG_E("SendSocketDiagRequest failed, errno=%{public}d", errno);
+        return false;
+    }
+    return true;
+}
+
+// Reads the answer to one request, a dump ends with NLMSG_DONE and a single lookup with its only message.
+// Returns false when the kernel reported an error, which for a lookup means the socket is gone.
+bool NetTrafficFilterRedirectManager::ReceiveSocketDiag(int fd, bool isDump,
+    const std::function<void(const struct inet_diag_msg&)>& onSocket)
+{
+    std::vector<uint32_t> buf(SOCKET_DIAG_RECV_BUF_SIZE / sizeof(uint32_t));
+    while (true) {
+        ssize_t len = recv(fd, buf.data(), SOCKET_DIAG_RECV_BUF_SIZE, 0);
+        if (len < 0 && errno == EINTR) {
+            continue;
+        }
+        if (len <= 0) {
+            return false;
+        }
+        int remaining = static_cast<int>(len);
+        for (auto nlh = reinterpret_cast<struct nlmsghdr*>(buf.data()); NLMSG_OK(nlh, remaining);
+            nlh = NLMSG_NEXT(nlh, remaining)) {
+            if (nlh->nlmsg_type == NLMSG_DONE) {
+                return true;
+            }
+            if (nlh->nlmsg_type == NLMSG_ERROR) {
+                return false;
             }
+            if (nlh->nlmsg_type == SOCK_DIAG_BY_FAMILY && nlh->nlmsg_len >= NLMSG_LENGTH(sizeof(inet_diag_msg))) {
+                onSocket(*static_cast<const struct inet_diag_msg*>(NLMSG_DATA(nlh)));
+            }
+        }
+        if (!isDump) {
+            return true;
         }
     }
-    NETMGR_EXT_LOG_E("QueryProcess: no matching process found");
-    return TRAFFICFILTER_ERROR_NOT_FOUND;
 }
 
 bool NetTrafficFilterRedirectManager::MatchTcpConnection(const TcpNetPortStatesInfo& tcpInfo,
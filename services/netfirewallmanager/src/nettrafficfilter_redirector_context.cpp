@@ -65,6 +65,7 @@ int32_t NetTrafficFilterRedirectorContext::AddRuleWithPriority(const TrafficFilt
     std::lock_guard<std::mutex> lock(mutex_);
 
     rules_.push_back(rule);
+    hookFamilyMaskValid_ = false;
 
     std::sort(rules_.begin(), rules_.end(),
         [](const TrafficFilterRedirectRule& a, const TrafficFilterRedirectRule& b) {
@@ -81,6 +82,7 @@ int32_t NetTrafficFilterRedirectorContext::ClearRules()
     std::lock_guard<std::mutex> lock(mutex_);
     int32_t count = static_cast<int32_t>(rules_.size());
     rules_.clear();
+    hookFamilyMaskValid_ = false;
     NETMGR_EXT_LOG_I("Cleared %{public}d rules from redirector %{public}s", count, redirectorId_.c_str());
     return NETFIREWALL_SUCCESS;
 }
@@ -107,6 +109,7 @@ int32_t NetTrafficFilterRedirectorContext::RestoreRules(const std::vector<Traffi
 {
     std::lock_guard<std::mutex> lock(mutex_);
     rules_ = rules;
+    hookFamilyMaskValid_ = false;
     std::sort(rules_.begin(), rules_.end(),
         [](const TrafficFilterRedirectRule& a, const TrafficFilterRedirectRule& b) {
             return a.priority_ < b.priority_;
@@ -116,5 +119,19 @@ int32_t NetTrafficFilterRedirectorContext::RestoreRules(const std::vector<Traffi
     return NETFIREWALL_SUCCESS;
 }
 
+bool NetTrafficFilterRedirectorContext::GetHookFamilyMask(uint32_t& mask) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    mask = hookFamilyMask_;
+    return hookFamilyMaskValid_;
+}
+
+void NetTrafficFilterRedirectorContext::SetHookFamilyMask(uint32_t mask)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    hookFamilyMask_ = mask;
+    hookFamilyMaskValid_ = true;
+}
+
 } // namespace NetManagerStandard
 } // namespace OHOS
@@ -14,8 +14,12 @@
  */
 
 #include <gtest/gtest.h>
+#include <atomic>
+#include <future>
 #include <thread>
 #include <arpa/inet.h>
+#include <net/if.h>
+#include <unistd.h>
 
 #ifdef GTEST_API_
 #define private public
@@ -574,14 +578,19 @@ HWTEST_F(MDnsProtocolImplTest, BrowseTest001, TestSize.Level0)
     EXPECT_EQ(ret, false);
 }
 
-HWTEST_F(MDnsProtocolImplTest, ConnectControlTest001, TestSize.Level0)
+HWTEST_F(MDnsProtocolImplTest, ProbeConnectivityTest002, TestSize.Level0)
 {
-    int32_t sockfd = 0;
-    sockaddr serverAddr;
-    auto mDnsProtocolImpl = std::make_shared<MDnsProtocolImpl>();
-    mDnsProtocolImpl->Init();
-    int32_t result = mDnsProtocolImpl->ConnectControl(sockfd, &serverAddr);
-    EXPECT_EQ(result, NETMANAGER_EXT_ERR_INTERNAL);
+    EXPECT_TRUE(MDnsProtocolImpl::ProbeConnectivity({}).empty());
+    std::vector<MDnsProtocolImpl::ProbeTarget> targets(2);
+    targets[0].addr = "";
+    targets[0].port = 1234;
+    targets[1].addr = "::1";
+    targets[1].ipv6 = false;
+    targets[1].port = 1234;
+    std::vector<bool> alive = MDnsProtocolImpl::ProbeConnectivity(targets);
+    ASSERT_EQ(alive.size(), targets.size());
+    EXPECT_FALSE(alive[0]);
+    EXPECT_FALSE(alive[1]);
 }
 
 HWTEST_F(MDnsProtocolImplTest, IsConnectivityTest001, TestSize.Level0)
@@ -1933,5 +1942,500 @@ HWTEST_F(MDnsProtocolImplTest, DecoratedTest008, TestSize.Level1)
     std::string result = mDnsProtocolImpl->Decorated(serviceName);
     EXPECT_EQ(result, "MyService._http._tcp.local");
 }
+
+/**
+ * @tc.name: SocketListenerDrainTest001
+ * @tc.desc: A burst larger than one recvmmsg batch is delivered completely and in order
+ * @tc.type: FUNC
+ */
+HWTEST_F(MDnsProtocolImplTest, SocketListenerDrainTest001, TestSize.Level1)
+{
+    constexpr int burst = 50;
+    constexpr int timeoutSec = 10;
+    int sock = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    ASSERT_GE(sock, 0);
+    const int one = 1;
+    setsockopt(sock, IPPROTO_IP, IP_PKTINFO, &one, sizeof(one));
+    sockaddr_in addr{.sin_family = AF_INET};
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLen = sizeof(addr);
+    ASSERT_EQ(bind(sock, reinterpret_cast<sockaddr *>(&addr), addrLen), 0);
+    ASSERT_EQ(getsockname(sock, reinterpret_cast<sockaddr *>(&addr), &addrLen), 0);
+
+    MDnsSocketListener listener;
+    listener.socks_.emplace_back(sock);
+    listener.iface_[sock] = "lo";
+    listener.ifIndex_[sock] = if_nametoindex("lo");
+    std::atomic<int> received = 0;
+    std::atomic<bool> ordered = true;
+    std::promise<void> allReceived;
+    std::future<void> done = allReceived.get_future();
+    listener.SetReceiveHandler([&](int, const MDnsPayload &payload) {
+        if (payload.size() != static_cast<size_t>(received.load() + 1)) {
+            ordered = false;
+        }
+        if (++received == burst) {
+            allReceived.set_value();
+        }
+    });
+
+    int sender = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(sender, 0);
+    uint8_t data[burst] = {};
+    for (int i = 0; i < burst; ++i) {
+        sendto(sender, data, i + 1, 0, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    }
+    listener.Start();
+    // The timeout only bounds a broken run, the burst is complete as soon as the last datagram is handled
+    EXPECT_EQ(done.wait_for(std::chrono::seconds(timeoutSec)), std::future_status::ready);
+    listener.Stop();
+    listener.CloseAllSocket();
+    close(sender);
+    EXPECT_EQ(received.load(), burst);
+    EXPECT_TRUE(ordered.load());
+}
+
+/**
+ * @tc.name: ReceiveQuestionCacheTest001
+ * @tc.desc: Responses are cached per question section and dropped when the registered services change
+ * @tc.type: FUNC
+ */
+HWTEST_F(MDnsProtocolImplTest, ReceiveQuestionCacheTest001, TestSize.Level1)
+{
+    auto mDnsProtocolImpl = std::make_shared<MDnsProtocolImpl>();
+    mDnsProtocolImpl->config_.topDomain = MDNS_TOP_DOMAIN_DEFAULT;
+    int sock = -1;
+    mDnsProtocolImpl->listener_.saddr_[sock].ss_family = AF_INET;
+    MDnsProtocolImpl::Result result;
+    result.port = DEMO_PORT;
+    mDnsProtocolImpl->srvMap_[mDnsProtocolImpl->Decorated(std::string(DEMO_NAME) + "." + DEMO_TYPE)] = result;
+
+    MDnsMessage query;
+    query.questions.emplace_back(DNSProto::Question{
+        .name = mDnsProtocolImpl->Decorated(DEMO_TYPE),
+        .qtype = DNSProto::RRTYPE_PTR,
+        .qclass = DNSProto::RRCLASS_IN,
+    });
+    MDnsPayload payload = MDnsPayloadParser().ToBytes(query);
+    mDnsProtocolImpl->ReceivePacket(sock, payload);
+    ASSERT_EQ(mDnsProtocolImpl->responseCache_[sock].size(), 1);
+    EXPECT_FALSE(mDnsProtocolImpl->responseCache_[sock].begin()->second.empty());
+    mDnsProtocolImpl->ReceivePacket(sock, payload);
+    EXPECT_EQ(mDnsProtocolImpl->responseCache_[sock].size(), 1);
+
+    query.questions[0].name = mDnsProtocolImpl->Decorated("_unknown._tcp");
+    mDnsProtocolImpl->ReceivePacket(sock, MDnsPayloadParser().ToBytes(query));
+    EXPECT_EQ(mDnsProtocolImpl->responseCache_[sock].size(), 2);
+
+    EXPECT_EQ(mDnsProtocolImpl->UnRegister(std::string(DEMO_NAME) + "." + DEMO_TYPE), NETMANAGER_EXT_SUCCESS);
+    EXPECT_TRUE(mDnsProtocolImpl->responseCache_.empty());
+}
+
+/**
+ * @tc.name: ProbeConnectivityTest001
+ * @tc.desc: One probe batch reports a listening loopback port alive and a closed port or bad address dead
+ * @tc.type: FUNC
+ */
+HWTEST_F(MDnsProtocolImplTest, ProbeConnectivityTest001, TestSize.Level1)
+{
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(server, 0);
+    sockaddr_in addr{.sin_family = AF_INET};
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLen = sizeof(addr);
+    ASSERT_EQ(bind(server, reinterpret_cast<sockaddr *>(&addr), addrLen), 0);
+    ASSERT_EQ(listen(server, 1), 0);
+    ASSERT_EQ(getsockname(server, reinterpret_cast<sockaddr *>(&addr), &addrLen), 0);
+    int closed = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(closed, 0);
+    sockaddr_in closedAddr{.sin_family = AF_INET};
+    closedAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t closedLen = sizeof(closedAddr);
+    ASSERT_EQ(bind(closed, reinterpret_cast<sockaddr *>(&closedAddr), closedLen), 0);
+    ASSERT_EQ(getsockname(closed, reinterpret_cast<sockaddr *>(&closedAddr), &closedLen), 0);
+    close(closed);
+
+    std::vector<MDnsProtocolImpl::ProbeTarget> targets(3);
+    targets[0].addr = "127.0.0.1";
+    targets[0].port = ntohs(addr.sin_port);
+    targets[1].addr = "127.0.0.1";
+    targets[1].port = ntohs(closedAddr.sin_port);
+    targets[2].addr = "not an address";
+    targets[2].port = ntohs(addr.sin_port);
+    std::vector<bool> alive = MDnsProtocolImpl::ProbeConnectivity(targets);
+    close(server);
+    ASSERT_EQ(alive.size(), targets.size());
+    EXPECT_TRUE(alive[0]);
+    EXPECT_FALSE(alive[1]);
+    EXPECT_FALSE(alive[2]);
+}
+
+/**
+ * @tc.name: ApplyProbeResultsTest001
+ * @tc.desc: A failed probe only drops the service when it was not refreshed while the probe was running
+ * @tc.type: FUNC
+ */
+HWTEST_F(MDnsProtocolImplTest, ApplyProbeResultsTest001, TestSize.Level0)
+{
+    auto mDnsProtocolImpl = std::make_shared<MDnsProtocolImpl>();
+    mDnsProtocolImpl->Init();
+    MDnsProtocolImpl::Result result;
+    result.serviceName = DEMO_NAME;
+    result.serviceType = DEMO_TYPE;
+    result.state = MDnsProtocolImpl::State::LIVE;
+    result.refrehTime = 1;
+    mDnsProtocolImpl->browserMap_["test_key"].push_back(result);
+
+    MDnsProtocolImpl::ProbeTarget target;
+    target.key = "test_key";
+    target.serviceName = DEMO_NAME;
+    target.refrehTime = 0;
+    uint64_t generation = mDnsProtocolImpl->probeGeneration_;
+    mDnsProtocolImpl->probeInFlight_ = true;
+    mDnsProtocolImpl->ApplyProbeResults(generation, {target}, {false});
+    EXPECT_FALSE(mDnsProtocolImpl->probeInFlight_);
+    EXPECT_EQ(mDnsProtocolImpl->browserMap_["test_key"].size(), 1u);
+
+    target.refrehTime = result.refrehTime;
+    mDnsProtocolImpl->ApplyProbeResults(generation, {target}, {true});
+    EXPECT_EQ(mDnsProtocolImpl->browserMap_["test_key"].size(), 1u);
+    mDnsProtocolImpl->ApplyProbeResults(generation, {target}, {false});
+    EXPECT_TRUE(mDnsProtocolImpl->browserMap_["test_key"].empty());
+}
+
+/**
+ * @tc.name: ApplyProbeResultsTest002
+ * @tc.desc: Init releases a probe whose result was dropped with the task queue, its late result is ignored
+ * @tc.type: FUNC
+ */
+HWTEST_F(MDnsProtocolImplTest, ApplyProbeResultsTest002, TestSize.Level0)
+{
+    auto mDnsProtocolImpl = std::make_shared<MDnsProtocolImpl>();
+    mDnsProtocolImpl->Init();
+    MDnsProtocolImpl::Result result;
+    result.serviceName = DEMO_NAME;
+    result.serviceType = DEMO_TYPE;
+    result.state = MDnsProtocolImpl::State::LIVE;
+    result.refrehTime = 1;
+    mDnsProtocolImpl->browserMap_["test_key"].push_back(result);
+
+    MDnsProtocolImpl::ProbeTarget target;
+    target.key = "test_key";
+    target.serviceName = DEMO_NAME;
+    target.refrehTime = result.refrehTime;
+    uint64_t generation = mDnsProtocolImpl->probeGeneration_;
+    mDnsProtocolImpl->probeInFlight_ = true;
+    mDnsProtocolImpl->Init();
+    EXPECT_FALSE(mDnsProtocolImpl->probeInFlight_);
+    EXPECT_NE(mDnsProtocolImpl->probeGeneration_, generation);
+
+    mDnsProtocolImpl->probeInFlight_ = true;
+    mDnsProtocolImpl->ApplyProbeResults(generation, {target}, {false});
+    EXPECT_TRUE(mDnsProtocolImpl->probeInFlight_);
+    EXPECT_EQ(mDnsProtocolImpl->browserMap_["test_key"].size(), 1u);
+}
+/**
+ * @tc.name: KnownAnswerSuppressionTest001
+ * @tc.desc: Answers listed by the querier with half their TTL left, or just multicast by another host, are dropped
+ * @tc.type: FUNC
+ */
+HWTEST_F(MDnsProtocolImplTest, KnownAnswerSuppressionTest001, TestSize.Level1)
+{
+    auto mDnsProtocolImpl = std::make_shared<MDnsProtocolImpl>();
+    mDnsProtocolImpl->config_.topDomain = MDNS_TOP_DOMAIN_DEFAULT;
+    int sock = -1;
+    mDnsProtocolImpl->listener_.saddr_[sock].ss_family = AF_INET;
+    MDnsProtocolImpl::Result result;
+    result.port = DEMO_PORT;
+    std::string type = mDnsProtocolImpl->Decorated(DEMO_TYPE);
+    std::string instance = mDnsProtocolImpl->Decorated(std::string(DEMO_NAME) + "." + DEMO_TYPE);
+    mDnsProtocolImpl->srvMap_[instance] = result;
+
+    MDnsMessage query;
+    query.questions.emplace_back(DNSProto::Question{
+        .name = type,
+        .qtype = DNSProto::RRTYPE_PTR,
+        .qclass = DNSProto::RRCLASS_IN,
+    });
+    query.header.qdcount = query.questions.size();
+    EXPECT_FALSE(mDnsProtocolImpl->BuildQuestionResponse(sock, query).empty());
+    query.answers.emplace_back(DNSProto::ResourceRecord{
+        .name = type,
+        .rtype = static_cast<uint16_t>(DNSProto::RRTYPE_PTR),
+        .rclass = DNSProto::RRCLASS_IN,
+        .ttl = 120,
+        .rdata = instance,
+    });
+    EXPECT_TRUE(mDnsProtocolImpl->BuildQuestionResponse(sock, query).empty());
+    query.answers[0].ttl = 30;
+    EXPECT_FALSE(mDnsProtocolImpl->BuildQuestionResponse(sock, query).empty());
+
+    MDnsMessage response;
+    response.header.flags = DNSProto::MDNS_ANSWER_FLAGS;
+    response.answers.emplace_back(query.answers[0]);
+    response.answers[0].ttl = 120;
+    MDnsPayload payload = MDnsPayloadParser().ToBytes(response);
+    mDnsProtocolImpl->RememberSent(payload);
+    mDnsProtocolImpl->ReceivePacket(sock, payload);
+    EXPECT_FALSE(mDnsProtocolImpl->HasHeardAnswers(sock));
+    mDnsProtocolImpl->sentPackets_.clear();
+    mDnsProtocolImpl->ReceivePacket(sock, payload);
+    EXPECT_TRUE(mDnsProtocolImpl->HasHeardAnswers(sock));
+    query.answers.clear();
+    EXPECT_TRUE(mDnsProtocolImpl->BuildQuestionResponse(sock, query).empty());
+}
+
+/**
+ * @tc.name: DuplicateQuestionSuppressionTest001
+ * @tc.desc: Another host's query counts as ours unless it lists known answers we lack, looped back queries do not
+ * @tc.type: FUNC
+ */
+HWTEST_F(MDnsProtocolImplTest, DuplicateQuestionSuppressionTest001, TestSize.Level1)
+{
+    auto mDnsProtocolImpl = std::make_shared<MDnsProtocolImpl>();
+    mDnsProtocolImpl->config_.topDomain = MDNS_TOP_DOMAIN_DEFAULT;
+    int sock = -1;
+    mDnsProtocolImpl->listener_.saddr_[sock].ss_family = AF_INET;
+    std::string type = mDnsProtocolImpl->Decorated(DEMO_TYPE);
+    MDnsProtocolImpl::Result result;
+    result.serviceName = DEMO_NAME;
+    result.serviceType = DEMO_TYPE;
+    result.state = MDnsProtocolImpl::State::LIVE;
+    result.ttl = 120;
+    result.refrehTime = MilliSecondsSinceEpochTest();
+    mDnsProtocolImpl->browserMap_[type].push_back(result);
+    ASSERT_EQ(mDnsProtocolImpl->KnownBrowseAnswers(type).size(), 1u);
+
+    std::vector<DNSProto::Question> questions{DNSProto::Question{
+        .name = type,
+        .qtype = DNSProto::RRTYPE_PTR,
+        .qclass = DNSProto::RRCLASS_IN,
+    }};
+    MDnsMessage query;
+    query.questions = questions;
+    MDnsPayload payload = MDnsPayloadParser().ToBytes(query);
+    mDnsProtocolImpl->ReceivePacket(sock, payload);
+    EXPECT_TRUE(mDnsProtocolImpl->IsQuestionHeard(sock, questions));
+
+    mDnsProtocolImpl->heardQuestions_.clear();
+    query.answers.emplace_back(DNSProto::ResourceRecord{
+        .name = type,
+        .rtype = static_cast<uint16_t>(DNSProto::RRTYPE_PTR),
+        .rclass = DNSProto::RRCLASS_IN,
+        .ttl = 120,
+        .rdata = mDnsProtocolImpl->Decorated(std::string("other.") + DEMO_TYPE),
+    });
+    mDnsProtocolImpl->ReceivePacket(sock, MDnsPayloadParser().ToBytes(query));
+    EXPECT_FALSE(mDnsProtocolImpl->IsQuestionHeard(sock, questions));
+
+    mDnsProtocolImpl->RememberSent(payload);
+    mDnsProtocolImpl->ReceivePacket(sock, payload);
+    EXPECT_FALSE(mDnsProtocolImpl->IsQuestionHeard(sock, questions));
+}
+
+/**
+ * @tc.name: TruncatedQueryTest001
+ * @tc.desc: A truncated query is answered later and collects the known answers of its follow-up packets
+ * @tc.type: FUNC
+ */
+HWTEST_F(MDnsProtocolImplTest, TruncatedQueryTest001, TestSize.Level1)
+{
+    auto mDnsProtocolImpl = std::make_shared<MDnsProtocolImpl>();
+    mDnsProtocolImpl->config_.topDomain = MDNS_TOP_DOMAIN_DEFAULT;
+    int sock = -1;
+    mDnsProtocolImpl->listener_.saddr_[sock].ss_family = AF_INET;
+    MDnsProtocolImpl::Result result;
+    result.port = DEMO_PORT;
+    std::string type = mDnsProtocolImpl->Decorated(DEMO_TYPE);
+    std::string instance = mDnsProtocolImpl->Decorated(std::string(DEMO_NAME) + "." + DEMO_TYPE);
+    mDnsProtocolImpl->srvMap_[instance] = result;
+
+    DNSProto::ResourceRecord known{
+        .name = type,
+        .rtype = static_cast<uint16_t>(DNSProto::RRTYPE_PTR),
+        .rclass = DNSProto::RRCLASS_IN,
+        .ttl = 120,
+        .rdata = mDnsProtocolImpl->Decorated(std::string("other.") + DEMO_TYPE),
+    };
+    MDnsMessage query;
+    query.header.flags = DNSProto::HEADER_FLAGS_TC_MASK;
+    query.questions.emplace_back(DNSProto::Question{
+        .name = type,
+        .qtype = DNSProto::RRTYPE_PTR,
+        .qclass = DNSProto::RRCLASS_IN,
+    });
+    query.answers.emplace_back(known);
+    mDnsProtocolImpl->ReceivePacket(sock, MDnsPayloadParser().ToBytes(query));
+    ASSERT_EQ(mDnsProtocolImpl->deferredQuestions_[sock].size(), 1u);
+    EXPECT_EQ(mDnsProtocolImpl->timerWheel_.Size(), 1u);
+
+    MDnsMessage followUp;
+    known.rdata = instance;
+    followUp.answers.emplace_back(known);
+    mDnsProtocolImpl->ReceivePacket(sock, MDnsPayloadParser().ToBytes(followUp));
+    ASSERT_EQ(mDnsProtocolImpl->deferredQuestions_[sock].size(), 1u);
+    EXPECT_EQ(mDnsProtocolImpl->deferredQuestions_[sock].front().answers.size(), 2u);
+    EXPECT_TRUE(mDnsProtocolImpl->BuildQuestionResponse(sock, mDnsProtocolImpl->deferredQuestions_[sock].front())
+                    .empty());
+
+    mDnsProtocolImpl->AnswerDeferredQuestion(sock);
+    EXPECT_TRUE(mDnsProtocolImpl->deferredQuestions_.empty());
+}
+
+/**
+ * @tc.name: LockDomainTest001
+ * @tc.desc: Queueing tasks, receiving and answering questions and unregistering do not wait for the discovery lock
+ * @tc.type: FUNC
+ */
+HWTEST_F(MDnsProtocolImplTest, LockDomainTest001, TestSize.Level1)
+{
+    auto mDnsProtocolImpl = std::make_shared<MDnsProtocolImpl>();
+    mDnsProtocolImpl->config_.topDomain = MDNS_TOP_DOMAIN_DEFAULT;
+    int sock = -1;
+    mDnsProtocolImpl->listener_.saddr_[sock].ss_family = AF_INET;
+    MDnsProtocolImpl::Result result;
+    result.port = DEMO_PORT;
+    mDnsProtocolImpl->srvMap_[mDnsProtocolImpl->Decorated(std::string(DEMO_NAME) + "." + DEMO_TYPE)] = result;
+    MDnsMessage query;
+    query.header.qdcount = 1;
+    query.questions.emplace_back(DNSProto::Question{
+        .name = mDnsProtocolImpl->Decorated(DEMO_TYPE),
+        .qtype = DNSProto::RRTYPE_PTR,
+        .qclass = DNSProto::RRCLASS_IN,
+    });
+
+    std::future<bool> client;
+    bool ready = false;
+    {
+        std::lock_guard<std::recursive_mutex> guard(mDnsProtocolImpl->mutex_);
+        client = std::async(std::launch::async, [&mDnsProtocolImpl, &query, sock]() {
+            mDnsProtocolImpl->AddTask([]() { return true; }, false);
+            MDnsPayload payload = MDnsPayloadParser().ToBytes(query);
+            mDnsProtocolImpl->ReceivePacket(sock, payload);
+            mDnsProtocolImpl->ReceivePacket(sock, payload);
+            bool answered = !mDnsProtocolImpl->BuildQuestionResponse(sock, query).empty();
+            return answered &&
+                   mDnsProtocolImpl->UnRegister(std::string(DEMO_NAME) + "." + DEMO_TYPE) == NETMANAGER_EXT_SUCCESS;
+        });
+        ready = client.wait_for(std::chrono::seconds(1)) == std::future_status::ready;
+    }
+    EXPECT_TRUE(ready);
+    EXPECT_TRUE(client.get());
+    EXPECT_EQ(mDnsProtocolImpl->taskQueue_.size(), 1);
+    EXPECT_TRUE(mDnsProtocolImpl->srvMap_.empty());
+    EXPECT_TRUE(mDnsProtocolImpl->responseCache_.empty());
+}
+
+/**
+ * @tc.name: HasQuestionToAnswerTest001
+ * @tc.desc: Only questions for published names, or malformed ones, get past the screening
+ * @tc.type: FUNC
+ */
+HWTEST_F(MDnsProtocolImplTest, HasQuestionToAnswerTest001, TestSize.Level1)
+{
+    auto mDnsProtocolImpl = std::make_shared<MDnsProtocolImpl>();
+    mDnsProtocolImpl->config_.topDomain = MDNS_TOP_DOMAIN_DEFAULT;
+    int sock = -1;
+    std::string type = mDnsProtocolImpl->Decorated(DEMO_TYPE);
+    std::string instance = mDnsProtocolImpl->Decorated(std::string(DEMO_NAME) + "." + DEMO_TYPE);
+    auto screen = [&mDnsProtocolImpl, sock](const std::string &name, DNSProto::RRType qtype) {
+        MDnsMessage query;
+        query.questions.emplace_back(DNSProto::Question{
+            .name = name,
+            .qtype = static_cast<uint16_t>(qtype),
+            .qclass = DNSProto::RRCLASS_IN,
+        });
+        MDnsPayload payload = MDnsPayloadParser().ToBytes(query);
+        return mDnsProtocolImpl->HasQuestionToAnswer(sock, MDnsPayloadView(payload));
+    };
+    EXPECT_FALSE(screen(type, DNSProto::RRTYPE_PTR));
+    mDnsProtocolImpl->listener_.saddr_[sock].ss_family = AF_INET;
+    EXPECT_FALSE(screen(type, DNSProto::RRTYPE_PTR));
+
+    MDnsProtocolImpl::Result result;
+    result.port = DEMO_PORT;
+    mDnsProtocolImpl->srvMap_[instance] = result;
+    EXPECT_TRUE(screen(type, DNSProto::RRTYPE_PTR));
+    EXPECT_TRUE(screen(instance, DNSProto::RRTYPE_SRV));
+    EXPECT_TRUE(screen(instance, DNSProto::RRTYPE_ANY));
+    EXPECT_FALSE(screen(mDnsProtocolImpl->Decorated("_other._tcp"), DNSProto::RRTYPE_PTR));
+    EXPECT_FALSE(screen(type, DNSProto::RRTYPE_SRV));
+    EXPECT_TRUE(screen(mDnsProtocolImpl->GetHostDomain(), DNSProto::RRTYPE_A));
+    EXPECT_FALSE(screen(mDnsProtocolImpl->GetHostDomain(), DNSProto::RRTYPE_AAAA));
+
+    MDnsMessage query;
+    query.questions.emplace_back(DNSProto::Question{
+        .name = mDnsProtocolImpl->Decorated("_other._tcp"),
+        .qtype = DNSProto::RRTYPE_PTR,
+        .qclass = DNSProto::RRCLASS_IN,
+    });
+    MDnsPayload payload = MDnsPayloadParser().ToBytes(query);
+    payload.pop_back();
+    EXPECT_TRUE(mDnsProtocolImpl->HasQuestionToAnswer(sock, MDnsPayloadView(payload)));
+}
+
+/**
+ * @tc.name: HasAnswerToProcessTest001
+ * @tc.desc: Browsed PTR answers and records of the socket's family get past the screening, echoes of our own
+ *           records, authority records and other families do not
+ * @tc.type: FUNC
+ */
+HWTEST_F(MDnsProtocolImplTest, HasAnswerToProcessTest001, TestSize.Level1)
+{
+    auto mDnsProtocolImpl = std::make_shared<MDnsProtocolImpl>();
+    mDnsProtocolImpl->config_.topDomain = MDNS_TOP_DOMAIN_DEFAULT;
+    int sock = -1;
+    std::string type = mDnsProtocolImpl->Decorated(DEMO_TYPE);
+    std::string instance = mDnsProtocolImpl->Decorated(std::string(DEMO_NAME) + "." + DEMO_TYPE);
+    std::string host = mDnsProtocolImpl->Decorated("peer");
+    auto record = [](const std::string &name, DNSProto::RRType rtype, const std::any &rdata) {
+        return DNSProto::ResourceRecord{
+            .name = name,
+            .rtype = static_cast<uint16_t>(rtype),
+            .rclass = DNSProto::RRCLASS_IN,
+            .ttl = 120,
+            .rdata = rdata,
+        };
+    };
+    auto screen = [&mDnsProtocolImpl, sock](const MDnsMessage &response) {
+        MDnsPayload payload = MDnsPayloadParser().ToBytes(response);
+        return mDnsProtocolImpl->HasAnswerToProcess(sock, MDnsPayloadView(payload));
+    };
+    MDnsMessage ptr;
+    ptr.header.flags = DNSProto::MDNS_ANSWER_FLAGS;
+    ptr.answers.emplace_back(record(type, DNSProto::RRTYPE_PTR, instance));
+    EXPECT_FALSE(screen(ptr));
+    mDnsProtocolImpl->listener_.saddr_[sock].ss_family = AF_INET;
+    EXPECT_FALSE(screen(ptr));
+    mDnsProtocolImpl->browserMap_[type];
+    EXPECT_TRUE(screen(ptr));
+
+    in_addr v4 = {};
+    in6_addr v6 = {};
+    MDnsMessage addr;
+    addr.header.flags = DNSProto::MDNS_ANSWER_FLAGS;
+    addr.answers.emplace_back(record(host, DNSProto::RRTYPE_AAAA, v6));
+    EXPECT_FALSE(screen(addr));
+    addr.authorities.emplace_back(record(host, DNSProto::RRTYPE_A, v4));
+    EXPECT_FALSE(screen(addr));
+    addr.additional.emplace_back(record(host, DNSProto::RRTYPE_A, v4));
+    EXPECT_TRUE(screen(addr));
+
+    MDnsMessage echo;
+    echo.header.flags = DNSProto::MDNS_ANSWER_FLAGS;
+    echo.answers.emplace_back(record(instance, DNSProto::RRTYPE_SRV, DNSProto::RDataSrv{
+        .priority = 0,
+        .weight = 0,
+        .port = DEMO_PORT,
+        .name = mDnsProtocolImpl->GetHostDomain(),
+    }));
+    EXPECT_TRUE(screen(echo));
+    mDnsProtocolImpl->srvMap_[instance] = MDnsProtocolImpl::Result{};
+    EXPECT_FALSE(screen(echo));
+
+    MDnsPayload payload = MDnsPayloadParser().ToBytes(addr);
+    payload.pop_back();
+    EXPECT_TRUE(mDnsProtocolImpl->HasAnswerToProcess(sock, MDnsPayloadView(payload)));
+}
 } // namespace NetManagerStandard
 } // namespace OHOS
\ No newline at end of file
@@ -24,6 +24,8 @@
 #include "registration_callback_stub.h"
 #include "resolve_callback_stub.h"
 #include "mdns_packet_parser.h"
+#include "mdns_suffix_map.h"
+#include "mdns_timer_wheel.h"
 
 namespace OHOS {
 namespace NetManagerStandard {
@@ -137,5 +139,281 @@ HWTEST_F(MDnsProtocolTest, MDnsPayloadParserTest006, TestSize.Level1)
     auto msg = parser.FromBytes(payload);
     EXPECT_NE(parser.GetError(), ERR_OK);
 }
+
+/**
+ * @tc.name: MDnsPayloadViewTest001
+ * @tc.desc: MDnsPayloadView reads the same names and types as MDnsPayloadParser
+ * @tc.type: FUNC
+ */
+HWTEST_F(MDnsProtocolTest, MDnsPayloadViewTest001, TestSize.Level1)
+{
+    MDnsPayload payload(std::begin(RESPONSE), std::end(RESPONSE) - 1);
+    MDnsPayloadParser parser;
+    auto msg = parser.FromBytes(payload);
+    MDnsPayloadView view(payload);
+    ASSERT_TRUE(view.IsValid());
+    EXPECT_EQ(view.GetHeader().ancount, msg.answers.size());
+    size_t pos = view.Begin();
+    for (const auto &answer : msg.answers) {
+        MDnsPayloadView::RecordView rr;
+        MDnsPayloadView::NameBuffer buffer;
+        std::string_view name;
+        ASSERT_TRUE(view.ReadRecord(pos, rr));
+        ASSERT_TRUE(view.ReadName(rr.nameOffset, buffer, name));
+        EXPECT_EQ(name, answer.name);
+        EXPECT_EQ(rr.rtype, answer.rtype);
+        EXPECT_EQ(rr.ttl, answer.ttl);
+    }
+    EXPECT_EQ(pos, payload.size());
+}
+
+/**
+ * @tc.name: MDnsPayloadViewTest002
+ * @tc.desc: MDnsPayloadView rejects truncated headers and forward compression pointers
+ * @tc.type: FUNC
+ */
+HWTEST_F(MDnsProtocolTest, MDnsPayloadViewTest002, TestSize.Level1)
+{
+    MDnsPayload shortPayload(std::begin(SERVICE_QUERY), std::begin(SERVICE_QUERY) + sizeof(DNSProto::Header) - 1);
+    EXPECT_FALSE(MDnsPayloadView(shortPayload).IsValid());
+
+    // One question whose name is a compression pointer to itself
+    MDnsPayload payload = {0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                           0xc0, 0x0c, 0x00, static_cast<uint8_t>(DNSProto::RRTYPE_PTR), 0x00,
+                           static_cast<uint8_t>(DNSProto::RRCLASS_IN)};
+    MDnsPayloadView view(payload);
+    ASSERT_TRUE(view.IsValid());
+    size_t pos = view.Begin();
+    MDnsPayloadView::QuestionView qu;
+    MDnsPayloadView::NameBuffer buffer;
+    std::string_view name;
+    ASSERT_TRUE(view.ReadQuestion(pos, qu));
+    EXPECT_EQ(qu.qtype, DNSProto::RRTYPE_PTR);
+    EXPECT_FALSE(view.ReadName(qu.nameOffset, buffer, name));
+}
+
+/**
+ * @tc.name: MDnsPayloadViewTest003
+ * @tc.desc: MDnsPayloadView follows backward compression pointers, also into a name and through another pointer
+ * @tc.type: FUNC
+ */
+HWTEST_F(MDnsProtocolTest, MDnsPayloadViewTest003, TestSize.Level1)
+{
+    MDnsPayload payload = {0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                           // offset 12: _http._tcp.local, _tcp starts at offset 18
+                           0x05, '_', 'h', 't', 't', 'p', 0x04, '_', 't', 'c', 'p', 0x05, 'l', 'o', 'c', 'a', 'l', 0x00,
+                           0x00, static_cast<uint8_t>(DNSProto::RRTYPE_PTR), 0x00,
+                           static_cast<uint8_t>(DNSProto::RRCLASS_IN),
+                           // offset 34: inst, then a pointer to offset 12
+                           0x04, 'i', 'n', 's', 't', 0xc0, 0x0c, 0x00, static_cast<uint8_t>(DNSProto::RRTYPE_SRV),
+                           0x00, static_cast<uint8_t>(DNSProto::RRCLASS_IN),
+                           // a pointer into the middle of the first name
+                           0xc0, 0x12, 0x00, static_cast<uint8_t>(DNSProto::RRTYPE_PTR), 0x00,
+                           static_cast<uint8_t>(DNSProto::RRCLASS_IN),
+                           // a pointer to the second name, which holds a pointer itself
+                           0xc0, 0x22, 0x00, static_cast<uint8_t>(DNSProto::RRTYPE_TXT), 0x00,
+                           static_cast<uint8_t>(DNSProto::RRCLASS_IN)};
+    const std::string_view expected[] = {"_http._tcp.local", "inst._http._tcp.local", "_tcp.local",
+                                         "inst._http._tcp.local"};
+    MDnsPayloadParser parser;
+    auto msg = parser.FromBytes(payload);
+    ASSERT_EQ(parser.GetError(), ERR_OK);
+    ASSERT_EQ(msg.questions.size(), std::size(expected));
+    MDnsPayloadView view(payload);
+    ASSERT_TRUE(view.IsValid());
+    size_t pos = view.Begin();
+    for (size_t i = 0; i < std::size(expected); ++i) {
+        MDnsPayloadView::QuestionView qu;
+        MDnsPayloadView::NameBuffer buffer;
+        std::string_view name;
+        ASSERT_TRUE(view.ReadQuestion(pos, qu));
+        ASSERT_TRUE(view.ReadName(qu.nameOffset, buffer, name));
+        EXPECT_EQ(name, expected[i]);
+        EXPECT_EQ(name, msg.questions[i].name);
+        EXPECT_EQ(qu.qtype, msg.questions[i].qtype);
+    }
+    EXPECT_EQ(pos, payload.size());
+}
+
+/**
+ * @tc.name: MDnsPayloadViewTest004
+ * @tc.desc: MDnsPayloadView rejects truncated entries, bad labels, bad address lengths and overlong names
+ * @tc.type: FUNC
+ */
+HWTEST_F(MDnsProtocolTest, MDnsPayloadViewTest004, TestSize.Level1)
+{
+    const MDnsPayload header = {0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00};
+    auto withBody = [&header](std::initializer_list<uint8_t> body) {
+        MDnsPayload payload = header;
+        payload.insert(payload.end(), body);
+        return payload;
+    };
+    MDnsPayloadView::QuestionView qu;
+    MDnsPayloadView::RecordView rr;
+    MDnsPayloadView::NameBuffer buffer;
+    std::string_view name;
+
+    // question type and class cut off
+    MDnsPayload payload = withBody({0x01, 'a', 0x00, 0x00});
+    size_t pos = MDnsPayloadView(payload).Begin();
+    EXPECT_FALSE(MDnsPayloadView(payload).ReadQuestion(pos, qu));
+
+    // label running past the end, reserved 0x40 label type, unterminated name
+    for (const auto &body : {withBody({0x10, 'a', 'b'}), withBody({0x40, 'a', 0x00, 0x00, 0x01, 0x00, 0x01}),
+                             withBody({0x01, 'a', 0x01, 'b'})}) {
+        MDnsPayloadView view(body);
+        pos = view.Begin();
+        EXPECT_FALSE(view.ReadQuestion(pos, qu));
+    }
+
+    // A record whose rdata is not an IPv4 address, and TXT rdata longer than the payload
+    payload = withBody({0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x02,
+                        0x0a, 0x00});
+    MDnsPayloadView view(payload);
+    pos = view.Begin();
+    ASSERT_TRUE(view.ReadQuestion(pos, qu));
+    EXPECT_FALSE(view.ReadRecord(pos, rr));
+    payload = withBody({0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x10, 0x00, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x64,
+                        0x01, 'a'});
+    MDnsPayloadView txtView(payload);
+    pos = txtView.Begin();
+    ASSERT_TRUE(txtView.ReadQuestion(pos, qu));
+    EXPECT_FALSE(txtView.ReadRecord(pos, rr));
+
+    // five full labels are well formed on the wire but longer than any domain name
+    payload = header;
+    for (int i = 0; i < 5; ++i) {
+        payload.push_back(static_cast<uint8_t>(MDNS_MAX_DOMAIN_LABEL));
+        payload.insert(payload.end(), MDNS_MAX_DOMAIN_LABEL, 'a');
+    }
+    payload.insert(payload.end(), {0x00, 0x00, 0x01, 0x00, 0x01});
+    MDnsPayloadView longView(payload);
+    pos = longView.Begin();
+    ASSERT_TRUE(longView.ReadQuestion(pos, qu));
+    EXPECT_FALSE(longView.ReadName(qu.nameOffset, buffer, name));
+}
+
+/**
+ * @tc.name: MDnsTimerWheelTest001
+ * @tc.desc: Timers fire in order, never before they expire, and cancelled timers never fire
+ * @tc.type: FUNC
+ */
+HWTEST_F(MDnsProtocolTest, MDnsTimerWheelTest001, TestSize.Level1)
+{
+    constexpr int64_t start = 1000000;
+    MDnsTimerWheel wheel;
+    wheel.Reset(start);
+    std::vector<int> fired;
+    wheel.Schedule(start + 250, [&fired]() { fired.push_back(1); });
+    MDnsTimerWheel::TimerId cancelled = wheel.Schedule(start + 300, [&fired]() { fired.push_back(2); });
+    // Far enough to sit in the last level, then cascade down twice
+    wheel.Schedule(start + 500000, [&fired]() { fired.push_back(3); });
+    EXPECT_EQ(wheel.Size(), 3u);
+    EXPECT_TRUE(wheel.Cancel(cancelled));
+    EXPECT_FALSE(wheel.Cancel(cancelled));
+
+    EXPECT_EQ(wheel.Advance(start + 200), 0u);
+    EXPECT_EQ(wheel.Advance(start + 300), 1u);
+    EXPECT_EQ(wheel.Advance(start + 499999), 0u);
+    EXPECT_EQ(wheel.Advance(start + 500000), 1u);
+    EXPECT_EQ(fired, std::vector<int>({1, 3}));
+    EXPECT_EQ(wheel.Size(), 0u);
+}
+
+/**
+ * @tc.name: MDnsTimerWheelTest002
+ * @tc.desc: NextExpire never reports a time after the earliest timer, including timers beyond the wheel span
+ * @tc.type: FUNC
+ */
+HWTEST_F(MDnsProtocolTest, MDnsTimerWheelTest002, TestSize.Level1)
+{
+    constexpr int64_t start = 1000000;
+    constexpr int64_t day = 86400000;
+    MDnsTimerWheel wheel;
+    wheel.Reset(start);
+    EXPECT_EQ(wheel.NextExpire(), -1);
+    int count = 0;
+    wheel.Schedule(start + day, [&count]() { count++; });
+    EXPECT_LE(wheel.NextExpire(), start + day);
+    wheel.Schedule(start + 7000, [&count]() { count++; });
+    EXPECT_EQ(wheel.NextExpire(), start + 7000);
+
+    EXPECT_EQ(wheel.Advance(wheel.NextExpire()), 1u);
+    while (wheel.Size() > 0) {
+        int64_t next = wheel.NextExpire();
+        ASSERT_GT(next, start + 7000);
+        ASSERT_LE(next, start + day);
+        wheel.Advance(next);
+    }
+    EXPECT_EQ(count, 2);
+    // A timer scheduled in the past fires on the next tick
+    wheel.Schedule(start, [&count]() { count++; });
+    EXPECT_EQ(wheel.Advance(start + day + MDnsTimerWheel::DEFAULT_TICK_MS), 1u);
+    EXPECT_EQ(count, 3);
+}
+
+/**
+ * @tc.name: MDnsTimerWheelTest003
+ * @tc.desc: Cancel removes exactly the given timer from its slot, also after cascading and from a callback
+ * @tc.type: FUNC
+ */
+HWTEST_F(MDnsProtocolTest, MDnsTimerWheelTest003, TestSize.Level1)
+{
+    constexpr int64_t start = 1000000;
+    MDnsTimerWheel wheel;
+    wheel.Reset(start);
+    std::vector<int> fired;
+    MDnsTimerWheel::TimerId first = wheel.Schedule(start + 500, [&fired]() { fired.push_back(1); });
+    wheel.Schedule(start + 500, [&fired]() { fired.push_back(2); });
+    MDnsTimerWheel::TimerId last = wheel.Schedule(start + 500, [&fired]() { fired.push_back(3); });
+    // The last timer of the slot moves into the place of the first one
+    EXPECT_TRUE(wheel.Cancel(first));
+    EXPECT_TRUE(wheel.Cancel(last));
+    EXPECT_EQ(wheel.Size(), 1u);
+
+    MDnsTimerWheel::TimerId victim = MDnsTimerWheel::INVALID_TIMER;
+    bool cancelled = false;
+    wheel.Schedule(start + 500000, [&]() { cancelled = wheel.Cancel(victim); fired.push_back(4); });
+    victim = wheel.Schedule(start + 500000, [&fired]() { fired.push_back(5); });
+    MDnsTimerWheel::TimerId cascaded = wheel.Schedule(start + 400000, [&fired]() { fired.push_back(6); });
+    EXPECT_EQ(wheel.Advance(start + 300000), 1u);
+    EXPECT_TRUE(wheel.Cancel(cascaded));
+    EXPECT_EQ(wheel.Advance(start + 500000), 1u);
+    EXPECT_TRUE(cancelled);
+    EXPECT_EQ(fired, std::vector<int>({2, 4}));
+    EXPECT_EQ(wheel.Size(), 0u);
+    EXPECT_EQ(wheel.NextExpire(), -1);
+}
+/**
+ * @tc.name: MDnsSuffixMapTest001
+ * @tc.desc: Entries are found by every label aligned suffix of their name and leave the index when erased
+ * @tc.type: FUNC
+ */
+HWTEST_F(MDnsProtocolTest, MDnsSuffixMapTest001, TestSize.Level1)
+{
+    MDnsSuffixMap<int> map;
+    map.emplace("a._x._tcp.local", 1);
+    map["b._x._tcp.local"] = 2;
+    map.emplace("c.b_x._tcp.local", 3);
+    EXPECT_FALSE(map.emplace("a._x._tcp.local", 4).second);
+    EXPECT_EQ(map.size(), 3u);
+
+    const auto *matches = map.FindSuffix("_x._tcp.local");
+    ASSERT_NE(matches, nullptr);
+    ASSERT_EQ(matches->size(), 2u);
+    EXPECT_EQ(matches->begin()->first, "a._x._tcp.local");
+    EXPECT_EQ(matches->begin()->second->second, 1);
+    EXPECT_EQ(map.FindSuffix("_tcp.local")->size(), 3u);
+    EXPECT_EQ(map.FindSuffix("b._x._tcp.local")->size(), 1u);
+    EXPECT_EQ(map.FindSuffix("x._tcp.local"), nullptr);
+
+    EXPECT_EQ(map.erase("a._x._tcp.local"), 1u);
+    EXPECT_EQ(map.erase("a._x._tcp.local"), 0u);
+    EXPECT_EQ(map.FindSuffix("_x._tcp.local")->size(), 1u);
+    EXPECT_EQ(map.FindSuffix("a._x._tcp.local"), nullptr);
+    map.clear();
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(map.FindSuffix("local"), nullptr);
+}
 } // namespace NetManagerStandard
 } // namespace OHOS
\ No newline at end of file
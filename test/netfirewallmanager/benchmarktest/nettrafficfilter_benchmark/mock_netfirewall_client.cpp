@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mock_netfirewall_client.h"
+#include "netfirewall_client.h"
+
+namespace OHOS {
+namespace NetManagerStandard {
+namespace {
+constexpr int32_t MOCK_NFQ_ACCEPT = 1;
+constexpr int32_t MOCK_NOT_SUPPORTED = -1;
+}
+
+MockNetFirewallClientCounters &GetMockNetFirewallClientCounters()
+{
+    static MockNetFirewallClientCounters counters;
+    return counters;
+}
+
+NetFirewallClient &NetFirewallClient::GetInstance()
+{
+    static NetFirewallClient instance;
+    return instance;
+}
+
+int32_t NetFirewallClient::SendVerdict(int32_t queueNum, uint32_t packetId, int32_t verdict, int32_t mark)
+{
+    MockNetFirewallClientCounters &counters = GetMockNetFirewallClientCounters();
+    counters.sendVerdict++;
+    if (verdict == MOCK_NFQ_ACCEPT) {
+        counters.acceptVerdicts++;
+    } else {
+        counters.dropVerdicts++;
+    }
+    return 0;
+}
+
+int32_t NetFirewallClient::CreateRedirector(uint32_t groupId, uint32_t priority, std::string &redirectorId)
+{
+    return MOCK_NOT_SUPPORTED;
+}
+
+int32_t NetFirewallClient::DestroyRedirector(const std::string &redirectorId)
+{
+    return MOCK_NOT_SUPPORTED;
+}
+
+int32_t NetFirewallClient::AddRedirectRule(const std::string &redirectorId,
+    const sptr<TrafficFilterRedirectRule> &rule)
+{
+    return MOCK_NOT_SUPPORTED;
+}
+
+int32_t NetFirewallClient::ClearRedirectRule(const std::string &redirectorId)
+{
+    return MOCK_NOT_SUPPORTED;
+}
+
+int32_t NetFirewallClient::QueryProcess(const std::string &srcIp, uint16_t srcPort, const std::string &dstIp,
+    uint16_t dstPort, uint8_t protocol, uint32_t &uid, uint32_t &pid)
+{
+    return MOCK_NOT_SUPPORTED;
+}
+
+int32_t NetFirewallClient::QueryProcesses(const std::vector<TrafficFilterConnectionTuple> &connections,
+    std::vector<TrafficFilterProcessOwner> &owners)
+{
+    return MOCK_NOT_SUPPORTED;
+}
+
+int32_t NetFirewallClient::CreatePacketController(uint32_t groupId, uint32_t priority,
+    const sptr<TrafficFilterConfig> &config, std::string &packetControllerId, int32_t &fd)
+{
+    return MOCK_NOT_SUPPORTED;
+}
+
+int32_t NetFirewallClient::DestroyPacketController(const std::string &packetControllerId)
+{
+    return MOCK_NOT_SUPPORTED;
+}
+
+int32_t NetFirewallClient::GetPacketControllerFanoutFds(const std::string &packetControllerId,
+    std::vector<int32_t> &fds)
+{
+    return MOCK_NOT_SUPPORTED;
+}
+
+int32_t NetFirewallClient::GetPacketControllerFlowMark(const std::string &packetControllerId, uint32_t &flowMark)
+{
+    return MOCK_NOT_SUPPORTED;
+}
+
+int32_t NetFirewallClient::AddPacketRule(const std::string &controllerId, const sptr<TrafficFilterPacketRule> &rule)
+{
+    return MOCK_NOT_SUPPORTED;
+}
+
+int32_t NetFirewallClient::ClearPacketRule(const std::string &controllerId)
+{
+    return MOCK_NOT_SUPPORTED;
+}
+} // namespace NetManagerStandard
+} // namespace OHOS
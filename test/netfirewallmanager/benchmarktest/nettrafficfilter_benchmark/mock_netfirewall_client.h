@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MOCK_NETFIREWALL_CLIENT_H
+#define MOCK_NETFIREWALL_CLIENT_H
+
+#include <cstdint>
+
+namespace OHOS {
+namespace NetManagerStandard {
+// Calls the mocked NetFirewallClient received, the mock never leaves the process
+struct MockNetFirewallClientCounters {
+    uint64_t sendVerdict = 0;
+    uint64_t acceptVerdicts = 0;
+    uint64_t dropVerdicts = 0;
+};
+
+MockNetFirewallClientCounters &GetMockNetFirewallClientCounters();
+} // namespace NetManagerStandard
+} // namespace OHOS
+#endif // MOCK_NETFIREWALL_CLIENT_H
@@ -0,0 +1,333 @@
+/*
+ * Copyright (C) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Replays a fixed corpus of synthetic NFQUEUE packet messages through the per-packet path of the packet controller
+ * worker: attribute parsing, header extraction, payload parsing, the callback and the verdict. Verdicts go to the
+ * mocked NetFirewallClient::SendVerdict, so nothing leaves the process and the run is the same on every host.
+ *
+ * Usage: nettrafficfilter_packet_path_benchmark [--passes=N] [--max-allocs-per-packet=X]
+ * The process exits with 1 when a copy mode allocates more than X times per packet.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include <linux/if_ether.h>
+
+// the per-packet path is file local, the benchmark is built from the same translation unit
+#include "net_trafficfilter_adapter.cpp"
+#include "mock_netfirewall_client.h"
+
+static std::atomic<uint64_t> g_allocCount {0};
+
+void *operator new(size_t size)
+{
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    void *ptr = malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size == 0 ? 1 : size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+namespace {
+using namespace OHOS::NetManagerStandard;
+
+constexpr uint32_t CORPUS_SEED = 0x5eed;
+constexpr uint32_t CORPUS_PACKETS = 4096;
+constexpr uint32_t DEFAULT_PASSES = 200;
+constexpr uint32_t RECV_BURST = 16;
+constexpr uint32_t TRUNCATED_COPY_LEN = 128;
+constexpr uint32_t V4_PERCENT = 60;
+constexpr uint32_t TCP_PERCENT = 70;
+constexpr uint32_t PERCENT = 100;
+constexpr uint32_t MAX_APP_DATA = 1400;
+constexpr uint8_t IP_VERSION_SHIFT = 4;
+constexpr uint8_t IPV4_IHL_UNIT = 4;
+constexpr uint8_t IPV4_MAX_IHL = 8;
+constexpr uint8_t TCP_MIN_DATA_OFFSET = 5;
+constexpr uint8_t TCP_MAX_DATA_OFFSET = 15;
+constexpr uint8_t TCP_FLAGS_ACK_PSH = 0x18;
+constexpr uint8_t DEFAULT_TTL = 64;
+constexpr uint8_t IPV4_TTL_OFFSET = 8;
+constexpr uint8_t IPV4_TOTAL_LEN_OFFSET = 2;
+constexpr uint8_t IPV6_PAYLOAD_LEN_OFFSET = 4;
+constexpr uint8_t IPV6_HOP_LIMIT_OFFSET = 7;
+constexpr uint8_t TCP_DATA_OFFSET_BYTE = 12;
+constexpr uint8_t UDP_LEN_OFFSET = 4;
+constexpr uint32_t LOCAL_IFINDEX = 3;
+constexpr double NS_PER_SEC = 1e9;
+
+struct CopyModeCase {
+    const char *name;
+    uint32_t copyMode;
+    bool hasPayload;
+    uint32_t copyLen;
+};
+
+constexpr CopyModeCase COPY_MODE_CASES[] = {
+    {"META", OH_TRAFFICFILTER_COPY_MODE_META, false, 0},
+    {"HEADER", OH_TRAFFICFILTER_COPY_MODE_HEADER, true, TRUNCATED_COPY_LEN},
+    {"FULL", OH_TRAFFICFILTER_COPY_MODE_FULL, true, 0},
+    {"MAXLEN", OH_TRAFFICFILTER_COPY_MODE_MAXLEN, true, TRUNCATED_COPY_LEN},
+};
+
+void PutU16(std::vector<uint8_t> &buf, size_t offset, uint16_t value)
+{
+    buf[offset] = static_cast<uint8_t>(value >> PORT_BYTE_SHIFT);
+    buf[offset + 1] = static_cast<uint8_t>(value);
+}
+
+// IPv4 with 0 to 12 bytes of options or IPv6, carrying TCP with 0 to 40 bytes of options or UDP
+std::vector<uint8_t> BuildIpPacket(std::mt19937 &rng)
+{
+    bool isV4 = rng() % PERCENT < V4_PERCENT;
+    bool isTcp = rng() % PERCENT < TCP_PERCENT;
+    uint16_t ipHeaderLen = isV4 ? static_cast<uint16_t>((IPV4_HEADER_MIN_LEN / IPV4_IHL_UNIT +
+        rng() % (IPV4_MAX_IHL - IPV4_HEADER_MIN_LEN / IPV4_IHL_UNIT + 1)) * IPV4_IHL_UNIT) : IPV6_HEADER_LEN;
+    uint8_t tcpDataOffset = static_cast<uint8_t>(TCP_MIN_DATA_OFFSET +
+        rng() % (TCP_MAX_DATA_OFFSET - TCP_MIN_DATA_OFFSET + 1));
+    uint16_t transportLen = isTcp ? static_cast<uint16_t>(tcpDataOffset * TCP_DATA_OFFSET_UNIT) : UDP_HEADER_LEN;
+    uint16_t dataLen = static_cast<uint16_t>(rng() % (MAX_APP_DATA + 1));
+    std::vector<uint8_t> packet(ipHeaderLen + transportLen + dataLen);
+    uint8_t protocol = isTcp ? OH_TRAFFICFILTER_PROTO_TCP : OH_TRAFFICFILTER_PROTO_UDP;
+    if (isV4) {
+        packet[0] = static_cast<uint8_t>((IP_VERSION_V4 << IP_VERSION_SHIFT) | (ipHeaderLen / IPV4_IHL_UNIT));
+        PutU16(packet, IPV4_TOTAL_LEN_OFFSET, static_cast<uint16_t>(packet.size()));
+        packet[IPV4_TTL_OFFSET] = DEFAULT_TTL;
+        packet[IPV4_PROTOCOL_OFFSET] = protocol;
+        for (uint8_t i = 0; i < IPV4_ADDR_LEN; i++) {
+            packet[IPV4_SRC_IP_OFFSET + i] = static_cast<uint8_t>(rng());
+            packet[IPV4_DST_IP_OFFSET + i] = static_cast<uint8_t>(rng());
+        }
+    } else {
+        packet[0] = static_cast<uint8_t>(IP_VERSION_V6 << IP_VERSION_SHIFT);
+        PutU16(packet, IPV6_PAYLOAD_LEN_OFFSET, static_cast<uint16_t>(packet.size() - IPV6_HEADER_LEN));
+        packet[IPV6_PROTOCOL_OFFSET] = protocol;
+        packet[IPV6_HOP_LIMIT_OFFSET] = DEFAULT_TTL;
+        for (uint8_t i = 0; i < IPV6_ADDR_LEN; i++) {
+            packet[IPV6_SRC_IP_OFFSET + i] = static_cast<uint8_t>(rng());
+            packet[IPV6_DST_IP_OFFSET + i] = static_cast<uint8_t>(rng());
+        }
+    }
+    PutU16(packet, ipHeaderLen + TRANSPORT_SRC_PORT_OFFSET, static_cast<uint16_t>(rng()));
+    PutU16(packet, ipHeaderLen + TRANSPORT_DST_PORT_OFFSET, static_cast<uint16_t>(rng()));
+    if (isTcp) {
+        packet[ipHeaderLen + TCP_DATA_OFFSET_BYTE] = static_cast<uint8_t>(tcpDataOffset << TCP_DATA_OFFSET_SHIFT);
+        packet[ipHeaderLen + TCP_FLAGS_OFFSET] = TCP_FLAGS_ACK_PSH;
+    } else {
+        PutU16(packet, ipHeaderLen + UDP_LEN_OFFSET, static_cast<uint16_t>(transportLen + dataLen));
+    }
+    return packet;
+}
+
+void AppendAttr(std::vector<uint8_t> &msg, uint16_t type, const void *data, size_t len)
+{
+    size_t offset = msg.size();
+    msg.resize(offset + NLA_ALIGN(NLA_HDRLEN + len));
+    struct nlattr attr = {};
+    attr.nla_type = type;
+    attr.nla_len = static_cast<uint16_t>(NLA_HDRLEN + len);
+    memcpy_s(msg.data() + offset, sizeof(attr), &attr, sizeof(attr));
+    if (len > 0) {
+        memcpy_s(msg.data() + offset + NLA_HDRLEN, len, data, len);
+    }
+}
+
+// One NFQNL_MSG_PACKET netlink message laid out the way the kernel queues it
+std::vector<uint8_t> BuildPacketMessage(uint32_t packetId, const std::vector<uint8_t> &packet,
+    const CopyModeCase &mode)
+{
+    std::vector<uint8_t> msg(NLMSG_LENGTH(sizeof(struct NfqNfg)));
+    struct NfqNfg nfg = {AF_UNSPEC, 0, 0};
+    memcpy_s(msg.data() + NLMSG_HDRLEN, sizeof(nfg), &nfg, sizeof(nfg));
+    struct NfqPhdr phdr = {};
+    phdr.packetId = htonl(packetId);
+    phdr.hwProtocol = htons((packet[0] >> IP_VERSION_SHIFT) == IP_VERSION_V4 ? ETH_P_IP : ETH_P_IPV6);
+    phdr.hook = NFQ_HOOK_LOCAL_IN;
+    AppendAttr(msg, NFQA_PACKET_HDR, &phdr, sizeof(phdr));
+    uint32_t indev = htonl(LOCAL_IFINDEX);
+    AppendAttr(msg, NFQA_IFINDEX_INDEV, &indev, sizeof(indev));
+    struct NfqHwaddr hw = {};
+    hw.hwAddrlen = htons(HWADDR_ETHER_LEN);
+    AppendAttr(msg, NFQA_HWADDR, &hw, sizeof(hw));
+    if (mode.hasPayload) {
+        size_t copyLen = (mode.copyLen == 0 || mode.copyLen > packet.size()) ? packet.size() : mode.copyLen;
+        AppendAttr(msg, NFQA_PAYLOAD, packet.data(), copyLen);
+    }
+    struct nlmsghdr nlh = {};
+    nlh.nlmsg_len = static_cast<uint32_t>(msg.size());
+    nlh.nlmsg_type = static_cast<uint16_t>(NfqNlType(NFNL_SUBSYS_QUEUE, NFQ_MSG_PACKET));
+    memcpy_s(msg.data(), sizeof(nlh), &nlh, sizeof(nlh));
+    return msg;
+}
+
+// Decides on fields of the descriptor so the parse results feed the verdicts
+OH_TrafficFilter_PacketDecision BenchmarkCallback(const OH_TrafficFilter_PacketDesc *packet, void *userData)
+{
+    uint64_t &checksum = *static_cast<uint64_t *>(userData);
+    checksum += packet->packetLen + packet->srcPort + packet->dstPort + packet->protocol + packet->srcIp.addr[0];
+    return (packet->dstPort & 1) ? OH_TRAFFICFILTER_DECISION_DROP : OH_TRAFFICFILTER_DECISION_ACCEPT;
+}
+
+struct ModeResult {
+    uint64_t packets = 0;
+    uint64_t elapsedNs = 0;
+    uint64_t allocs = 0;
+    uint64_t verdicts = 0;
+    uint64_t checksum = 0;
+};
+
+ModeResult RunMode(const CopyModeCase &mode, uint32_t passes)
+{
+    std::mt19937 rng(CORPUS_SEED);
+    std::vector<std::vector<uint8_t>> corpus;
+    corpus.reserve(CORPUS_PACKETS);
+    for (uint32_t i = 0; i < CORPUS_PACKETS; i++) {
+        corpus.push_back(BuildPacketMessage(i + 1, BuildIpPacket(rng), mode));
+    }
+    // the kernel hands every message over in its own 4-byte aligned receive buffer
+    std::vector<std::vector<uint32_t>> buffers;
+    buffers.reserve(corpus.size());
+    for (const auto &msg : corpus) {
+        std::vector<uint32_t> buffer((msg.size() + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+        memcpy_s(buffer.data(), buffer.size() * sizeof(uint32_t), msg.data(), msg.size());
+        buffers.push_back(std::move(buffer));
+    }
+
+    ModeResult result;
+    NfqWorkerStats stats;
+    OH_TrafficFilter_PacketController controller;
+    controller.fd = -1;
+    controller.callback = BenchmarkCallback;
+    controller.userData = &result.checksum;
+    controller.packetCopyMode = mode.copyMode;
+    controller.nfqueueFlags = 0;
+    controller.directVerdictRetry = std::chrono::steady_clock::time_point::max();
+    controller.stats = &stats;
+    PacketControllerAdapterManager &manager = PacketControllerAdapterManager::GetInstance();
+
+    uint64_t allocsBefore = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t pass = 0; pass <= passes; pass++) {
+        // pass 0 warms the caches and is not measured
+        if (pass == 1) {
+            GetMockNetFirewallClientCounters() = MockNetFirewallClientCounters();
+            result.checksum = 0;
+            allocsBefore = g_allocCount.load(std::memory_order_relaxed);
+            start = std::chrono::steady_clock::now();
+        }
+        for (size_t i = 0; i < buffers.size(); i++) {
+            ProcessNetlinkBuffer(&controller, reinterpret_cast<char *>(buffers[i].data()),
+                static_cast<ssize_t>(corpus[i].size()));
+            if ((i + 1) % RECV_BURST == 0) {
+                manager.FlushVerdicts(&controller);
+            }
+        }
+        manager.FlushVerdicts(&controller);
+    }
+    result.elapsedNs = TrafficFilterLatencyHistogram::ElapsedNs(start);
+    result.allocs = g_allocCount.load(std::memory_order_relaxed) - allocsBefore;
+    result.packets = static_cast<uint64_t>(passes) * corpus.size();
+    result.verdicts = GetMockNetFirewallClientCounters().sendVerdict;
+    return result;
+}
+
+bool ParseArgs(int argc, char *argv[], uint32_t &passes, double &maxAllocsPerPacket)
+{
+    const std::string passesFlag = "--passes=";
+    const std::string allocsFlag = "--max-allocs-per-packet=";
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.compare(0, passesFlag.size(), passesFlag) == 0) {
+            passes = static_cast<uint32_t>(strtoul(arg.c_str() + passesFlag.size(), nullptr, 0));
+        } else if (arg.compare(0, allocsFlag.size(), allocsFlag) == 0) {
+            maxAllocsPerPacket = strtod(arg.c_str() + allocsFlag.size(), nullptr);
+        } else {
+            return false;
+        }
+    }
+    return passes > 0;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    uint32_t passes = DEFAULT_PASSES;
+    double maxAllocsPerPacket = -1;
+    if (!ParseArgs(argc, argv, passes, maxAllocsPerPacket)) {
+        printf("usage: %s [--passes=N] [--max-allocs-per-packet=X]\n", argv[0]);
+        return 1;
+    }
+    printf("corpus: %u packets, seed 0x%x, %u passes\n", CORPUS_PACKETS, CORPUS_SEED, passes);
+    printf("%-8s %12s %14s %10s %14s %12s %20s\n", "mode", "packets", "packets/sec", "ns/packet",
+        "allocs/packet", "verdicts", "checksum");
+    int exitCode = 0;
+    for (const auto &mode : COPY_MODE_CASES) {
+        ModeResult result = RunMode(mode, passes);
+        double nsPerPacket = static_cast<double>(result.elapsedNs) / result.packets;
+        double allocsPerPacket = static_cast<double>(result.allocs) / result.packets;
+        printf("%-8s %12" PRIu64 " %14.0f %10.1f %14.3f %12" PRIu64 " %20" PRIu64 "\n", mode.name, result.packets,
+            NS_PER_SEC / nsPerPacket, nsPerPacket, allocsPerPacket, result.verdicts, result.checksum);
+        if (maxAllocsPerPacket >= 0 && allocsPerPacket > maxAllocsPerPacket) {
+            printf("%s: %.3f allocations per packet exceeds %.3f\n", mode.name, allocsPerPacket, maxAllocsPerPacket);
+            exitCode = 1;
+        }
+    }
+    return exitCode;
+}
@@ -13,9 +13,11 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <gtest/gtest.h>
 
+#define private public
 #include "netfirewall_rule_manager.h"
 #include "net_manager_constants.h"
 #include "singleton.h"
@@ -111,6 +113,36 @@ HWTEST_F(NetFirewallRuleManagerTest, UpdateNetFirewallRule002, TestSize.Level1)
     EXPECT_EQ(ret, FIREWALL_SUCCESS);
 }
 
+HWTEST_F(NetFirewallRuleManagerTest, UpdateNetFirewallRule003, TestSize.Level1)
+{
+    sptr<NetFirewallRule> rule = GetNetFirewallRuleSptr(NetFirewallRuleType::RULE_IP);
+    int32_t ruleId = 0;
+    int32_t ret = instance_->AddNetFirewallRule(rule, ruleId);
+    EXPECT_NE(ruleId, 0);
+    rule->ruleId = ruleId;
+    NetFirewallRule oldRule = *rule;
+    rule->ruleName = "UpdateNetFirewallRule003";
+    rule->ruleDescription = "UpdateNetFirewallRule003";
+    // a name or description change leaves the rule netsys gets as it was, the skipped push loses nothing
+    EXPECT_TRUE(instance_->IsSameNativeRule(oldRule, *rule));
+    ret = instance_->UpdateNetFirewallRule(rule);
+    EXPECT_EQ(ret, FIREWALL_SUCCESS);
+    std::vector<NetFirewallRule> rules;
+    instance_->GetEnabledRulesByType(rules, NetFirewallRuleType::RULE_IP);
+    auto it = std::find_if(rules.begin(), rules.end(),
+        [ruleId](const NetFirewallRule &enabled) { return enabled.ruleId == ruleId; });
+    ASSERT_NE(it, rules.end());
+    EXPECT_EQ(it->ruleName, rule->ruleName);
+    EXPECT_TRUE(instance_->IsSameNativeRule(oldRule, *it));
+
+    // anything netsys sees has to be pushed again
+    rule->ruleAction = FirewallRuleAction::RULE_DENY;
+    EXPECT_FALSE(instance_->IsSameNativeRule(oldRule, *rule));
+    ret = instance_->UpdateNetFirewallRule(rule);
+    instance_->DeleteNetFirewallRule(rule->userId, ruleId);
+    EXPECT_EQ(ret, FIREWALL_SUCCESS);
+}
+
 HWTEST_F(NetFirewallRuleManagerTest, DeleteNetFirewallRule001, TestSize.Level1)
 {
     int32_t userId = USER_ID;
@@ -31,6 +31,7 @@
 #define private public
 #define protected public
 
+#include <algorithm>
 #include <string>
 
 #include "i_netfirewall_service.h"
@@ -72,6 +73,8 @@ constexpr uint32_t TEST_PRIORITY = 100;
 constexpr uint16_t RULE_PORT = 8080;
 constexpr uint32_t TEST_COPY_LEN = 65535;
 constexpr uint32_t TEST_NFQUEUE_LEN = 1024;
+constexpr int32_t USER_ID_CACHE = 199;
+constexpr int32_t CACHE_TEST_PAGE_SIZE = 3;
 
 std::vector<NetFirewallIpParam> GetIpList(const std::string &addressStart)
 {
@@ -183,6 +186,79 @@ sptr<NetFirewallRule> GetNetFirewallRuleSptrTypeDns()
 
     return rule;
 }
+
+NetFirewallRule GetCacheTestRule(int32_t userId, const std::string &ruleName)
+{
+    NetFirewallRule rule;
+    rule.userId = userId;
+    rule.ruleName = ruleName;
+    rule.ruleDirection = NetFirewallRuleDirection::RULE_OUT;
+    rule.ruleAction = FirewallRuleAction::RULE_ALLOW;
+    rule.ruleType = NetFirewallRuleType::RULE_IP;
+    rule.isEnabled = true;
+    rule.appUid = APPID_TEST01;
+    rule.remoteIps = GetIpList("192.168.3.");
+    return rule;
+}
+
+std::vector<std::string> QueryCachedRuleNames(int32_t userId, NetFirewallOrderType orderType)
+{
+    std::vector<std::string> names;
+    sptr<RequestParam> param = new (std::nothrow) RequestParam();
+    param->page = 1;
+    param->pageSize = CACHE_TEST_PAGE_SIZE;
+    param->orderType = orderType;
+    for (;; param->page++) {
+        sptr<FirewallRulePage> info = new (std::nothrow) FirewallRulePage();
+        if (NetFirewallDbHelper::GetInstance().QueryFirewallRule(userId, param, info) != FIREWALL_OK ||
+            info->data.empty()) {
+            break;
+        }
+        for (const auto &rule : info->data) {
+            names.push_back(rule.ruleName);
+        }
+    }
+    return names;
+}
+
+std::vector<std::string> QueryDatabaseRuleNames(int32_t userId, NetFirewallOrderType orderType)
+{
+    auto &helper = NetFirewallDbHelper::GetInstance();
+    NativeRdb::RdbPredicates rdbPredicates(FIREWALL_TABLE_NAME);
+    rdbPredicates.EqualTo(NET_FIREWALL_USER_ID, std::to_string(userId));
+    if (orderType == NetFirewallOrderType::ORDER_ASC) {
+        rdbPredicates.OrderByAsc(NET_FIREWALL_RULE_NAME);
+    } else {
+        rdbPredicates.OrderByDesc(NET_FIREWALL_RULE_NAME);
+    }
+    std::vector<std::string> columns;
+    std::vector<NetFirewallRule> rules;
+    {
+        std::lock_guard<std::mutex> guard(helper.databaseMutex_);
+        helper.QueryFirewallRuleRecord(rdbPredicates, columns, rules);
+    }
+    std::vector<std::string> names;
+    for (const auto &rule : rules) {
+        names.push_back(rule.ruleName);
+    }
+    return names;
+}
+
+std::vector<int32_t> GetCachedRuleIds(int32_t userId, const std::string &ruleName)
+{
+    auto &helper = NetFirewallDbHelper::GetInstance();
+    std::vector<int32_t> ruleIds;
+    auto userIt = helper.userRuleNames_.find(userId);
+    if (userIt == helper.userRuleNames_.end()) {
+        return ruleIds;
+    }
+    auto range = userIt->second.equal_range(ruleName);
+    for (auto it = range.first; it != range.second; ++it) {
+        ruleIds.push_back(it->second);
+    }
+    std::sort(ruleIds.begin(), ruleIds.end());
+    return ruleIds;
+}
 }
 
 class NetFirewallServiceTest : public testing::Test {
@@ -263,6 +339,19 @@ HWTEST_F(NetFirewallServiceTest, GetDumpMessage, TestSize.Level1)
     EXPECT_EQ(message.empty(), false);
 }
 
+/**
+ * @tc.name: GetDumpMessage002
+ * @tc.desc: Test NetFirewallServiceTest GetDumpMessage reports the traffic filter counters.
+ * @tc.type: FUNC
+ */
+HWTEST_F(NetFirewallServiceTest, GetDumpMessage002, TestSize.Level1)
+{
+    std::string message;
+    instance_->GetDumpMessage(message);
+    EXPECT_NE(message.find("TrafficFilter: "), std::string::npos);
+    EXPECT_NE(message.find("RelayedVerdicts: count="), std::string::npos);
+}
+
 /**
  * @tc.name: OnAddSystemAbility001
  * @tc.desc: Test NetFirewallServiceTest OnAddSystemAbility.
@@ -1211,6 +1300,36 @@ HWTEST_F(NetFirewallServiceTest, PutRecordCacheWithoutSkip002, TestSize.Level1)
     EXPECT_GE(cacheSize, 0);
 }
 
+/**
+ * @tc.name: InterceptRecordRing001
+ * @tc.desc: Test InterceptRecordRing keeps FIFO order and rejects records when full.
+ * @tc.type: FUNC
+ */
+HWTEST_F(NetFirewallServiceTest, InterceptRecordRing001, TestSize.Level1)
+{
+    auto ring = std::make_unique<InterceptRecordRing>();
+    for (size_t i = 0; i < INTERCEPT_RECORD_RING_SIZE; i++) {
+        sptr<InterceptRecord> record = new (std::nothrow) InterceptRecord();
+        ASSERT_NE(record, nullptr);
+        record->localPort = static_cast<uint16_t>(i);
+        EXPECT_TRUE(ring->Push(record));
+    }
+    EXPECT_EQ(ring->Size(), INTERCEPT_RECORD_RING_SIZE);
+    sptr<InterceptRecord> overflow = new (std::nothrow) InterceptRecord();
+    EXPECT_FALSE(ring->Push(overflow));
+    sptr<InterceptRecord> record = nullptr;
+    ASSERT_TRUE(ring->Pop(record));
+    ASSERT_NE(record, nullptr);
+    EXPECT_EQ(record->localPort, 0);
+    EXPECT_TRUE(ring->Push(overflow));
+    size_t count = 0;
+    while (ring->Pop(record)) {
+        count++;
+    }
+    EXPECT_EQ(count, INTERCEPT_RECORD_RING_SIZE);
+    EXPECT_EQ(ring->Size(), 0U);
+}
+
 /**
  * @tc.name: ShouldSkipNotify001
  * @tc.desc: Test NetFirewallInterceptRecorder ShouldSkipNotify.
@@ -1263,6 +1382,34 @@ HWTEST_F(NetFirewallServiceTest, ShouldSkipNotify001, TestSize.Level1)
     EXPECT_FALSE(skip);
 }
 
+/**
+ * @tc.name: ShouldSkipNotify002
+ * @tc.desc: Test NetFirewallInterceptRecorder ShouldSkipNotify merges interleaved flows.
+ * @tc.type: FUNC
+ */
+HWTEST_F(NetFirewallServiceTest, ShouldSkipNotify002, TestSize.Level1)
+{
+    std::shared_ptr<NetFirewallInterceptRecorder> netFirewallInterceptRecorder =
+        std::make_shared<NetFirewallInterceptRecorder>();
+    ASSERT_NE(netFirewallInterceptRecorder, nullptr);
+    sptr<InterceptRecord> first = new (std::nothrow) InterceptRecord();
+    sptr<InterceptRecord> second = new (std::nothrow) InterceptRecord();
+    ASSERT_NE(first, nullptr);
+    ASSERT_NE(second, nullptr);
+    first->time = 0;
+    first->localIp = "192.168.1.1";
+    first->remoteIp = "192.168.1.2";
+    second->time = 0;
+    second->localIp = "192.168.1.1";
+    second->remoteIp = "192.168.1.3";
+    EXPECT_FALSE(netFirewallInterceptRecorder->ShouldSkipNotify(first));
+    EXPECT_FALSE(netFirewallInterceptRecorder->ShouldSkipNotify(second));
+    EXPECT_TRUE(netFirewallInterceptRecorder->ShouldSkipNotify(first));
+    EXPECT_TRUE(netFirewallInterceptRecorder->ShouldSkipNotify(second));
+    first->time = static_cast<decltype(first->time)>(INTERCEPT_BUFF_INTERVAL_MS);
+    EXPECT_FALSE(netFirewallInterceptRecorder->ShouldSkipNotify(first));
+}
+
 /**
  * @tc.name: ReportInterceptWithoutSkip001
  * @tc.desc: Test NetFirewallServiceTest ReportInterceptWithoutSkip.
@@ -1927,6 +2074,27 @@ HWTEST_F(NetFirewallServiceTest, DestroyPacketController001, TestSize.Level1)
     EXPECT_NE(ret, NETMANAGER_EXT_ERR_INVALID_PARAMETER);
 }
 
+/**
+ * @tc.name: DestroyPacketController002
+ * @tc.desc: Test NetFirewallService rejects packet controller IDs whose queue number does not parse.
+ * @tc.type: FUNC
+ */
+HWTEST_F(NetFirewallServiceTest, DestroyPacketController002, TestSize.Level1)
+{
+    for (const std::string packetControllerId : {":", ":abc", ":23x", ": 23", ":-1", ":65536", ":99999999999"}) {
+        EXPECT_EQ(instance_->DestroyPacketController(packetControllerId), NETMANAGER_EXT_ERR_INVALID_PARAMETER);
+        uint32_t flowMark = 0;
+        EXPECT_EQ(instance_->GetPacketControllerFlowMark(packetControllerId, flowMark),
+            NETMANAGER_EXT_ERR_INVALID_PARAMETER);
+        std::vector<int32_t> fds;
+        EXPECT_EQ(instance_->GetPacketControllerFanoutFds(packetControllerId, fds),
+            NETMANAGER_EXT_ERR_INVALID_PARAMETER);
+    }
+    uint16_t queueNum = 0;
+    EXPECT_EQ(instance_->ParseOwnedQueueNumber(":65535", queueNum), FIREWALL_SUCCESS);
+    EXPECT_EQ(queueNum, 65535);
+}
+
 /**
  * @tc.name: SendVerdict001
  * @tc.desc: Test NetFirewallService SendVerdict with invalid queueNum.
@@ -1956,5 +2124,117 @@ HWTEST_F(NetFirewallServiceTest, SendVerdict002, TestSize.Level1)
     int32_t ret = instance_->SendVerdict(queueNum, packetId, verdict, mark);
     EXPECT_NE(ret, FIREWALL_SUCCESS);
 }
+
+/**
+ * @tc.name: QueryCachedFirewallRule001
+ * @tc.desc: Test NetFirewallDbHelper pages cached rules in the order of ORDER BY ruleName.
+ * @tc.type: FUNC
+ */
+HWTEST_F(NetFirewallServiceTest, QueryCachedFirewallRule001, TestSize.Level1)
+{
+    auto &helper = NetFirewallDbHelper::GetInstance();
+    helper.DeleteFirewallRuleRecordByUserId(USER_ID_CACHE);
+    ASSERT_TRUE(helper.EnsureRuleCache());
+    for (const std::string ruleName : {"b", "B", "a", "ab", "a b", "_", "rule 10", "rule 9"}) {
+        EXPECT_GT(helper.AddFirewallRuleRecord(GetCacheTestRule(USER_ID_CACHE, ruleName)), 0);
+    }
+    for (auto orderType : {NetFirewallOrderType::ORDER_ASC, NetFirewallOrderType::ORDER_DESC}) {
+        std::vector<std::string> names = QueryCachedRuleNames(USER_ID_CACHE, orderType);
+        EXPECT_EQ(names.size(), 8);
+        EXPECT_EQ(names, QueryDatabaseRuleNames(USER_ID_CACHE, orderType));
+    }
+    helper.DeleteFirewallRuleRecordByUserId(USER_ID_CACHE);
+    EXPECT_TRUE(QueryCachedRuleNames(USER_ID_CACHE, NetFirewallOrderType::ORDER_ASC).empty());
+}
+
+/**
+ * @tc.name: QueryCachedFirewallRule002
+ * @tc.desc: Test NetFirewallDbHelper keeps every rule when one user has duplicate rule names.
+ * @tc.type: FUNC
+ */
+HWTEST_F(NetFirewallServiceTest, QueryCachedFirewallRule002, TestSize.Level1)
+{
+    auto &helper = NetFirewallDbHelper::GetInstance();
+    helper.DeleteFirewallRuleRecordByUserId(USER_ID_CACHE);
+    ASSERT_TRUE(helper.EnsureRuleCache());
+    int32_t firstId = helper.AddFirewallRuleRecord(GetCacheTestRule(USER_ID_CACHE, "same"));
+    int32_t secondId = helper.AddFirewallRuleRecord(GetCacheTestRule(USER_ID_CACHE, "same"));
+    ASSERT_GT(firstId, 0);
+    ASSERT_GT(secondId, 0);
+    EXPECT_EQ(GetCachedRuleIds(USER_ID_CACHE, "same"), std::vector<int32_t>({firstId, secondId}));
+    EXPECT_EQ(QueryCachedRuleNames(USER_ID_CACHE, NetFirewallOrderType::ORDER_ASC),
+        std::vector<std::string>({"same", "same"}));
+
+    EXPECT_EQ(helper.DeleteFirewallRuleRecord(USER_ID_CACHE, firstId), FIREWALL_OK);
+    EXPECT_EQ(GetCachedRuleIds(USER_ID_CACHE, "same"), std::vector<int32_t>({secondId}));
+    EXPECT_EQ(helper.ruleCache_.count(firstId), 0);
+    EXPECT_EQ(helper.ruleCache_.count(secondId), 1);
+    helper.DeleteFirewallRuleRecordByUserId(USER_ID_CACHE);
+}
+
+/**
+ * @tc.name: QueryCachedFirewallRule003
+ * @tc.desc: Test NetFirewallDbHelper keeps the rule name index in step with update and delete.
+ * @tc.type: FUNC
+ */
+HWTEST_F(NetFirewallServiceTest, QueryCachedFirewallRule003, TestSize.Level1)
+{
+    auto &helper = NetFirewallDbHelper::GetInstance();
+    helper.DeleteFirewallRuleRecordByUserId(USER_ID_CACHE);
+    ASSERT_TRUE(helper.EnsureRuleCache());
+    NetFirewallRule rule = GetCacheTestRule(USER_ID_CACHE, "before");
+    rule.ruleId = helper.AddFirewallRuleRecord(rule);
+    ASSERT_GT(rule.ruleId, 0);
+
+    rule.ruleName = "after";
+    EXPECT_EQ(helper.UpdateFirewallRuleRecord(rule), FIREWALL_OK);
+    EXPECT_TRUE(GetCachedRuleIds(USER_ID_CACHE, "before").empty());
+    EXPECT_EQ(GetCachedRuleIds(USER_ID_CACHE, "after"), std::vector<int32_t>({rule.ruleId}));
+    EXPECT_EQ(helper.userRuleNames_[USER_ID_CACHE].size(), 1);
+    EXPECT_EQ(helper.ruleCache_[rule.ruleId].ruleName, "after");
+    EXPECT_EQ(QueryCachedRuleNames(USER_ID_CACHE, NetFirewallOrderType::ORDER_ASC),
+        QueryDatabaseRuleNames(USER_ID_CACHE, NetFirewallOrderType::ORDER_ASC));
+
+    EXPECT_EQ(helper.DeleteFirewallRuleRecord(USER_ID_CACHE, rule.ruleId), FIREWALL_OK);
+    EXPECT_EQ(helper.ruleCache_.count(rule.ruleId), 0);
+    EXPECT_EQ(helper.userRuleNames_.count(USER_ID_CACHE), 0);
+}
+
+/**
+ * @tc.name: QueryCachedFirewallRule004
+ * @tc.desc: Test NetFirewallDbHelper drops the rule cache when a database write fails.
+ * @tc.type: FUNC
+ */
+HWTEST_F(NetFirewallServiceTest, QueryCachedFirewallRule004, TestSize.Level1)
+{
+    auto &helper = NetFirewallDbHelper::GetInstance();
+    helper.DeleteFirewallRuleRecordByUserId(USER_ID_CACHE);
+    ASSERT_TRUE(helper.EnsureRuleCache());
+    NetFirewallRule rule = GetCacheTestRule(USER_ID_CACHE, "kept");
+    rule.ruleId = helper.AddFirewallRuleRecord(rule);
+    ASSERT_GT(rule.ruleId, 0);
+
+    auto store = helper.firewallDatabase_->store_;
+    helper.firewallDatabase_->store_ = nullptr;
+    NetFirewallRule renamed = rule;
+    renamed.ruleName = "lost";
+    EXPECT_LT(helper.UpdateFirewallRuleRecord(renamed), FIREWALL_OK);
+    helper.firewallDatabase_->store_ = store;
+    EXPECT_FALSE(helper.ruleCacheLoaded_);
+    EXPECT_TRUE(helper.ruleCache_.empty());
+    EXPECT_TRUE(helper.userRuleNames_.empty());
+    EXPECT_EQ(QueryCachedRuleNames(USER_ID_CACHE, NetFirewallOrderType::ORDER_ASC),
+        std::vector<std::string>({"kept"}));
+
+    helper.firewallDatabase_->store_ = nullptr;
+    EXPECT_NE(helper.DeleteFirewallRuleRecord(USER_ID_CACHE, rule.ruleId), FIREWALL_OK);
+    helper.firewallDatabase_->store_ = store;
+    EXPECT_FALSE(helper.ruleCacheLoaded_);
+    EXPECT_EQ(GetCachedRuleIds(USER_ID_CACHE, "kept"), std::vector<int32_t>());
+    EXPECT_EQ(QueryCachedRuleNames(USER_ID_CACHE, NetFirewallOrderType::ORDER_ASC),
+        std::vector<std::string>({"kept"}));
+    EXPECT_EQ(GetCachedRuleIds(USER_ID_CACHE, "kept"), std::vector<int32_t>({rule.ruleId}));
+    helper.DeleteFirewallRuleRecordByUserId(USER_ID_CACHE);
+}
 } // namespace NetManagerStandard
 } // namespace OHOS
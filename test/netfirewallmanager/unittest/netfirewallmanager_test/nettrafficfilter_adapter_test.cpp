@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <vector>
+#include <gtest/gtest.h>
+#include <linux/if_ether.h>
+
+// the packet path is file local, the test is built from the same translation unit
+#include "net_trafficfilter_adapter.cpp"
+#include "mock_netfirewall_client.h"
+
+namespace OHOS {
+namespace NetManagerStandard {
+namespace {
+using namespace testing::ext;
+
+constexpr uint16_t HTTPS_PORT = 443;
+constexpr uint16_t HTTP_PORT = 80;
+constexpr uint16_t CLIENT_PORT = 50000;
+constexpr uint8_t IPV4_VERSION_IHL = 0x45;
+constexpr uint8_t TCP_DATA_OFFSET_BYTE = 12;
+constexpr uint8_t TCP_DATA_OFFSET_MIN = (TCP_MIN_HEADER_LEN / TCP_DATA_OFFSET_UNIT) << TCP_DATA_OFFSET_SHIFT;
+constexpr uint8_t TCP_FLAG_SYN = 0x02;
+constexpr uint8_t IPV4_TOTAL_LEN_OFFSET = 2;
+constexpr uint32_t LOCAL_IFINDEX = 3;
+constexpr uint32_t VERDICT_DROP = 0;
+
+void PutU16(std::vector<uint8_t> &buf, size_t offset, uint16_t value)
+{
+    buf[offset] = static_cast<uint8_t>(value >> PORT_BYTE_SHIFT);
+    buf[offset + 1] = static_cast<uint8_t>(value);
+}
+
+std::vector<uint8_t> BuildTcpPacket(uint16_t dstPort)
+{
+    std::vector<uint8_t> packet(IPV4_HEADER_MIN_LEN + TCP_MIN_HEADER_LEN);
+    packet[0] = IPV4_VERSION_IHL;
+    PutU16(packet, IPV4_TOTAL_LEN_OFFSET, static_cast<uint16_t>(packet.size()));
+    packet[IPV4_PROTOCOL_OFFSET] = OH_TRAFFICFILTER_PROTO_TCP;
+    const uint8_t src[IPV4_ADDR_LEN] = {192, 168, 1, 10};
+    const uint8_t dst[IPV4_ADDR_LEN] = {192, 168, 1, 1};
+    for (uint8_t i = 0; i < IPV4_ADDR_LEN; i++) {
+        packet[IPV4_SRC_IP_OFFSET + i] = src[i];
+        packet[IPV4_DST_IP_OFFSET + i] = dst[i];
+    }
+    PutU16(packet, IPV4_HEADER_MIN_LEN + TRANSPORT_SRC_PORT_OFFSET, CLIENT_PORT);
+    PutU16(packet, IPV4_HEADER_MIN_LEN + TRANSPORT_DST_PORT_OFFSET, dstPort);
+    packet[IPV4_HEADER_MIN_LEN + TCP_DATA_OFFSET_BYTE] = TCP_DATA_OFFSET_MIN;
+    packet[IPV4_HEADER_MIN_LEN + TCP_FLAGS_OFFSET] = TCP_FLAG_SYN;
+    return packet;
+}
+
+void AppendAttr(std::vector<uint8_t> &msg, uint16_t type, const void *data, size_t len)
+{
+    size_t offset = msg.size();
+    msg.resize(offset + NLA_ALIGN(NLA_HDRLEN + len));
+    struct nlattr attr = {};
+    attr.nla_type = type;
+    attr.nla_len = static_cast<uint16_t>(NLA_HDRLEN + len);
+    memcpy_s(msg.data() + offset, sizeof(attr), &attr, sizeof(attr));
+    memcpy_s(msg.data() + offset + NLA_HDRLEN, len, data, len);
+}
+
+// One NFQNL_MSG_PACKET message queued on the input hook, kept in a 4-byte aligned buffer like the receive buffer
+std::vector<uint32_t> BuildPacketMessage(uint32_t packetId, const std::vector<uint8_t> &packet, size_t &msgLen)
+{
+    std::vector<uint8_t> msg(NLMSG_LENGTH(sizeof(struct NfqNfg)));
+    struct NfqNfg nfg = {AF_UNSPEC, 0, 0};
+    memcpy_s(msg.data() + NLMSG_HDRLEN, sizeof(nfg), &nfg, sizeof(nfg));
+    struct NfqPhdr phdr = {};
+    phdr.packetId = htonl(packetId);
+    phdr.hwProtocol = htons(ETH_P_IP);
+    phdr.hook = NFQ_HOOK_LOCAL_IN;
+    AppendAttr(msg, NFQA_PACKET_HDR, &phdr, sizeof(phdr));
+    uint32_t indev = htonl(LOCAL_IFINDEX);
+    AppendAttr(msg, NFQA_IFINDEX_INDEV, &indev, sizeof(indev));
+    AppendAttr(msg, NFQA_PAYLOAD, packet.data(), packet.size());
+    struct nlmsghdr nlh = {};
+    nlh.nlmsg_len = static_cast<uint32_t>(msg.size());
+    nlh.nlmsg_type = static_cast<uint16_t>(NfqNlType(NFNL_SUBSYS_QUEUE, NFQ_MSG_PACKET));
+    memcpy_s(msg.data(), sizeof(nlh), &nlh, sizeof(nlh));
+    msgLen = msg.size();
+    std::vector<uint32_t> buffer((msg.size() + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+    memcpy_s(buffer.data(), buffer.size() * sizeof(uint32_t), msg.data(), msg.size());
+    return buffer;
+}
+
+// The kernel's answer to a verdict message, an acknowledgement when error is 0
+std::vector<uint32_t> BuildErrorMessage(uint32_t seq, int32_t error, size_t &msgLen)
+{
+    struct {
+        struct nlmsghdr nlh;
+        struct nlmsgerr err;
+    } msg = {};
+    msg.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct nlmsgerr));
+    msg.nlh.nlmsg_type = NLMSG_ERROR;
+    msg.err.error = error;
+    msg.err.msg.nlmsg_seq = seq;
+    msgLen = msg.nlh.nlmsg_len;
+    std::vector<uint32_t> buffer((msgLen + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+    memcpy_s(buffer.data(), buffer.size() * sizeof(uint32_t), &msg, msgLen);
+    return buffer;
+}
+
+// Every packet the callback sees is dropped, packets bypassing it are accepted by the worker
+OH_TrafficFilter_PacketDecision CountingCallback(const OH_TrafficFilter_PacketDesc *packet, void *userData)
+{
+    (*static_cast<uint32_t *>(userData))++;
+    return OH_TRAFFICFILTER_DECISION_DROP;
+}
+
+TrafficFilterPacketRule BuildHttpsInputRule()
+{
+    TrafficFilterPacketRule rule;
+    rule.hookPoint_ = static_cast<int32_t>(TrafficFilterHookPoint::HOOK_INPUT);
+    rule.protocol_ = NETTRAFFICFILTER_PROTO_TCP;
+    rule.srcIp_.type_ = static_cast<int32_t>(TrafficFilterIPMatchType::IP_MATCH_ANY);
+    rule.srcIp_.invert_ = false;
+    rule.dstIp_.type_ = static_cast<int32_t>(TrafficFilterIPMatchType::IP_MATCH_ANY);
+    rule.dstIp_.invert_ = false;
+    rule.srcPort_.type_ = static_cast<int32_t>(TrafficFilterPortMatchType::PORT_MATCH_ANY);
+    rule.srcPort_.invert_ = false;
+    rule.dstPort_.type_ = static_cast<int32_t>(TrafficFilterPortMatchType::PORT_MATCH_SINGLE);
+    rule.dstPort_.invert_ = false;
+    rule.dstPort_.single_ = HTTPS_PORT;
+    for (auto *iface : {&rule.inInterface_, &rule.outInterface_}) {
+        iface->enabled_ = false;
+        iface->invert_ = false;
+        iface->isPrefix_ = false;
+    }
+    return rule;
+}
+} // namespace
+
+class NetTrafficFilterAdapterTest : public testing::Test {
+public:
+    void SetUp() override
+    {
+        GetMockNetFirewallClientCounters() = MockNetFirewallClientCounters();
+        controller_.fd = -1;
+        controller_.callback = CountingCallback;
+        controller_.userData = &delivered_;
+        controller_.packetCopyMode = OH_TRAFFICFILTER_COPY_MODE_FULL;
+        controller_.nfqueueFlags = 0;
+        controller_.directVerdictRetry = std::chrono::steady_clock::time_point::max();
+        controller_.stats = &stats_;
+    }
+
+    void Receive(uint16_t dstPort)
+    {
+        size_t msgLen = 0;
+        std::vector<uint32_t> buffer = BuildPacketMessage(++packetId_, BuildTcpPacket(dstPort), msgLen);
+        ProcessNetlinkBuffer(&controller_, reinterpret_cast<char *>(buffer.data()), static_cast<ssize_t>(msgLen));
+        PacketControllerAdapterManager::GetInstance().FlushVerdicts(&controller_);
+    }
+
+    void Answer(uint32_t seq, int32_t error)
+    {
+        size_t msgLen = 0;
+        std::vector<uint32_t> buffer = BuildErrorMessage(seq, error, msgLen);
+        ProcessNetlinkBuffer(&controller_, reinterpret_cast<char *>(buffer.data()), static_cast<ssize_t>(msgLen));
+    }
+
+    // a verdict message for the ids firstId to lastId that went out on the socket
+    uint32_t SendDirect(uint32_t verdict, uint32_t firstId, uint32_t lastId)
+    {
+        controller_.verdictBatch.queueNum = 0;
+        controller_.verdictBatch.verdict = verdict;
+        return TrackVerdictMsg(&controller_, firstId, lastId);
+    }
+
+    OH_TrafficFilter_PacketController controller_;
+    NfqWorkerStats stats_;
+    uint32_t delivered_ = 0;
+    uint32_t packetId_ = 0;
+};
+
+HWTEST_F(NetTrafficFilterAdapterTest, KernelMatchDeliversWithoutClassifier, TestSize.Level1)
+{
+    Receive(HTTP_PORT);
+    EXPECT_EQ(delivered_, 1);
+    EXPECT_EQ(GetMockNetFirewallClientCounters().dropVerdicts, 1);
+}
+
+HWTEST_F(NetTrafficFilterAdapterTest, UserSpaceMatchFailsClosedWithoutClassifier, TestSize.Level1)
+{
+    controller_.userSpaceMatch = true;
+    Receive(HTTPS_PORT);
+    Receive(HTTP_PORT);
+    EXPECT_EQ(delivered_, 0);
+    EXPECT_EQ(stats_.packetsBypassed.load(), 2);
+    EXPECT_EQ(GetMockNetFirewallClientCounters().acceptVerdicts, 2);
+    EXPECT_EQ(GetMockNetFirewallClientCounters().dropVerdicts, 0);
+}
+
+HWTEST_F(NetTrafficFilterAdapterTest, UserSpaceMatchAcceptsUnmatchedPackets, TestSize.Level1)
+{
+    controller_.userSpaceMatch = true;
+    PacketControllerAdapterManager::GetInstance().PublishClassifier(&controller_,
+        PacketRuleClassifier::Build({BuildHttpsInputRule()}));
+    Receive(HTTP_PORT);
+    Receive(HTTP_PORT);
+    EXPECT_EQ(delivered_, 0);
+    EXPECT_EQ(stats_.packetsBypassed.load(), 2);
+    EXPECT_EQ(stats_.packetsAccepted.load(), 2);
+    EXPECT_EQ(GetMockNetFirewallClientCounters().acceptVerdicts, 2);
+    EXPECT_EQ(GetMockNetFirewallClientCounters().dropVerdicts, 0);
+}
+
+HWTEST_F(NetTrafficFilterAdapterTest, UserSpaceMatchDeliversSelectedPackets, TestSize.Level1)
+{
+    controller_.userSpaceMatch = true;
+    PacketControllerAdapterManager &manager = PacketControllerAdapterManager::GetInstance();
+    manager.PublishClassifier(&controller_, PacketRuleClassifier::Build({BuildHttpsInputRule()}));
+    ASSERT_NE(std::atomic_load(&controller_.classifier), nullptr);
+    Receive(HTTPS_PORT);
+    EXPECT_EQ(delivered_, 1);
+    Receive(HTTP_PORT);
+    EXPECT_EQ(delivered_, 1);
+    EXPECT_EQ(GetMockNetFirewallClientCounters().dropVerdicts, 1);
+    EXPECT_EQ(GetMockNetFirewallClientCounters().acceptVerdicts, 1);
+
+    // a classifier that went away stops the delivery again
+    manager.PublishClassifier(&controller_, nullptr);
+    Receive(HTTPS_PORT);
+    EXPECT_EQ(delivered_, 1);
+}
+
+HWTEST_F(NetTrafficFilterAdapterTest, UpdateUserSpaceRulesPublishesClassifier, TestSize.Level1)
+{
+    controller_.userSpaceMatch = true;
+    PacketControllerAdapterManager &manager = PacketControllerAdapterManager::GetInstance();
+    TrafficFilterPacketRule rule = BuildHttpsInputRule();
+    manager.UpdateUserSpaceRules(&controller_, &rule);
+    Receive(HTTPS_PORT);
+    Receive(HTTP_PORT);
+    EXPECT_EQ(delivered_, 1);
+
+    manager.UpdateUserSpaceRules(&controller_, nullptr);
+    EXPECT_NE(std::atomic_load(&controller_.classifier), nullptr);
+    {
+        std::lock_guard<std::mutex> lock(manager.ruleMutex_);
+        manager.userSpaceRules_.erase(&controller_);
+    }
+}
+
+HWTEST_F(NetTrafficFilterAdapterTest, RejectedBatchVerdictGoesThroughService, TestSize.Level1)
+{
+    controller_.directVerdictRetry = {};
+    uint32_t seq = SendDirect(NFQ_VERDICT_ACCEPT, 5, 8);
+    SendDirect(VERDICT_DROP, 9, 9);
+    Answer(seq, -EINVAL);
+    EXPECT_EQ(GetMockNetFirewallClientCounters().acceptVerdicts, 4);
+    EXPECT_EQ(GetMockNetFirewallClientCounters().dropVerdicts, 0);
+    EXPECT_EQ(stats_.serviceVerdicts.load(), 4);
+    EXPECT_GT(controller_.directVerdictRetry, std::chrono::steady_clock::now());
+
+    // a repeated answer finds nothing left to decide
+    Answer(seq, -EINVAL);
+    EXPECT_EQ(GetMockNetFirewallClientCounters().sendVerdict, 4);
+}
+
+HWTEST_F(NetTrafficFilterAdapterTest, AcknowledgedVerdictIsReleased, TestSize.Level1)
+{
+    controller_.directVerdictRetry = {};
+    uint32_t seq = SendDirect(VERDICT_DROP, 1, 3);
+    Answer(seq, 0);
+    Answer(seq, -EINVAL);
+    EXPECT_EQ(GetMockNetFirewallClientCounters().sendVerdict, 0);
+    EXPECT_EQ(controller_.directVerdictRetry, std::chrono::steady_clock::time_point{});
+}
+
+HWTEST_F(NetTrafficFilterAdapterTest, VerdictForDequeuedPacketsIsNotRetried, TestSize.Level1)
+{
+    uint32_t seq = SendDirect(VERDICT_DROP, 1, 1);
+    Answer(seq, -ENOENT);
+    Answer(seq + 1, -EINVAL);
+    EXPECT_EQ(GetMockNetFirewallClientCounters().sendVerdict, 0);
+    EXPECT_EQ(stats_.serviceVerdicts.load(), 0);
+}
+} // namespace NetManagerStandard
+} // namespace OHOS
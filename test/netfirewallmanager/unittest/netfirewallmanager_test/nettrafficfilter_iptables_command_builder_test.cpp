@@ -1565,5 +1565,245 @@ HWTEST_F(NetTrafficFilterIptablesCommandBuilderTest, ExecuteIptablesCommandInval
     EXPECT_EQ(ret, -1);
 }
 
+HWTEST_F(NetTrafficFilterIptablesCommandBuilderTest, BuildNfqueueTargetSingleQueue, TestSize.Level1)
+{
+    std::string result = NetTrafficFilterIptablesCommandBuilder::BuildNfqueueTarget(5);
+    EXPECT_EQ(result, "NFQUEUE --queue-num 5");
+}
+
+HWTEST_F(NetTrafficFilterIptablesCommandBuilderTest, BuildNfqueueTargetFanout, TestSize.Level1)
+{
+    std::string result = NetTrafficFilterIptablesCommandBuilder::BuildNfqueueTarget(5, 4);
+    EXPECT_EQ(result, "NFQUEUE --queue-balance 5:8 --queue-cpu-fanout");
+}
+
+HWTEST_F(NetTrafficFilterIptablesCommandBuilderTest, BuildPacketFilterCommandFanout, TestSize.Level1)
+{
+    TrafficFilterPacketRule rule;
+    rule.hookPoint_ = static_cast<int32_t>(TrafficFilterHookPoint::HOOK_INPUT);
+    rule.protocol_ = NETTRAFFICFILTER_PROTO_TCP;
+    rule.srcIp_.type_ = static_cast<int32_t>(TrafficFilterIPMatchType::IP_MATCH_ANY);
+    rule.srcPort_.type_ = static_cast<int32_t>(TrafficFilterPortMatchType::PORT_MATCH_ANY);
+    rule.dstIp_.type_ = static_cast<int32_t>(TrafficFilterIPMatchType::IP_MATCH_ANY);
+    rule.dstPort_.type_ = static_cast<int32_t>(TrafficFilterPortMatchType::PORT_MATCH_ANY);
+    rule.inInterface_.enabled_ = false;
+    rule.outInterface_.enabled_ = false;
+
+    std::string result = NetTrafficFilterIptablesCommandBuilder::BuildPacketFilterCommand(rule, "PF_chain", 3, 2);
+    EXPECT_TRUE(result.find("-j NFQUEUE --queue-balance 3:4 --queue-cpu-fanout") != std::string::npos);
+}
+
+HWTEST_F(NetTrafficFilterIptablesCommandBuilderTest, BuildFlowCacheCommands001, TestSize.Level1)
+{
+    auto commands = NetTrafficFilterIptablesCommandBuilder::BuildFlowCacheCommands("PF_chain", 0x01000000);
+    ASSERT_EQ(commands.size(), 2U);
+    EXPECT_EQ(commands[0], "-t filter -A PF_chain -m connmark --mark 0x1000000/0x7f000000 -j ACCEPT");
+    EXPECT_EQ(commands[1], "-t filter -A PF_chain -m connmark --mark 0x41000000/0x7f000000 -j DROP");
+}
+
+HWTEST_F(NetTrafficFilterIptablesCommandBuilderTest, BuildFlowCacheCommandsDisabled, TestSize.Level1)
+{
+    EXPECT_TRUE(NetTrafficFilterIptablesCommandBuilder::BuildFlowCacheCommands("PF_chain", 0).empty());
+    EXPECT_TRUE(NetTrafficFilterIptablesCommandBuilder::BuildFlowCacheCommands("", 0x01000000).empty());
+}
+
+HWTEST_F(NetTrafficFilterIptablesCommandBuilderTest, BuildPacketQueueAllCommand001, TestSize.Level1)
+{
+    EXPECT_EQ(NetTrafficFilterIptablesCommandBuilder::BuildPacketQueueAllCommand("PF_chain", 100),
+        "-t filter -A PF_chain -j NFQUEUE --queue-num 100");
+    EXPECT_EQ(NetTrafficFilterIptablesCommandBuilder::BuildPacketQueueAllCommand("PF_chain", 100, 4),
+        "-t filter -A PF_chain -j NFQUEUE --queue-balance 100:103 --queue-cpu-fanout");
+    EXPECT_TRUE(NetTrafficFilterIptablesCommandBuilder::BuildPacketQueueAllCommand("", 100).empty());
+}
+
+HWTEST_F(NetTrafficFilterIptablesCommandBuilderTest, BuildPacketFilterChainCommandsBothMultiIP, TestSize.Level1)
+{
+    TrafficFilterPacketRule rule;
+    rule.hookPoint_ = static_cast<int32_t>(TrafficFilterHookPoint::HOOK_OUTPUT);
+    rule.protocol_ = NETTRAFFICFILTER_PROTO_TCP;
+    rule.srcIp_.type_ = static_cast<int32_t>(TrafficFilterIPMatchType::IP_MATCH_MULTI);
+    rule.srcIp_.invert_ = false;
+    rule.srcIp_.multi_.ipCount_ = 2;
+    SetupIPv4Address(rule.srcIp_.multi_.ips_[0], "192.168.1.10");
+    SetupIPv4Address(rule.srcIp_.multi_.ips_[1], "192.168.1.20");
+    rule.dstIp_.type_ = static_cast<int32_t>(TrafficFilterIPMatchType::IP_MATCH_MULTI);
+    rule.dstIp_.invert_ = false;
+    rule.dstIp_.multi_.ipCount_ = 3;
+    SetupIPv4Address(rule.dstIp_.multi_.ips_[0], "10.0.0.1");
+    SetupIPv4Address(rule.dstIp_.multi_.ips_[1], "10.0.0.2");
+    SetupIPv4Address(rule.dstIp_.multi_.ips_[2], "10.0.0.3");
+    rule.srcPort_.type_ = static_cast<int32_t>(TrafficFilterPortMatchType::PORT_MATCH_ANY);
+    rule.dstPort_.type_ = static_cast<int32_t>(TrafficFilterPortMatchType::PORT_MATCH_SINGLE);
+    rule.dstPort_.invert_ = false;
+    rule.dstPort_.single_ = 443;
+    rule.inInterface_.enabled_ = false;
+    rule.outInterface_.enabled_ = false;
+
+    auto result = NetTrafficFilterIptablesCommandBuilder::BuildPacketFilterChainCommands(rule, "PF_chain", 1, 5);
+    ASSERT_EQ(result.matchChains.size(), 2);
+    EXPECT_EQ(result.matchChains[0], "PF_chain_1");
+    EXPECT_EQ(result.matchChains[1], "PF_chain_2");
+    ASSERT_EQ(result.commands.size(), 7);
+    EXPECT_EQ(result.commands[0], "-t filter -A PF_chain_2 -p tcp -d 10.0.0.1 -j NFQUEUE --queue-num 5");
+    EXPECT_EQ(result.commands[3], "-t filter -A PF_chain_1 -p tcp -s 192.168.1.10 -j PF_chain_2");
+    EXPECT_EQ(result.commands[5], "-t filter -A PF_chain -p tcp -m tcp --dport 443 -j PF_chain_1");
+    EXPECT_EQ(result.commands[6], "-t filter -A PF_chain -p tcp -m tcp --dport 443 -j RETURN");
+}
+
+HWTEST_F(NetTrafficFilterIptablesCommandBuilderTest, BuildPacketFilterChainCommandsSingleMatch, TestSize.Level1)
+{
+    TrafficFilterPacketRule rule;
+    rule.hookPoint_ = static_cast<int32_t>(TrafficFilterHookPoint::HOOK_INPUT);
+    rule.protocol_ = NETTRAFFICFILTER_PROTO_TCP;
+    rule.srcIp_.type_ = static_cast<int32_t>(TrafficFilterIPMatchType::IP_MATCH_SINGLE);
+    rule.srcIp_.invert_ = false;
+    SetupIPv4Address(rule.srcIp_.single_, "192.168.1.10");
+    rule.dstIp_.type_ = static_cast<int32_t>(TrafficFilterIPMatchType::IP_MATCH_ANY);
+    rule.srcPort_.type_ = static_cast<int32_t>(TrafficFilterPortMatchType::PORT_MATCH_ANY);
+    rule.dstPort_.type_ = static_cast<int32_t>(TrafficFilterPortMatchType::PORT_MATCH_ANY);
+    rule.inInterface_.enabled_ = false;
+    rule.outInterface_.enabled_ = false;
+
+    auto result = NetTrafficFilterIptablesCommandBuilder::BuildPacketFilterChainCommands(rule, "PF_chain", 1, 5);
+    EXPECT_TRUE(result.matchChains.empty());
+    EXPECT_EQ(result.commands, NetTrafficFilterIptablesCommandBuilder::BuildPacketFilterCommands(rule, "PF_chain", 5));
+}
+
+HWTEST_F(NetTrafficFilterIptablesCommandBuilderTest, GenerateMatchChainNameFitsIptables, TestSize.Level1)
+{
+    constexpr size_t maxChainNameLen = 28;
+    EXPECT_EQ(NetTrafficFilterIptablesCommandBuilder::GenerateMatchChainName("TR_10042_GRP_1001_OUT", 1),
+        "TR_10042_GRP_1001_OUT_1");
+
+    std::string longChain = "TR_1020010042_GRP_65535_OUT";
+    std::string first = NetTrafficFilterIptablesCommandBuilder::GenerateMatchChainName(longChain, 1);
+    std::string last = NetTrafficFilterIptablesCommandBuilder::GenerateMatchChainName(longChain, UINT32_MAX);
+    EXPECT_LE(first.size(), maxChainNameLen);
+    EXPECT_LE(last.size(), maxChainNameLen);
+    EXPECT_NE(first, last);
+    EXPECT_EQ(first, NetTrafficFilterIptablesCommandBuilder::GenerateMatchChainName(longChain, 1));
+    EXPECT_EQ(first.compare(0, 3, "TR_"), 0);
+
+    // chains that only differ past the kept prefix still get distinct match chains
+    std::string otherChain = "TR_1020010042_GRP_65535_FWD";
+    EXPECT_NE(first, NetTrafficFilterIptablesCommandBuilder::GenerateMatchChainName(otherChain, 1));
+}
+
+HWTEST_F(NetTrafficFilterIptablesCommandBuilderTest, IptablesTransactionEmpty, TestSize.Level1)
+{
+    NetTrafficFilterIptablesTransaction transaction;
+    transaction.Add("", TrafficFilterIPFamily::IP_FAMILY_V4V6);
+    EXPECT_TRUE(transaction.Empty());
+    EXPECT_EQ(transaction.Commit(), TRAFFICFILTER_OK);
+}
+
+HWTEST_F(NetTrafficFilterIptablesCommandBuilderTest, IptablesTransactionCommitClears, TestSize.Level1)
+{
+    NetTrafficFilterIptablesTransaction transaction;
+    transaction.Add("-t filter -D OUTPUT -j RD_chain", TrafficFilterIPFamily::IP_FAMILY_V4, true);
+    transaction.Add("-t filter -D OUTPUT -j RD_chain", TrafficFilterIPFamily::IP_FAMILY_V6, true);
+    EXPECT_FALSE(transaction.Empty());
+    EXPECT_EQ(transaction.Commit(), TRAFFICFILTER_OK);
+    EXPECT_TRUE(transaction.Empty());
+}
+
+using IptablesCall = std::pair<std::string, TrafficFilterIPFamily>;
+
+NetTrafficFilterIptablesTransaction::Executor RecordingExecutor(std::vector<IptablesCall>& calls,
+    const std::string& failingCommand = "")
+{
+    return [&calls, failingCommand](const std::string& command, TrafficFilterIPFamily family) {
+        calls.emplace_back(command, family);
+        return command == failingCommand ? -1 : TRAFFICFILTER_OK;
+    };
+}
+
+HWTEST_F(NetTrafficFilterIptablesCommandBuilderTest, IptablesTransactionMergesFamilies, TestSize.Level1)
+{
+    std::vector<IptablesCall> calls;
+    NetTrafficFilterIptablesTransaction transaction(RecordingExecutor(calls));
+    transaction.Add("X", TrafficFilterIPFamily::IP_FAMILY_V4V6);
+    transaction.Add("Y", TrafficFilterIPFamily::IP_FAMILY_V4);
+    transaction.Add("Y", TrafficFilterIPFamily::IP_FAMILY_V6);
+    EXPECT_EQ(transaction.Commit(), TRAFFICFILTER_OK);
+    std::vector<IptablesCall> expected = {
+        {"X", TrafficFilterIPFamily::IP_FAMILY_V4V6},
+        {"Y", TrafficFilterIPFamily::IP_FAMILY_V4V6},
+    };
+    EXPECT_EQ(calls, expected);
+}
+
+HWTEST_F(NetTrafficFilterIptablesCommandBuilderTest, IptablesTransactionKeepsFamilyOrder, TestSize.Level1)
+{
+    std::vector<IptablesCall> calls;
+    NetTrafficFilterIptablesTransaction transaction(RecordingExecutor(calls));
+    transaction.Add("X", TrafficFilterIPFamily::IP_FAMILY_V4);
+    transaction.Add("Y", TrafficFilterIPFamily::IP_FAMILY_V4);
+    transaction.Add("Y", TrafficFilterIPFamily::IP_FAMILY_V6);
+    transaction.Add("X", TrafficFilterIPFamily::IP_FAMILY_V6);
+    EXPECT_EQ(transaction.Commit(), TRAFFICFILTER_OK);
+    // X must come before Y for IPv4 and after it for IPv6
+    std::vector<IptablesCall> expected = {
+        {"Y", TrafficFilterIPFamily::IP_FAMILY_V6},
+        {"X", TrafficFilterIPFamily::IP_FAMILY_V4V6},
+        {"Y", TrafficFilterIPFamily::IP_FAMILY_V4},
+    };
+    EXPECT_EQ(calls, expected);
+}
+
+HWTEST_F(NetTrafficFilterIptablesCommandBuilderTest, IptablesTransactionUndoesFailedGroup, TestSize.Level1)
+{
+    std::vector<IptablesCall> calls;
+    NetTrafficFilterIptablesTransaction transaction(RecordingExecutor(calls, "C"));
+    transaction.BeginGroup();
+    transaction.Add("A", TrafficFilterIPFamily::IP_FAMILY_V4V6, false, "undo A");
+    transaction.Add("B", TrafficFilterIPFamily::IP_FAMILY_V4, false, "undo B");
+    transaction.Add("C", TrafficFilterIPFamily::IP_FAMILY_V4V6, false, "undo C");
+    transaction.Add("D", TrafficFilterIPFamily::IP_FAMILY_V4V6, false, "undo D");
+    transaction.BeginGroup();
+    transaction.Add("E", TrafficFilterIPFamily::IP_FAMILY_V6);
+    EXPECT_NE(transaction.Commit(), TRAFFICFILTER_OK);
+    // the failed step and the rest of its group are not undone, the next group still runs
+    std::vector<IptablesCall> expected = {
+        {"A", TrafficFilterIPFamily::IP_FAMILY_V4V6},
+        {"B", TrafficFilterIPFamily::IP_FAMILY_V4},
+        {"C", TrafficFilterIPFamily::IP_FAMILY_V4V6},
+        {"undo B", TrafficFilterIPFamily::IP_FAMILY_V4},
+        {"undo A", TrafficFilterIPFamily::IP_FAMILY_V4V6},
+        {"E", TrafficFilterIPFamily::IP_FAMILY_V6},
+    };
+    EXPECT_EQ(calls, expected);
+    EXPECT_TRUE(transaction.Empty());
+}
+
+HWTEST_F(NetTrafficFilterIptablesCommandBuilderTest, IptablesTransactionIgnoredFailureNotUndone, TestSize.Level1)
+{
+    std::vector<IptablesCall> calls;
+    NetTrafficFilterIptablesTransaction transaction(RecordingExecutor(calls, "C"));
+    transaction.Add("A", TrafficFilterIPFamily::IP_FAMILY_V4, true, "undo A");
+    transaction.Add("B", TrafficFilterIPFamily::IP_FAMILY_V4, false, "undo B");
+    transaction.Add("C", TrafficFilterIPFamily::IP_FAMILY_V4, false, "undo C");
+    EXPECT_NE(transaction.Commit(), TRAFFICFILTER_OK);
+    std::vector<IptablesCall> expected = {
+        {"A", TrafficFilterIPFamily::IP_FAMILY_V4},
+        {"B", TrafficFilterIPFamily::IP_FAMILY_V4},
+        {"C", TrafficFilterIPFamily::IP_FAMILY_V4},
+        {"undo B", TrafficFilterIPFamily::IP_FAMILY_V4},
+        {"undo A", TrafficFilterIPFamily::IP_FAMILY_V4},
+    };
+    EXPECT_EQ(calls, expected);
+
+    calls.clear();
+    NetTrafficFilterIptablesTransaction ignored(RecordingExecutor(calls, "A"));
+    ignored.Add("A", TrafficFilterIPFamily::IP_FAMILY_V4, true, "undo A");
+    ignored.Add("B", TrafficFilterIPFamily::IP_FAMILY_V4, false, "undo B");
+    EXPECT_EQ(ignored.Commit(), TRAFFICFILTER_OK);
+    expected = {
+        {"A", TrafficFilterIPFamily::IP_FAMILY_V4},
+        {"B", TrafficFilterIPFamily::IP_FAMILY_V4},
+    };
+    EXPECT_EQ(calls, expected);
+}
+
 } // namespace NetManagerStandard
 } // namespace OHOS
@@ -103,6 +103,49 @@ HWTEST_F(NFQueueCoreTest, GetQueueInfo, TestSize.Level1)
     EXPECT_EQ(info.groupId, TEST_GROUP_ID);
 }
 
+HWTEST_F(NFQueueCoreTest, GetQueueHandles, TestSize.Level1)
+{
+    EXPECT_EQ(instance_->GetQueueHandles(TEST_QUEUE_NUM), nullptr);
+    EXPECT_EQ(instance_->GetQueueHandles(MAX_QUEUE_NUM), nullptr);
+
+    QueueInfo info;
+    info.queueNum = TEST_QUEUE_NUM;
+    info.nfqHandle = nullptr;
+    info.qh = nullptr;
+    info.fanoutQueues.push_back(FanoutQueue{TEST_QUEUE_NUM + 1, -1, nullptr, nullptr});
+    instance_->PublishQueueInfo(info);
+    EXPECT_EQ(instance_->GetQueueHandles(TEST_QUEUE_NUM), nullptr);
+    EXPECT_EQ(instance_->GetQueueHandles(TEST_QUEUE_NUM + 1), nullptr);
+    instance_->RetractQueueInfo(info);
+    EXPECT_EQ(instance_->GetQueueHandles(TEST_QUEUE_NUM), nullptr);
+
+    OHOS::sptr<NfqCtx> ctx = new (std::nothrow) NfqCtx();
+    OHOS::sptr<NfqQueue> qh = new (std::nothrow) NfqQueue();
+    OHOS::sptr<NfqQueue> fanoutQh = new (std::nothrow) NfqQueue();
+    ASSERT_NE(ctx, nullptr);
+    ASSERT_NE(qh, nullptr);
+    ASSERT_NE(fanoutQh, nullptr);
+    info.nfqHandle = ctx;
+    info.qh = qh;
+    info.fanoutQueues.clear();
+    info.fanoutQueues.push_back(FanoutQueue{TEST_QUEUE_NUM + 1, -1, ctx, fanoutQh});
+    instance_->PublishQueueInfo(info);
+    std::shared_ptr<const QueueHandles> handles = instance_->GetQueueHandles(TEST_QUEUE_NUM);
+    ASSERT_NE(handles, nullptr);
+    EXPECT_EQ(handles->nfqHandle, ctx);
+    EXPECT_EQ(handles->qh, qh);
+    std::shared_ptr<const QueueHandles> fanoutHandles = instance_->GetQueueHandles(TEST_QUEUE_NUM + 1);
+    ASSERT_NE(fanoutHandles, nullptr);
+    EXPECT_EQ(fanoutHandles->qh, fanoutQh);
+    EXPECT_EQ(instance_->GetQueueHandles(TEST_QUEUE_NUM + 2), nullptr);
+
+    instance_->RetractQueueInfo(info);
+    EXPECT_EQ(instance_->GetQueueHandles(TEST_QUEUE_NUM), nullptr);
+    EXPECT_EQ(instance_->GetQueueHandles(TEST_QUEUE_NUM + 1), nullptr);
+    // a lookup taken before the retract keeps its handles alive
+    EXPECT_EQ(handles->qh, qh);
+}
+
 HWTEST_F(NFQueueCoreTest, GetPacketCopyLen, TestSize.Level1)
 {
     OHOS::sptr<TrafficFilterConfig> config = new (std::nothrow) TrafficFilterConfig();
@@ -183,6 +226,24 @@ HWTEST_F(NFQueueCoreTest, DestroyByBundleName, TestSize.Level1)
     EXPECT_EQ(ret, TRAFFICFILTER_ERROR_NOT_FOUND);
 }
 
+HWTEST_F(NFQueueCoreTest, CreateQueueOwnSocket, TestSize.Level1)
+{
+    std::string bundleName = TEST_BUNDLE_NAME;
+    uint16_t queueNum = TEST_QUEUE_NUM;
+    int32_t ret = instance_->CreateQueue(TEST_GROUP_ID, TEST_PRIORITY, queueNum, bundleName, nullptr);
+    EXPECT_EQ(ret, TRAFFICFILTER_OK);
+    ret = instance_->CreateQueue(TEST_GROUP_ID + 1, TEST_PRIORITY, queueNum + 1, bundleName, nullptr);
+    EXPECT_EQ(ret, TRAFFICFILTER_OK);
+    EXPECT_NE(instance_->queues_[queueNum].nfqHandle, instance_->queues_[queueNum + 1].nfqHandle);
+
+    ret = instance_->DestroyQueue(queueNum);
+    EXPECT_EQ(ret, TRAFFICFILTER_OK);
+    ret = instance_->DestroyByBundleName(bundleName);
+    EXPECT_EQ(ret, TRAFFICFILTER_OK);
+    ret = instance_->DestroyByBundleName(bundleName);
+    EXPECT_EQ(ret, TRAFFICFILTER_ERROR_NOT_FOUND);
+}
+
 HWTEST_F(NFQueueCoreTest, Observer, TestSize.Level1)
 {
     std::string bundleName = "";
@@ -15,6 +15,8 @@
 
 #include <gtest/gtest.h>
 #include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 #define private public
 #define protected public
@@ -46,6 +48,42 @@ constexpr int32_t ADDR_BIT1 = 1;
 constexpr int32_t ADDR_BIT2 = 2;
 constexpr int32_t ADDR_BIT3 = 3;
 constexpr uint8_t ADDR1 = 127;
+constexpr const char *LOOPBACK_IP = "127.0.0.1";
+
+int BindLoopbackUdp(uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, LOOPBACK_IP, &addr.sin_addr);
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+uint16_t GetLocalPort(int fd)
+{
+    struct sockaddr_in addr = {};
+    socklen_t len = sizeof(addr);
+    getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &len);
+    return ntohs(addr.sin_port);
+}
+
+UdpNetPortStatesInfo CreateLoopbackUdpInfo(uint16_t port)
+{
+    UdpNetPortStatesInfo udpInfo;
+    udpInfo.udpLocalIp_ = LOOPBACK_IP;
+    udpInfo.udpLocalPort_ = port;
+    udpInfo.udpUid_ = static_cast<uint32_t>(getuid());
+    udpInfo.udpPid_ = static_cast<uint32_t>(getpid());
+    return udpInfo;
+}
 
 TrafficFilterRedirectRule CreateTestRule(uint32_t priority = TEST_PRIORITY)
 {
@@ -717,6 +755,155 @@ HWTEST_F(NetTrafficFilterRedirectManagerTest, MatchUdpConnection002, TestSize.Le
     EXPECT_TRUE(isMatch);
 }
 
+HWTEST_F(NetTrafficFilterRedirectManagerTest, LookupSocketOwner001, TestSize.Level1)
+{
+    NetPortStatesInfo states;
+    TcpNetPortStatesInfo other;
+    other.tcpLocalIp_ = "192.168.1.100";
+    other.tcpLocalPort_ = 40000;
+    other.tcpRemoteIp_ = "93.184.216.34";
+    other.tcpRemotePort_ = 443;
+    other.tcpUid_ = 1001;
+    other.tcpPid_ = 2001;
+    states.tcpNetPortStatesInfo_.push_back(other);
+    TcpNetPortStatesInfo target = other;
+    target.tcpLocalPort_ = 54321;
+    target.tcpUid_ = 1002;
+    target.tcpPid_ = 2002;
+    states.tcpNetPortStatesInfo_.push_back(target);
+    auto table = instance_->BuildSocketOwnerTable(states, std::chrono::steady_clock::now());
+    ASSERT_NE(table, nullptr);
+
+    TrafficFilterConnectionTuple connection;
+    connection.srcIp_ = "93.184.216.34";
+    connection.srcPort_ = 443;
+    connection.dstIp_ = "192.168.1.100";
+    connection.dstPort_ = 54321;
+    connection.protocol_ = NETTRAFFICFILTER_PROTO_TCP;
+    TrafficFilterProcessOwner owner;
+    size_t pos = 0;
+    EXPECT_TRUE(instance_->LookupSocketOwner(*table, connection, owner, pos));
+    EXPECT_EQ(owner.result_, TRAFFICFILTER_OK);
+    EXPECT_EQ(owner.uid_, 1002);
+    EXPECT_EQ(owner.pid_, 2002);
+    EXPECT_EQ(pos, 1);
+
+    connection.dstPort_ = 0;
+    EXPECT_TRUE(instance_->LookupSocketOwner(*table, connection, owner, pos));
+    EXPECT_EQ(owner.uid_, 1001);
+    EXPECT_EQ(pos, 0);
+
+    connection.dstPort_ = 1;
+    EXPECT_FALSE(instance_->LookupSocketOwner(*table, connection, owner, pos));
+    EXPECT_EQ(owner.result_, TRAFFICFILTER_ERROR_NOT_FOUND);
+}
+
+HWTEST_F(NetTrafficFilterRedirectManagerTest, LookupSocketOwner002, TestSize.Level1)
+{
+    NetPortStatesInfo states;
+    UdpNetPortStatesInfo udpInfo;
+    udpInfo.udpLocalIp_ = "2001:db8::1";
+    udpInfo.udpLocalPort_ = 5353;
+    udpInfo.udpUid_ = 1003;
+    udpInfo.udpPid_ = 2003;
+    states.udpNetPortStatesInfo_.push_back(udpInfo);
+    auto table = instance_->BuildSocketOwnerTable(states, std::chrono::steady_clock::now());
+    ASSERT_NE(table, nullptr);
+
+    TrafficFilterConnectionTuple connection;
+    connection.srcIp_ = "2001:db8::1";
+    connection.srcPort_ = 5353;
+    connection.dstIp_ = "ff02::fb";
+    connection.dstPort_ = 5353;
+    connection.protocol_ = NETTRAFFICFILTER_PROTO_UDP;
+    TrafficFilterProcessOwner owner;
+    size_t pos = 0;
+    EXPECT_TRUE(instance_->LookupSocketOwner(*table, connection, owner, pos));
+    EXPECT_EQ(owner.uid_, 1003);
+
+    connection.protocol_ = NETTRAFFICFILTER_PROTO_TCP;
+    EXPECT_FALSE(instance_->LookupSocketOwner(*table, connection, owner, pos));
+}
+
+HWTEST_F(NetTrafficFilterRedirectManagerTest, QueryProcesses001, TestSize.Level1)
+{
+    std::vector<TrafficFilterConnectionTuple> connections;
+    std::vector<TrafficFilterProcessOwner> owners;
+    EXPECT_EQ(instance_->QueryProcesses(connections, owners), TRAFFICFILTER_ERROR_INVALID_PARAM);
+    connections.resize(NETTRAFFICFILTER_MAX_QUERY_PROCESS_COUNT + 1);
+    EXPECT_EQ(instance_->QueryProcesses(connections, owners), TRAFFICFILTER_ERROR_INVALID_PARAM);
+}
+
+HWTEST_F(NetTrafficFilterRedirectManagerTest, IsSocketOwnerCurrent001, TestSize.Level1)
+{
+    int fd = BindLoopbackUdp(0);
+    ASSERT_GE(fd, 0);
+    uint16_t port = GetLocalPort(fd);
+    NetPortStatesInfo states;
+    states.udpNetPortStatesInfo_.push_back(CreateLoopbackUdpInfo(port));
+    auto table = instance_->BuildSocketOwnerTable(states, std::chrono::steady_clock::now());
+    ASSERT_NE(table, nullptr);
+    ASSERT_EQ(table->udpCookies.size(), 1);
+    EXPECT_NE(table->udpCookies[0], 0);
+    EXPECT_TRUE(instance_->IsSocketOwnerCurrent(*table, false, 0));
+
+    // Another socket bound to the same port after the snapshot is not the socket of the entry
+    close(fd);
+    EXPECT_FALSE(instance_->IsSocketOwnerCurrent(*table, false, 0));
+    fd = BindLoopbackUdp(port);
+    ASSERT_GE(fd, 0);
+    EXPECT_FALSE(instance_->IsSocketOwnerCurrent(*table, false, 0));
+    close(fd);
+}
+
+HWTEST_F(NetTrafficFilterRedirectManagerTest, IsSocketOwnerCurrent002, TestSize.Level1)
+{
+    NetPortStatesInfo states;
+    TcpNetPortStatesInfo tcpInfo;
+    tcpInfo.tcpLocalIp_ = "192.168.1.100";
+    tcpInfo.tcpLocalPort_ = 54321;
+    tcpInfo.tcpRemoteIp_ = "93.184.216.34";
+    tcpInfo.tcpRemotePort_ = 443;
+    states.tcpNetPortStatesInfo_.push_back(tcpInfo);
+    auto table = instance_->BuildSocketOwnerTable(states, std::chrono::steady_clock::now());
+    ASSERT_NE(table, nullptr);
+    // An entry sock_diag did not report cannot be checked, its cached hits are always resolved again
+    EXPECT_EQ(table->tcpCookies[0], 0);
+    EXPECT_FALSE(instance_->IsSocketOwnerCurrent(*table, true, 0));
+    EXPECT_FALSE(instance_->IsSocketOwnerCurrent(*table, true, 1));
+}
+
+HWTEST_F(NetTrafficFilterRedirectManagerTest, QueryProcesses002, TestSize.Level1)
+{
+    int fd = BindLoopbackUdp(0);
+    ASSERT_GE(fd, 0);
+    uint16_t port = GetLocalPort(fd);
+    NetPortStatesInfo states;
+    states.udpNetPortStatesInfo_.push_back(CreateLoopbackUdpInfo(port));
+    {
+        std::lock_guard<std::mutex> lock(instance_->socketTableMutex_);
+        instance_->socketTable_ = instance_->BuildSocketOwnerTable(states,
+            std::chrono::steady_clock::now() - std::chrono::milliseconds(100));
+    }
+
+    TrafficFilterConnectionTuple connection;
+    connection.srcIp_ = "127.0.0.1";
+    connection.srcPort_ = port;
+    connection.dstIp_ = "127.0.0.2";
+    connection.dstPort_ = TEST_PROXY_PORT;
+    connection.protocol_ = NETTRAFFICFILTER_PROTO_UDP;
+    std::vector<TrafficFilterProcessOwner> owners;
+    // A cached hit whose socket is still open is served without a new dump
+    EXPECT_EQ(instance_->QueryProcesses({connection}, owners), TRAFFICFILTER_OK);
+    ASSERT_EQ(owners.size(), 1);
+    EXPECT_EQ(owners[0].result_, TRAFFICFILTER_OK);
+    EXPECT_EQ(owners[0].pid_, static_cast<uint32_t>(getpid()));
+    close(fd);
+
+    std::lock_guard<std::mutex> lock(instance_->socketTableMutex_);
+    instance_->socketTable_ = nullptr;
+}
+
 HWTEST_F(NetTrafficFilterRedirectManagerTest, ValidateProxyFamilyConsistency001, TestSize.Level1)
 {
     TrafficFilterRedirectRule rule = CreateTestRule();
@@ -1696,5 +1883,59 @@ HWTEST_F(NetTrafficFilterRedirectManagerTest, DestroyRedirector010, TestSize.Lev
     instance_->DestroyRedirector(redirectorId2);
     instance_->uidToObserverMap_.erase(testUid);
 }
+
+HWTEST_F(NetTrafficFilterRedirectManagerTest, InsertRedirectorOrdered001, TestSize.Level1)
+{
+    // Insertion keeps priority order, equal priorities stay in creation order
+    const std::vector<std::pair<std::string, uint32_t>> entries = {
+        {"test_order_001_a", TEST_PRIORITY + 2}, {"test_order_001_b", TEST_PRIORITY},
+        {"test_order_001_c", TEST_PRIORITY + 1}, {"test_order_001_d", TEST_PRIORITY}};
+    std::vector<std::string> savedList = instance_->redirectorIdList_;
+    instance_->redirectorIdList_.clear();
+    for (const auto& [redirectorId, priority] : entries) {
+        instance_->redirectors_[redirectorId] = std::make_shared<NetTrafficFilterRedirectorContext>(
+            redirectorId, "com.example.order001", TEST_GROUP_ID, priority);
+        instance_->InsertRedirectorOrdered(redirectorId, priority);
+    }
+
+    std::vector<std::string> expected = {"test_order_001_b", "test_order_001_d", "test_order_001_c",
+        "test_order_001_a"};
+    EXPECT_EQ(instance_->redirectorIdList_, expected);
+
+    for (const auto& entry : entries) {
+        instance_->redirectors_.erase(entry.first);
+    }
+    instance_->redirectorIdList_ = savedList;
+}
+
+HWTEST_F(NetTrafficFilterRedirectManagerTest, GetActiveRedirectorsForHookPoint001, TestSize.Level1)
+{
+    // Hook point membership follows rule changes of the redirector
+    std::string redirectorId = "test_active_001";
+    auto redirector = std::make_shared<NetTrafficFilterRedirectorContext>(
+        redirectorId, "com.example.active001", TEST_GROUP_ID, TEST_PRIORITY);
+    instance_->redirectors_[redirectorId] = redirector;
+    instance_->redirectorIdList_.push_back(redirectorId);
+    auto isActive = [&redirectorId](TrafficFilterHookPoint hookPoint, TrafficFilterIPFamily family) {
+        auto active = instance_->GetActiveRedirectorsForHookPoint(hookPoint, family);
+        return std::find(active.begin(), active.end(), redirectorId) != active.end();
+    };
+
+    EXPECT_FALSE(isActive(TrafficFilterHookPoint::HOOK_PREROUTING, TrafficFilterIPFamily::IP_FAMILY_V4));
+    redirector->AddRuleWithPriority(CreateTestRule());
+    EXPECT_TRUE(isActive(TrafficFilterHookPoint::HOOK_PREROUTING, TrafficFilterIPFamily::IP_FAMILY_V4));
+    EXPECT_FALSE(isActive(TrafficFilterHookPoint::HOOK_PREROUTING, TrafficFilterIPFamily::IP_FAMILY_V6));
+    EXPECT_FALSE(isActive(TrafficFilterHookPoint::HOOK_OUTPUT, TrafficFilterIPFamily::IP_FAMILY_V4));
+    redirector->SetPaused(true);
+    EXPECT_FALSE(isActive(TrafficFilterHookPoint::HOOK_PREROUTING, TrafficFilterIPFamily::IP_FAMILY_V4));
+    redirector->SetPaused(false);
+    redirector->ClearRules();
+    EXPECT_FALSE(isActive(TrafficFilterHookPoint::HOOK_PREROUTING, TrafficFilterIPFamily::IP_FAMILY_V4));
+
+    instance_->redirectors_.erase(redirectorId);
+    auto listIt = std::remove(instance_->redirectorIdList_.begin(), instance_->redirectorIdList_.end(),
+        redirectorId);
+    instance_->redirectorIdList_.erase(listIt, instance_->redirectorIdList_.end());
+}
 } // namespace NetManagerStandard
 } // namespace OHOS
@@ -497,5 +497,37 @@ HWTEST_F(NetTrafficFilterRedirectorContextTest, EdgeCase_LargePriority001, TestS
     EXPECT_EQ(sortedRules[1].priority_, 5000);
     EXPECT_EQ(sortedRules[2].priority_, 10000);
 }
+
+HWTEST_F(NetTrafficFilterRedirectorContextTest, RecordIptablesTime001, TestSize.Level1)
+{
+    NetTrafficFilterRedirectorContext context("test_id", "com.test.app", 1001, 100);
+    EXPECT_EQ(context.GetIptablesTimeSummary(), "count=0 avg=0us p50<=0us p99<=0us max=0us");
+
+    for (int i = 0; i < 99; i++) {
+        context.RecordIptablesTime(3000000);
+    }
+    context.RecordIptablesTime(100000000);
+    EXPECT_EQ(context.GetIptablesTimeSummary(), "count=100 avg=3970us p50<=4194us p99<=4194us max=100000us");
+}
+
+HWTEST_F(NetTrafficFilterRedirectorContextTest, LatencyHistogramBuckets001, TestSize.Level1)
+{
+    TrafficFilterLatencyHistogram histogram;
+    histogram.Record(0);
+    histogram.Record(1);
+    histogram.Record(1024);
+    histogram.Record(2047);
+    histogram.Record(UINT64_MAX);
+
+    TrafficFilterLatencyHistogram::Snapshot snapshot = histogram.Read();
+    EXPECT_EQ(snapshot.count, 5);
+    EXPECT_EQ(snapshot.maxNs, UINT64_MAX);
+    EXPECT_EQ(snapshot.buckets[0], 2);
+    EXPECT_EQ(snapshot.buckets[10], 2);
+    EXPECT_EQ(snapshot.buckets[TrafficFilterLatencyHistogram::BUCKET_COUNT - 1], 1);
+    EXPECT_EQ(TrafficFilterLatencyHistogram::PercentileUpperBound(snapshot, 40), 2);
+    EXPECT_EQ(TrafficFilterLatencyHistogram::PercentileUpperBound(snapshot, 80), 2048);
+    EXPECT_EQ(TrafficFilterLatencyHistogram::PercentileUpperBound(snapshot, 100), UINT64_MAX);
+}
 } // namespace NetManagerStandard
 } // namespace OHOS
@@ -115,6 +115,12 @@ public:
         return 0;
     }
 
+    int32_t QueryProcesses(const std::vector<TrafficFilterConnectionTuple>& connections,
+        std::vector<TrafficFilterProcessOwner>& owners) override
+    {
+        return 0;
+    }
+
     int32_t AddPacketRule(const std::string& controllerId, const sptr<TrafficFilterPacketRule>& rule) override
     {
         return 0;
@@ -139,6 +145,17 @@ public:
     {
         return 0;
     }
+
+    int32_t GetPacketControllerFanoutFds(const std::string& packetControllerId,
+        std::vector<int32_t>& fds) override
+    {
+        return 0;
+    }
+
+    int32_t GetPacketControllerFlowMark(const std::string& packetControllerId, uint32_t& flowMark) override
+    {
+        return 0;
+    }
 };
 } // namespace NetManagerStandard
 } // namespace OHOS